@@ -0,0 +1,59 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "box2d/box2d.h"
+
+/// A headless benchmark scene. Scenes build their bodies in the constructor and
+/// may add more in Update, which runs before each world step.
+class Scene
+{
+public:
+	Scene();
+	virtual ~Scene();
+
+	virtual void Update() {}
+
+	b2World* GetWorld() { return m_world; }
+
+protected:
+	b2World* m_world;
+};
+
+typedef Scene* SceneCreateFcn();
+
+int RegisterScene(const char* name, int32 stepCount, SceneCreateFcn* fcn);
+
+struct SceneEntry
+{
+	const char* name;
+	int32 stepCount;
+	SceneCreateFcn* createFcn;
+};
+
+#define MAX_SCENES 32
+extern SceneEntry g_sceneEntries[MAX_SCENES];
+extern int g_sceneCount;
+
+#endif
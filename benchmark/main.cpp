@@ -0,0 +1,388 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "benchmark.h"
+#include "box2d/b2_trace.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+SceneEntry g_sceneEntries[MAX_SCENES];
+int g_sceneCount = 0;
+
+int RegisterScene(const char* name, int32 stepCount, SceneCreateFcn* fcn)
+{
+	int index = g_sceneCount;
+	if (index < MAX_SCENES)
+	{
+		g_sceneEntries[index] = { name, stepCount, fcn };
+		++g_sceneCount;
+		return index;
+	}
+
+	return -1;
+}
+
+Scene::Scene()
+{
+	b2Vec2 gravity(0.0f, -10.0f);
+	m_world = new b2World(gravity);
+}
+
+Scene::~Scene()
+{
+	delete m_world;
+	m_world = nullptr;
+}
+
+// The b2Profile timings that are reported
+struct Phase
+{
+	const char* name;
+	float b2Profile::*field;
+};
+
+static const Phase s_phases[] =
+{
+	{ "step", &b2Profile::step },
+	{ "collide", &b2Profile::collide },
+	{ "solve", &b2Profile::solve },
+	{ "buildIslands", &b2Profile::buildIslands },
+	{ "solveInit", &b2Profile::solveInit },
+	{ "solveVelocity", &b2Profile::solveVelocity },
+	{ "solvePosition", &b2Profile::solvePosition },
+	{ "synchronizeFixtures", &b2Profile::synchronizeFixtures },
+	{ "broadphase", &b2Profile::broadphase },
+	{ "solveTOI", &b2Profile::solveTOI },
+};
+
+static const int32 s_phaseCount = sizeof(s_phases) / sizeof(s_phases[0]);
+
+struct PhaseStats
+{
+	float min;
+	float median;
+	float p99;
+};
+
+struct SceneResult
+{
+	const char* name;
+	int32 stepCount;
+	int32 bodyCount;
+	int32 contactCount;
+	int32 jointCount;
+	float total;
+	PhaseStats phases[s_phaseCount];
+
+	// Forking the final state with CopyTo against building the scene again
+	int32 forkCount;
+	PhaseStats copy;
+	PhaseStats rebuild;
+};
+
+static PhaseStats ComputeStats(std::vector<float>& samples)
+{
+	std::sort(samples.begin(), samples.end());
+
+	int32 count = int32(samples.size());
+	int32 p99 = int32(ceilf(0.99f * count)) - 1;
+
+	PhaseStats stats;
+	stats.min = samples[0];
+	stats.median = samples[count / 2];
+	stats.p99 = samples[b2Clamp(p99, 0, count - 1)];
+	return stats;
+}
+
+static void RunScene(const SceneEntry& entry, int32 stepCount, int32 subStepCount, int32 forkCount, SceneResult* result)
+{
+	Scene* scene = entry.createFcn();
+	b2World* world = scene->GetWorld();
+	world->SetSubStepping(subStepCount > 0);
+
+	std::vector<float> samples[s_phaseCount];
+	for (int32 i = 0; i < s_phaseCount; ++i)
+	{
+		samples[i].reserve(stepCount);
+	}
+
+	const float timeStep = 1.0f / 60.0f;
+	const int32 velocityIterations = subStepCount > 0 ? subStepCount : 8;
+	const int32 positionIterations = 3;
+
+	b2Timer timer;
+	for (int32 step = 0; step < stepCount; ++step)
+	{
+		scene->Update();
+		world->Step(timeStep, velocityIterations, positionIterations);
+
+		const b2Profile& profile = world->GetProfile();
+		for (int32 i = 0; i < s_phaseCount; ++i)
+		{
+			samples[i].push_back(profile.*s_phases[i].field);
+		}
+	}
+
+	result->name = entry.name;
+	result->stepCount = stepCount;
+	result->bodyCount = world->GetBodyCount();
+	result->contactCount = world->GetContactCount();
+	result->jointCount = world->GetJointCount();
+	result->total = timer.GetMilliseconds();
+
+	for (int32 i = 0; i < s_phaseCount; ++i)
+	{
+		result->phases[i] = ComputeStats(samples[i]);
+	}
+
+	// The rebuild runs the scene constructor, which creates the bodies but has no
+	// contacts or warm starting yet. The copy carries the complete state.
+	result->forkCount = forkCount;
+	if (forkCount > 0)
+	{
+		std::vector<float> copySamples;
+		std::vector<float> rebuildSamples;
+		copySamples.reserve(forkCount);
+		rebuildSamples.reserve(forkCount);
+
+		b2World fork(b2Vec2_zero);
+		for (int32 i = 0; i < forkCount; ++i)
+		{
+			b2Timer forkTimer;
+			world->CopyTo(&fork);
+			copySamples.push_back(forkTimer.GetMilliseconds());
+		}
+
+		for (int32 i = 0; i < forkCount; ++i)
+		{
+			b2Timer forkTimer;
+			Scene* rebuild = entry.createFcn();
+			rebuildSamples.push_back(forkTimer.GetMilliseconds());
+			delete rebuild;
+		}
+
+		result->copy = ComputeStats(copySamples);
+		result->rebuild = ComputeStats(rebuildSamples);
+	}
+
+	delete scene;
+}
+
+static void PrintResult(const SceneResult& result)
+{
+	printf("%s: %d steps, %d bodies, %d contacts, %d joints, %.1f ms total\n", result.name,
+		result.stepCount, result.bodyCount, result.contactCount, result.jointCount, result.total);
+	printf("  %-20s %10s %10s %10s\n", "phase [ms]", "min", "median", "p99");
+
+	for (int32 i = 0; i < s_phaseCount; ++i)
+	{
+		const PhaseStats& stats = result.phases[i];
+		printf("  %-20s %10.4f %10.4f %10.4f\n", s_phases[i].name, stats.min, stats.median, stats.p99);
+	}
+
+	if (result.forkCount > 0)
+	{
+		printf("  %-20s %10.4f %10.4f %10.4f\n", "fork copy", result.copy.min, result.copy.median, result.copy.p99);
+		printf("  %-20s %10.4f %10.4f %10.4f\n", "fork rebuild", result.rebuild.min, result.rebuild.median,
+			result.rebuild.p99);
+	}
+
+	printf("\n");
+}
+
+static void WriteJson(FILE* file, const SceneResult* results, int32 resultCount)
+{
+	fprintf(file, "{\n");
+	fprintf(file, "  \"version\": \"%d.%d.%d\",\n", b2_version.major, b2_version.minor, b2_version.revision);
+	fprintf(file, "  \"scenes\": [\n");
+
+	for (int32 i = 0; i < resultCount; ++i)
+	{
+		const SceneResult& result = results[i];
+		fprintf(file, "    {\n");
+		fprintf(file, "      \"name\": \"%s\",\n", result.name);
+		fprintf(file, "      \"steps\": %d,\n", result.stepCount);
+		fprintf(file, "      \"bodies\": %d,\n", result.bodyCount);
+		fprintf(file, "      \"contacts\": %d,\n", result.contactCount);
+		fprintf(file, "      \"joints\": %d,\n", result.jointCount);
+		fprintf(file, "      \"total\": %.4f,\n", result.total);
+		fprintf(file, "      \"phases\": {\n");
+
+		for (int32 j = 0; j < s_phaseCount; ++j)
+		{
+			const PhaseStats& stats = result.phases[j];
+			fprintf(file, "        \"%s\": { \"min\": %.4f, \"median\": %.4f, \"p99\": %.4f }%s\n",
+				s_phases[j].name, stats.min, stats.median, stats.p99, j + 1 < s_phaseCount ? "," : "");
+		}
+
+		fprintf(file, "      }%s\n", result.forkCount > 0 ? "," : "");
+
+		if (result.forkCount > 0)
+		{
+			fprintf(file, "      \"fork\": {\n");
+			fprintf(file, "        \"count\": %d,\n", result.forkCount);
+			fprintf(file, "        \"copy\": { \"min\": %.4f, \"median\": %.4f, \"p99\": %.4f },\n",
+				result.copy.min, result.copy.median, result.copy.p99);
+			fprintf(file, "        \"rebuild\": { \"min\": %.4f, \"median\": %.4f, \"p99\": %.4f }\n",
+				result.rebuild.min, result.rebuild.median, result.rebuild.p99);
+			fprintf(file, "      }\n");
+		}
+		fprintf(file, "    }%s\n", i + 1 < resultCount ? "," : "");
+	}
+
+	fprintf(file, "  ]\n");
+	fprintf(file, "}\n");
+}
+
+static void PrintUsage()
+{
+	printf("usage: box2d_benchmark [options]\n");
+	printf("  --scene <name>  run only the named scene, may be repeated\n");
+	printf("  --steps <n>     override the step count of every scene\n");
+	printf("  --substeps <n>  use the sub-stepping solver with n sub-steps\n");
+	printf("  --fork <n>      time n copies of the final state against n scene rebuilds\n");
+	printf("  --json <file>   write a JSON summary, use - for stdout\n");
+	printf("  --trace <file>  write a Chrome trace of the last steps, needs BOX2D_TRACE\n");
+	printf("  --list          list the scenes and exit\n");
+}
+
+int main(int argc, char** argv)
+{
+	const char* sceneNames[MAX_SCENES];
+	int32 sceneNameCount = 0;
+	int32 stepCount = 0;
+	int32 subStepCount = 0;
+	int32 forkCount = 0;
+	const char* jsonPath = nullptr;
+	const char* tracePath = nullptr;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--scene") == 0 && i + 1 < argc)
+		{
+			if (sceneNameCount < MAX_SCENES)
+			{
+				sceneNames[sceneNameCount++] = argv[++i];
+			}
+		}
+		else if (strcmp(argv[i], "--steps") == 0 && i + 1 < argc)
+		{
+			stepCount = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--substeps") == 0 && i + 1 < argc)
+		{
+			subStepCount = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--fork") == 0 && i + 1 < argc)
+		{
+			forkCount = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+		{
+			jsonPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+		{
+			tracePath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--list") == 0)
+		{
+			for (int32 j = 0; j < g_sceneCount; ++j)
+			{
+				printf("%s (%d steps)\n", g_sceneEntries[j].name, g_sceneEntries[j].stepCount);
+			}
+			return 0;
+		}
+		else
+		{
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	// JSON on stdout must not be mixed with the table
+	bool printTable = jsonPath == nullptr || strcmp(jsonPath, "-") != 0;
+
+	SceneResult results[MAX_SCENES];
+	int32 resultCount = 0;
+
+	for (int32 i = 0; i < g_sceneCount; ++i)
+	{
+		const SceneEntry& entry = g_sceneEntries[i];
+
+		bool selected = sceneNameCount == 0;
+		for (int32 j = 0; j < sceneNameCount; ++j)
+		{
+			selected = selected || strcmp(sceneNames[j], entry.name) == 0;
+		}
+
+		if (selected == false)
+		{
+			continue;
+		}
+
+		SceneResult* result = results + resultCount;
+		RunScene(entry, stepCount > 0 ? stepCount : entry.stepCount, subStepCount, forkCount, result);
+		++resultCount;
+
+		if (printTable)
+		{
+			PrintResult(*result);
+		}
+	}
+
+	if (resultCount == 0)
+	{
+		fprintf(stderr, "no scenes matched\n");
+		return 1;
+	}
+
+	if (tracePath != nullptr && b2TraceWrite(tracePath) == false)
+	{
+		fprintf(stderr, "could not write %s\n", tracePath);
+		return 1;
+	}
+
+	if (jsonPath != nullptr)
+	{
+		FILE* file = printTable ? fopen(jsonPath, "w") : stdout;
+		if (file == nullptr)
+		{
+			fprintf(stderr, "could not open %s\n", jsonPath);
+			return 1;
+		}
+
+		WriteJson(file, results, resultCount);
+
+		if (file != stdout)
+		{
+			fclose(file);
+		}
+	}
+
+	return 0;
+}
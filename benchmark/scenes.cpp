@@ -0,0 +1,461 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "benchmark.h"
+
+// Headless copies of the testbed benchmark scenes. Keep them in sync with
+// testbed/tests so timings can be compared against what the testbed shows.
+
+class Pyramid : public Scene
+{
+public:
+	enum
+	{
+		e_count = 20
+	};
+
+	Pyramid()
+	{
+		{
+			b2BodyDef bd;
+			b2Body* ground = m_world->CreateBody(&bd);
+
+			b2EdgeShape shape;
+			shape.SetTwoSided(b2Vec2(-40.0f, 0.0f), b2Vec2(40.0f, 0.0f));
+			ground->CreateFixture(&shape, 0.0f);
+		}
+
+		{
+			float a = 0.5f;
+			b2PolygonShape shape;
+			shape.SetAsBox(a, a);
+
+			b2Vec2 x(-7.0f, 0.75f);
+			b2Vec2 y;
+			b2Vec2 deltaX(0.5625f, 1.25f);
+			b2Vec2 deltaY(1.125f, 0.0f);
+
+			for (int32 i = 0; i < e_count; ++i)
+			{
+				y = x;
+
+				for (int32 j = i; j < e_count; ++j)
+				{
+					b2BodyDef bd;
+					bd.type = b2_dynamicBody;
+					bd.position = y;
+					b2Body* body = m_world->CreateBody(&bd);
+					body->CreateFixture(&shape, 5.0f);
+
+					y += deltaY;
+				}
+
+				x += deltaX;
+			}
+		}
+	}
+
+	static Scene* Create()
+	{
+		return new Pyramid;
+	}
+};
+
+static int pyramidIndex = RegisterScene("pyramid", 600, Pyramid::Create);
+
+// Create a tumbler centered at the given point. The boxes are fed in by Update.
+static b2Body* CreateTumbler(b2World* world, const b2Vec2& center)
+{
+	b2BodyDef bd;
+	bd.position = center;
+	b2Body* ground = world->CreateBody(&bd);
+
+	bd.type = b2_dynamicBody;
+	bd.allowSleep = false;
+	b2Body* body = world->CreateBody(&bd);
+
+	b2PolygonShape shape;
+	shape.SetAsBox(0.5f, 10.0f, b2Vec2( 10.0f, 0.0f), 0.0);
+	body->CreateFixture(&shape, 5.0f);
+	shape.SetAsBox(0.5f, 10.0f, b2Vec2(-10.0f, 0.0f), 0.0);
+	body->CreateFixture(&shape, 5.0f);
+	shape.SetAsBox(10.0f, 0.5f, b2Vec2(0.0f, 10.0f), 0.0);
+	body->CreateFixture(&shape, 5.0f);
+	shape.SetAsBox(10.0f, 0.5f, b2Vec2(0.0f, -10.0f), 0.0);
+	body->CreateFixture(&shape, 5.0f);
+
+	b2RevoluteJointDef jd;
+	jd.Initialize(ground, body, center);
+	jd.motorSpeed = 0.05f * b2_pi;
+	jd.maxMotorTorque = 1e8f;
+	jd.enableMotor = true;
+	world->CreateJoint(&jd);
+
+	return body;
+}
+
+static void AddTumblerBox(b2World* world, const b2Vec2& center)
+{
+	b2BodyDef bd;
+	bd.type = b2_dynamicBody;
+	bd.position = center;
+	b2Body* body = world->CreateBody(&bd);
+
+	b2PolygonShape shape;
+	shape.SetAsBox(0.125f, 0.125f);
+	body->CreateFixture(&shape, 1.0f);
+}
+
+class Tumbler : public Scene
+{
+public:
+	enum
+	{
+		e_count = 800
+	};
+
+	Tumbler()
+	{
+		CreateTumbler(m_world, b2Vec2(0.0f, 10.0f));
+		m_count = 0;
+	}
+
+	void Update() override
+	{
+		if (m_count < e_count)
+		{
+			AddTumblerBox(m_world, b2Vec2(0.0f, 10.0f));
+			++m_count;
+		}
+	}
+
+	static Scene* Create()
+	{
+		return new Tumbler;
+	}
+
+	int32 m_count;
+};
+
+static int tumblerIndex = RegisterScene("tumbler", 1000, Tumbler::Create);
+
+class ManyTumblers : public Scene
+{
+public:
+	enum
+	{
+		e_rowCount = 4,
+		e_columnCount = 4,
+		e_count = 200
+	};
+
+	ManyTumblers()
+	{
+		for (int32 i = 0; i < e_rowCount; ++i)
+		{
+			for (int32 j = 0; j < e_columnCount; ++j)
+			{
+				b2Vec2 center(25.0f * j, 25.0f * i);
+				CreateTumbler(m_world, center);
+				m_centers[i * e_columnCount + j] = center;
+			}
+		}
+
+		m_count = 0;
+	}
+
+	void Update() override
+	{
+		if (m_count < e_count)
+		{
+			for (int32 i = 0; i < e_rowCount * e_columnCount; ++i)
+			{
+				AddTumblerBox(m_world, m_centers[i]);
+			}
+			++m_count;
+		}
+	}
+
+	static Scene* Create()
+	{
+		return new ManyTumblers;
+	}
+
+	b2Vec2 m_centers[e_rowCount * e_columnCount];
+	int32 m_count;
+};
+
+static int manyTumblersIndex = RegisterScene("many_tumblers", 600, ManyTumblers::Create);
+
+class Boxes : public Scene
+{
+public:
+	Boxes()
+	{
+		float groundSize = 25.0f;
+
+		{
+			b2BodyDef bd;
+			b2Body* ground = m_world->CreateBody(&bd);
+
+			b2PolygonShape box;
+			box.SetAsBox(groundSize, 1.2f);
+			b2FixtureDef sd;
+			sd.shape = &box;
+			ground->CreateFixture(&sd);
+
+			bd.angle = 0.5f * b2_pi;
+			bd.position = { groundSize, 2.0f * groundSize };
+			ground = m_world->CreateBody(&bd);
+
+			box.SetAsBox(2.0f * groundSize, 1.2f);
+			ground->CreateFixture(&sd);
+
+			bd.position = { -groundSize, 2.0f * groundSize };
+			ground = m_world->CreateBody(&bd);
+			ground->CreateFixture(&sd);
+		}
+
+		int32 num = 26;
+		float rad = 0.5f;
+
+		float shift = rad * 2.0f;
+		float centerx = shift * num / 2.0f;
+		float centery = shift / 2.0f;
+
+		b2BodyDef bd;
+		bd.type = b2_dynamicBody;
+
+		b2FixtureDef sd;
+		sd.density = 1.0f;
+		sd.friction = 0.5f;
+
+		b2PolygonShape cuboid;
+		cuboid.SetAsBox(0.5f, 0.5f);
+		sd.shape = &cuboid;
+
+		int32 numj = 5 * num;
+
+		for (int32 i = 0; i < num; ++i)
+		{
+			float x = i * shift - centerx;
+
+			for (int32 j = 0; j < numj; ++j)
+			{
+				float y = j * shift + centery + 2.0f;
+
+				bd.position = { x, y };
+
+				b2Body* rigidBody = m_world->CreateBody(&bd);
+				rigidBody->CreateFixture(&sd);
+			}
+		}
+	}
+
+	static Scene* Create()
+	{
+		return new Boxes;
+	}
+};
+
+static int boxesIndex = RegisterScene("benchmark_boxes", 300, Boxes::Create);
+
+class VerticalStacks : public Scene
+{
+public:
+	enum
+	{
+		e_columnCount = 5,
+		e_rowCount = 15
+	};
+
+	VerticalStacks()
+	{
+		{
+			b2BodyDef bd;
+			b2Body* ground = m_world->CreateBody(&bd);
+
+			b2EdgeShape shape;
+			shape.SetTwoSided(b2Vec2(-40.0f, 0.0f), b2Vec2(40.0f, 0.0f));
+			ground->CreateFixture(&shape, 0.0f);
+
+			shape.SetTwoSided(b2Vec2(20.0f, 0.0f), b2Vec2(20.0f, 20.0f));
+			ground->CreateFixture(&shape, 0.0f);
+		}
+
+		float xs[e_columnCount] = {0.0f, -10.0f, -5.0f, 5.0f, 10.0f};
+
+		b2PolygonShape box;
+		box.SetAsBox(0.5f, 0.5f);
+
+		b2FixtureDef fd;
+		fd.shape = &box;
+		fd.density = 1.0f;
+		fd.friction = 0.6f;
+
+		float offset = 0.01f;
+
+		for (int32 j = 0; j < e_columnCount; ++j)
+		{
+			for (int32 i = 0; i < e_rowCount; ++i)
+			{
+				b2BodyDef bd;
+				bd.type = b2_dynamicBody;
+
+				float x = (i % 2 == 0 ? -offset : offset);
+				bd.position.Set(xs[j] + x, 0.55f + 1.1f * i);
+				b2Body* body = m_world->CreateBody(&bd);
+				body->CreateFixture(&fd);
+			}
+		}
+	}
+
+	static Scene* Create()
+	{
+		return new VerticalStacks;
+	}
+};
+
+static int verticalStacksIndex = RegisterScene("vertical_stacks", 600, VerticalStacks::Create);
+
+// A hanging grid of circles where each circle is pinned to its neighbors
+// with revolute joints. This is mostly joint solver work.
+class JointGrid : public Scene
+{
+public:
+	enum
+	{
+		e_count = 60
+	};
+
+	JointGrid()
+	{
+		b2CircleShape shape;
+		shape.m_radius = 0.4f;
+
+		b2FixtureDef fd;
+		fd.shape = &shape;
+		fd.density = 1.0f;
+
+		// Neighbors are jointed instead of colliding
+		fd.filter.categoryBits = 0x0002;
+		fd.filter.maskBits = ~0x0002;
+
+		b2RevoluteJointDef jd;
+
+		b2Body* bodies[e_count * e_count];
+
+		for (int32 k = 0; k < e_count; ++k)
+		{
+			for (int32 i = 0; i < e_count; ++i)
+			{
+				b2BodyDef bd;
+				bd.type = (i == 0 && k % 10 == 0) ? b2_staticBody : b2_dynamicBody;
+				bd.position.Set(1.0f * k, -1.0f * i);
+
+				b2Body* body = m_world->CreateBody(&bd);
+				body->CreateFixture(&fd);
+
+				if (i > 0)
+				{
+					jd.Initialize(bodies[k * e_count + i - 1], body, bd.position + b2Vec2(0.0f, 0.5f));
+					m_world->CreateJoint(&jd);
+				}
+
+				if (k > 0)
+				{
+					jd.Initialize(bodies[(k - 1) * e_count + i], body, bd.position - b2Vec2(0.5f, 0.0f));
+					m_world->CreateJoint(&jd);
+				}
+
+				bodies[k * e_count + i] = body;
+			}
+		}
+	}
+
+	static Scene* Create()
+	{
+		return new JointGrid;
+	}
+};
+
+static int jointGridIndex = RegisterScene("joint_grid", 300, JointGrid::Create);
+
+// A field of short stacks that falls asleep. One stack is woken now and then, so
+// the steps measure what a large sleeping world costs next to a small awake part.
+class SleepingStacks : public Scene
+{
+public:
+	enum
+	{
+		e_columnCount = 1000,
+		e_rowCount = 5,
+		e_wakeInterval = 60
+	};
+
+	SleepingStacks()
+	{
+		b2BodyDef bd;
+		b2Body* ground = m_world->CreateBody(&bd);
+
+		b2EdgeShape edge;
+		edge.SetTwoSided(b2Vec2(-800.0f, 0.0f), b2Vec2(800.0f, 0.0f));
+		ground->CreateFixture(&edge, 0.0f);
+
+		b2PolygonShape box;
+		box.SetAsBox(0.5f, 0.5f);
+
+		bd.type = b2_dynamicBody;
+		for (int32 j = 0; j < e_columnCount; ++j)
+		{
+			for (int32 i = 0; i < e_rowCount; ++i)
+			{
+				bd.position.Set(-0.75f * e_columnCount + 1.5f * j, 0.5f + 1.0f * i);
+				b2Body* body = m_world->CreateBody(&bd);
+				body->CreateFixture(&box, 1.0f);
+				m_tops[j] = body;
+			}
+		}
+
+		m_stepCount = 0;
+	}
+
+	void Update() override
+	{
+		++m_stepCount;
+		if (m_stepCount % e_wakeInterval == 0)
+		{
+			int32 column = (m_stepCount / e_wakeInterval * 7) % e_columnCount;
+			m_tops[column]->SetAwake(true);
+		}
+	}
+
+	static Scene* Create()
+	{
+		return new SleepingStacks;
+	}
+
+	b2Body* m_tops[e_columnCount];
+	int32 m_stepCount;
+};
+
+static int sleepingStacksIndex = RegisterScene("sleeping_stacks", 1200, SleepingStacks::Create);
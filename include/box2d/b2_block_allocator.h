@@ -26,14 +26,45 @@
 #include "b2_api.h"
 #include "b2_settings.h"
 
+#include <atomic>
+
 const int32 b2_blockSizeCount = 14;
+const int32 b2_blockCacheSize = 32;
+
+/// Allocations larger than this go directly to b2Alloc.
+const int32 b2_maxBlockSize = 640;
 
 struct b2Block;
 struct b2Chunk;
+struct b2ChunkRelocation;
+class b2BlockAllocatorCache;
+
+/// Usage of one block size class.
+struct B2_API b2BlockSizeStats
+{
+	int32 blockSize;
+	int32 liveBlocks;
+	int32 freeBlocks;
+	int32 chunkCount;
+};
+
+/// Block allocator usage. Allocations larger than the biggest block size
+/// go directly to b2Alloc and are reported separately.
+struct B2_API b2BlockAllocatorStats
+{
+	b2BlockSizeStats sizes[b2_blockSizeCount];
+	int32 chunkCount;
+	int32 chunkBytes;
+	int32 largeCount;
+	int32 largeBytes;
+};
 
 /// This is a small object allocator used for allocating small
 /// objects that persist for more than one time step.
 /// See: http://www.codeproject.com/useritems/Small_Block_Allocator.asp
+/// The allocator is not thread safe. Threads that need to allocate concurrently
+/// must each bind a b2BlockAllocatorCache. Allocate and Free on a thread without a
+/// bound cache take no lock, so they must not be called while any cache is bound.
 class B2_API b2BlockAllocator
 {
 public:
@@ -48,13 +79,98 @@ public:
 
 	void Clear();
 
+	/// Release chunks that have no live blocks.
+	/// @return the number of bytes returned to b2Free.
+	int32 Trim();
+
+	/// Get the current usage. Blocks held by caches count as live.
+	void GetStats(b2BlockAllocatorStats* stats) const;
+
+	/// Replace the blocks of this allocator with a copy of the blocks of another one.
+	/// The chunks are copied whole, so every block keeps its offset and the pointers
+	/// held by the copied blocks can be moved over with Relocate. The chunk memory of
+	/// this allocator is reused. Large allocations are not copied, and blocks held
+	/// by the caches of the source stay unused in the copy.
+	/// @warning no cache may be bound to either allocator.
+	void Copy(const b2BlockAllocator* source);
+
+	/// Map a pointer into a block of the source of the last Copy to the same place in
+	/// this allocator. Null stays null.
+	template <typename T>
+	T* Relocate(T* p) const
+	{
+		return (T*)RelocatePointer(p);
+	}
+
 private:
 
+	friend class b2BlockAllocatorCache;
+
+	void* AllocateBlock(int32 index);
+
+	// Move blocks between the free lists and a cache. These lock the allocator.
+	int32 AllocateBlocks(int32 index, void** blocks, int32 count);
+	void FreeBlocks(int32 index, void** blocks, int32 count);
+	void* AllocateLarge(int32 size);
+	void FreeLarge(void* p, int32 size);
+
+	void Lock();
+	void Unlock();
+
+	void* RelocatePointer(const void* p) const;
+
 	b2Chunk* m_chunks;
 	int32 m_chunkCount;
 	int32 m_chunkSpace;
 
 	b2Block* m_freeLists[b2_blockSizeCount];
+
+	int32 m_liveCounts[b2_blockSizeCount];
+	int32 m_chunkCounts[b2_blockSizeCount];
+	int32 m_largeCount;
+	int32 m_largeBytes;
+
+	// Hash table of the source chunks of the last Copy, see RelocatePointer.
+	b2ChunkRelocation* m_relocations;
+	int32 m_relocationCapacity;
+
+	std::atomic_flag m_lock;
+
+	// The number of caches bound to a thread, to check the unlocked path
+	std::atomic<int32> m_boundCount;
+};
+
+/// A front cache that lets one thread allocate from a shared b2BlockAllocator.
+/// Each size class keeps a small magazine of blocks and only refills or flushes
+/// lock the shared allocator. While bound, b2BlockAllocator::Allocate and Free on
+/// the calling thread are routed through the cache.
+class B2_API b2BlockAllocatorCache
+{
+public:
+	b2BlockAllocatorCache();
+	~b2BlockAllocatorCache();
+
+	/// Route allocations of the allocator on the calling thread through this cache.
+	/// A thread can have one bound cache and a cache can be bound to one thread.
+	void Bind(b2BlockAllocator* allocator);
+
+	/// Stop routing allocations on the calling thread. Cached blocks are kept.
+	void Unbind();
+
+	/// Return all cached blocks to the allocator. The cache must not be bound
+	/// while other threads use the allocator directly.
+	void Flush();
+
+	void* Allocate(int32 size);
+	void Free(void* p, int32 size);
+
+private:
+
+	friend class b2BlockAllocator;
+
+	b2BlockAllocator* m_allocator;
+	void* m_blocks[b2_blockSizeCount][b2_blockCacheSize];
+	int32 m_counts[b2_blockSizeCount];
 };
 
 #endif
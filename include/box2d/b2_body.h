@@ -31,10 +31,12 @@ class b2Fixture;
 class b2Joint;
 class b2Contact;
 class b2Controller;
+class b2SnapshotArchive;
 class b2World;
 struct b2FixtureDef;
 struct b2JointEdge;
 struct b2ContactEdge;
+struct b2SleepingIsland;
 
 /// The body type.
 /// static: zero mass, zero velocity, may be manually moved
@@ -337,6 +339,11 @@ public:
 	/// Get the active state of the body.
 	bool IsEnabled() const;
 
+	/// Is this the body of a static layer? Layer bodies own their fixture
+	/// and cannot be edited, moved, disabled or destroyed directly.
+	/// @see b2World::CreateStaticLayer
+	bool IsStaticLayer() const;
+
 	/// Set this body to have fixed rotation. This causes the mass
 	/// to be reset.
 	void SetFixedRotation(bool flag);
@@ -379,6 +386,7 @@ private:
 	friend class b2Island;
 	friend class b2ContactManager;
 	friend class b2ContactSolver;
+	friend class b2RopeSystem;
 	friend class b2Contact;
 
 	friend class b2DistanceJoint;
@@ -400,7 +408,15 @@ private:
 		e_autoSleepFlag		= 0x0004,
 		e_fixedRotationFlag	= 0x0010,
 		e_enabledFlag		= 0x0020,
-		e_toiFlag			= 0x0040
+		e_toiFlag			= 0x0040,
+		e_staticLayerFlag	= 0x0080,
+
+		// Set on a body of a sleeping island that gained a contact or joint outside
+		// the island. The island search follows the edges of these bodies only.
+		e_linkFlag			= 0x0100,
+
+		// Set while the body is in the world's awake list, see b2World::AddAwakeBody.
+		e_awakeListFlag		= 0x0200
 	};
 
 	b2Body(const b2BodyDef* bd, b2World* world);
@@ -414,8 +430,17 @@ private:
 	// It may lie, depending on the collideConnected flag.
 	bool ShouldCollide(const b2Body* other) const;
 
+	// Read or write the body state for a world snapshot.
+	void Serialize(b2SnapshotArchive& archive);
+
 	b2Sweep GetSweep() const;
 
+	// Wake every body of the sleeping island this body belongs to.
+	void WakeSleepingIsland();
+
+	// Enter or leave the world's awake list after the type, awake or enabled state changed.
+	void UpdateAwakeList();
+
 	b2BodyType m_type;
 
 	uint16 m_flags;
@@ -457,6 +482,15 @@ private:
 
 	float m_sleepTime;
 
+	// Ring of the bodies that fell asleep together, null while not in a sleeping island.
+	b2SleepingIsland* m_sleepingIsland;
+	b2Body* m_sleepingPrev;
+	b2Body* m_sleepingNext;
+
+	// Awake, enabled, non-static bodies are linked here. The island search starts from them.
+	b2Body* m_awakePrev;
+	b2Body* m_awakeNext;
+
 	b2BodyUserData m_userData;
 };
 
@@ -618,8 +652,19 @@ inline void b2Body::SetAwake(bool flag)
 
 	if (flag)
 	{
+		if (m_sleepingIsland)
+		{
+			WakeSleepingIsland();
+			return;
+		}
+
 		m_flags |= e_awakeFlag;
 		m_sleepTime = 0.0f;
+
+		if ((m_flags & e_awakeListFlag) == 0)
+		{
+			UpdateAwakeList();
+		}
 	}
 	else
 	{
@@ -629,6 +674,11 @@ inline void b2Body::SetAwake(bool flag)
 		m_angularVelocity = 0.0f;
 		m_force.SetZero();
 		m_torque = 0.0f;
+
+		if (m_flags & e_awakeListFlag)
+		{
+			UpdateAwakeList();
+		}
 	}
 }
 
@@ -642,6 +692,11 @@ inline bool b2Body::IsEnabled() const
 	return (m_flags & e_enabledFlag) == e_enabledFlag;
 }
 
+inline bool b2Body::IsStaticLayer() const
+{
+	return (m_flags & e_staticLayerFlag) == e_staticLayerFlag;
+}
+
 inline bool b2Body::IsFixedRotation() const
 {
 	return (m_flags & e_fixedRotationFlag) == e_fixedRotationFlag;
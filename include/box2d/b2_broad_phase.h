@@ -26,6 +26,7 @@
 #include "b2_api.h"
 #include "b2_settings.h"
 #include "b2_collision.h"
+#include "b2_compact_tree.h"
 #include "b2_dynamic_tree.h"
 
 struct B2_API b2Pair
@@ -103,14 +104,33 @@ public:
 	/// Get the quality metric of the embedded tree.
 	float GetTreeQuality() const;
 
+	/// Get the number of rotations done by the embedded tree since creation.
+	int32 GetTreeRotationCount() const;
+
+	/// Get the number of moved proxies processed by UpdatePairs since creation.
+	int32 GetMovedProxyCount() const;
+
+	/// Get the number of pairs reported by UpdatePairs since creation.
+	int32 GetFoundPairCount() const;
+
 	/// Shift the world origin. Useful for large worlds.
 	/// The shift formula is: position -= newOrigin
 	/// @param newOrigin the new origin with respect to the old origin
 	void ShiftOrigin(const b2Vec2& newOrigin);
 
+	/// Enable/disable the compact query tree. When enabled, Query and RayCast
+	/// use a compact copy of the tree whenever it is up to date.
+	void SetCompactQueries(bool flag);
+	bool GetCompactQueries() const;
+
+	/// Refit or rebuild the compact query tree if it is enabled and out of date.
+	void UpdateCompactTree();
+
 private:
 
+	friend class b2ContactManager;
 	friend class b2DynamicTree;
+	friend class b2World;
 
 	void BufferMove(int32 proxyId);
 	void UnBufferMove(int32 proxyId);
@@ -119,6 +139,12 @@ private:
 
 	b2DynamicTree m_tree;
 
+	b2CompactTree m_compactTree;
+	bool m_compactQueries;
+	bool m_compactValid;
+	bool m_compactRebuild;
+	int32 m_compactMoveCount;
+
 	int32 m_proxyCount;
 
 	int32* m_moveBuffer;
@@ -129,6 +155,9 @@ private:
 	int32 m_pairCapacity;
 	int32 m_pairCount;
 
+	int32 m_movedProxyCount;
+	int32 m_foundPairCount;
+
 	int32 m_queryProxyId;
 };
 
@@ -169,6 +198,21 @@ inline float b2BroadPhase::GetTreeQuality() const
 	return m_tree.GetAreaRatio();
 }
 
+inline int32 b2BroadPhase::GetTreeRotationCount() const
+{
+	return m_tree.GetRotationCount();
+}
+
+inline int32 b2BroadPhase::GetMovedProxyCount() const
+{
+	return m_movedProxyCount;
+}
+
+inline int32 b2BroadPhase::GetFoundPairCount() const
+{
+	return m_foundPairCount;
+}
+
 template <typename T>
 void b2BroadPhase::UpdatePairs(T* callback)
 {
@@ -184,6 +228,8 @@ void b2BroadPhase::UpdatePairs(T* callback)
 			continue;
 		}
 
+		++m_movedProxyCount;
+
 		// We have to query the tree with the fat AABB so that
 		// we don't fail to create a pair that may touch later.
 		const b2AABB& fatAABB = m_tree.GetFatAABB(m_queryProxyId);
@@ -202,6 +248,8 @@ void b2BroadPhase::UpdatePairs(T* callback)
 		callback->AddPair(userDataA, userDataB);
 	}
 
+	m_foundPairCount += m_pairCount;
+
 	// Clear move flags
 	for (int32 i = 0; i < m_moveCount; ++i)
 	{
@@ -221,18 +269,38 @@ void b2BroadPhase::UpdatePairs(T* callback)
 template <typename T>
 inline void b2BroadPhase::Query(T* callback, const b2AABB& aabb) const
 {
+	if (m_compactValid)
+	{
+		m_compactTree.Query(callback, aabb);
+		return;
+	}
+
 	m_tree.Query(callback, aabb);
 }
 
 template <typename T>
 inline void b2BroadPhase::RayCast(T* callback, const b2RayCastInput& input) const
 {
+	if (m_compactValid)
+	{
+		m_compactTree.RayCast(callback, input);
+		return;
+	}
+
 	m_tree.RayCast(callback, input);
 }
 
 inline void b2BroadPhase::ShiftOrigin(const b2Vec2& newOrigin)
 {
 	m_tree.ShiftOrigin(newOrigin);
+
+	// A uniform shift is handled exactly by a refit.
+	m_compactValid = false;
+}
+
+inline bool b2BroadPhase::GetCompactQueries() const
+{
+	return m_compactQueries;
 }
 
 #endif
@@ -107,6 +107,17 @@
 #define b2_baumgarte				0.2f
 #define b2_toiBaumgarte				0.75f
 
+/// Contact stiffness used by the sub-stepping solver. The effective stiffness is
+/// capped at a quarter of the sub-step rate. Hertz.
+#define b2_contactHertz				30.0f
+
+/// Contact damping ratio used by the sub-stepping solver. This is heavily over-damped
+/// so overlap is removed without bounce.
+#define b2_contactDampingRatio		10.0f
+
+/// The maximum speed the sub-stepping solver uses to push overlapping shapes apart. Meters per second.
+#define b2_contactPushVelocity		(3.0f * b2_lengthUnitsPerMeter)
+
 
 // Sleep
 
@@ -119,6 +130,13 @@
 /// A body cannot sleep if its angular velocity is above this tolerance.
 #define b2_angularSleepTolerance	(2.0f / 180.0f * b2_pi)
 
+/// Get the number of allocations made by b2Alloc_Default since startup. This counts
+/// all threads. A custom b2Alloc is only counted if it calls b2Alloc_Default.
+B2_API int32 b2GetAllocationCount();
+
+/// Get the number of b2Alloc_Default allocations that were not released by b2Free_Default.
+B2_API int32 b2GetLiveAllocationCount();
+
 /// Dump to a file. Only one dump file allowed at a time.
 void b2OpenDump(const char* fileName);
 void b2Dump(const char* string, ...);
@@ -0,0 +1,416 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef B2_COMPACT_TREE_H
+#define B2_COMPACT_TREE_H
+
+#include "b2_api.h"
+#include "b2_collision.h"
+#include "b2_dynamic_tree.h"
+#include "b2_growable_stack.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define B2_COMPACT_TREE_SSE2
+#include <emmintrin.h>
+#endif
+
+/// The number of children per compact tree node.
+#define b2_compactTreeWidth		4
+
+/// The largest quantized coordinate.
+#define b2_compactQuantizationMax	65535.0f
+
+/// A node in the compact tree. The bounds of the children are stored in the node,
+/// quantized to 16 bits relative to the node bounds. This way a node fits in a
+/// 64 byte cache line and all children can be tested without touching them.
+/// The client does not interact with this directly.
+struct B2_API b2CompactNode
+{
+	/// A child reference is a node index, b2_nullNode for an empty slot,
+	/// or an encoded proxy id for a leaf.
+	static bool IsLeaf(int32 child)
+	{
+		return child < b2_nullNode;
+	}
+
+	static int32 EncodeLeaf(int32 proxyId)
+	{
+		return -(proxyId + 2);
+	}
+
+	static int32 DecodeLeaf(int32 child)
+	{
+		return -child - 2;
+	}
+
+	/// Get the conservative bounds of a child.
+	b2AABB GetChildAABB(int32 index) const
+	{
+		b2AABB aabb;
+		aabb.lowerBound.x = origin.x + float(lowerX[index]) * quantum.x;
+		aabb.lowerBound.y = origin.y + float(lowerY[index]) * quantum.y;
+		aabb.upperBound.x = origin.x + float(upperX[index]) * quantum.x;
+		aabb.upperBound.y = origin.y + float(upperY[index]) * quantum.y;
+		return aabb;
+	}
+
+	/// Test all children against an AABB at once.
+	/// @return a mask where bit i is set if child i may overlap the AABB.
+	int32 TestOverlap(const b2AABB& aabb) const;
+
+	/// Test all children against a segment at once. This is the segment bounding box test
+	/// followed by the separating axis test of b2DynamicTree::RayCast.
+	/// @return a mask where bit i is set if child i may overlap the segment.
+	int32 TestSegment(const b2Vec2& p1, const b2Vec2& v, const b2Vec2& abs_v, const b2AABB& segmentAABB) const;
+
+	/// Set the node frame from its bounds and quantize the child bounds conservatively.
+	/// Slots past the count are cleared.
+	void SetBounds(const b2AABB& bounds, const b2AABB* childAABBs, int32 count);
+
+	/// Get the conservative bounds of this node.
+	b2AABB GetAABB() const
+	{
+		b2AABB aabb;
+		aabb.lowerBound = origin;
+		aabb.upperBound.x = origin.x + b2_compactQuantizationMax * quantum.x;
+		aabb.upperBound.y = origin.y + b2_compactQuantizationMax * quantum.y;
+		return aabb;
+	}
+
+	/// The lower bound of this node and the size of one quantization step.
+	b2Vec2 origin;
+	b2Vec2 quantum;
+
+	/// Quantized child bounds.
+	uint16 lowerX[b2_compactTreeWidth];
+	uint16 lowerY[b2_compactTreeWidth];
+	uint16 upperX[b2_compactTreeWidth];
+	uint16 upperY[b2_compactTreeWidth];
+
+	/// Child references. Empty slots are at the end.
+	int32 children[b2_compactTreeWidth];
+};
+
+/// A read-only, cache friendly copy of a b2DynamicTree used to accelerate queries.
+/// The binary tree is collapsed into a 4-wide tree with quantized child bounds.
+/// Leaves refer to the proxy ids of the source tree, so query results are identical
+/// to the source tree. The compact tree must be rebuilt after the source tree changes.
+class B2_API b2CompactTree
+{
+public:
+	/// Constructing the tree does not allocate.
+	b2CompactTree();
+
+	/// Destroy the tree, freeing the node pool.
+	~b2CompactTree();
+
+	/// Rebuild the compact tree from a dynamic tree. The source tree must
+	/// outlive the compact tree. The node pool is reused when possible.
+	void Build(const b2DynamicTree* tree);
+
+	/// Update the bounds for moved proxies without changing the structure. This
+	/// is valid as long as no proxies were created or destroyed since the last build.
+	/// The query performance degrades as proxies move away from their neighbors.
+	void Refit();
+
+	/// Remove all nodes. This keeps the node pool.
+	void Clear();
+
+	/// Query an AABB for overlapping proxies. The callback class
+	/// is called for each proxy that overlaps the supplied AABB.
+	template <typename T>
+	void Query(T* callback, const b2AABB& aabb) const;
+
+	/// Ray-cast against the proxies in the tree. This has the same behavior
+	/// as b2DynamicTree::RayCast.
+	template <typename T>
+	void RayCast(T* callback, const b2RayCastInput& input) const;
+
+	/// Get the number of compact nodes.
+	int32 GetNodeCount() const;
+
+private:
+
+	b2CompactTree(const b2CompactTree&) = delete;
+	void operator=(const b2CompactTree&) = delete;
+
+	int32 BuildNode(int32 treeNodeId);
+
+	const b2DynamicTree* m_tree;
+
+	b2CompactNode* m_nodes;
+	int32 m_nodeCount;
+	int32 m_nodeCapacity;
+
+	int32 m_root;
+};
+
+inline int32 b2CompactTree::GetNodeCount() const
+{
+	return m_nodeCount;
+}
+
+#if defined(B2_COMPACT_TREE_SSE2)
+
+// Dequantize the four children. This matches b2CompactNode::GetChildAABB exactly.
+inline void b2LoadCompactChildren(const b2CompactNode* node, __m128* lx, __m128* ly, __m128* ux, __m128* uy)
+{
+	__m128i zero = _mm_setzero_si128();
+	__m128i lower = _mm_loadu_si128((const __m128i*)node->lowerX);
+	__m128i upper = _mm_loadu_si128((const __m128i*)node->upperX);
+	__m128 ox = _mm_set1_ps(node->origin.x);
+	__m128 oy = _mm_set1_ps(node->origin.y);
+	__m128 qx = _mm_set1_ps(node->quantum.x);
+	__m128 qy = _mm_set1_ps(node->quantum.y);
+	*lx = _mm_add_ps(ox, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lower, zero)), qx));
+	*ly = _mm_add_ps(oy, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lower, zero)), qy));
+	*ux = _mm_add_ps(ox, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(upper, zero)), qx));
+	*uy = _mm_add_ps(oy, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(upper, zero)), qy));
+}
+
+inline int32 b2CompactNode::TestOverlap(const b2AABB& aabb) const
+{
+	__m128 lx, ly, ux, uy;
+	b2LoadCompactChildren(this, &lx, &ly, &ux, &uy);
+
+	__m128 mask = _mm_cmple_ps(lx, _mm_set1_ps(aabb.upperBound.x));
+	mask = _mm_and_ps(mask, _mm_cmple_ps(ly, _mm_set1_ps(aabb.upperBound.y)));
+	mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_set1_ps(aabb.lowerBound.x), ux));
+	mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_set1_ps(aabb.lowerBound.y), uy));
+	return _mm_movemask_ps(mask);
+}
+
+inline int32 b2CompactNode::TestSegment(const b2Vec2& p1, const b2Vec2& v, const b2Vec2& abs_v, const b2AABB& segmentAABB) const
+{
+	__m128 lx, ly, ux, uy;
+	b2LoadCompactChildren(this, &lx, &ly, &ux, &uy);
+
+	__m128 mask = _mm_cmple_ps(lx, _mm_set1_ps(segmentAABB.upperBound.x));
+	mask = _mm_and_ps(mask, _mm_cmple_ps(ly, _mm_set1_ps(segmentAABB.upperBound.y)));
+	mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_set1_ps(segmentAABB.lowerBound.x), ux));
+	mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_set1_ps(segmentAABB.lowerBound.y), uy));
+
+	// Separating axis for segment (Gino, p80).
+	// |dot(v, p1 - c)| > dot(|v|, h)
+	__m128 half = _mm_set1_ps(0.5f);
+	__m128 cx = _mm_mul_ps(half, _mm_add_ps(lx, ux));
+	__m128 cy = _mm_mul_ps(half, _mm_add_ps(ly, uy));
+	__m128 hx = _mm_mul_ps(half, _mm_sub_ps(ux, lx));
+	__m128 hy = _mm_mul_ps(half, _mm_sub_ps(uy, ly));
+	__m128 d = _mm_add_ps(
+		_mm_mul_ps(_mm_set1_ps(v.x), _mm_sub_ps(_mm_set1_ps(p1.x), cx)),
+		_mm_mul_ps(_mm_set1_ps(v.y), _mm_sub_ps(_mm_set1_ps(p1.y), cy)));
+	__m128 absD = _mm_andnot_ps(_mm_set1_ps(-0.0f), d);
+	__m128 radius = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(abs_v.x), hx), _mm_mul_ps(_mm_set1_ps(abs_v.y), hy));
+	mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_sub_ps(absD, radius), _mm_setzero_ps()));
+	return _mm_movemask_ps(mask);
+}
+
+#else
+
+inline int32 b2CompactNode::TestOverlap(const b2AABB& aabb) const
+{
+	int32 mask = 0;
+	for (int32 i = 0; i < b2_compactTreeWidth; ++i)
+	{
+		if (b2TestOverlap(GetChildAABB(i), aabb))
+		{
+			mask |= 1 << i;
+		}
+	}
+	return mask;
+}
+
+inline int32 b2CompactNode::TestSegment(const b2Vec2& p1, const b2Vec2& v, const b2Vec2& abs_v, const b2AABB& segmentAABB) const
+{
+	int32 mask = 0;
+	for (int32 i = 0; i < b2_compactTreeWidth; ++i)
+	{
+		b2AABB aabb = GetChildAABB(i);
+		if (b2TestOverlap(aabb, segmentAABB) == false)
+		{
+			continue;
+		}
+
+		// Separating axis for segment (Gino, p80).
+		// |dot(v, p1 - c)| > dot(|v|, h)
+		b2Vec2 c = aabb.GetCenter();
+		b2Vec2 h = aabb.GetExtents();
+		float separation = b2Abs(b2Dot(v, p1 - c)) - b2Dot(abs_v, h);
+		if (separation <= 0.0f)
+		{
+			mask |= 1 << i;
+		}
+	}
+	return mask;
+}
+
+#endif
+
+template <typename T>
+inline void b2CompactTree::Query(T* callback, const b2AABB& aabb) const
+{
+	if (m_root == b2_nullNode)
+	{
+		return;
+	}
+
+	b2GrowableStack<int32, 256> stack;
+	stack.Push(m_root);
+
+	while (stack.GetCount() > 0)
+	{
+		const b2CompactNode* node = m_nodes + stack.Pop();
+		int32 mask = node->TestOverlap(aabb);
+
+		for (int32 i = 0; i < b2_compactTreeWidth; ++i)
+		{
+			int32 child = node->children[i];
+			if (child == b2_nullNode)
+			{
+				break;
+			}
+
+			if ((mask & (1 << i)) == 0)
+			{
+				continue;
+			}
+
+			if (b2CompactNode::IsLeaf(child))
+			{
+				// The quantized bounds are conservative, so test the exact fat AABB.
+				int32 proxyId = b2CompactNode::DecodeLeaf(child);
+				if (b2TestOverlap(m_tree->GetFatAABB(proxyId), aabb) == false)
+				{
+					continue;
+				}
+
+				bool proceed = callback->QueryCallback(proxyId);
+				if (proceed == false)
+				{
+					return;
+				}
+			}
+			else
+			{
+				stack.Push(child);
+			}
+		}
+	}
+}
+
+template <typename T>
+inline void b2CompactTree::RayCast(T* callback, const b2RayCastInput& input) const
+{
+	if (m_root == b2_nullNode)
+	{
+		return;
+	}
+
+	b2Vec2 p1 = input.p1;
+	b2Vec2 p2 = input.p2;
+	b2Vec2 r = p2 - p1;
+	b2Assert(r.LengthSquared() > 0.0f);
+	r.Normalize();
+
+	// v is perpendicular to the segment.
+	b2Vec2 v = b2Cross(1.0f, r);
+	b2Vec2 abs_v = b2Abs(v);
+
+	float maxFraction = input.maxFraction;
+
+	// Build a bounding box for the segment.
+	b2AABB segmentAABB;
+	{
+		b2Vec2 t = p1 + maxFraction * (p2 - p1);
+		segmentAABB.lowerBound = b2Min(p1, t);
+		segmentAABB.upperBound = b2Max(p1, t);
+	}
+
+	b2GrowableStack<int32, 256> stack;
+	stack.Push(m_root);
+
+	while (stack.GetCount() > 0)
+	{
+		const b2CompactNode* node = m_nodes + stack.Pop();
+		int32 mask = node->TestSegment(p1, v, abs_v, segmentAABB);
+
+		for (int32 i = 0; i < b2_compactTreeWidth; ++i)
+		{
+			int32 child = node->children[i];
+			if (child == b2_nullNode)
+			{
+				break;
+			}
+
+			if ((mask & (1 << i)) == 0)
+			{
+				continue;
+			}
+
+			if (b2CompactNode::IsLeaf(child) == false)
+			{
+				stack.Push(child);
+				continue;
+			}
+
+			// The quantized bounds are conservative, so test the exact fat AABB.
+			const b2AABB& aabb = m_tree->GetFatAABB(b2CompactNode::DecodeLeaf(child));
+			if (b2TestOverlap(aabb, segmentAABB) == false)
+			{
+				continue;
+			}
+
+			b2Vec2 c = aabb.GetCenter();
+			b2Vec2 h = aabb.GetExtents();
+			float separation = b2Abs(b2Dot(v, p1 - c)) - b2Dot(abs_v, h);
+			if (separation > 0.0f)
+			{
+				continue;
+			}
+
+			b2RayCastInput subInput;
+			subInput.p1 = input.p1;
+			subInput.p2 = input.p2;
+			subInput.maxFraction = maxFraction;
+
+			float value = callback->RayCastCallback(subInput, b2CompactNode::DecodeLeaf(child));
+
+			if (value == 0.0f)
+			{
+				// The client has terminated the ray cast.
+				return;
+			}
+
+			if (value > 0.0f)
+			{
+				// Update segment bounding box.
+				maxFraction = value;
+				b2Vec2 t = p1 + maxFraction * (p2 - p1);
+				segmentAABB.lowerBound = b2Min(p1, t);
+				segmentAABB.upperBound = b2Max(p1, t);
+			}
+		}
+	}
+}
+
+#endif
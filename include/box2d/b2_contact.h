@@ -36,6 +36,8 @@ class b2World;
 class b2BlockAllocator;
 class b2StackAllocator;
 class b2ContactListener;
+class b2SnapshotArchive;
+struct b2SleepingIsland;
 
 /// Friction mixing law. The idea is to allow either fixture to drive the friction to zero.
 /// For example, anything slides on ice.
@@ -208,7 +210,12 @@ protected:
 	b2Contact(b2Fixture* fixtureA, int32 indexA, b2Fixture* fixtureB, int32 indexB);
 	virtual ~b2Contact() {}
 
-	void Update(b2ContactListener* listener);
+	// Adds the time spent in b2TimeOfImpact to toiTime, in milliseconds, and the
+	// number of calls to toiCalls.
+	void Update(b2ContactListener* listener, float* toiTime, int32* toiCalls);
+
+	// Read or write the contact state, including the manifold, for a world snapshot.
+	void Serialize(b2SnapshotArchive& archive);
 
 	static b2ContactRegister s_registers[b2Shape::e_typeCount][b2Shape::e_typeCount];
 	static bool s_initialized;
@@ -219,6 +226,11 @@ protected:
 	b2Contact* m_prev;
 	b2Contact* m_next;
 
+	// Sleeping island that holds this contact, see b2SleepingIsland.
+	b2SleepingIsland* m_sleepingIsland;
+	b2Contact* m_sleepingPrev;
+	b2Contact* m_sleepingNext;
+
 	// Nodes for connecting bodies.
 	b2ContactEdge m_nodeA;
 	b2ContactEdge m_nodeB;
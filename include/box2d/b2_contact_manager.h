@@ -29,29 +29,86 @@
 class b2Contact;
 class b2ContactFilter;
 class b2ContactListener;
+class b2StaticLayer;
 class b2BlockAllocator;
+class b2BlockAllocatorCache;
+class b2TaskExecutor;
+struct b2FixtureProxy;
+
+// A new broad-phase pair and the contact created for it.
+struct B2_API b2ContactPair
+{
+	b2FixtureProxy* proxyA;
+	b2FixtureProxy* proxyB;
+	b2Contact* contact;
+};
 
 // Delegate of b2World.
 class B2_API b2ContactManager
 {
 public:
 	b2ContactManager();
+	~b2ContactManager();
 
 	// Broad-phase callback.
 	void AddPair(void* proxyUserDataA, void* proxyUserDataB);
 
 	void FindNewContacts();
 
+	// Create the contacts between moved proxies and the static layers.
+	void FindLayerContacts();
+
+	// Filter a pair and create the contact, without linking it. This is safe to
+	// call from several threads if each has bound an allocator cache.
+	b2Contact* CreateContact(b2FixtureProxy* proxyA, b2FixtureProxy* proxyB);
+
+	// Insert a new contact into the world and body contact lists.
+	void LinkContact(b2Contact* c);
+
+	// New contacts are created in parallel when the executor has several threads.
+	void SetTaskExecutor(b2TaskExecutor* executor);
+
+	// Return the blocks held by the thread caches to the allocator.
+	void FlushCaches();
+
 	void Destroy(b2Contact* c);
 
+	// Take a contact out of its sleeping island.
+	void RemoveSleepingContact(b2Contact* c);
+
 	void Collide();
 
 	b2BroadPhase m_broadPhase;
 	b2Contact* m_contactList;
 	int32 m_contactCount;
+
+	// Contacts with the touching flag, sleeping ones included. This bounds the island arrays.
+	int32 m_touchingCount;
 	b2ContactFilter* m_contactFilter;
 	b2ContactListener* m_contactListener;
 	b2BlockAllocator* m_allocator;
+
+	b2StaticLayer* m_layerList;
+
+	// One proxy per layer with the layer bounds in world space, so the layer pairs
+	// and the world queries only visit the layers they overlap.
+	b2DynamicTree m_layerTree;
+
+	b2TaskExecutor* m_executor;
+
+	// One cache per thread. The cached blocks are kept from step to step and only
+	// returned by FlushCaches or when the executor changes.
+	b2BlockAllocatorCache* m_caches;
+	int32 m_cacheCount;
+
+	b2ContactPair* m_pairs;
+	int32 m_pairCount;
+	int32 m_pairCapacity;
+
+	// Time spent in b2TimeOfImpact during the last Collide, in milliseconds, and the
+	// number of calls. These are per world, unlike the b2_toi globals.
+	float m_toiTime;
+	int32 m_toiCalls;
 };
 
 #endif
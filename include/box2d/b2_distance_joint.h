@@ -26,6 +26,8 @@
 #include "b2_api.h"
 #include "b2_joint.h"
 
+struct b2DistanceConstraint;
+
 /// Distance joint definition. This requires defining an anchor point on both
 /// bodies and the non-zero distance of the distance joint. The definition uses
 /// local anchor points so that the initial configuration can violate the
@@ -135,12 +137,23 @@ public:
 protected:
 
 	friend class b2Joint;
+	friend class b2Island;
+
 	b2DistanceJoint(const b2DistanceJointDef* data);
 
 	void InitVelocityConstraints(const b2SolverData& data) override;
 	void SolveVelocityConstraints(const b2SolverData& data) override;
 	bool SolvePositionConstraints(const b2SolverData& data) override;
 
+	// The island solves its distance joints from a dense array, like the revolute joints.
+	// See b2DistanceConstraint.
+	void PrepareConstraint(b2DistanceConstraint* constraint, int32 jointIndex);
+	void StoreConstraint(const b2DistanceConstraint* constraint);
+	static void InitVelocityBatch(b2DistanceConstraint* constraints, int32 count, const b2SolverData& data);
+	static void SolveVelocityBatch(b2DistanceConstraint* constraints, int32 count, const b2SolverData& data);
+	static bool SolvePositionBatch(const b2DistanceConstraint* constraints, int32 count, const b2SolverData& data);
+	void Serialize(b2SnapshotArchive& archive) override;
+
 	float m_stiffness;
 	float m_damping;
 	float m_bias;
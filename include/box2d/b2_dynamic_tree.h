@@ -125,6 +125,9 @@ public:
 	/// Get the ratio of the sum of the node areas to the root area.
 	float GetAreaRatio() const;
 
+	/// Get the number of rotations performed to keep the tree balanced.
+	int32 GetRotationCount() const;
+
 	/// Build an optimal tree. Very expensive. For testing.
 	void RebuildBottomUp();
 
@@ -135,6 +138,9 @@ public:
 
 private:
 
+	friend class b2CompactTree;
+	friend class b2World;
+
 	int32 AllocateNode();
 	void FreeNode(int32 node);
 
@@ -158,8 +164,14 @@ private:
 	int32 m_freeList;
 
 	int32 m_insertionCount;
+	int32 m_rotationCount;
 };
 
+inline int32 b2DynamicTree::GetRotationCount() const
+{
+	return m_rotationCount;
+}
+
 inline void* b2DynamicTree::GetUserData(int32 proxyId) const
 {
 	b2Assert(0 <= proxyId && proxyId < m_nodeCapacity);
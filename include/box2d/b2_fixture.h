@@ -32,6 +32,7 @@ class b2BlockAllocator;
 class b2Body;
 class b2BroadPhase;
 class b2Fixture;
+class b2SnapshotArchive;
 
 /// This holds contact filtering data.
 struct B2_API b2Filter
@@ -204,8 +205,9 @@ public:
 
 	/// Get the fixture's AABB. This AABB may be enlarge and/or stale.
 	/// If you need a more accurate AABB, compute it using the shape and
-	/// the body transform.
-	const b2AABB& GetAABB(int32 childIndex) const;
+	/// the body transform. Static layer edges have no proxies, so for a layer
+	/// fixture this is the exact bounds of the edge.
+	b2AABB GetAABB(int32 childIndex) const;
 
 	/// Dump this fixture to the log file.
 	void Dump(int32 bodyIndex);
@@ -231,6 +233,10 @@ protected:
 	void Synchronize(b2BroadPhase* broadPhase, const b2Transform& xf);
 	void Synchronize(b2BroadPhase* broadPhase, const b2Transform& xf1, const b2Transform& xf2);
 
+	// Read or write the fixture state, shape, and proxies for a world snapshot.
+	// When loading, the shape and proxy array must already be allocated.
+	void Serialize(b2SnapshotArchive& archive);
+
 	float m_density;
 
 	b2Fixture* m_next;
@@ -363,10 +369,4 @@ inline void b2Fixture::GetMassData(b2MassData* massData) const
 	m_shape->ComputeMass(massData, m_density);
 }
 
-inline const b2AABB& b2Fixture::GetAABB(int32 childIndex) const
-{
-	b2Assert(0 <= childIndex && childIndex < m_proxyCount);
-	return m_proxies[childIndex].aabb;
-}
-
 #endif
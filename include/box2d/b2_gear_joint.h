@@ -88,6 +88,8 @@ protected:
 	void InitVelocityConstraints(const b2SolverData& data) override;
 	void SolveVelocityConstraints(const b2SolverData& data) override;
 	bool SolvePositionConstraints(const b2SolverData& data) override;
+	void Serialize(b2SnapshotArchive& archive) override;
+	void Relocate(const b2BlockAllocator* allocator) override;
 
 	b2Joint* m_joint1;
 	b2Joint* m_joint2;
@@ -29,8 +29,10 @@
 class b2Body;
 class b2Draw;
 class b2Joint;
+class b2SnapshotArchive;
 struct b2SolverData;
 class b2BlockAllocator;
+struct b2SleepingIsland;
 
 enum b2JointType
 {
@@ -174,9 +176,29 @@ protected:
 	// This returns true if the position errors are within tolerance.
 	virtual bool SolvePositionConstraints(const b2SolverData& data) = 0;
 
+	// Solve a run of joints that share a type with the virtual functions. Revolute, weld,
+	// and distance joints are solved by the island from dense storage instead, see
+	// b2RevoluteConstraint.
+	static void SolveVelocityBatch(b2JointType type, b2Joint** joints, int32 count, const b2SolverData& data);
+	static bool SolvePositionBatch(b2JointType type, b2Joint** joints, int32 count, const b2SolverData& data);
+
+	// Read or write the joint state for a world snapshot. Body and joint references
+	// are handled by b2World.
+	virtual void Serialize(b2SnapshotArchive& archive);
+
+	// Move the pointers of a joint copied by b2World::CopyTo over to the copy, see
+	// b2BlockAllocator::Copy.
+	virtual void Relocate(const b2BlockAllocator* allocator);
+
 	b2JointType m_type;
 	b2Joint* m_prev;
 	b2Joint* m_next;
+
+	// Sleeping island that holds this joint, see b2SleepingIsland.
+	b2SleepingIsland* m_sleepingIsland;
+	b2Joint* m_sleepingPrev;
+	b2Joint* m_sleepingNext;
+
 	b2JointEdge m_edgeA;
 	b2JointEdge m_edgeB;
 	b2Body* m_bodyA;
@@ -184,6 +206,9 @@ protected:
 
 	int32 m_index;
 
+	// Index into the island's dense constraints of this joint type
+	int32 m_constraintIndex;
+
 	bool m_islandFlag;
 	bool m_collideConnected;
 
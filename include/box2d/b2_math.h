@@ -34,8 +34,22 @@ inline bool b2IsValid(float x)
 	return isfinite(x);
 }
 
+/// Deterministic versions of the standard library functions used by the simulation.
+/// These only use basic arithmetic, so they give the same results on every platform
+/// with IEEE floats when floating point contraction is disabled. The error is a few ulp.
+B2_API float b2ComputeAtan2(float y, float x);
+B2_API void b2ComputeCosSin(float angle, float* c, float* s);
+B2_API float b2ComputeExp(float x);
+
 #define	b2Sqrt(x)	sqrtf(x)
+
+#if defined(B2_DETERMINISTIC)
+#define	b2Atan2(y, x)	b2ComputeAtan2(y, x)
+#define	b2Exp(x)	b2ComputeExp(x)
+#else
 #define	b2Atan2(y, x)	atan2f(y, x)
+#define	b2Exp(x)	expf(x)
+#endif
 
 /// A 2D column vector.
 struct B2_API b2Vec2
@@ -291,17 +305,19 @@ struct B2_API b2Rot
 	/// Initialize from an angle in radians
 	explicit b2Rot(float angle)
 	{
-		/// TODO_ERIN optimize
-		s = sinf(angle);
-		c = cosf(angle);
+		Set(angle);
 	}
 
 	/// Set using an angle in radians.
 	void Set(float angle)
 	{
+#if defined(B2_DETERMINISTIC)
+		b2ComputeCosSin(angle, &c, &s);
+#else
 		/// TODO_ERIN optimize
 		s = sinf(angle);
 		c = cosf(angle);
+#endif
 	}
 
 	/// Set to the identity rotation
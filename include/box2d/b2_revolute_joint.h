@@ -26,6 +26,9 @@
 #include "b2_api.h"
 #include "b2_joint.h"
 
+class b2StackAllocator;
+struct b2RevoluteConstraint;
+
 /// Revolute joint definition. This requires defining an anchor point where the
 /// bodies are joined. The definition uses local anchor points so that the
 /// initial configuration can violate the constraint slightly. You also need to
@@ -165,6 +168,7 @@ protected:
 
 	friend class b2Joint;
 	friend class b2GearJoint;
+	friend class b2Island;
 
 	b2RevoluteJoint(const b2RevoluteJointDef* def);
 
@@ -172,6 +176,21 @@ protected:
 	void SolveVelocityConstraints(const b2SolverData& data) override;
 	bool SolvePositionConstraints(const b2SolverData& data) override;
 
+	// The island solves its revolute joints from a dense array, see b2RevoluteConstraint.
+	// PrepareConstraint copies the joint into the array at the start of the step and
+	// StoreConstraint copies the results back at the end. The batch kernels solve a run
+	// of constraints in order, like the virtual functions above would.
+	void PrepareConstraint(b2RevoluteConstraint* constraint, int32 jointIndex);
+	void StoreConstraint(const b2RevoluteConstraint* constraint);
+	static void InitVelocityBatch(b2RevoluteConstraint* constraints, int32 count, const b2SolverData& data);
+	static void SolveVelocityBatch(b2RevoluteConstraint* constraints, int32 count, const b2SolverData& data);
+	static bool SolvePositionBatch(const b2RevoluteConstraint* constraints, int32 count, const b2SolverData& data);
+
+	// Solve the point constraints of a chain as one block tridiagonal system. Neighboring
+	// joints share a dynamic body. The joints must not have a limit or motor.
+	static void SolveChainVelocities(b2RevoluteConstraint* constraints, int32 count, b2StackAllocator* allocator, const b2SolverData& data);
+	void Serialize(b2SnapshotArchive& archive) override;
+
 	// Solver shared
 	b2Vec2 m_localAnchorA;
 	b2Vec2 m_localAnchorB;
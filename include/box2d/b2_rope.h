@@ -29,6 +29,7 @@
 class b2Draw;
 struct b2RopeStretch;
 struct b2RopeBend;
+struct b2RopeData;
 
 enum b2StretchingModel
 {
@@ -89,6 +90,7 @@ struct B2_API b2RopeDef
 		count = 0;
 		masses = nullptr;
 		gravity.SetZero();
+		radius = 0.05f;
 	}
 
 	b2Vec2 position;
@@ -97,6 +99,9 @@ struct B2_API b2RopeDef
 	float* masses;
 	b2Vec2 gravity;
 	b2RopeTuning tuning;
+
+	/// The particle collision radius. Only used by ropes in a b2RopeSystem that is added to a world.
+	float radius;
 };
 
 ///
@@ -123,14 +128,7 @@ public:
 
 private:
 
-	void SolveStretch_PBD();
-	void SolveStretch_XPBD(float dt);
-	void SolveBend_PBD_Angle();
-	void SolveBend_XPBD_Angle(float dt);
-	void SolveBend_PBD_Distance();
-	void SolveBend_PBD_Height();
-	void SolveBend_PBD_Triangle();
-	void ApplyBendForces(float dt);
+	void GetData(b2RopeData* data) const;
 
 	b2Vec2 m_position;
 
@@ -0,0 +1,198 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef B2_ROPE_SYSTEM_H
+#define B2_ROPE_SYSTEM_H
+
+#include "b2_api.h"
+#include "b2_math.h"
+#include "b2_rope.h"
+
+class b2Body;
+class b2Draw;
+class b2Fixture;
+class b2TaskExecutor;
+class b2World;
+struct b2AABB;
+struct b2RopeAttachment;
+struct b2RopeBend;
+struct b2RopeCollider;
+struct b2RopeContact;
+struct b2RopeData;
+struct b2RopeStretch;
+
+/// Rope system step statistics.
+struct B2_API b2RopeProfile
+{
+	float step;
+	int32 ropeCount;
+	int32 particleCount;
+	int32 constraintCount;
+	int32 colliderCount;
+};
+
+/// A container for many ropes. Particles and constraints of all ropes are stored
+/// in contiguous arrays and stepped in one call. Constraints are solved in colored
+/// order (even/odd for stretch, three colors for bend), so each sweep has no
+/// dependencies. Ropes are independent and are distributed over the task executor.
+/// When added to a world with b2World::SetRopeSystem, the ropes are stepped before the
+/// rigid bodies. Particles then collide with fixtures and can be attached to bodies.
+/// Reaction impulses are applied before the bodies are solved, so they take effect in
+/// the same step. A sleeping body holds still for the rope and is woken when a particle
+/// hits it or pulls on it faster than the sleep tolerance.
+class B2_API b2RopeSystem
+{
+public:
+	b2RopeSystem();
+	~b2RopeSystem();
+
+	/// Add a rope. The definition is copied.
+	/// @return the rope index.
+	int32 CreateRope(const b2RopeDef& def);
+
+	/// Remove all ropes. Memory is kept for reuse.
+	void Clear();
+
+	/// Change the tuning of a rope.
+	void SetTuning(int32 index, const b2RopeTuning& tuning);
+
+	/// Set the target position of a rope. Particles with zero mass follow this position.
+	void SetPosition(int32 index, const b2Vec2& position);
+
+	/// Move a rope back to its bind pose at a new position.
+	void Reset(int32 index, const b2Vec2& position);
+
+	/// Pin a particle to a body. The particle mass determines how strongly the rope
+	/// pulls on the body. A particle with zero mass follows the body exactly.
+	/// Attachments are removed when the system is removed from the world or the world
+	/// is destroyed.
+	/// @param localAnchor the anchor point relative to the body origin.
+	void Attach(int32 index, int32 particleIndex, b2Body* body, const b2Vec2& localAnchor);
+
+	/// Remove all attachments of a particle.
+	void Detach(int32 index, int32 particleIndex);
+
+	/// Get the number of attachments of all ropes.
+	int32 GetAttachmentCount() const { return m_anchorCount; }
+
+	/// Shift the particles. This is called by b2World::ShiftOrigin.
+	void ShiftOrigin(const b2Vec2& newOrigin);
+
+	/// Use an executor to step ropes in parallel. Pass nullptr to step on the calling thread.
+	void SetTaskExecutor(b2TaskExecutor* executor);
+
+	/// Advance all ropes. Do not call this if the system is added to a world.
+	void Step(float timeStep, int32 iterations);
+
+	/// Get the number of ropes.
+	int32 GetRopeCount() const { return m_ropeCount; }
+
+	/// Get the number of particles in a rope.
+	int32 GetParticleCount(int32 index) const;
+
+	/// Get the particle positions of a rope.
+	const b2Vec2* GetPositions(int32 index) const;
+
+	/// Get the statistics of the last step.
+	const b2RopeProfile& GetProfile() const { return m_profile; }
+
+	/// Draw all ropes.
+	void Draw(b2Draw* draw) const;
+
+private:
+
+	friend class b2RopeSystemTask;
+	friend class b2World;
+	friend struct b2RopeColliderCallback;
+
+	struct Rope
+	{
+		int32 particleOffset;
+		int32 stretchOffset;
+		int32 bendOffset;
+		int32 count;
+		b2Vec2 position;
+		b2Vec2 gravity;
+		float radius;
+		b2RopeTuning tuning;
+
+		// Ranges of the solver arrays, updated each step
+		int32 attachmentStart;
+		int32 attachmentCount;
+		int32 colliderStart;
+		int32 colliderCount;
+	};
+
+	struct Anchor
+	{
+		int32 rope;
+		int32 particle;
+		b2Body* body;
+		b2Vec2 localAnchor;
+	};
+
+	void GetData(int32 index, b2RopeData* data) const;
+	void Reserve(int32 particleCapacity, int32 ropeCapacity);
+	void PrepareCoupling(float timeStep);
+	void AddCollider(b2Fixture* fixture, int32 childIndex, const b2AABB& aabb, b2Body* body);
+	void ApplyImpulses();
+	static void ApplyImpulse(b2Body* body, const b2Vec2& linearImpulse, float angularImpulse, bool wake);
+	void RemoveBody(b2Body* body);
+	void RemoveWorld();
+
+	Rope* m_ropes;
+	int32 m_ropeCount;
+	int32 m_ropeCapacity;
+
+	b2Vec2* m_bindPositions;
+	b2Vec2* m_ps;
+	b2Vec2* m_p0s;
+	b2Vec2* m_vs;
+	float* m_invMasses;
+	int32 m_particleCount;
+	int32 m_particleCapacity;
+
+	// Each rope has count - 1 stretch and count - 2 bend constraints
+	b2RopeStretch* m_stretchConstraints;
+	b2RopeBend* m_bendConstraints;
+	int32 m_stretchCount;
+	int32 m_bendCount;
+
+	// Attachments sorted by rope
+	Anchor* m_anchors;
+	int32 m_anchorCount;
+	int32 m_anchorCapacity;
+
+	b2RopeAttachment* m_attachments;
+	b2RopeCollider* m_colliders;
+	int32 m_colliderCount;
+	int32 m_colliderCapacity;
+
+	// Each particle may touch b2_ropeContactsPerParticle colliders
+	b2RopeContact* m_contacts;
+
+	b2World* m_world;
+	b2TaskExecutor* m_executor;
+	b2RopeProfile m_profile;
+};
+
+#endif
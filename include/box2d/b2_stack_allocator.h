@@ -26,7 +26,7 @@
 #include "b2_api.h"
 #include "b2_settings.h"
 
-const int32 b2_stackSize = 100 * 1024;	// 100k
+const int32 b2_stackSize = 100 * 1024;	// 100k initial arena
 const int32 b2_maxStackEntries = 32;
 
 struct B2_API b2StackEntry
@@ -39,6 +39,8 @@ struct B2_API b2StackEntry
 // This is a stack allocator used for fast per step allocations.
 // You must nest allocate/free pairs. The code will assert
 // if you try to interleave multiple allocate/free pairs.
+// Allocations that do not fit in the arena fall back to b2Alloc.
+// Call Grow between steps so the arena covers the high-water mark.
 class B2_API b2StackAllocator
 {
 public:
@@ -50,13 +52,30 @@ public:
 
 	int32 GetMaxAllocation() const;
 
+	/// Grow the arena to fit the largest allocation seen so far. This
+	/// must be called when nothing is allocated.
+	void Grow();
+
+	/// Get the arena size in bytes.
+	int32 GetCapacity() const;
+
+	/// Get the number of allocations that did not fit in the arena.
+	int32 GetFallbackCount() const;
+
+	/// Get the largest total allocation since the last call to ResetPeakAllocation.
+	int32 GetPeakAllocation() const;
+	void ResetPeakAllocation();
+
 private:
 
-	char m_data[b2_stackSize];
+	char* m_data;
+	int32 m_capacity;
 	int32 m_index;
 
 	int32 m_allocation;
 	int32 m_maxAllocation;
+	int32 m_peakAllocation;
+	int32 m_fallbackCount;
 
 	b2StackEntry m_entries[b2_maxStackEntries];
 	int32 m_entryCount;
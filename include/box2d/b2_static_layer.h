@@ -0,0 +1,465 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#ifndef B2_STATIC_LAYER_H
+#define B2_STATIC_LAYER_H
+
+#include "b2_api.h"
+#include "b2_collision.h"
+#include "b2_compact_tree.h"
+#include "b2_fixture.h"
+#include "b2_growable_stack.h"
+
+class b2Body;
+class b2World;
+
+/// A chain in a static layer. This has the same meaning as b2ChainShape::CreateChain
+/// and b2ChainShape::CreateLoop. Like chain shapes, the edges are one-sided.
+struct B2_API b2StaticChainDef
+{
+	b2StaticChainDef()
+	{
+		vertices = nullptr;
+		count = 0;
+		prevVertex.SetZero();
+		nextVertex.SetZero();
+		loop = false;
+	}
+
+	/// The chain vertices.
+	const b2Vec2* vertices;
+
+	/// The number of vertices. At least 2 for a chain and 3 for a loop.
+	int32 count;
+
+	/// The ghost vertices of an open chain. These are ignored for loops.
+	b2Vec2 prevVertex;
+	b2Vec2 nextVertex;
+
+	/// Close the chain.
+	bool loop;
+};
+
+/// Build a static layer blob from a set of chains. This is meant to run offline, for
+/// example in a level exporter. The blob holds the chain vertices, the bounds of every
+/// edge, and a prebuilt compact tree. It contains no pointers, so it can be saved to a
+/// file and memory mapped later. The format is native: the byte order and float format
+/// must match the target.
+/// @param buffer the output, 4 byte aligned. This may be null to get the size.
+/// @return the size of the blob in bytes when it is written, otherwise the capacity needed.
+B2_API int32 b2BuildStaticLayer(const b2StaticChainDef* chains, int32 chainCount, void* buffer, int32 capacity);
+
+/// Static layer definition. The blob is not copied and must outlive the layer.
+struct B2_API b2StaticLayerDef
+{
+	b2StaticLayerDef()
+	{
+		data = nullptr;
+		size = 0;
+		position.SetZero();
+		friction = 0.2f;
+		restitution = 0.0f;
+		restitutionThreshold = 1.0f * b2_lengthUnitsPerMeter;
+	}
+
+	/// The blob from b2BuildStaticLayer, 4 byte aligned.
+	const void* data;
+
+	/// The size of the blob in bytes.
+	int32 size;
+
+	/// The world position of the layer origin. Building tiles around their own
+	/// origin keeps the blob coordinates small in large worlds.
+	b2Vec2 position;
+
+	/// Use this to store application specific fixture data.
+	b2FixtureUserData userData;
+
+	/// The friction coefficient of all edges.
+	float friction;
+
+	/// The restitution of all edges.
+	float restitution;
+
+	/// The restitution velocity threshold of all edges.
+	float restitutionThreshold;
+
+	/// Contact filtering data for all edges.
+	b2Filter filter;
+};
+
+/// A read-only layer of static edges that takes part in collision without per edge
+/// fixtures or broad-phase proxies. The layer owns one static body with a single chain
+/// fixture that refers to the blob vertices. Contacts report this fixture along with
+/// the edge index as the child index. The body must not be changed or destroyed;
+/// use b2World::DestroyStaticLayer instead. Create a layer with b2World::CreateStaticLayer.
+class B2_API b2StaticLayer
+{
+public:
+
+	/// Get the static body that owns the layer fixture.
+	b2Body* GetBody();
+
+	/// Get the chain fixture of the layer.
+	b2Fixture* GetFixture();
+
+	/// Get the number of edges in the layer. Edge indices are chain child indices and
+	/// are not contiguous because the vertices of all chains are packed together.
+	int32 GetEdgeCount() const;
+
+	/// Get the next layer in the world layer list.
+	b2StaticLayer* GetNext();
+
+	/// Query the layer edges with an AABB in layer coordinates. The callback is called
+	/// with the child index of each edge whose bounds overlap the AABB.
+	template <typename T>
+	void Query(T* callback, const b2AABB& aabb) const;
+
+	/// Ray-cast against the edge bounds in layer coordinates. This has the same
+	/// behavior as b2DynamicTree::RayCast, reporting child indices.
+	template <typename T>
+	void RayCast(T* callback, const b2RayCastInput& input) const;
+
+	/// Get the exact bounds of an edge in layer coordinates.
+	const b2AABB& GetEdgeAABB(int32 childIndex) const;
+
+	/// Get conservative bounds of all edges in layer coordinates. The bounds are
+	/// empty if the layer has no edges.
+	b2AABB GetAABB() const;
+
+private:
+
+	friend class b2World;
+
+	// Bind the blob. Returns false if the blob is invalid.
+	bool Initialize(const void* data, int32 size);
+
+	const b2Vec2* m_vertices;
+	int32 m_vertexCount;
+
+	const b2AABB* m_aabbs;
+	int32 m_edgeCount;
+
+	const b2CompactNode* m_nodes;
+	int32 m_nodeCount;
+	int32 m_root;
+
+	b2Body* m_body;
+	b2Fixture* m_fixture;
+
+	// Proxy in the layer tree of the contact manager, null if the layer is empty.
+	int32 m_proxyId;
+
+	b2StaticLayer* m_prev;
+	b2StaticLayer* m_next;
+};
+
+/// Static tile definition. The chains are copied, so they may be released after
+/// b2World::AddStaticTile returns.
+struct B2_API b2StaticTileDef
+{
+	b2StaticTileDef()
+	{
+		chains = nullptr;
+		chainCount = 0;
+		position.SetZero();
+		friction = 0.2f;
+		restitution = 0.0f;
+		restitutionThreshold = 1.0f * b2_lengthUnitsPerMeter;
+	}
+
+	/// The tile geometry, relative to the tile position.
+	const b2StaticChainDef* chains;
+	int32 chainCount;
+
+	/// The world position of the tile origin.
+	b2Vec2 position;
+
+	/// Use this to store application specific fixture data.
+	b2FixtureUserData userData;
+
+	/// The friction coefficient of all edges.
+	float friction;
+
+	/// The restitution of all edges.
+	float restitution;
+
+	/// The restitution velocity threshold of all edges.
+	float restitutionThreshold;
+
+	/// Contact filtering data for all edges.
+	b2Filter filter;
+};
+
+/// A streamed piece of static geometry. Adding and removing tiles is queued and the
+/// world works through the queue at the start of each time step within a time budget,
+/// see b2World::SetStaticTileBudget. Loading a tile builds its static layer in one
+/// pass instead of inserting edges into the broad-phase one by one.
+class B2_API b2StaticTile
+{
+public:
+
+	/// Has the tile been loaded? A tile is loaded by the first time step that
+	/// reaches it in the queue.
+	bool IsLoaded() const;
+
+	/// Get the static layer of the tile, or nullptr if the tile is not loaded.
+	/// The layer is destroyed with the tile; do not destroy it directly.
+	b2StaticLayer* GetLayer();
+
+	/// Get the world position of the tile origin.
+	const b2Vec2& GetPosition() const;
+
+	/// Get the next tile in the world tile list.
+	b2StaticTile* GetNext();
+
+private:
+
+	friend class b2World;
+
+	// The copied geometry, released once the layer is built.
+	b2StaticChainDef* m_chains;
+	int32 m_chainCount;
+
+	// The layer blob, owned by the tile.
+	void* m_data;
+
+	b2StaticLayerDef m_layerDef;
+	b2StaticLayer* m_layer;
+
+	bool m_removed;
+
+	// The world tile list.
+	b2StaticTile* m_prev;
+	b2StaticTile* m_next;
+
+	// The request queue.
+	b2StaticTile* m_queueNext;
+};
+
+inline b2Body* b2StaticLayer::GetBody()
+{
+	return m_body;
+}
+
+inline b2Fixture* b2StaticLayer::GetFixture()
+{
+	return m_fixture;
+}
+
+inline int32 b2StaticLayer::GetEdgeCount() const
+{
+	return m_edgeCount;
+}
+
+inline b2StaticLayer* b2StaticLayer::GetNext()
+{
+	return m_next;
+}
+
+inline const b2AABB& b2StaticLayer::GetEdgeAABB(int32 childIndex) const
+{
+	b2Assert(0 <= childIndex && childIndex < m_vertexCount - 1);
+	return m_aabbs[childIndex];
+}
+
+inline b2AABB b2StaticLayer::GetAABB() const
+{
+	if (m_root == b2_nullNode)
+	{
+		b2AABB aabb;
+		aabb.lowerBound.Set(b2_maxFloat, b2_maxFloat);
+		aabb.upperBound.Set(-b2_maxFloat, -b2_maxFloat);
+		return aabb;
+	}
+
+	return m_nodes[m_root].GetAABB();
+}
+
+inline bool b2StaticTile::IsLoaded() const
+{
+	return m_layer != nullptr;
+}
+
+inline b2StaticLayer* b2StaticTile::GetLayer()
+{
+	return m_layer;
+}
+
+inline const b2Vec2& b2StaticTile::GetPosition() const
+{
+	return m_layerDef.position;
+}
+
+inline b2StaticTile* b2StaticTile::GetNext()
+{
+	return m_next;
+}
+
+template <typename T>
+inline void b2StaticLayer::Query(T* callback, const b2AABB& aabb) const
+{
+	if (m_root == b2_nullNode)
+	{
+		return;
+	}
+
+	b2GrowableStack<int32, 256> stack;
+	stack.Push(m_root);
+
+	while (stack.GetCount() > 0)
+	{
+		const b2CompactNode* node = m_nodes + stack.Pop();
+		int32 mask = node->TestOverlap(aabb);
+
+		for (int32 i = 0; i < b2_compactTreeWidth; ++i)
+		{
+			int32 child = node->children[i];
+			if (child == b2_nullNode)
+			{
+				break;
+			}
+
+			if ((mask & (1 << i)) == 0)
+			{
+				continue;
+			}
+
+			if (b2CompactNode::IsLeaf(child))
+			{
+				// The quantized bounds are conservative, so test the exact bounds.
+				int32 childIndex = b2CompactNode::DecodeLeaf(child);
+				if (b2TestOverlap(m_aabbs[childIndex], aabb) == false)
+				{
+					continue;
+				}
+
+				bool proceed = callback->QueryCallback(childIndex);
+				if (proceed == false)
+				{
+					return;
+				}
+			}
+			else
+			{
+				stack.Push(child);
+			}
+		}
+	}
+}
+
+template <typename T>
+inline void b2StaticLayer::RayCast(T* callback, const b2RayCastInput& input) const
+{
+	if (m_root == b2_nullNode)
+	{
+		return;
+	}
+
+	b2Vec2 p1 = input.p1;
+	b2Vec2 p2 = input.p2;
+	b2Vec2 r = p2 - p1;
+	b2Assert(r.LengthSquared() > 0.0f);
+	r.Normalize();
+
+	// v is perpendicular to the segment.
+	b2Vec2 v = b2Cross(1.0f, r);
+	b2Vec2 abs_v = b2Abs(v);
+
+	float maxFraction = input.maxFraction;
+
+	// Build a bounding box for the segment.
+	b2AABB segmentAABB;
+	{
+		b2Vec2 t = p1 + maxFraction * (p2 - p1);
+		segmentAABB.lowerBound = b2Min(p1, t);
+		segmentAABB.upperBound = b2Max(p1, t);
+	}
+
+	b2GrowableStack<int32, 256> stack;
+	stack.Push(m_root);
+
+	while (stack.GetCount() > 0)
+	{
+		const b2CompactNode* node = m_nodes + stack.Pop();
+		int32 mask = node->TestSegment(p1, v, abs_v, segmentAABB);
+
+		for (int32 i = 0; i < b2_compactTreeWidth; ++i)
+		{
+			int32 child = node->children[i];
+			if (child == b2_nullNode)
+			{
+				break;
+			}
+
+			if ((mask & (1 << i)) == 0)
+			{
+				continue;
+			}
+
+			if (b2CompactNode::IsLeaf(child) == false)
+			{
+				stack.Push(child);
+				continue;
+			}
+
+			// The quantized bounds are conservative, so test the exact bounds.
+			int32 childIndex = b2CompactNode::DecodeLeaf(child);
+			const b2AABB& aabb = m_aabbs[childIndex];
+			if (b2TestOverlap(aabb, segmentAABB) == false)
+			{
+				continue;
+			}
+
+			b2Vec2 c = aabb.GetCenter();
+			b2Vec2 h = aabb.GetExtents();
+			float separation = b2Abs(b2Dot(v, p1 - c)) - b2Dot(abs_v, h);
+			if (separation > 0.0f)
+			{
+				continue;
+			}
+
+			b2RayCastInput subInput;
+			subInput.p1 = input.p1;
+			subInput.p2 = input.p2;
+			subInput.maxFraction = maxFraction;
+
+			float value = callback->RayCastCallback(subInput, childIndex);
+
+			if (value == 0.0f)
+			{
+				// The client has terminated the ray cast.
+				return;
+			}
+
+			if (value > 0.0f)
+			{
+				// Update segment bounding box.
+				maxFraction = value;
+				b2Vec2 t = p1 + maxFraction * (p2 - p1);
+				segmentAABB.lowerBound = b2Min(p1, t);
+				segmentAABB.upperBound = b2Max(p1, t);
+			}
+		}
+	}
+}
+
+#endif
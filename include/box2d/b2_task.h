@@ -0,0 +1,66 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef B2_TASK_H
+#define B2_TASK_H
+
+#include "b2_api.h"
+#include "b2_settings.h"
+
+/// A unit of work that is split into independent index ranges.
+class B2_API b2Task
+{
+public:
+	virtual ~b2Task() {}
+
+	/// Process the items in [startIndex, endIndex). Ranges never overlap, so
+	/// different ranges may be executed concurrently.
+	/// @param threadIndex the index of the executing thread, less than b2TaskExecutor::GetThreadCount.
+	virtual void Execute(int32 startIndex, int32 endIndex, int32 threadIndex) = 0;
+};
+
+/// Implement this class to run Box2D work on your own threads. The default
+/// implementation executes everything on the calling thread.
+class B2_API b2TaskExecutor
+{
+public:
+	virtual ~b2TaskExecutor() {}
+
+	/// The number of threads that may call b2Task::Execute concurrently.
+	virtual int32 GetThreadCount() const
+	{
+		return 1;
+	}
+
+	/// Execute the task over [0, itemCount). Split the items into ranges of at least
+	/// minRange items (except the last one) and return once all ranges are done.
+	virtual void ParallelFor(b2Task* task, int32 itemCount, int32 minRange)
+	{
+		B2_NOT_USED(minRange);
+		if (itemCount > 0)
+		{
+			task->Execute(0, itemCount, 0);
+		}
+	}
+};
+
+#endif
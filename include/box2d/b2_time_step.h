@@ -31,11 +31,58 @@ struct B2_API b2Profile
 	float step;
 	float collide;
 	float solve;
+	float buildIslands;
 	float solveInit;
 	float solveVelocity;
 	float solvePosition;
+	float synchronizeFixtures;
 	float broadphase;
 	float solveTOI;
+	float rope;
+	float tiles;
+
+	// The times above overlap: solve includes buildIslands through broadphase,
+	// broadphase includes synchronizeFixtures, and collide includes solveTOI
+	// (time spent in b2TimeOfImpact).
+
+	// Non-static bodies in awake islands
+	int32 awakeBodyCount;
+
+	// Awake islands
+	int32 islandCount;
+
+	// Touching contacts in awake islands
+	int32 touchingContactCount;
+
+	// Most graph colors used by an island
+	int32 graphColorCount;
+
+	// Constraints of colored islands that did not fit a color and were solved serially
+	int32 overflowConstraintCount;
+
+	// Revolute joints solved by the direct chain solver
+	int32 chainJointCount;
+
+	// Calls to b2TimeOfImpact
+	int32 toiCalls;
+
+	// Pairs found by the broad-phase, including pairs that already have a contact
+	int32 pairCount;
+
+	// Proxies the broad-phase queried for new pairs
+	int32 movedProxyCount;
+
+	// Dynamic tree rotations
+	int32 treeRotations;
+
+	// Peak stack allocator usage in bytes
+	int32 stackHighWater;
+
+	// Stack allocations that fell back to b2Alloc
+	int32 stackFallbacks;
+
+	// Heap allocations made during the step, see b2GetAllocationCount
+	int32 heapAllocations;
 };
 
 /// This is an internal structure.
@@ -47,6 +94,7 @@ struct B2_API b2TimeStep
 	int32 velocityIterations;
 	int32 positionIterations;
 	bool warmStarting;
+	bool subStepping;	// velocityIterations is the sub-step count
 };
 
 /// This is an internal structure.
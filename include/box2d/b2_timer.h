@@ -26,8 +26,8 @@
 #include "b2_api.h"
 #include "b2_settings.h"
 
-/// Timer for profiling. This has platform specific code and may
-/// not work on every platform.
+/// Timer for profiling. This uses a monotonic clock with nanosecond resolution
+/// where the platform has one, so it is not affected by wall clock adjustments.
 class B2_API b2Timer
 {
 public:
@@ -41,15 +41,43 @@ public:
 	/// Get the time since construction or the last reset.
 	float GetMilliseconds() const;
 
+	/// Get the time since construction or the last reset.
+	float GetMicroseconds() const;
+
+	/// Get the time since construction or the last reset.
+	unsigned long long GetNanoseconds() const;
+
+	/// Read the monotonic clock in nanoseconds. The origin is arbitrary.
+	static unsigned long long GetTicks();
+
 private:
 
-#if defined(_WIN32)
-	double m_start;
-	static double s_invFrequency;
-#elif defined(__linux__) || defined (__APPLE__)
-	unsigned long long m_start_sec;
-	unsigned long long m_start_usec;
-#endif
+	unsigned long long m_start;
+};
+
+/// Timer that reads the CPU cycle counter (rdtsc on x86, cntvct on arm64). This is
+/// cheaper to read than b2Timer, but cycles are not converted to time and the rate
+/// may differ between machines. Use it to compare costs within one run. Platforms
+/// without a cycle counter fall back to b2Timer nanoseconds.
+class B2_API b2CycleTimer
+{
+public:
+
+	/// Constructor
+	b2CycleTimer();
+
+	/// Reset the timer.
+	void Reset();
+
+	/// Get the cycles since construction or the last reset.
+	unsigned long long GetCycles() const;
+
+	/// Read the cycle counter. The origin is arbitrary.
+	static unsigned long long GetCounter();
+
+private:
+
+	unsigned long long m_start;
 };
 
 #endif
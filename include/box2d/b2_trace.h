@@ -0,0 +1,81 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef B2_TRACE_H
+#define B2_TRACE_H
+
+#include "b2_api.h"
+#include "b2_settings.h"
+
+/// Number of events kept by the trace ring buffer. Older events are overwritten.
+#define b2_traceCapacity (1 << 16)
+
+/// Record the start of a zone on the calling thread. The name must be a string
+/// literal or otherwise outlive the trace. Prefer the b2TraceZone macros, which
+/// compile to nothing unless B2_TRACE is defined.
+B2_API void b2TraceBegin(const char* name);
+
+/// Record the end of a zone on the calling thread.
+B2_API void b2TraceEnd(const char* name);
+
+/// Discard all recorded events.
+B2_API void b2TraceClear();
+
+/// Get the number of events currently held by the ring buffer.
+B2_API int32 b2TraceGetEventCount();
+
+/// Write the recorded events in the Chrome trace event format. The result loads in
+/// chrome://tracing and Perfetto. Do not call this while other threads are recording.
+/// @return false if the file could not be written
+B2_API bool b2TraceWrite(const char* fileName);
+
+/// Ends a zone when it goes out of scope.
+struct b2TraceScope
+{
+	explicit b2TraceScope(const char* name)
+	{
+		m_name = name;
+		b2TraceBegin(name);
+	}
+
+	~b2TraceScope()
+	{
+		b2TraceEnd(m_name);
+	}
+
+	const char* m_name;
+};
+
+#define b2_traceConcat2(a, b) a##b
+#define b2_traceConcat(a, b) b2_traceConcat2(a, b)
+
+#if defined(B2_TRACE)
+#define b2TraceZoneBegin(name) b2TraceBegin(name)
+#define b2TraceZoneEnd(name) b2TraceEnd(name)
+#define b2TraceZone(name) b2TraceScope b2_traceConcat(b2_traceScope, __LINE__)(name)
+#else
+#define b2TraceZoneBegin(name)
+#define b2TraceZoneEnd(name)
+#define b2TraceZone(name)
+#endif
+
+#endif
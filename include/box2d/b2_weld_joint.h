@@ -26,6 +26,8 @@
 #include "b2_api.h"
 #include "b2_joint.h"
 
+struct b2WeldConstraint;
+
 /// Weld joint definition. You need to specify local anchor points
 /// where they are attached and the relative body angle. The position
 /// of the anchor points is important for computing the reaction torque.
@@ -98,6 +100,7 @@ public:
 protected:
 
 	friend class b2Joint;
+	friend class b2Island;
 
 	b2WeldJoint(const b2WeldJointDef* def);
 
@@ -105,6 +108,15 @@ protected:
 	void SolveVelocityConstraints(const b2SolverData& data) override;
 	bool SolvePositionConstraints(const b2SolverData& data) override;
 
+	// The island solves its weld joints from a dense array, like the revolute joints.
+	// See b2WeldConstraint.
+	void PrepareConstraint(b2WeldConstraint* constraint, int32 jointIndex);
+	void StoreConstraint(const b2WeldConstraint* constraint);
+	static void InitVelocityBatch(b2WeldConstraint* constraints, int32 count, const b2SolverData& data);
+	static void SolveVelocityBatch(b2WeldConstraint* constraints, int32 count, const b2SolverData& data);
+	static bool SolvePositionBatch(const b2WeldConstraint* constraints, int32 count, const b2SolverData& data);
+	void Serialize(b2SnapshotArchive& archive) override;
+
 	float m_stiffness;
 	float m_damping;
 	float m_bias;
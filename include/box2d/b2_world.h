@@ -39,6 +39,14 @@ class b2Body;
 class b2Draw;
 class b2Fixture;
 class b2Joint;
+class b2RopeSystem;
+class b2SnapshotArchive;
+struct b2SleepingIsland;
+class b2StaticLayer;
+class b2StaticTile;
+struct b2StaticLayerDef;
+struct b2StaticTileDef;
+class b2TaskExecutor;
 
 /// The world class manages all physics entities, dynamic simulation,
 /// and asynchronous queries. The world also contains efficient memory
@@ -91,6 +99,39 @@ public:
 	/// @warning This function is locked during callbacks.
 	void DestroyJoint(b2Joint* joint);
 
+	/// Create a static layer from a blob built by b2BuildStaticLayer. The layer is
+	/// collided through its own prebuilt tree instead of the broad-phase, so loading
+	/// a large static level costs no fixture or proxy creation.
+	/// @return the layer, or nullptr if the blob is invalid.
+	/// @warning This function is locked during callbacks.
+	b2StaticLayer* CreateStaticLayer(const b2StaticLayerDef* def);
+
+	/// Destroy a static layer along with its body, fixture, and contacts. The blob
+	/// may be released after this.
+	/// @warning This function is locked during callbacks.
+	void DestroyStaticLayer(b2StaticLayer* layer);
+
+	/// Queue a static tile for loading. The tile is loaded by a later time step,
+	/// see SetStaticTileBudget. The geometry is copied.
+	/// @warning This function is locked during callbacks.
+	b2StaticTile* AddStaticTile(const b2StaticTileDef* def);
+
+	/// Queue a static tile for removal. The tile leaves the tile list at once, but
+	/// a loaded tile keeps colliding until the queue reaches it. The tile pointer must
+	/// not be used after this.
+	/// @warning This function is locked during callbacks.
+	void RemoveStaticTile(b2StaticTile* tile);
+
+	/// Limit the time each step spends on queued tile requests, in milliseconds. At least
+	/// one request is served per step, so keep tiles small. With a budget the step that
+	/// loads a tile depends on the speed of the machine. Zero, the default, serves all
+	/// requests in the next step.
+	void SetStaticTileBudget(float milliseconds) { m_tileBudget = milliseconds; }
+	float GetStaticTileBudget() const { return m_tileBudget; }
+
+	/// Get the number of queued tile requests.
+	int32 GetStaticTileQueueCount() const { return m_tileQueueCount; }
+
 	/// Take a time step. This performs collision detection, integration,
 	/// and constraint solution.
 	/// @param timeStep the amount of time to simulate, this should not vary.
@@ -146,6 +187,13 @@ public:
 	b2Contact* GetContactList();
 	const b2Contact* GetContactList() const;
 
+	/// Get the world static layer list. Use b2StaticLayer::GetNext to get the next layer.
+	b2StaticLayer* GetStaticLayerList();
+
+	/// Get the world static tile list, including tiles that are not loaded yet.
+	/// Use b2StaticTile::GetNext to get the next tile.
+	b2StaticTile* GetStaticTileList() { return m_tileList; }
+
 	/// Enable/disable sleep.
 	void SetAllowSleeping(bool flag);
 	bool GetAllowSleeping() const { return m_allowSleep; }
@@ -158,10 +206,50 @@ public:
 	void SetContinuousPhysics(bool flag) { m_useContinuous = flag; }
 	bool GetContinuousPhysics() const { return m_useContinuous; }
 
-	/// Enable/disable single stepped continuous physics. For testing.
+	/// Enable/disable the sub-stepping solver. When enabled, Step splits the time step
+	/// into velocityIterations sub-steps, each with one soft constraint solve and one
+	/// relax pass, and positionIterations is not used. Four sub-steps typically give
+	/// stiffer stacks than 8 velocity and 3 position iterations at lower cost.
 	void SetSubStepping(bool flag) { m_subStepping = flag; }
 	bool GetSubStepping() const { return m_subStepping; }
 
+	/// Enable/disable the direct chain solver. Chains of revolute joints without a limit
+	/// or motor, such as ropes and bridges, are solved as one linear system in each
+	/// iteration instead of one joint at a time, so they do not stretch with few
+	/// iterations. Branches, loops, and other joints still use the iterative solver.
+	void SetChainSolving(bool flag) { m_chainSolving = flag; }
+	bool GetChainSolving() const { return m_chainSolving; }
+
+	/// Enable/disable compact broad-phase queries. The compact tree is rebuilt at the
+	/// end of each time step and speeds up QueryAABB and RayCast in large worlds.
+	void SetCompactQueries(bool flag);
+	bool GetCompactQueries() const;
+
+	/// Run parts of the time step on worker threads. New contacts are created in
+	/// parallel, so the contact filter may be called from several threads at once.
+	/// With an executor, large islands are solved by graph color. This changes the
+	/// solver order, so results differ from a world without an executor, but not
+	/// between executors with different thread counts.
+	/// The executor is not owned by the world. Pass nullptr to run on the calling thread.
+	void SetTaskExecutor(b2TaskExecutor* executor);
+	b2TaskExecutor* GetTaskExecutor() { return m_contactManager.m_executor; }
+
+	/// Step a rope system with the world. Rope particles collide with fixtures and can
+	/// be attached to bodies, see b2RopeSystem. The ropes use the velocity iteration count.
+	/// Pass nullptr to remove the rope system. The rope system is not owned by the world.
+	void SetRopeSystem(b2RopeSystem* ropeSystem);
+	b2RopeSystem* GetRopeSystem() { return m_ropeSystem; }
+
+	/// Get the usage of the small object allocator that holds bodies, fixtures, contacts, and joints.
+	/// With a task executor, blocks kept by the contact creation threads count as live.
+	void GetBlockAllocatorStats(b2BlockAllocatorStats* stats) const;
+
+	/// Return unused small object memory to the system, for example after many bodies
+	/// were destroyed. This also returns the blocks kept by the contact creation threads.
+	/// This should be called outside of a time step.
+	/// @return the number of bytes released.
+	int32 TrimBlockAllocator();
+
 	/// Get the number of broad-phase proxies.
 	int32 GetProxyCount() const;
 
@@ -174,6 +262,10 @@ public:
 	/// Get the number of contacts (each may have 0 or more contact points).
 	int32 GetContactCount() const;
 
+	/// Get the number of sleeping islands. An island that falls asleep is kept as a unit
+	/// so that waking any of its bodies wakes all of them at once.
+	int32 GetSleepingIslandCount() const;
+
 	/// Get the height of the dynamic tree.
 	int32 GetTreeHeight() const;
 
@@ -214,12 +306,65 @@ public:
 	/// @warning this should be called outside of a time step.
 	void Dump();
 
+	/// Flags for ComputeStateHash.
+	enum
+	{
+		e_hashContacts			= 0x0001,	///< include contact manifolds and impulses
+		e_hashJointImpulses		= 0x0002	///< include joint impulses
+	};
+
+	/// Hash the simulation state for desync detection. Body transforms, velocities, and
+	/// sleep state are always included. The hash covers the exact bits in list order,
+	/// so two worlds match only if they will continue identically.
+	/// @param flags a combination of e_hashContacts and e_hashJointImpulses.
+	unsigned long long ComputeStateHash(uint32 flags = 0) const;
+
+	/// Get the number of bytes SaveSnapshot needs for the current world state.
+	int32 GetSnapshotSize() const;
+
+	/// Save the complete simulation state into a caller owned buffer. This covers bodies,
+	/// fixtures, joints, contacts with their warm starting impulses, and the broad-phase
+	/// tree, so a restored world continues bit for bit. The format is versioned but
+	/// native: restore only into a build with the same settings and pointer size.
+	/// Listeners, debug draw, rope attachments, and the profile are not saved. Worlds
+	/// with static layers or queued tiles are not supported.
+	/// @return the number of bytes written, or 0 if the buffer is too small or the
+	/// world has static layers.
+	/// @warning this should be called outside of a time step.
+	int32 SaveSnapshot(void* buffer, int32 capacity) const;
+
+	/// Replace the world contents with a snapshot from SaveSnapshot. All existing body,
+	/// fixture, joint, and contact pointers are invalidated without destruction or
+	/// contact callbacks. User data is restored with the saved values. Rope attachments
+	/// are released. This world must not have static layers or queued tiles.
+	/// @return false if the buffer is not a compatible snapshot. The world is left
+	/// unchanged when the header does not match and empty when the data is damaged.
+	/// @warning this should be called outside of a time step.
+	bool RestoreSnapshot(const void* buffer, int32 size);
+
+	/// Create an independent copy of this world for speculative simulation, such as
+	/// rollback or lookahead. The copy continues bit for bit like the original. It has
+	/// no listeners, contact filter, debug draw, task executor, or rope system; set these
+	/// on the copy if needed. Delete the copy when done.
+	/// @warning this should be called outside of a time step.
+	b2World* Clone() const;
+
+	/// Replace the contents of another world with a copy of this world. The block
+	/// allocator chunks and the broad-phase tree are copied in bulk and one pass moves
+	/// the pointers over; no body, fixture, contact or joint is created one by one.
+	/// This reuses the memory of the target, which makes repeated forks cheaper than
+	/// Clone. The target keeps its own listeners and other callbacks. Neither world may
+	/// have static layers or queued tiles.
+	/// @warning this should be called outside of a time step.
+	void CopyTo(b2World* world) const;
+
 private:
 
 	friend class b2Body;
 	friend class b2Fixture;
 	friend class b2ContactManager;
 	friend class b2Controller;
+	friend class b2RopeSystem;
 
 	b2World(const b2World&) = delete;
 	void operator=(const b2World&) = delete;
@@ -229,6 +374,26 @@ private:
 
 	void DrawShape(b2Fixture* shape, const b2Transform& xf, const b2Color& color);
 
+	// Snapshot support, see b2_world_snapshot.cpp
+	void WriteSnapshot(b2SnapshotArchive& archive);
+	bool ReadSnapshot(b2SnapshotArchive& archive);
+	void DestroyAll();
+
+	// Static tile streaming, see b2_world_tiles.cpp
+	void UpdateStaticTiles();
+	void FreeStaticTile(b2StaticTile* tile);
+
+	// Sleeping islands, see b2_world_sleep.cpp
+	b2SleepingIsland* CreateSleepingIsland(b2Body** bodies, int32 bodyCount, b2Contact** contacts, int32 contactCount,
+										   b2Joint** joints, int32 jointCount);
+	void WakeSleepingIsland(b2Body* body);
+	void RemoveSleepingBody(b2Body* body);
+	void RemoveSleepingJoint(b2Joint* joint);
+	void FreeSleepingIsland(b2SleepingIsland* island);
+	void ClearSleepingIslands();
+	void AddAwakeBody(b2Body* body);
+	void RemoveAwakeBody(b2Body* body);
+
 	b2BlockAllocator m_blockAllocator;
 	b2StackAllocator m_stackAllocator;
 
@@ -245,6 +410,7 @@ private:
 
 	b2DestructionListener* m_destructionListener;
 	b2Draw* m_debugDraw;
+	b2RopeSystem* m_ropeSystem;
 
 	// This is used to compute the time step ratio to
 	// support a variable time step.
@@ -258,9 +424,24 @@ private:
 	bool m_warmStarting;
 	bool m_useContinuous;
 	bool m_subStepping;
+	bool m_chainSolving;
 
 	bool m_stepComplete;
 
+	// Static tile streaming.
+	b2StaticTile* m_tileList;
+	b2StaticTile* m_tileQueueHead;
+	b2StaticTile* m_tileQueueTail;
+	int32 m_tileQueueCount;
+	float m_tileBudget;
+
+	// Sleeping islands that were not woken yet, see b2SleepingIsland.
+	int32 m_sleepingIslandCount;
+
+	// The bodies that can start an island, so sleeping ones are not visited each step.
+	b2Body* m_awakeBodyList;
+	int32 m_awakeBodyCount;
+
 	b2Profile m_profile;
 };
 
@@ -294,6 +475,11 @@ inline const b2Contact* b2World::GetContactList() const
 	return m_contactManager.m_contactList;
 }
 
+inline b2StaticLayer* b2World::GetStaticLayerList()
+{
+	return m_contactManager.m_layerList;
+}
+
 inline int32 b2World::GetBodyCount() const
 {
 	return m_bodyCount;
@@ -309,6 +495,11 @@ inline int32 b2World::GetContactCount() const
 	return m_contactManager.m_contactCount;
 }
 
+inline int32 b2World::GetSleepingIslandCount() const
+{
+	return m_sleepingIslandCount;
+}
+
 inline void b2World::SetGravity(const b2Vec2& gravity)
 {
 	m_gravity = gravity;
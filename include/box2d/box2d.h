@@ -40,6 +40,7 @@
 #include "b2_body.h"
 #include "b2_contact.h"
 #include "b2_fixture.h"
+#include "b2_static_layer.h"
 #include "b2_time_step.h"
 #include "b2_world.h"
 #include "b2_world_callbacks.h"
@@ -27,6 +27,11 @@ b2BroadPhase::b2BroadPhase()
 {
 	m_proxyCount = 0;
 
+	m_compactQueries = false;
+	m_compactValid = false;
+	m_compactRebuild = true;
+	m_compactMoveCount = 0;
+
 	m_pairCapacity = 16;
 	m_pairCount = 0;
 	m_pairBuffer = (b2Pair*)b2Alloc(m_pairCapacity * sizeof(b2Pair));
@@ -34,6 +39,9 @@ b2BroadPhase::b2BroadPhase()
 	m_moveCapacity = 16;
 	m_moveCount = 0;
 	m_moveBuffer = (int32*)b2Alloc(m_moveCapacity * sizeof(int32));
+
+	m_movedProxyCount = 0;
+	m_foundPairCount = 0;
 }
 
 b2BroadPhase::~b2BroadPhase()
@@ -46,6 +54,8 @@ int32 b2BroadPhase::CreateProxy(const b2AABB& aabb, void* userData)
 {
 	int32 proxyId = m_tree.CreateProxy(aabb, userData);
 	++m_proxyCount;
+	m_compactValid = false;
+	m_compactRebuild = true;
 	BufferMove(proxyId);
 	return proxyId;
 }
@@ -55,6 +65,8 @@ void b2BroadPhase::DestroyProxy(int32 proxyId)
 	UnBufferMove(proxyId);
 	--m_proxyCount;
 	m_tree.DestroyProxy(proxyId);
+	m_compactValid = false;
+	m_compactRebuild = true;
 }
 
 void b2BroadPhase::MoveProxy(int32 proxyId, const b2AABB& aabb)
@@ -63,7 +75,43 @@ void b2BroadPhase::MoveProxy(int32 proxyId, const b2AABB& aabb)
 	if (buffer)
 	{
 		BufferMove(proxyId);
+		m_compactValid = false;
+		++m_compactMoveCount;
+	}
+}
+
+void b2BroadPhase::SetCompactQueries(bool flag)
+{
+	m_compactQueries = flag;
+	if (flag == false)
+	{
+		m_compactTree.Clear();
+		m_compactValid = false;
+		m_compactRebuild = true;
+	}
+}
+
+void b2BroadPhase::UpdateCompactTree()
+{
+	if (m_compactQueries == false || m_compactValid)
+	{
+		return;
 	}
+
+	// Refitting keeps the structure, so the bounds get looser as proxies move.
+	// Rebuild once a significant fraction of the proxies has moved.
+	if (m_compactRebuild || 4 * m_compactMoveCount > m_proxyCount)
+	{
+		m_compactTree.Build(&m_tree);
+		m_compactRebuild = false;
+		m_compactMoveCount = 0;
+	}
+	else
+	{
+		m_compactTree.Refit();
+	}
+
+	m_compactValid = true;
 }
 
 void b2BroadPhase::TouchProxy(int32 proxyId)
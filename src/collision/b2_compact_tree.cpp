@@ -0,0 +1,265 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "box2d/b2_compact_tree.h"
+
+#include <math.h>
+
+// Compute the quantization step so that the largest quantized value covers the upper bound.
+static float b2ComputeQuantum(float lower, float upper)
+{
+	float quantum = (upper - lower) / b2_compactQuantizationMax;
+	while (lower + b2_compactQuantizationMax * quantum < upper)
+	{
+		quantum = nextafterf(quantum, b2_maxFloat);
+	}
+	return quantum;
+}
+
+// Quantize a lower bound, rounding down.
+static uint16 b2QuantizeLower(float value, float origin, float quantum)
+{
+	if (quantum == 0.0f)
+	{
+		return 0;
+	}
+
+	float q = b2Clamp(floorf((value - origin) / quantum), 0.0f, b2_compactQuantizationMax);
+	int32 i = int32(q);
+	while (i > 0 && origin + float(i) * quantum > value)
+	{
+		--i;
+	}
+	return uint16(i);
+}
+
+// Quantize an upper bound, rounding up.
+static uint16 b2QuantizeUpper(float value, float origin, float quantum)
+{
+	if (quantum == 0.0f)
+	{
+		return 0;
+	}
+
+	float q = b2Clamp(ceilf((value - origin) / quantum), 0.0f, b2_compactQuantizationMax);
+	int32 i = int32(q);
+	while (i < int32(b2_compactQuantizationMax) && origin + float(i) * quantum < value)
+	{
+		++i;
+	}
+	return uint16(i);
+}
+
+b2CompactTree::b2CompactTree()
+{
+	m_tree = nullptr;
+	m_nodes = nullptr;
+	m_nodeCount = 0;
+	m_nodeCapacity = 0;
+	m_root = b2_nullNode;
+}
+
+b2CompactTree::~b2CompactTree()
+{
+	if (m_nodes)
+	{
+		b2Free(m_nodes);
+	}
+}
+
+void b2CompactTree::Clear()
+{
+	m_nodeCount = 0;
+	m_root = b2_nullNode;
+}
+
+void b2CompactTree::Build(const b2DynamicTree* tree)
+{
+	m_tree = tree;
+	Clear();
+
+	if (tree->m_root == b2_nullNode)
+	{
+		return;
+	}
+
+	// A compact node consumes at least one internal binary node. The root may be a leaf.
+	int32 capacity = b2Max(tree->m_nodeCount, 1);
+	if (capacity > m_nodeCapacity)
+	{
+		if (m_nodes)
+		{
+			b2Free(m_nodes);
+		}
+
+		m_nodeCapacity = capacity;
+		m_nodes = (b2CompactNode*)b2Alloc(m_nodeCapacity * sizeof(b2CompactNode));
+	}
+
+	m_root = BuildNode(tree->m_root);
+}
+
+// Collapse a binary sub-tree into a compact node. Children are built after their parent,
+// so nodes are stored in depth first order.
+int32 b2CompactTree::BuildNode(int32 treeNodeId)
+{
+	const b2TreeNode* treeNodes = m_tree->m_nodes;
+
+	int32 candidates[b2_compactTreeWidth];
+	int32 count = 0;
+
+	if (treeNodes[treeNodeId].IsLeaf())
+	{
+		// Only the root can be a leaf.
+		candidates[count++] = treeNodeId;
+	}
+	else
+	{
+		candidates[count++] = treeNodes[treeNodeId].child1;
+		candidates[count++] = treeNodes[treeNodeId].child2;
+
+		// Pull up grandchildren, largest internal node first.
+		while (count < b2_compactTreeWidth)
+		{
+			int32 best = -1;
+			float bestPerimeter = -1.0f;
+			for (int32 i = 0; i < count; ++i)
+			{
+				const b2TreeNode* candidate = treeNodes + candidates[i];
+				if (candidate->IsLeaf())
+				{
+					continue;
+				}
+
+				float perimeter = candidate->aabb.GetPerimeter();
+				if (perimeter > bestPerimeter)
+				{
+					best = i;
+					bestPerimeter = perimeter;
+				}
+			}
+
+			if (best == -1)
+			{
+				break;
+			}
+
+			int32 expand = candidates[best];
+			candidates[best] = treeNodes[expand].child1;
+			candidates[count++] = treeNodes[expand].child2;
+		}
+	}
+
+	b2Assert(m_nodeCount < m_nodeCapacity);
+	int32 nodeId = m_nodeCount++;
+
+	b2AABB childAABBs[b2_compactTreeWidth];
+	for (int32 i = 0; i < count; ++i)
+	{
+		childAABBs[i] = treeNodes[candidates[i]].aabb;
+	}
+
+	m_nodes[nodeId].SetBounds(treeNodes[treeNodeId].aabb, childAABBs, count);
+
+	for (int32 i = 0; i < count; ++i)
+	{
+		int32 candidate = candidates[i];
+		int32 child;
+		if (treeNodes[candidate].IsLeaf())
+		{
+			child = b2CompactNode::EncodeLeaf(candidate);
+		}
+		else
+		{
+			child = BuildNode(candidate);
+		}
+
+		m_nodes[nodeId].children[i] = child;
+	}
+
+	for (int32 i = count; i < b2_compactTreeWidth; ++i)
+	{
+		m_nodes[nodeId].children[i] = b2_nullNode;
+	}
+
+	return nodeId;
+}
+
+// Set the node frame and quantize the child bounds.
+void b2CompactNode::SetBounds(const b2AABB& bounds, const b2AABB* childAABBs, int32 count)
+{
+	origin = bounds.lowerBound;
+	quantum.x = b2ComputeQuantum(bounds.lowerBound.x, bounds.upperBound.x);
+	quantum.y = b2ComputeQuantum(bounds.lowerBound.y, bounds.upperBound.y);
+
+	for (int32 i = 0; i < b2_compactTreeWidth; ++i)
+	{
+		if (i < count)
+		{
+			const b2AABB& aabb = childAABBs[i];
+			lowerX[i] = b2QuantizeLower(aabb.lowerBound.x, origin.x, quantum.x);
+			lowerY[i] = b2QuantizeLower(aabb.lowerBound.y, origin.y, quantum.y);
+			upperX[i] = b2QuantizeUpper(aabb.upperBound.x, origin.x, quantum.x);
+			upperY[i] = b2QuantizeUpper(aabb.upperBound.y, origin.y, quantum.y);
+		}
+		else
+		{
+			lowerX[i] = 0;
+			lowerY[i] = 0;
+			upperX[i] = 0;
+			upperY[i] = 0;
+		}
+	}
+}
+
+// Children are stored after their parent, so a reverse sweep updates children first.
+void b2CompactTree::Refit()
+{
+	for (int32 nodeId = m_nodeCount - 1; nodeId >= 0; --nodeId)
+	{
+		const b2CompactNode* node = m_nodes + nodeId;
+
+		b2AABB childAABBs[b2_compactTreeWidth];
+		int32 count = 0;
+		while (count < b2_compactTreeWidth && node->children[count] != b2_nullNode)
+		{
+			int32 child = node->children[count];
+			if (b2CompactNode::IsLeaf(child))
+			{
+				childAABBs[count] = m_tree->GetFatAABB(b2CompactNode::DecodeLeaf(child));
+			}
+			else
+			{
+				b2Assert(child > nodeId);
+				childAABBs[count] = m_nodes[child].GetAABB();
+			}
+			++count;
+		}
+
+		b2AABB bounds = childAABBs[0];
+		for (int32 i = 1; i < count; ++i)
+		{
+			bounds.Combine(childAABBs[i]);
+		}
+
+		m_nodes[nodeId].SetBounds(bounds, childAABBs, count);
+	}
+}
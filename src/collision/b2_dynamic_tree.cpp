@@ -42,6 +42,7 @@ b2DynamicTree::b2DynamicTree()
 	m_freeList = 0;
 
 	m_insertionCount = 0;
+	m_rotationCount = 0;
 }
 
 b2DynamicTree::~b2DynamicTree()
@@ -63,6 +64,7 @@ int32 b2DynamicTree::AllocateNode()
 		m_nodeCapacity *= 2;
 		m_nodes = (b2TreeNode*)b2Alloc(m_nodeCapacity * sizeof(b2TreeNode));
 		memcpy(m_nodes, oldNodes, m_nodeCount * sizeof(b2TreeNode));
+		memset(m_nodes + m_nodeCount, 0, (m_nodeCapacity - m_nodeCount) * sizeof(b2TreeNode));
 		b2Free(oldNodes);
 
 		// Build a linked list for the free list. The parent
@@ -397,6 +399,8 @@ int32 b2DynamicTree::Balance(int32 iA)
 	// Rotate C up
 	if (balance > 1)
 	{
+		++m_rotationCount;
+
 		int32 iF = C->child1;
 		int32 iG = C->child2;
 		b2TreeNode* F = m_nodes + iF;
@@ -457,6 +461,8 @@ int32 b2DynamicTree::Balance(int32 iA)
 	// Rotate B up
 	if (balance < -1)
 	{
+		++m_rotationCount;
+
 		int32 iD = B->child1;
 		int32 iE = B->child2;
 		b2TreeNode* D = m_nodes + iD;
@@ -0,0 +1,396 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "box2d/b2_static_layer.h"
+#include "box2d/b2_chain_shape.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define b2_staticLayerMagic 0x4c533262
+#define b2_staticLayerVersion 1
+
+// The blob starts with this header. Offsets are in bytes from the start of the blob.
+struct b2StaticLayerHeader
+{
+	uint32 magic;
+	int32 version;
+	int32 byteCount;
+	int32 vertexCount;
+	int32 edgeCount;
+	int32 nodeCount;
+	int32 root;
+	int32 vertexOffset;
+	int32 aabbOffset;
+	int32 nodeOffset;
+};
+
+struct b2StaticLayerItem
+{
+	b2Vec2 center;
+	int32 childIndex;
+};
+
+static int b2CompareItemsX(const void* a, const void* b)
+{
+	const b2StaticLayerItem* ia = (const b2StaticLayerItem*)a;
+	const b2StaticLayerItem* ib = (const b2StaticLayerItem*)b;
+	if (ia->center.x != ib->center.x)
+	{
+		return ia->center.x < ib->center.x ? -1 : 1;
+	}
+	return ia->childIndex - ib->childIndex;
+}
+
+static int b2CompareItemsY(const void* a, const void* b)
+{
+	const b2StaticLayerItem* ia = (const b2StaticLayerItem*)a;
+	const b2StaticLayerItem* ib = (const b2StaticLayerItem*)b;
+	if (ia->center.y != ib->center.y)
+	{
+		return ia->center.y < ib->center.y ? -1 : 1;
+	}
+	return ia->childIndex - ib->childIndex;
+}
+
+// Sort the items along the longest axis of their centers.
+static void b2SortItems(b2StaticLayerItem* items, int32 count)
+{
+	b2Vec2 lower = items[0].center;
+	b2Vec2 upper = items[0].center;
+	for (int32 i = 1; i < count; ++i)
+	{
+		lower = b2Min(lower, items[i].center);
+		upper = b2Max(upper, items[i].center);
+	}
+
+	b2Vec2 d = upper - lower;
+	qsort(items, count, sizeof(b2StaticLayerItem), d.x >= d.y ? b2CompareItemsX : b2CompareItemsY);
+}
+
+struct b2StaticLayerBuilder
+{
+	// Build a node over the items with a top down median split. Children are stored
+	// after their parent, like b2CompactTree.
+	int32 BuildNode(b2StaticLayerItem* items, int32 count)
+	{
+		int32 starts[b2_compactTreeWidth + 1];
+		int32 groupCount;
+
+		if (count <= b2_compactTreeWidth)
+		{
+			groupCount = count;
+			for (int32 i = 0; i <= count; ++i)
+			{
+				starts[i] = i;
+			}
+		}
+		else
+		{
+			// Split in half, then split each half again.
+			int32 half = count / 2;
+			b2SortItems(items, count);
+			b2SortItems(items, half);
+			b2SortItems(items + half, count - half);
+
+			groupCount = 4;
+			starts[0] = 0;
+			starts[1] = half / 2;
+			starts[2] = half;
+			starts[3] = half + (count - half) / 2;
+			starts[4] = count;
+		}
+
+		b2AABB groupAABBs[b2_compactTreeWidth];
+		b2AABB bounds;
+		for (int32 i = 0; i < groupCount; ++i)
+		{
+			b2AABB aabb = aabbs[items[starts[i]].childIndex];
+			for (int32 j = starts[i] + 1; j < starts[i + 1]; ++j)
+			{
+				aabb.Combine(aabbs[items[j].childIndex]);
+			}
+
+			groupAABBs[i] = aabb;
+			if (i == 0)
+			{
+				bounds = aabb;
+			}
+			else
+			{
+				bounds.Combine(aabb);
+			}
+		}
+
+		b2Assert(nodeCount < nodeCapacity);
+		int32 nodeId = nodeCount++;
+		nodes[nodeId].SetBounds(bounds, groupAABBs, groupCount);
+
+		for (int32 i = 0; i < b2_compactTreeWidth; ++i)
+		{
+			int32 child = b2_nullNode;
+			if (i < groupCount)
+			{
+				int32 groupSize = starts[i + 1] - starts[i];
+				if (groupSize == 1)
+				{
+					child = b2CompactNode::EncodeLeaf(items[starts[i]].childIndex);
+				}
+				else
+				{
+					child = BuildNode(items + starts[i], groupSize);
+				}
+			}
+
+			nodes[nodeId].children[i] = child;
+		}
+
+		return nodeId;
+	}
+
+	const b2AABB* aabbs;
+	b2CompactNode* nodes;
+	int32 nodeCount;
+	int32 nodeCapacity;
+};
+
+// Keep every array 4 byte aligned.
+static int32 b2AlignLayerOffset(int32 offset)
+{
+	return (offset + 3) & ~3;
+}
+
+int32 b2BuildStaticLayer(const b2StaticChainDef* chains, int32 chainCount, void* buffer, int32 capacity)
+{
+	b2Assert(chainCount >= 0);
+
+	// Chains are packed with their ghost vertices in place, so that every edge reads
+	// its neighbors from the shared array: [prev, v0, ..., vn-1, next]. A loop is
+	// stored as [vn-1, v0, ..., vn-1, v0, v1]. The edges that join two chains are
+	// left out of the tree.
+	int32 vertexCount = 0;
+	int32 edgeCount = 0;
+	for (int32 i = 0; i < chainCount; ++i)
+	{
+		const b2StaticChainDef* def = chains + i;
+		b2Assert(def->vertices != nullptr);
+		if (def->loop)
+		{
+			b2Assert(def->count >= 3);
+			vertexCount += def->count + 3;
+			edgeCount += def->count;
+		}
+		else
+		{
+			b2Assert(def->count >= 2);
+			vertexCount += def->count + 2;
+			edgeCount += def->count - 1;
+		}
+	}
+
+	// Every internal node has at least two children.
+	int32 nodeCapacity = b2Max(edgeCount - 1, 1);
+
+	b2StaticLayerHeader header;
+	header.magic = b2_staticLayerMagic;
+	header.version = b2_staticLayerVersion;
+	header.vertexCount = vertexCount;
+	header.edgeCount = edgeCount;
+	header.vertexOffset = b2AlignLayerOffset(int32(sizeof(b2StaticLayerHeader)));
+	header.aabbOffset = b2AlignLayerOffset(header.vertexOffset + vertexCount * int32(sizeof(b2Vec2)));
+	header.nodeOffset = b2AlignLayerOffset(header.aabbOffset + b2Max(vertexCount - 1, 0) * int32(sizeof(b2AABB)));
+
+	// The exact node count is only known after the build, so reserve the worst case.
+	int32 byteCount = header.nodeOffset + nodeCapacity * int32(sizeof(b2CompactNode));
+	if (buffer == nullptr || capacity < byteCount)
+	{
+		return byteCount;
+	}
+
+	b2Assert((((uintptr_t)buffer) & 3) == 0);
+	uint8* data = (uint8*)buffer;
+	b2Vec2* vertices = (b2Vec2*)(data + header.vertexOffset);
+	b2AABB* aabbs = (b2AABB*)(data + header.aabbOffset);
+	b2CompactNode* nodes = (b2CompactNode*)(data + header.nodeOffset);
+
+	b2StaticLayerItem* items = (b2StaticLayerItem*)b2Alloc(b2Max(edgeCount, 1) * sizeof(b2StaticLayerItem));
+
+	int32 vertexIndex = 0;
+	int32 itemCount = 0;
+	for (int32 i = 0; i < chainCount; ++i)
+	{
+		const b2StaticChainDef* def = chains + i;
+		int32 n = def->count;
+
+		for (int32 j = 1; j < n; ++j)
+		{
+			// If the code crashes here, it means your vertices are too close together.
+			b2Assert(b2DistanceSquared(def->vertices[j-1], def->vertices[j]) > b2_linearSlop * b2_linearSlop);
+		}
+
+		int32 first = vertexIndex + 1;
+		int32 chainEdgeCount;
+		if (def->loop)
+		{
+			vertices[vertexIndex] = def->vertices[n - 1];
+			memcpy(vertices + first, def->vertices, n * sizeof(b2Vec2));
+			vertices[first + n] = def->vertices[0];
+			vertices[first + n + 1] = def->vertices[1];
+			vertexIndex += n + 3;
+			chainEdgeCount = n;
+		}
+		else
+		{
+			vertices[vertexIndex] = def->prevVertex;
+			memcpy(vertices + first, def->vertices, n * sizeof(b2Vec2));
+			vertices[first + n] = def->nextVertex;
+			vertexIndex += n + 2;
+			chainEdgeCount = n - 1;
+		}
+
+		for (int32 j = 0; j < chainEdgeCount; ++j)
+		{
+			items[itemCount].childIndex = first + j;
+			++itemCount;
+		}
+	}
+
+	b2Assert(vertexIndex == vertexCount);
+	b2Assert(itemCount == edgeCount);
+
+	// Compute the bounds with the chain shape, so they match the contact manager exactly.
+	// The joints between chains get empty bounds.
+	b2AABB empty;
+	empty.lowerBound.Set(b2_maxFloat, b2_maxFloat);
+	empty.upperBound.Set(-b2_maxFloat, -b2_maxFloat);
+	for (int32 i = 0; i < vertexCount - 1; ++i)
+	{
+		aabbs[i] = empty;
+	}
+
+	b2ChainShape chain;
+	chain.m_vertices = vertices;
+	chain.m_count = vertexCount;
+
+	b2Transform xf;
+	xf.SetIdentity();
+	for (int32 i = 0; i < edgeCount; ++i)
+	{
+		int32 childIndex = items[i].childIndex;
+		chain.ComputeAABB(aabbs + childIndex, xf, childIndex);
+		items[i].center = aabbs[childIndex].GetCenter();
+	}
+
+	// The chain does not own the vertices.
+	chain.m_vertices = nullptr;
+	chain.m_count = 0;
+
+	b2StaticLayerBuilder builder;
+	builder.aabbs = aabbs;
+	builder.nodes = nodes;
+	builder.nodeCount = 0;
+	builder.nodeCapacity = nodeCapacity;
+
+	header.root = b2_nullNode;
+	if (edgeCount > 0)
+	{
+		header.root = builder.BuildNode(items, edgeCount);
+	}
+
+	b2Free(items);
+
+	header.nodeCount = builder.nodeCount;
+	header.byteCount = header.nodeOffset + header.nodeCount * int32(sizeof(b2CompactNode));
+	memcpy(data, &header, sizeof(b2StaticLayerHeader));
+
+	// Clear the unused node space, so the output does not depend on the buffer contents.
+	memset(data + header.byteCount, 0, byteCount - header.byteCount);
+
+	return header.byteCount;
+}
+
+bool b2StaticLayer::Initialize(const void* data, int32 size)
+{
+	if (data == nullptr || size < int32(sizeof(b2StaticLayerHeader)) || (((uintptr_t)data) & 3) != 0)
+	{
+		return false;
+	}
+
+	b2StaticLayerHeader header;
+	memcpy(&header, data, sizeof(b2StaticLayerHeader));
+
+	if (header.magic != b2_staticLayerMagic ||
+		header.version != b2_staticLayerVersion ||
+		header.byteCount > size ||
+		header.vertexOffset < int32(sizeof(b2StaticLayerHeader)) ||
+		header.vertexCount < 0 || header.edgeCount < 0 || header.nodeCount < 0 ||
+		header.vertexCount > size / int32(sizeof(b2Vec2)) ||
+		header.nodeCount > size / int32(sizeof(b2CompactNode)) ||
+		header.edgeCount > header.vertexCount ||
+		header.vertexOffset + header.vertexCount * int32(sizeof(b2Vec2)) > header.aabbOffset ||
+		header.aabbOffset + b2Max(header.vertexCount - 1, 0) * int32(sizeof(b2AABB)) > header.nodeOffset ||
+		header.nodeOffset + header.nodeCount * int32(sizeof(b2CompactNode)) > header.byteCount ||
+		header.root < b2_nullNode || header.root >= header.nodeCount ||
+		(header.root == b2_nullNode && header.edgeCount > 0))
+	{
+		return false;
+	}
+
+	const uint8* bytes = (const uint8*)data;
+
+	// The queries trust the tree, so check every child reference. The builder writes
+	// parents before their children, which also rules out cycles. Leaves must name an
+	// edge of the chains.
+	const b2CompactNode* nodes = (const b2CompactNode*)(bytes + header.nodeOffset);
+	for (int32 i = 0; i < header.nodeCount; ++i)
+	{
+		for (int32 j = 0; j < b2_compactTreeWidth; ++j)
+		{
+			int32 child = nodes[i].children[j];
+			if (child == b2_nullNode)
+			{
+				break;
+			}
+
+			if (b2CompactNode::IsLeaf(child))
+			{
+				// The last edge starts at vertex count - 2.
+				if (child < b2CompactNode::EncodeLeaf(header.vertexCount - 2))
+				{
+					return false;
+				}
+			}
+			else if (child <= i || child >= header.nodeCount)
+			{
+				return false;
+			}
+		}
+	}
+
+	m_vertices = (const b2Vec2*)(bytes + header.vertexOffset);
+	m_vertexCount = header.vertexCount;
+	m_aabbs = (const b2AABB*)(bytes + header.aabbOffset);
+	m_edgeCount = header.edgeCount;
+	m_nodes = (const b2CompactNode*)(bytes + header.nodeOffset);
+	m_nodeCount = header.nodeCount;
+	m_root = header.root;
+	return true;
+}
@@ -24,9 +24,10 @@
 #include <limits.h>
 #include <string.h>
 #include <stddef.h>
+#include <stdlib.h>
 
-static const int32 b2_chunkSize = 16 * 1024;
-static const int32 b2_maxBlockSize = 640;
+static const int32 b2_chunkShift = 14;
+static const int32 b2_chunkSize = 1 << b2_chunkShift;
 static const int32 b2_chunkArrayIncrement = 128;
 
 // These are the supported object sizes. Actual allocations are rounded up the next size.
@@ -86,6 +87,13 @@ struct b2Block
 	b2Block* next;
 };
 
+// A chunk of the source of b2BlockAllocator::Copy and its copy.
+struct b2ChunkRelocation
+{
+	const int8* source;
+	int8* target;
+};
+
 b2BlockAllocator::b2BlockAllocator()
 {
 	b2Assert(b2_blockSizeCount < UCHAR_MAX);
@@ -96,6 +104,14 @@ b2BlockAllocator::b2BlockAllocator()
 	
 	memset(m_chunks, 0, m_chunkSpace * sizeof(b2Chunk));
 	memset(m_freeLists, 0, sizeof(m_freeLists));
+	memset(m_liveCounts, 0, sizeof(m_liveCounts));
+	memset(m_chunkCounts, 0, sizeof(m_chunkCounts));
+	m_largeCount = 0;
+	m_largeBytes = 0;
+	m_relocations = nullptr;
+	m_relocationCapacity = 0;
+	m_lock.clear();
+	m_boundCount.store(0);
 }
 
 b2BlockAllocator::~b2BlockAllocator()
@@ -106,8 +122,12 @@ b2BlockAllocator::~b2BlockAllocator()
 	}
 
 	b2Free(m_chunks);
+	b2Free(m_relocations);
 }
 
+// The cache bound to the calling thread, if any.
+static thread_local b2BlockAllocatorCache* b2_threadCache = nullptr;
+
 void* b2BlockAllocator::Allocate(int32 size)
 {
 	if (size == 0)
@@ -117,14 +137,31 @@ void* b2BlockAllocator::Allocate(int32 size)
 
 	b2Assert(0 < size);
 
+	b2BlockAllocatorCache* cache = b2_threadCache;
+	if (cache != nullptr && cache->m_allocator == this)
+	{
+		return cache->Allocate(size);
+	}
+
+	// This path is not locked, so no other thread may be in a cache.
+	b2Assert(m_boundCount.load(std::memory_order_relaxed) == 0);
+
 	if (size > b2_maxBlockSize)
 	{
+		++m_largeCount;
+		m_largeBytes += size;
 		return b2Alloc(size);
 	}
 
 	int32 index = b2_sizeMap.values[size];
 	b2Assert(0 <= index && index < b2_blockSizeCount);
 
+	++m_liveCounts[index];
+	return AllocateBlock(index);
+}
+
+void* b2BlockAllocator::AllocateBlock(int32 index)
+{
 	if (m_freeLists[index])
 	{
 		b2Block* block = m_freeLists[index];
@@ -163,6 +200,7 @@ void* b2BlockAllocator::Allocate(int32 size)
 
 		m_freeLists[index] = chunk->blocks->next;
 		++m_chunkCount;
+		++m_chunkCounts[index];
 
 		return chunk->blocks;
 	}
@@ -177,8 +215,19 @@ void b2BlockAllocator::Free(void* p, int32 size)
 
 	b2Assert(0 < size);
 
+	b2BlockAllocatorCache* cache = b2_threadCache;
+	if (cache != nullptr && cache->m_allocator == this)
+	{
+		cache->Free(p, size);
+		return;
+	}
+
+	b2Assert(m_boundCount.load(std::memory_order_relaxed) == 0);
+
 	if (size > b2_maxBlockSize)
 	{
+		--m_largeCount;
+		m_largeBytes -= size;
 		b2Free(p);
 		return;
 	}
@@ -186,6 +235,9 @@ void b2BlockAllocator::Free(void* p, int32 size)
 	int32 index = b2_sizeMap.values[size];
 	b2Assert(0 <= index && index < b2_blockSizeCount);
 
+	b2Assert(m_liveCounts[index] > 0);
+	--m_liveCounts[index];
+
 #if defined(_DEBUG)
 	// Verify the memory address and size is valid.
 	int32 blockSize = b2_blockSizes[index];
@@ -227,4 +279,402 @@ void b2BlockAllocator::Clear()
 	m_chunkCount = 0;
 	memset(m_chunks, 0, m_chunkSpace * sizeof(b2Chunk));
 	memset(m_freeLists, 0, sizeof(m_freeLists));
+	memset(m_liveCounts, 0, sizeof(m_liveCounts));
+	memset(m_chunkCounts, 0, sizeof(m_chunkCounts));
+}
+
+static int b2CompareChunks(const void* a, const void* b)
+{
+	const b2Chunk* chunkA = (const b2Chunk*)a;
+	const b2Chunk* chunkB = (const b2Chunk*)b;
+	if (chunkA->blocks < chunkB->blocks)
+	{
+		return -1;
+	}
+	return chunkA->blocks > chunkB->blocks ? 1 : 0;
+}
+
+// Find the chunk holding a block. The chunks must be sorted by address.
+static int32 b2FindChunk(const b2Chunk* chunks, int32 count, const b2Block* block)
+{
+	int32 low = 0;
+	int32 high = count - 1;
+	while (low < high)
+	{
+		int32 mid = (low + high + 1) / 2;
+		if (chunks[mid].blocks <= block)
+		{
+			low = mid;
+		}
+		else
+		{
+			high = mid - 1;
+		}
+	}
+
+	b2Assert((const int8*)chunks[low].blocks <= (const int8*)block);
+	b2Assert((const int8*)block < (const int8*)chunks[low].blocks + b2_chunkSize);
+	return low;
+}
+
+int32 b2BlockAllocator::Trim()
+{
+	// Quick out if no size class has a whole chunk worth of free blocks.
+	bool candidate = false;
+	for (int32 i = 0; i < b2_blockSizeCount; ++i)
+	{
+		int32 freeCount = m_chunkCounts[i] * (b2_chunkSize / b2_blockSizes[i]) - m_liveCounts[i];
+		if (freeCount >= b2_chunkSize / b2_blockSizes[i])
+		{
+			candidate = true;
+			break;
+		}
+	}
+
+	if (candidate == false)
+	{
+		return 0;
+	}
+
+	qsort(m_chunks, m_chunkCount, sizeof(b2Chunk), b2CompareChunks);
+
+	// Count the free blocks of each chunk.
+	int32* freeCounts = (int32*)b2Alloc(m_chunkCount * sizeof(int32));
+	memset(freeCounts, 0, m_chunkCount * sizeof(int32));
+
+	for (int32 i = 0; i < b2_blockSizeCount; ++i)
+	{
+		for (b2Block* block = m_freeLists[i]; block; block = block->next)
+		{
+			++freeCounts[b2FindChunk(m_chunks, m_chunkCount, block)];
+		}
+	}
+
+	// Unlink the blocks of empty chunks from the free lists.
+	for (int32 i = 0; i < b2_blockSizeCount; ++i)
+	{
+		int32 blockCount = b2_chunkSize / b2_blockSizes[i];
+		b2Block** link = m_freeLists + i;
+		while (*link)
+		{
+			b2Block* block = *link;
+			if (freeCounts[b2FindChunk(m_chunks, m_chunkCount, block)] == blockCount)
+			{
+				*link = block->next;
+			}
+			else
+			{
+				link = &block->next;
+			}
+		}
+	}
+
+	// Release the empty chunks and compact the chunk array.
+	int32 released = 0;
+	int32 chunkCount = 0;
+	for (int32 i = 0; i < m_chunkCount; ++i)
+	{
+		b2Chunk* chunk = m_chunks + i;
+		if (freeCounts[i] == b2_chunkSize / chunk->blockSize)
+		{
+			--m_chunkCounts[b2_sizeMap.values[chunk->blockSize]];
+			b2Free(chunk->blocks);
+			released += b2_chunkSize;
+		}
+		else
+		{
+			m_chunks[chunkCount++] = *chunk;
+		}
+	}
+
+	memset(m_chunks + chunkCount, 0, (m_chunkCount - chunkCount) * sizeof(b2Chunk));
+	m_chunkCount = chunkCount;
+
+	b2Free(freeCounts);
+
+	return released;
+}
+
+void b2BlockAllocator::GetStats(b2BlockAllocatorStats* stats) const
+{
+	for (int32 i = 0; i < b2_blockSizeCount; ++i)
+	{
+		b2BlockSizeStats* size = stats->sizes + i;
+		size->blockSize = b2_blockSizes[i];
+		size->liveBlocks = m_liveCounts[i];
+		size->freeBlocks = m_chunkCounts[i] * (b2_chunkSize / b2_blockSizes[i]) - m_liveCounts[i];
+		size->chunkCount = m_chunkCounts[i];
+	}
+
+	stats->chunkCount = m_chunkCount;
+	stats->chunkBytes = m_chunkCount * b2_chunkSize;
+	stats->largeCount = m_largeCount;
+	stats->largeBytes = m_largeBytes;
+}
+
+// The relocation table is keyed by the 16K page of an address, using b2_chunkShift.
+static inline uint32 b2HashPage(uintptr_t page, uint32 mask)
+{
+	uint64_t h = uint64_t(page) * 0x9E3779B97F4A7C15ull;
+	return uint32(h >> 32) & mask;
+}
+
+void b2BlockAllocator::Copy(const b2BlockAllocator* source)
+{
+	b2Assert(source != this);
+	b2Assert(m_boundCount.load(std::memory_order_relaxed) == 0);
+	b2Assert(source->m_boundCount.load(std::memory_order_relaxed) == 0);
+
+	int32 chunkCount = source->m_chunkCount;
+	if (chunkCount > m_chunkSpace)
+	{
+		b2Chunk* oldChunks = m_chunks;
+		m_chunkSpace = source->m_chunkSpace;
+		m_chunks = (b2Chunk*)b2Alloc(m_chunkSpace * sizeof(b2Chunk));
+		memcpy(m_chunks, oldChunks, m_chunkCount * sizeof(b2Chunk));
+		memset(m_chunks + m_chunkCount, 0, (m_chunkSpace - m_chunkCount) * sizeof(b2Chunk));
+		b2Free(oldChunks);
+	}
+
+	// Keep the chunk memory that is already there.
+	for (int32 i = m_chunkCount; i < chunkCount; ++i)
+	{
+		m_chunks[i].blocks = (b2Block*)b2Alloc(b2_chunkSize);
+	}
+
+	for (int32 i = chunkCount; i < m_chunkCount; ++i)
+	{
+		b2Free(m_chunks[i].blocks);
+		m_chunks[i].blocks = nullptr;
+		m_chunks[i].blockSize = 0;
+	}
+
+	m_chunkCount = chunkCount;
+
+	// Each chunk overlaps two pages at most and is entered for both. The table is kept
+	// at most half full.
+	int32 capacity = 16;
+	while (capacity < 4 * chunkCount)
+	{
+		capacity *= 2;
+	}
+
+	if (capacity > m_relocationCapacity)
+	{
+		b2Free(m_relocations);
+		m_relocationCapacity = capacity;
+		m_relocations = (b2ChunkRelocation*)b2Alloc(capacity * sizeof(b2ChunkRelocation));
+	}
+
+	memset(m_relocations, 0, m_relocationCapacity * sizeof(b2ChunkRelocation));
+	uint32 mask = uint32(m_relocationCapacity - 1);
+
+	for (int32 i = 0; i < chunkCount; ++i)
+	{
+		const b2Chunk* sourceChunk = source->m_chunks + i;
+		b2Chunk* chunk = m_chunks + i;
+		memcpy(chunk->blocks, sourceChunk->blocks, b2_chunkSize);
+		chunk->blockSize = sourceChunk->blockSize;
+
+		const int8* start = (const int8*)sourceChunk->blocks;
+		uintptr_t firstPage = uintptr_t(start) >> b2_chunkShift;
+		uintptr_t lastPage = uintptr_t(start + b2_chunkSize - 1) >> b2_chunkShift;
+		for (uintptr_t page = firstPage; page <= lastPage; ++page)
+		{
+			uint32 slot = b2HashPage(page, mask);
+			while (m_relocations[slot].source != nullptr)
+			{
+				slot = (slot + 1) & mask;
+			}
+
+			m_relocations[slot].source = start;
+			m_relocations[slot].target = (int8*)chunk->blocks;
+		}
+	}
+
+	memcpy(m_liveCounts, source->m_liveCounts, sizeof(m_liveCounts));
+	memcpy(m_chunkCounts, source->m_chunkCounts, sizeof(m_chunkCounts));
+
+	// The free lists are linked through the copied blocks.
+	for (int32 i = 0; i < b2_blockSizeCount; ++i)
+	{
+		m_freeLists[i] = Relocate(source->m_freeLists[i]);
+		for (b2Block* block = m_freeLists[i]; block; block = block->next)
+		{
+			block->next = Relocate(block->next);
+		}
+	}
+}
+
+// A block lies in a chunk that was entered for the page of the block.
+void* b2BlockAllocator::RelocatePointer(const void* p) const
+{
+	if (p == nullptr)
+	{
+		return nullptr;
+	}
+
+	const int8* address = (const int8*)p;
+	uint32 mask = uint32(m_relocationCapacity - 1);
+	uint32 slot = b2HashPage(uintptr_t(address) >> b2_chunkShift, mask);
+	for (;;)
+	{
+		const b2ChunkRelocation* relocation = m_relocations + slot;
+		if (relocation->source == nullptr)
+		{
+			// Not a block of the source.
+			b2Assert(false);
+			return nullptr;
+		}
+
+		if (relocation->source <= address && address < relocation->source + b2_chunkSize)
+		{
+			return relocation->target + (address - relocation->source);
+		}
+
+		slot = (slot + 1) & mask;
+	}
+}
+
+void b2BlockAllocator::Lock()
+{
+	while (m_lock.test_and_set(std::memory_order_acquire))
+	{
+	}
+}
+
+void b2BlockAllocator::Unlock()
+{
+	m_lock.clear(std::memory_order_release);
+}
+
+int32 b2BlockAllocator::AllocateBlocks(int32 index, void** blocks, int32 count)
+{
+	Lock();
+	for (int32 i = 0; i < count; ++i)
+	{
+		blocks[i] = AllocateBlock(index);
+	}
+	m_liveCounts[index] += count;
+	Unlock();
+	return count;
+}
+
+void b2BlockAllocator::FreeBlocks(int32 index, void** blocks, int32 count)
+{
+	Lock();
+	for (int32 i = 0; i < count; ++i)
+	{
+		b2Block* block = (b2Block*)blocks[i];
+		block->next = m_freeLists[index];
+		m_freeLists[index] = block;
+	}
+	m_liveCounts[index] -= count;
+	Unlock();
+}
+
+void* b2BlockAllocator::AllocateLarge(int32 size)
+{
+	Lock();
+	++m_largeCount;
+	m_largeBytes += size;
+	Unlock();
+	return b2Alloc(size);
+}
+
+void b2BlockAllocator::FreeLarge(void* p, int32 size)
+{
+	Lock();
+	--m_largeCount;
+	m_largeBytes -= size;
+	Unlock();
+	b2Free(p);
+}
+
+b2BlockAllocatorCache::b2BlockAllocatorCache()
+{
+	m_allocator = nullptr;
+	memset(m_counts, 0, sizeof(m_counts));
+}
+
+b2BlockAllocatorCache::~b2BlockAllocatorCache()
+{
+	b2Assert(b2_threadCache != this);
+	Flush();
+}
+
+void b2BlockAllocatorCache::Bind(b2BlockAllocator* allocator)
+{
+	b2Assert(b2_threadCache == nullptr);
+
+	// Cached blocks belong to the previous allocator.
+	if (allocator != m_allocator)
+	{
+		Flush();
+		m_allocator = allocator;
+	}
+
+	m_allocator->m_boundCount.fetch_add(1, std::memory_order_relaxed);
+	b2_threadCache = this;
+}
+
+void b2BlockAllocatorCache::Unbind()
+{
+	b2Assert(b2_threadCache == this);
+	m_allocator->m_boundCount.fetch_sub(1, std::memory_order_relaxed);
+	b2_threadCache = nullptr;
+}
+
+void b2BlockAllocatorCache::Flush()
+{
+	for (int32 i = 0; i < b2_blockSizeCount; ++i)
+	{
+		if (m_counts[i] > 0)
+		{
+			m_allocator->FreeBlocks(i, m_blocks[i], m_counts[i]);
+			m_counts[i] = 0;
+		}
+	}
+}
+
+void* b2BlockAllocatorCache::Allocate(int32 size)
+{
+	if (size > b2_maxBlockSize)
+	{
+		return m_allocator->AllocateLarge(size);
+	}
+
+	int32 index = b2_sizeMap.values[size];
+	if (m_counts[index] == 0)
+	{
+		m_counts[index] = m_allocator->AllocateBlocks(index, m_blocks[index], b2_blockCacheSize);
+	}
+
+	--m_counts[index];
+	return m_blocks[index][m_counts[index]];
+}
+
+void b2BlockAllocatorCache::Free(void* p, int32 size)
+{
+	if (size > b2_maxBlockSize)
+	{
+		m_allocator->FreeLarge(p, size);
+		return;
+	}
+
+	int32 index = b2_sizeMap.values[size];
+
+#if defined(_DEBUG)
+	memset(p, 0xfd, b2_blockSizes[index]);
+#endif
+
+	// Keep half the magazine so alternating allocate and free does not thrash the lock.
+	if (m_counts[index] == b2_blockCacheSize)
+	{
+		const int32 half = b2_blockCacheSize / 2;
+		m_allocator->FreeBlocks(index, m_blocks[index] + half, half);
+		m_counts[index] = half;
+	}
+
+	m_blocks[index][m_counts[index]++] = p;
 }
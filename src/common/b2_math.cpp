@@ -96,3 +96,106 @@ void b2Mat33::GetSymInverse33(b2Mat33* M) const
 	M->ez.y = M->ey.z;
 	M->ez.z = det * (a11 * a22 - a12 * a12);
 }
+
+// The approximations below are the single precision Cephes polynomials.
+
+float b2ComputeAtan2(float y, float x)
+{
+	float ax = b2Abs(x);
+	float ay = b2Abs(y);
+
+	if (ax == 0.0f && ay == 0.0f)
+	{
+		return 0.0f;
+	}
+
+	// Reduce to atan(t) with 0 <= t <= 1.
+	float t = ax >= ay ? ay / ax : ax / ay;
+
+	// Reduce further to |t| <= tan(pi / 8).
+	float offset = 0.0f;
+	if (t > 0.4142135623730950f)
+	{
+		offset = 0.25f * b2_pi;
+		t = (t - 1.0f) / (t + 1.0f);
+	}
+
+	float z = t * t;
+	float r = (((8.05374449538e-2f * z - 1.38776856032e-1f) * z + 1.99777106478e-1f) * z - 3.33329491539e-1f) * z * t + t;
+	r += offset;
+
+	if (ay > ax)
+	{
+		r = 0.5f * b2_pi - r;
+	}
+
+	if (x < 0.0f)
+	{
+		r = b2_pi - r;
+	}
+
+	return y < 0.0f ? -r : r;
+}
+
+void b2ComputeCosSin(float angle, float* c, float* s)
+{
+	// Reduce by multiples of pi / 2. The constant is split so the product with
+	// the quadrant is exact for moderate angles.
+	float q = floorf(angle * (2.0f / b2_pi) + 0.5f);
+	float x = angle - q * 1.5703125f;
+	x = x - q * 4.837512969970703125e-4f;
+	x = x - q * 7.549789954891882e-8f;
+
+	float z = x * x;
+	float sx = ((-1.9515295891e-4f * z + 8.3321608736e-3f) * z - 1.6666654611e-1f) * z * x + x;
+	float cx = ((2.443315711809948e-5f * z - 1.388731625493765e-3f) * z + 4.166664568298827e-2f) * z * z - 0.5f * z + 1.0f;
+
+	int32 quadrant = int32(q - 4.0f * floorf(0.25f * q));
+	switch (quadrant)
+	{
+	case 0:
+		*c = cx;
+		*s = sx;
+		break;
+
+	case 1:
+		*c = -sx;
+		*s = cx;
+		break;
+
+	case 2:
+		*c = -cx;
+		*s = -sx;
+		break;
+
+	default:
+		*c = sx;
+		*s = -cx;
+		break;
+	}
+}
+
+float b2ComputeExp(float x)
+{
+	// Beyond these limits the result overflows or underflows.
+	if (x > 88.0f)
+	{
+		return b2_maxFloat;
+	}
+
+	if (x < -87.0f)
+	{
+		return 0.0f;
+	}
+
+	// exp(x) = 2^n * exp(r) with |r| <= ln(2) / 2
+	float n = floorf(x * 1.44269504088896341f + 0.5f);
+	float r = x - n * 0.693359375f;
+	r = r + n * 2.12194440e-4f;
+
+	float z = r * r;
+	float p = ((((1.9875691500e-4f * r + 1.3981999507e-3f) * r + 8.3334519073e-3f) * r + 4.1665795894e-2f) * r + 1.6666665459e-1f) * r + 5.0000001201e-1f;
+	p = p * z + r + 1.0f;
+
+	return ldexpf(p, int32(n));
+}
@@ -26,20 +26,39 @@
 #include <stdio.h>
 #include <stdarg.h>
 #include <stdlib.h>
+#include <atomic>
 
 b2Version b2_version = {2, 4, 1};
 
+static std::atomic<int32> b2_allocationCount(0);
+static std::atomic<int32> b2_freeCount(0);
+
 // Memory allocators. Modify these to use your own allocator.
 void* b2Alloc_Default(int32 size)
 {
+	b2_allocationCount.fetch_add(1, std::memory_order_relaxed);
 	return malloc(size);
 }
 
 void b2Free_Default(void* mem)
 {
+	if (mem != nullptr)
+	{
+		b2_freeCount.fetch_add(1, std::memory_order_relaxed);
+	}
 	free(mem);
 }
 
+int32 b2GetAllocationCount()
+{
+	return b2_allocationCount.load(std::memory_order_relaxed);
+}
+
+int32 b2GetLiveAllocationCount()
+{
+	return b2_allocationCount.load(std::memory_order_relaxed) - b2_freeCount.load(std::memory_order_relaxed);
+}
+
 // You can modify this to use your logging facility.
 void b2Log_Default(const char* string, va_list args)
 {
@@ -25,9 +25,13 @@
 
 b2StackAllocator::b2StackAllocator()
 {
+	m_data = (char*)b2Alloc(b2_stackSize);
+	m_capacity = b2_stackSize;
 	m_index = 0;
 	m_allocation = 0;
 	m_maxAllocation = 0;
+	m_peakAllocation = 0;
+	m_fallbackCount = 0;
 	m_entryCount = 0;
 }
 
@@ -35,18 +39,23 @@ b2StackAllocator::~b2StackAllocator()
 {
 	b2Assert(m_index == 0);
 	b2Assert(m_entryCount == 0);
+	b2Free(m_data);
 }
 
 void* b2StackAllocator::Allocate(int32 size)
 {
 	b2Assert(m_entryCount < b2_maxStackEntries);
 
+	// Keep every entry aligned for pointers and 64-bit values.
+	size = (size + 7) & ~7;
+
 	b2StackEntry* entry = m_entries + m_entryCount;
 	entry->size = size;
-	if (m_index + size > b2_stackSize)
+	if (m_index + size > m_capacity)
 	{
 		entry->data = (char*)b2Alloc(size);
 		entry->usedMalloc = true;
+		++m_fallbackCount;
 	}
 	else
 	{
@@ -57,6 +66,7 @@ void* b2StackAllocator::Allocate(int32 size)
 
 	m_allocation += size;
 	m_maxAllocation = b2Max(m_maxAllocation, m_allocation);
+	m_peakAllocation = b2Max(m_peakAllocation, m_allocation);
 	++m_entryCount;
 
 	return entry->data;
@@ -85,3 +95,37 @@ int32 b2StackAllocator::GetMaxAllocation() const
 {
 	return m_maxAllocation;
 }
+
+void b2StackAllocator::Grow()
+{
+	b2Assert(m_entryCount == 0);
+	if (m_entryCount > 0 || m_maxAllocation <= m_capacity)
+	{
+		return;
+	}
+
+	// Leave some headroom so a slowly growing world does not reallocate every step.
+	m_capacity = m_maxAllocation + m_maxAllocation / 4;
+	b2Free(m_data);
+	m_data = (char*)b2Alloc(m_capacity);
+}
+
+int32 b2StackAllocator::GetCapacity() const
+{
+	return m_capacity;
+}
+
+int32 b2StackAllocator::GetFallbackCount() const
+{
+	return m_fallbackCount;
+}
+
+int32 b2StackAllocator::GetPeakAllocation() const
+{
+	return m_peakAllocation;
+}
+
+void b2StackAllocator::ResetPeakAllocation()
+{
+	m_peakAllocation = m_allocation;
+}
@@ -24,102 +24,123 @@
 
 #if defined(_WIN32)
 
-double b2Timer::s_invFrequency = 0.0;
-
 #ifndef WIN32_LEAN_AND_MEAN
 #define WIN32_LEAN_AND_MEAN
 #endif
 
 #include <windows.h>
 
-b2Timer::b2Timer()
+// Nanoseconds per performance counter tick
+static double b2GetInvFrequency()
 {
 	LARGE_INTEGER largeInteger;
-
-	if (s_invFrequency == 0.0)
-	{
-		QueryPerformanceFrequency(&largeInteger);
-		s_invFrequency = double(largeInteger.QuadPart);
-		if (s_invFrequency > 0.0)
-		{
-			s_invFrequency = 1000.0 / s_invFrequency;
-		}
-	}
-
-	QueryPerformanceCounter(&largeInteger);
-	m_start = double(largeInteger.QuadPart);
+	QueryPerformanceFrequency(&largeInteger);
+	double frequency = double(largeInteger.QuadPart);
+	return frequency > 0.0 ? 1000000000.0 / frequency : 0.0;
 }
 
-void b2Timer::Reset()
+unsigned long long b2Timer::GetTicks()
 {
+	// Timers are used from worker threads, so this relies on thread safe static initialization.
+	static const double invFrequency = b2GetInvFrequency();
+
 	LARGE_INTEGER largeInteger;
 	QueryPerformanceCounter(&largeInteger);
-	m_start = double(largeInteger.QuadPart);
+	return (unsigned long long)(invFrequency * double(largeInteger.QuadPart));
 }
 
-float b2Timer::GetMilliseconds() const
+#elif defined(__linux__) || defined (__APPLE__)
+
+#include <time.h>
+
+unsigned long long b2Timer::GetTicks()
 {
-	LARGE_INTEGER largeInteger;
-	QueryPerformanceCounter(&largeInteger);
-	double count = double(largeInteger.QuadPart);
-	float ms = float(s_invFrequency * (count - m_start));
-	return ms;
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return 1000000000ull * (unsigned long long)t.tv_sec + (unsigned long long)t.tv_nsec;
 }
 
-#elif defined(__linux__) || defined (__APPLE__)
+#else
+
+unsigned long long b2Timer::GetTicks()
+{
+	return 0;
+}
 
-#include <sys/time.h>
+#endif
 
 b2Timer::b2Timer()
 {
-    Reset();
+	Reset();
 }
 
 void b2Timer::Reset()
 {
-    timeval t;
-    gettimeofday(&t, 0);
-    m_start_sec = t.tv_sec;
-    m_start_usec = t.tv_usec;
+	m_start = GetTicks();
 }
 
 float b2Timer::GetMilliseconds() const
 {
-    timeval t;
-    gettimeofday(&t, 0);
-	time_t start_sec = m_start_sec;
-	suseconds_t start_usec = m_start_usec;
-	
-	// http://www.gnu.org/software/libc/manual/html_node/Elapsed-Time.html
-	if (t.tv_usec < start_usec)
-	{
-		int nsec = (start_usec - t.tv_usec) / 1000000 + 1;
-		start_usec -= 1000000 * nsec;
-		start_sec += nsec;
-	}
-	
-	if (t.tv_usec - start_usec > 1000000)
-	{
-		int nsec = (t.tv_usec - start_usec) / 1000000;
-		start_usec += 1000000 * nsec;
-		start_sec -= nsec;
-	}
-	return 1000.0f * (t.tv_sec - start_sec) + 0.001f * (t.tv_usec - start_usec);
+	return 0.000001f * float(GetNanoseconds());
 }
 
-#else
+float b2Timer::GetMicroseconds() const
+{
+	return 0.001f * float(GetNanoseconds());
+}
 
-b2Timer::b2Timer()
+unsigned long long b2Timer::GetNanoseconds() const
 {
+	return GetTicks() - m_start;
 }
 
-void b2Timer::Reset()
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+
+#include <intrin.h>
+
+unsigned long long b2CycleTimer::GetCounter()
 {
+	return __rdtsc();
 }
 
-float b2Timer::GetMilliseconds() const
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+
+#include <x86intrin.h>
+
+unsigned long long b2CycleTimer::GetCounter()
+{
+	return __rdtsc();
+}
+
+#elif (defined(__GNUC__) || defined(__clang__)) && defined(__aarch64__)
+
+unsigned long long b2CycleTimer::GetCounter()
 {
-	return 0.0f;
+	unsigned long long counter;
+	__asm__ volatile("mrs %0, cntvct_el0" : "=r"(counter));
+	return counter;
+}
+
+#else
+
+unsigned long long b2CycleTimer::GetCounter()
+{
+	return b2Timer::GetTicks();
 }
 
 #endif
+
+b2CycleTimer::b2CycleTimer()
+{
+	Reset();
+}
+
+void b2CycleTimer::Reset()
+{
+	m_start = GetCounter();
+}
+
+unsigned long long b2CycleTimer::GetCycles() const
+{
+	return GetCounter() - m_start;
+}
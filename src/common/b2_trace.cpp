@@ -0,0 +1,111 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "box2d/b2_timer.h"
+#include "box2d/b2_trace.h"
+
+#include <atomic>
+#include <stdio.h>
+
+static_assert((b2_traceCapacity & (b2_traceCapacity - 1)) == 0, "trace capacity must be a power of two");
+
+struct b2TraceEvent
+{
+	const char* name;
+	unsigned long long time;
+	int32 thread;
+	char phase;
+};
+
+// Writers claim a slot with one atomic increment, so recording never blocks.
+static b2TraceEvent b2_traceEvents[b2_traceCapacity];
+static std::atomic<uint32> b2_traceIndex(0);
+static std::atomic<int32> b2_traceThreadCount(0);
+static thread_local int32 b2_traceThread = -1;
+
+static void b2TraceRecord(const char* name, char phase)
+{
+	if (b2_traceThread < 0)
+	{
+		b2_traceThread = b2_traceThreadCount.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	unsigned long long time = b2Timer::GetTicks();
+
+	uint32 index = b2_traceIndex.fetch_add(1, std::memory_order_relaxed);
+	b2TraceEvent* event = b2_traceEvents + (index & (b2_traceCapacity - 1));
+	event->name = name;
+	event->time = time;
+	event->thread = b2_traceThread;
+	event->phase = phase;
+}
+
+void b2TraceBegin(const char* name)
+{
+	b2TraceRecord(name, 'B');
+}
+
+void b2TraceEnd(const char* name)
+{
+	b2TraceRecord(name, 'E');
+}
+
+void b2TraceClear()
+{
+	b2_traceIndex.store(0, std::memory_order_relaxed);
+}
+
+int32 b2TraceGetEventCount()
+{
+	uint32 index = b2_traceIndex.load(std::memory_order_acquire);
+	return index < b2_traceCapacity ? int32(index) : b2_traceCapacity;
+}
+
+bool b2TraceWrite(const char* fileName)
+{
+	FILE* file = fopen(fileName, "w");
+	if (file == nullptr)
+	{
+		return false;
+	}
+
+	uint32 index = b2_traceIndex.load(std::memory_order_acquire);
+	uint32 count = uint32(b2TraceGetEventCount());
+	uint32 start = index - count;
+
+	// Timestamps are in microseconds relative to the oldest event.
+	unsigned long long origin = count > 0 ? b2_traceEvents[start & (b2_traceCapacity - 1)].time : 0;
+
+	fprintf(file, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+	for (uint32 i = 0; i < count; ++i)
+	{
+		const b2TraceEvent* event = b2_traceEvents + ((start + i) & (b2_traceCapacity - 1));
+		fprintf(file, "{\"name\": \"%s\", \"ph\": \"%c\", \"ts\": %.3f, \"pid\": 0, \"tid\": %d}%s\n",
+			event->name, event->phase, 0.001 * double((long long)(event->time - origin)), event->thread,
+			i + 1 < count ? "," : "");
+	}
+	fprintf(file, "]}\n");
+
+	bool ok = ferror(file) == 0;
+	fclose(file);
+	return ok;
+}
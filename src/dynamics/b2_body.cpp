@@ -20,6 +20,8 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include "b2_snapshot.h"
+
 #include "box2d/b2_body.h"
 #include "box2d/b2_contact.h"
 #include "box2d/b2_fixture.h"
@@ -85,6 +87,13 @@ b2Body::b2Body(const b2BodyDef* bd, b2World* world)
 
 	m_sleepTime = 0.0f;
 
+	m_sleepingIsland = nullptr;
+	m_sleepingPrev = nullptr;
+	m_sleepingNext = nullptr;
+
+	m_awakePrev = nullptr;
+	m_awakeNext = nullptr;
+
 	m_type = bd->type;
 
 	m_mass = 0.0f;
@@ -112,11 +121,20 @@ void b2Body::SetType(b2BodyType type)
 		return;
 	}
 
+	b2Assert(IsStaticLayer() == false);
+	if (IsStaticLayer())
+	{
+		return;
+	}
+
 	if (m_type == type)
 	{
 		return;
 	}
 
+	// Leave the sleeping island. The neighbors wake when the contacts are destroyed below.
+	m_world->RemoveSleepingBody(this);
+
 	m_type = type;
 
 	ResetMassData();
@@ -130,6 +148,7 @@ void b2Body::SetType(b2BodyType type)
 	}
 
 	SetAwake(true);
+	UpdateAwakeList();
 
 	m_force.SetZero();
 	m_torque = 0.0f;
@@ -164,6 +183,12 @@ b2Fixture* b2Body::CreateFixture(const b2FixtureDef* def)
 		return nullptr;
 	}
 
+	b2Assert(IsStaticLayer() == false);
+	if (IsStaticLayer())
+	{
+		return nullptr;
+	}
+
 	b2BlockAllocator* allocator = &m_world->m_blockAllocator;
 
 	void* memory = allocator->Allocate(sizeof(b2Fixture));
@@ -217,6 +242,12 @@ void b2Body::DestroyFixture(b2Fixture* fixture)
 		return;
 	}
 
+	b2Assert(IsStaticLayer() == false);
+	if (IsStaticLayer())
+	{
+		return;
+	}
+
 	b2Assert(fixture->m_body == this);
 
 	// Remove the fixture from this body's singly linked list.
@@ -417,6 +448,12 @@ void b2Body::SetTransform(const b2Vec2& position, float angle)
 		return;
 	}
 
+	b2Assert(IsStaticLayer() == false);
+	if (IsStaticLayer())
+	{
+		return;
+	}
+
 	m_xf.q.Set(angle);
 	m_xf.p = position;
 
@@ -481,10 +518,36 @@ b2Sweep b2Body::GetSweep() const
 }
 
 
+void b2Body::WakeSleepingIsland()
+{
+	m_world->WakeSleepingIsland(this);
+}
+
+void b2Body::UpdateAwakeList()
+{
+	const uint16 awakeFlags = e_awakeFlag | e_enabledFlag;
+	bool awake = m_type != b2_staticBody && (m_flags & awakeFlags) == awakeFlags;
+	bool listed = (m_flags & e_awakeListFlag) != 0;
+	if (awake && listed == false)
+	{
+		m_world->AddAwakeBody(this);
+	}
+	else if (awake == false && listed)
+	{
+		m_world->RemoveAwakeBody(this);
+	}
+}
+
 void b2Body::SetEnabled(bool flag)
 {
 	b2Assert(m_world->IsLocked() == false);
 
+	b2Assert(IsStaticLayer() == false);
+	if (IsStaticLayer())
+	{
+		return;
+	}
+
 	if (flag == IsEnabled())
 	{
 		return;
@@ -503,10 +566,23 @@ void b2Body::SetEnabled(bool flag)
 
 		// Contacts are created at the beginning of the next
 		m_world->m_newContacts = true;
+		UpdateAwakeList();
+
+		// The joints count again, so a sleeping island on the other side has to
+		// search for them when it wakes.
+		for (b2JointEdge* je = m_jointList; je; je = je->next)
+		{
+			if (je->other->m_sleepingIsland)
+			{
+				je->other->m_flags |= e_linkFlag;
+			}
+		}
 	}
 	else
 	{
 		m_flags &= ~e_enabledFlag;
+		m_world->RemoveSleepingBody(this);
+		UpdateAwakeList();
 
 		// Destroy all proxies.
 		b2BroadPhase* broadPhase = &m_world->m_contactManager.m_broadPhase;
@@ -580,3 +656,28 @@ void b2Body::Dump()
 	}
 	b2Dump("}\n");
 }
+
+void b2Body::Serialize(b2SnapshotArchive& archive)
+{
+	archive.Enum(m_type);
+	archive.Value(m_flags);
+	archive.Value(m_xf);
+	archive.Value(m_position);
+	archive.Value(m_angle);
+	archive.Value(m_localCenter);
+	archive.Value(m_speculativePosition);
+	archive.Value(m_speculativeAngle);
+	archive.Value(m_linearVelocity);
+	archive.Value(m_angularVelocity);
+	archive.Value(m_force);
+	archive.Value(m_torque);
+	archive.Value(m_mass);
+	archive.Value(m_invMass);
+	archive.Value(m_I);
+	archive.Value(m_invI);
+	archive.Value(m_linearDamping);
+	archive.Value(m_angularDamping);
+	archive.Value(m_gravityScale);
+	archive.Value(m_sleepTime);
+	archive.Value(m_userData);
+}
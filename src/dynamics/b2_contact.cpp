@@ -28,6 +28,7 @@
 #include "b2_edge_polygon_contact.h"
 #include "b2_polygon_circle_contact.h"
 #include "b2_polygon_contact.h"
+#include "b2_snapshot.h"
 
 #include "box2d/b2_contact.h"
 #include "box2d/b2_block_allocator.h"
@@ -36,8 +37,11 @@
 #include "box2d/b2_fixture.h"
 #include "box2d/b2_shape.h"
 #include "box2d/b2_time_of_impact.h"
+#include "box2d/b2_timer.h"
 #include "box2d/b2_world.h"
 
+#include <string.h>
+
 b2ContactRegister b2Contact::s_registers[b2Shape::e_typeCount][b2Shape::e_typeCount];
 bool b2Contact::s_initialized = false;
 
@@ -137,11 +141,16 @@ b2Contact::b2Contact(b2Fixture* fA, int32 indexA, b2Fixture* fB, int32 indexB)
 	m_indexA = indexA;
 	m_indexB = indexB;
 
-	m_manifold.pointCount = 0;
+	// Unused manifold points are written to snapshots, so they must be initialized.
+	memset(&m_manifold, 0, sizeof(b2Manifold));
 
 	m_prev = nullptr;
 	m_next = nullptr;
 
+	m_sleepingIsland = nullptr;
+	m_sleepingPrev = nullptr;
+	m_sleepingNext = nullptr;
+
 	m_nodeA.contact = nullptr;
 	m_nodeA.prev = nullptr;
 	m_nodeA.next = nullptr;
@@ -163,7 +172,7 @@ b2Contact::b2Contact(b2Fixture* fA, int32 indexA, b2Fixture* fB, int32 indexB)
 
 // Update the contact manifold and touching status.
 // Note: do not assume the fixture AABBs are overlapping or are valid.
-void b2Contact::Update(b2ContactListener* listener)
+void b2Contact::Update(b2ContactListener* listener, float* toiTime, int32* toiCalls)
 {
 	b2Manifold oldManifold = m_manifold;
 
@@ -206,7 +215,10 @@ void b2Contact::Update(b2ContactListener* listener)
 		input.tMax = 1.0f;
 
 		b2TOIOutput output;
+		b2Timer toiTimer;
 		b2TimeOfImpact(&output, &input);
+		*toiTime += toiTimer.GetMilliseconds();
+		++(*toiCalls);
 
 		if (output.state != b2TOIOutput::e_separated || noStatic)
 		{
@@ -274,3 +286,35 @@ void b2Contact::Update(b2ContactListener* listener)
 		listener->PreSolve(this, &oldManifold);
 	}
 }
+
+void b2Contact::Serialize(b2SnapshotArchive& archive)
+{
+	archive.Value(m_flags);
+
+	for (int32 i = 0; i < b2_maxManifoldPoints; ++i)
+	{
+		b2ManifoldPoint* mp = m_manifold.points + i;
+		archive.Value(mp->localPoint);
+		archive.Value(mp->normalImpulse);
+		archive.Value(mp->tangentImpulse);
+		archive.Value(mp->id.key);
+		archive.Value(mp->persisted);
+	}
+
+	archive.Value(m_manifold.localNormal);
+	archive.Value(m_manifold.localPoint);
+	archive.Enum(m_manifold.type);
+	archive.Value(m_manifold.pointCount);
+	if (m_manifold.pointCount < 0 || m_manifold.pointCount > b2_maxManifoldPoints)
+	{
+		archive.m_error = true;
+		m_manifold.pointCount = 0;
+	}
+
+	archive.Value(m_toiCount);
+	archive.Value(m_toi);
+	archive.Value(m_friction);
+	archive.Value(m_restitution);
+	archive.Value(m_restitutionThreshold);
+	archive.Value(m_tangentSpeed);
+}
@@ -20,12 +20,21 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include "box2d/b2_block_allocator.h"
 #include "box2d/b2_body.h"
 #include "box2d/b2_contact.h"
 #include "box2d/b2_contact_manager.h"
 #include "box2d/b2_fixture.h"
+#include "box2d/b2_static_layer.h"
+#include "box2d/b2_task.h"
+#include "box2d/b2_trace.h"
 #include "box2d/b2_world_callbacks.h"
 
+#include "b2_sleeping_island.h"
+
+#include <new>
+#include <string.h>
+
 b2ContactFilter b2_defaultFilter;
 b2ContactListener b2_defaultListener;
 
@@ -33,9 +42,56 @@ b2ContactManager::b2ContactManager()
 {
 	m_contactList = nullptr;
 	m_contactCount = 0;
+	m_touchingCount = 0;
 	m_contactFilter = &b2_defaultFilter;
 	m_contactListener = &b2_defaultListener;
 	m_allocator = nullptr;
+	m_layerList = nullptr;
+	m_executor = nullptr;
+	m_caches = nullptr;
+	m_cacheCount = 0;
+	m_pairs = nullptr;
+	m_pairCount = 0;
+	m_pairCapacity = 0;
+	m_toiTime = 0.0f;
+	m_toiCalls = 0;
+}
+
+b2ContactManager::~b2ContactManager()
+{
+	SetTaskExecutor(nullptr);
+	b2Free(m_pairs);
+}
+
+void b2ContactManager::SetTaskExecutor(b2TaskExecutor* executor)
+{
+	for (int32 i = 0; i < m_cacheCount; ++i)
+	{
+		m_caches[i].~b2BlockAllocatorCache();
+	}
+	b2Free(m_caches);
+	m_caches = nullptr;
+	m_cacheCount = 0;
+
+	m_executor = executor;
+
+	if (executor != nullptr && executor->GetThreadCount() > 1)
+	{
+		m_cacheCount = executor->GetThreadCount();
+		m_caches = (b2BlockAllocatorCache*)b2Alloc(m_cacheCount * sizeof(b2BlockAllocatorCache));
+		for (int32 i = 0; i < m_cacheCount; ++i)
+		{
+			new (m_caches + i) b2BlockAllocatorCache;
+		}
+	}
+}
+
+void b2ContactManager::FlushCaches()
+{
+	for (int32 i = 0; i < m_cacheCount; ++i)
+	{
+		m_caches[i].Flush();
+	}
 }
 
 void b2ContactManager::Destroy(b2Contact* c)
@@ -50,6 +106,11 @@ void b2ContactManager::Destroy(b2Contact* c)
 		m_contactListener->EndContact(c);
 	}
 
+	if (c->m_sleepingIsland)
+	{
+		RemoveSleepingContact(c);
+	}
+
 	// Remove from the world.
 	if (c->m_prev)
 	{
@@ -99,15 +160,48 @@ void b2ContactManager::Destroy(b2Contact* c)
 	}
 
 	// Call the factory.
+	if (c->IsTouching())
+	{
+		--m_touchingCount;
+	}
+
 	b2Contact::Destroy(c, m_allocator);
 	--m_contactCount;
 }
 
+void b2ContactManager::RemoveSleepingContact(b2Contact* c)
+{
+	b2SleepingIsland* island = c->m_sleepingIsland;
+	b2Assert(island != nullptr);
+
+	if (c->m_sleepingPrev)
+	{
+		c->m_sleepingPrev->m_sleepingNext = c->m_sleepingNext;
+	}
+
+	if (c->m_sleepingNext)
+	{
+		c->m_sleepingNext->m_sleepingPrev = c->m_sleepingPrev;
+	}
+
+	if (island->contacts == c)
+	{
+		island->contacts = c->m_sleepingNext;
+	}
+
+	c->m_sleepingIsland = nullptr;
+	c->m_sleepingPrev = nullptr;
+	c->m_sleepingNext = nullptr;
+}
+
 // This is the top level collision call for the time step. Here
 // all the narrow phase collision is processed for the world
 // contact list.
 void b2ContactManager::Collide()
 {
+	m_toiTime = 0.0f;
+	m_toiCalls = 0;
+
 	// Update awake contacts.
 	b2Contact* c = m_contactList;
 	while (c)
@@ -154,9 +248,29 @@ void b2ContactManager::Collide()
 			continue;
 		}
 
-		int32 proxyIdA = fixtureA->m_proxies[indexA].proxyId;
-		int32 proxyIdB = fixtureB->m_proxies[indexB].proxyId;
-		bool overlap = m_broadPhase.TestOverlap(proxyIdA, proxyIdB);
+		bool overlap;
+		if (bodyA->IsStaticLayer())
+		{
+			// Layer edges have no proxies. The layer body never moves, so its
+			// exact edge bounds stand in for a fat AABB.
+			b2AABB aabbA;
+			fixtureA->m_shape->ComputeAABB(&aabbA, bodyA->m_xf, indexA);
+			int32 proxyIdB = fixtureB->m_proxies[indexB].proxyId;
+			overlap = b2TestOverlap(aabbA, m_broadPhase.GetFatAABB(proxyIdB));
+		}
+		else if (bodyB->IsStaticLayer())
+		{
+			b2AABB aabbB;
+			fixtureB->m_shape->ComputeAABB(&aabbB, bodyB->m_xf, indexB);
+			int32 proxyIdA = fixtureA->m_proxies[indexA].proxyId;
+			overlap = b2TestOverlap(m_broadPhase.GetFatAABB(proxyIdA), aabbB);
+		}
+		else
+		{
+			int32 proxyIdA = fixtureA->m_proxies[indexA].proxyId;
+			int32 proxyIdB = fixtureB->m_proxies[indexB].proxyId;
+			overlap = m_broadPhase.TestOverlap(proxyIdA, proxyIdB);
+		}
 
 		// Here we destroy contacts that cease to overlap in the broad-phase.
 		if (overlap == false)
@@ -168,21 +282,219 @@ void b2ContactManager::Collide()
 		}
 
 		// The contact persists.
-		c->Update(m_contactListener);
+		bool wasTouching = c->IsTouching();
+		c->Update(m_contactListener, &m_toiTime, &m_toiCalls);
+		if (c->IsTouching() != wasTouching)
+		{
+			m_touchingCount += wasTouching ? -1 : 1;
+		}
+
+		// A contact that starts touching a woken island is not in its record, so the
+		// island search has to follow the edges of these bodies.
+		if ((c->m_flags & b2Contact::e_touchingFlag) && c->m_sleepingIsland == nullptr)
+		{
+			if (bodyA->m_sleepingIsland)
+			{
+				bodyA->m_flags |= b2Body::e_linkFlag;
+			}
+
+			if (bodyB->m_sleepingIsland)
+			{
+				bodyB->m_flags |= b2Body::e_linkFlag;
+			}
+		}
+
 		c = c->GetNext();
 	}
 }
 
+// Collects the new broad-phase pairs.
+struct b2ContactPairCollector
+{
+	void AddPair(void* proxyUserDataA, void* proxyUserDataB)
+	{
+		b2ContactManager* m = manager;
+		if (m->m_pairCount == m->m_pairCapacity)
+		{
+			b2ContactPair* oldPairs = m->m_pairs;
+			m->m_pairCapacity = b2Max(64, 2 * m->m_pairCapacity);
+			m->m_pairs = (b2ContactPair*)b2Alloc(m->m_pairCapacity * sizeof(b2ContactPair));
+			if (oldPairs)
+			{
+				memcpy(m->m_pairs, oldPairs, m->m_pairCount * sizeof(b2ContactPair));
+				b2Free(oldPairs);
+			}
+		}
+
+		b2ContactPair* pair = m->m_pairs + m->m_pairCount;
+		pair->proxyA = (b2FixtureProxy*)proxyUserDataA;
+		pair->proxyB = (b2FixtureProxy*)proxyUserDataB;
+		pair->contact = nullptr;
+		++m->m_pairCount;
+	}
+
+	b2ContactManager* manager;
+};
+
+// Creates the contacts of a range of pairs. Each thread allocates through its own cache.
+class b2ContactPairTask : public b2Task
+{
+public:
+	void Execute(int32 startIndex, int32 endIndex, int32 threadIndex) override
+	{
+		b2TraceZone("create contacts");
+
+		b2Assert(0 <= threadIndex && threadIndex < m_manager->m_cacheCount);
+		b2BlockAllocatorCache* cache = m_manager->m_caches + threadIndex;
+		cache->Bind(m_manager->m_allocator);
+
+		for (int32 i = startIndex; i < endIndex; ++i)
+		{
+			b2ContactPair* pair = m_manager->m_pairs + i;
+			pair->contact = m_manager->CreateContact(pair->proxyA, pair->proxyB);
+		}
+
+		cache->Unbind();
+	}
+
+	b2ContactManager* m_manager;
+};
+
+// Pairs the edges of a static layer with one moved proxy.
+struct b2StaticLayerPairCallback
+{
+	bool QueryCallback(int32 childIndex)
+	{
+		b2FixtureProxy layerProxy;
+		layerProxy.fixture = layer->GetFixture();
+		layerProxy.childIndex = childIndex;
+		layerProxy.proxyId = b2BroadPhase::e_nullProxy;
+
+		// The layer goes first so the existing contact search walks the
+		// short contact list of the moved body.
+		b2Contact* c = manager->CreateContact(&layerProxy, proxy);
+		if (c != nullptr)
+		{
+			manager->LinkContact(c);
+		}
+
+		return true;
+	}
+
+	b2ContactManager* manager;
+	b2StaticLayer* layer;
+	b2FixtureProxy* proxy;
+};
+
+// Queries the layers whose bounds overlap a moved proxy.
+struct b2StaticLayerTreeCallback
+{
+	bool QueryCallback(int32 layerProxyId)
+	{
+		b2StaticLayer* layer = (b2StaticLayer*)tree->GetUserData(layerProxyId);
+
+		// The layer body only moves when the world origin shifts.
+		b2Vec2 offset = layer->GetBody()->GetPosition();
+		b2AABB aabb;
+		aabb.lowerBound = fatAABB.lowerBound - offset;
+		aabb.upperBound = fatAABB.upperBound - offset;
+
+		pairCallback->layer = layer;
+		layer->Query(pairCallback, aabb);
+		return true;
+	}
+
+	const b2DynamicTree* tree;
+	b2StaticLayerPairCallback* pairCallback;
+	b2AABB fatAABB;
+};
+
+void b2ContactManager::FindLayerContacts()
+{
+	if (m_layerList == nullptr)
+	{
+		return;
+	}
+
+	b2TraceZone("layer pairs");
+
+	b2StaticLayerPairCallback callback;
+	callback.manager = this;
+
+	b2StaticLayerTreeCallback treeCallback;
+	treeCallback.tree = &m_layerTree;
+	treeCallback.pairCallback = &callback;
+
+	// This must run before UpdatePairs clears the move buffer.
+	for (int32 i = 0; i < m_broadPhase.m_moveCount; ++i)
+	{
+		int32 proxyId = m_broadPhase.m_moveBuffer[i];
+		if (proxyId == b2BroadPhase::e_nullProxy)
+		{
+			continue;
+		}
+
+		b2FixtureProxy* proxy = (b2FixtureProxy*)m_broadPhase.GetUserData(proxyId);
+		if (proxy->fixture->GetBody()->GetType() == b2_staticBody)
+		{
+			continue;
+		}
+
+		callback.proxy = proxy;
+		treeCallback.fatAABB = m_broadPhase.GetFatAABB(proxyId);
+		m_layerTree.Query(&treeCallback, treeCallback.fatAABB);
+	}
+}
+
 void b2ContactManager::FindNewContacts()
 {
-	m_broadPhase.UpdatePairs(this);
+	FindLayerContacts();
+
+	if (m_cacheCount == 0)
+	{
+		m_broadPhase.UpdatePairs(this);
+		return;
+	}
+
+	b2ContactPairCollector collector;
+	collector.manager = this;
+	m_pairCount = 0;
+	m_broadPhase.UpdatePairs(&collector);
+
+	// The registers are lazily initialized, do it before going wide.
+	if (b2Contact::s_initialized == false)
+	{
+		b2Contact::InitializeRegisters();
+		b2Contact::s_initialized = true;
+	}
+
+	b2ContactPairTask task;
+	task.m_manager = this;
+	m_executor->ParallelFor(&task, m_pairCount, 64);
+
+	// Link in pair order so the contact list does not depend on thread timing.
+	for (int32 i = 0; i < m_pairCount; ++i)
+	{
+		if (m_pairs[i].contact != nullptr)
+		{
+			LinkContact(m_pairs[i].contact);
+		}
+	}
+
+	m_pairCount = 0;
 }
 
 void b2ContactManager::AddPair(void* proxyUserDataA, void* proxyUserDataB)
 {
-	b2FixtureProxy* proxyA = (b2FixtureProxy*)proxyUserDataA;
-	b2FixtureProxy* proxyB = (b2FixtureProxy*)proxyUserDataB;
+	b2Contact* c = CreateContact((b2FixtureProxy*)proxyUserDataA, (b2FixtureProxy*)proxyUserDataB);
+	if (c != nullptr)
+	{
+		LinkContact(c);
+	}
+}
 
+b2Contact* b2ContactManager::CreateContact(b2FixtureProxy* proxyA, b2FixtureProxy* proxyB)
+{
 	b2Fixture* fixtureA = proxyA->fixture;
 	b2Fixture* fixtureB = proxyB->fixture;
 
@@ -195,7 +507,7 @@ void b2ContactManager::AddPair(void* proxyUserDataA, void* proxyUserDataB)
 	// Are the fixtures on the same body?
 	if (bodyA == bodyB)
 	{
-		return;
+		return nullptr;
 	}
 
 	// TODO_ERIN use a hash table to remove a potential bottleneck when both
@@ -214,13 +526,13 @@ void b2ContactManager::AddPair(void* proxyUserDataA, void* proxyUserDataB)
 			if (fA == fixtureA && fB == fixtureB && iA == indexA && iB == indexB)
 			{
 				// A contact already exists.
-				return;
+				return nullptr;
 			}
 
 			if (fA == fixtureB && fB == fixtureA && iA == indexB && iB == indexA)
 			{
 				// A contact already exists.
-				return;
+				return nullptr;
 			}
 		}
 
@@ -230,29 +542,24 @@ void b2ContactManager::AddPair(void* proxyUserDataA, void* proxyUserDataB)
 	// Does a joint override collision? Is at least one body dynamic?
 	if (bodyB->ShouldCollide(bodyA) == false)
 	{
-		return;
+		return nullptr;
 	}
 
 	// Check user filtering.
 	if (m_contactFilter && m_contactFilter->ShouldCollide(fixtureA, fixtureB) == false)
 	{
-		return;
+		return nullptr;
 	}
 
 	// Call the factory.
-	b2Contact* c = b2Contact::Create(fixtureA, indexA, fixtureB, indexB, m_allocator);
-	if (c == nullptr)
-	{
-		return;
-	}
+	return b2Contact::Create(fixtureA, indexA, fixtureB, indexB, m_allocator);
+}
 
+void b2ContactManager::LinkContact(b2Contact* c)
+{
 	// Contact creation may swap fixtures.
-	fixtureA = c->GetFixtureA();
-	fixtureB = c->GetFixtureB();
-	indexA = c->GetChildIndexA();
-	indexB = c->GetChildIndexB();
-	bodyA = fixtureA->GetBody();
-	bodyB = fixtureB->GetBody();
+	b2Body* bodyA = c->GetFixtureA()->GetBody();
+	b2Body* bodyB = c->GetFixtureB()->GetBody();
 
 	// Insert into the world.
 	c->m_prev = nullptr;
@@ -290,4 +597,10 @@ void b2ContactManager::AddPair(void* proxyUserDataA, void* proxyUserDataB)
 	bodyB->m_contactList = &c->m_nodeB;
 
 	++m_contactCount;
+
+	// Only a restored contact can be touching already.
+	if (c->IsTouching())
+	{
+		++m_touchingCount;
+	}
 }
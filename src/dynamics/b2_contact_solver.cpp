@@ -59,6 +59,11 @@ b2ContactSolver::b2ContactSolver(b2ContactSolverDef* def)
 	m_velocities = def->velocities;
 	m_contacts = def->contacts;
 
+	m_inv_h = 0.0f;
+	m_biasRate = 0.0f;
+	m_massScale = 1.0f;
+	m_impulseScale = 0.0f;
+
 	// Initialize position independent portions of the constraints.
 	for (int32 i = 0; i < m_count; ++i)
 	{
@@ -186,6 +191,10 @@ void b2ContactSolver::InitializeVelocityConstraints()
 		worldManifold.Initialize(manifold, xfA, radiusA, xfB, radiusB);
 
 		vc->normal = worldManifold.normal;
+		vc->centerA = cA;
+		vc->centerB = cB;
+		vc->angleA = aA;
+		vc->angleB = aB;
 
 		int32 pointCount = vc->pointCount;
 		for (int32 j = 0; j < pointCount; ++j)
@@ -214,6 +223,9 @@ void b2ContactSolver::InitializeVelocityConstraints()
 			// Velocity bias for speculative collision
 			vcp->velocityBias = -b2Max(0.0f, worldManifold.separations[j] * m_step.inv_dt);
 
+			// Separation without the anchors so it can be updated as the bodies move
+			vcp->adjustedSeparation = worldManifold.separations[j] - b2Dot(vcp->rB - vcp->rA, vc->normal);
+
 			// Relative velocity
 			vcp->relativeVelocity = b2Dot(vc->normal, vB + b2Cross(wB, vcp->rB) - vA - b2Cross(wA, vcp->rA));
 		}
@@ -292,9 +304,9 @@ void b2ContactSolver::WarmStart()
 	}
 }
 
-void b2ContactSolver::SolveVelocityConstraints()
+void b2ContactSolver::SolveVelocityConstraints(int32 start, int32 end)
 {
-	for (int32 i = 0; i < m_count; ++i)
+	for (int32 i = start; i < end; ++i)
 	{
 		b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
 
@@ -597,10 +609,153 @@ void b2ContactSolver::SolveVelocityConstraints()
 			}
 		}
 
-		m_velocities[indexA].v = vA;
-		m_velocities[indexA].w = wA;
-		m_velocities[indexB].v = vB;
-		m_velocities[indexB].w = wB;
+		// Bodies without mass are only read, so ranges that share them can run in parallel.
+		if (mA > 0.0f || iA > 0.0f)
+		{
+			m_velocities[indexA].v = vA;
+			m_velocities[indexA].w = wA;
+		}
+
+		if (mB > 0.0f || iB > 0.0f)
+		{
+			m_velocities[indexB].v = vB;
+			m_velocities[indexB].w = wB;
+		}
+	}
+}
+
+void b2ContactSolver::PrepareSoftConstraints(float h)
+{
+	// Soft constraint coefficients, see Solver2D soft step. The stiffness must stay well
+	// below the sub-step rate.
+	float hertz = b2Min(b2_contactHertz, 0.25f / h);
+	float zeta = b2_contactDampingRatio;
+	float omega = 2.0f * b2_pi * hertz;
+	float a1 = 2.0f * zeta + h * omega;
+	float a2 = h * omega * a1;
+	float a3 = 1.0f / (1.0f + a2);
+
+	m_inv_h = 1.0f / h;
+	m_biasRate = omega / a1;
+	m_massScale = a2 * a3;
+	m_impulseScale = a3;
+}
+
+void b2ContactSolver::SolveSoftVelocityConstraints(bool useBias, int32 start, int32 end)
+{
+	for (int32 i = start; i < end; ++i)
+	{
+		b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
+
+		int32 indexA = vc->indexA;
+		int32 indexB = vc->indexB;
+		float mA = vc->invMassA;
+		float iA = vc->invIA;
+		float mB = vc->invMassB;
+		float iB = vc->invIB;
+		int32 pointCount = vc->pointCount;
+
+		b2Vec2 vA = m_velocities[indexA].v;
+		float wA = m_velocities[indexA].w;
+		b2Vec2 vB = m_velocities[indexB].v;
+		float wB = m_velocities[indexB].w;
+
+		// Body movement since the constraints were initialized
+		b2Vec2 dcA = m_positions[indexA].c - vc->centerA;
+		b2Rot dqA(m_positions[indexA].a - vc->angleA);
+		b2Vec2 dcB = m_positions[indexB].c - vc->centerB;
+		b2Rot dqB(m_positions[indexB].a - vc->angleB);
+
+		b2Vec2 normal = vc->normal;
+		b2Vec2 tangent = b2Cross(normal, 1.0f);
+		float friction = vc->friction;
+
+		b2Assert(pointCount == 1 || pointCount == 2);
+
+		// Non-penetration is solved first so friction uses the current normal impulse.
+		for (int32 j = 0; j < pointCount; ++j)
+		{
+			b2VelocityConstraintPoint* vcp = vc->points + j;
+
+			// Current separation
+			b2Vec2 d = dcB - dcA + b2Mul(dqB, vcp->rB) - b2Mul(dqA, vcp->rA);
+			float s = b2Dot(d, normal) + vcp->adjustedSeparation;
+
+			float velocityBias = 0.0f;
+			float massScale = 1.0f;
+			float impulseScale = 0.0f;
+			if (s > 0.0f)
+			{
+				// Speculative
+				velocityBias = s * m_inv_h;
+			}
+			else if (useBias)
+			{
+				velocityBias = b2Max(m_biasRate * s, -b2_contactPushVelocity);
+				massScale = m_massScale;
+				impulseScale = m_impulseScale;
+			}
+
+			// Relative velocity at contact
+			b2Vec2 dv = vB + b2Cross(wB, vcp->rB) - vA - b2Cross(wA, vcp->rA);
+
+			// Compute normal impulse
+			float vn = b2Dot(dv, normal);
+			float lambda = -vcp->normalMass * massScale * (vn + velocityBias) - impulseScale * vcp->normalImpulse;
+
+			// b2Clamp the accumulated impulse
+			float newImpulse = b2Max(vcp->normalImpulse + lambda, 0.0f);
+			lambda = newImpulse - vcp->normalImpulse;
+			vcp->normalImpulse = newImpulse;
+
+			// Apply contact impulse
+			b2Vec2 P = lambda * normal;
+			vA -= mA * P;
+			wA -= iA * b2Cross(vcp->rA, P);
+
+			vB += mB * P;
+			wB += iB * b2Cross(vcp->rB, P);
+		}
+
+		for (int32 j = 0; j < pointCount; ++j)
+		{
+			b2VelocityConstraintPoint* vcp = vc->points + j;
+
+			// Relative velocity at contact
+			b2Vec2 dv = vB + b2Cross(wB, vcp->rB) - vA - b2Cross(wA, vcp->rA);
+
+			// Compute tangent force
+			float vt = b2Dot(dv, tangent) - vc->tangentSpeed;
+			float lambda = vcp->tangentMass * (-vt);
+
+			// b2Clamp the accumulated force
+			float maxFriction = friction * vcp->normalImpulse;
+			float newImpulse = b2Clamp(vcp->tangentImpulse + lambda, -maxFriction, maxFriction);
+			lambda = newImpulse - vcp->tangentImpulse;
+			vcp->tangentImpulse = newImpulse;
+
+			// Apply contact impulse
+			b2Vec2 P = lambda * tangent;
+
+			vA -= mA * P;
+			wA -= iA * b2Cross(vcp->rA, P);
+
+			vB += mB * P;
+			wB += iB * b2Cross(vcp->rB, P);
+		}
+
+		// Bodies without mass are only read, see SolveVelocityConstraints.
+		if (mA > 0.0f || iA > 0.0f)
+		{
+			m_velocities[indexA].v = vA;
+			m_velocities[indexA].w = wA;
+		}
+
+		if (mB > 0.0f || iB > 0.0f)
+		{
+			m_velocities[indexB].v = vB;
+			m_velocities[indexB].w = wB;
+		}
 	}
 }
 
@@ -730,11 +885,11 @@ struct b2PositionSolverManifold
 };
 
 // Sequential solver.
-bool b2ContactSolver::SolvePositionConstraints()
+float b2ContactSolver::SolvePositionConstraints(int32 start, int32 end)
 {
 	float minSeparation = 0.0f;
 
-	for (int32 i = 0; i < m_count; ++i)
+	for (int32 i = start; i < end; ++i)
 	{
 		b2ContactPositionConstraint* pc = m_positionConstraints + i;
 
@@ -796,14 +951,20 @@ bool b2ContactSolver::SolvePositionConstraints()
 			aB += iB * b2Cross(rB, P);
 		}
 
-		m_positions[indexA].c = cA;
-		m_positions[indexA].a = aA;
+		// Bodies without mass do not move, and they may be shared with constraints solved
+		// at the same time.
+		if (mA > 0.0f || iA > 0.0f)
+		{
+			m_positions[indexA].c = cA;
+			m_positions[indexA].a = aA;
+		}
 
-		m_positions[indexB].c = cB;
-		m_positions[indexB].a = aB;
+		if (mB > 0.0f || iB > 0.0f)
+		{
+			m_positions[indexB].c = cB;
+			m_positions[indexB].a = aB;
+		}
 	}
 
-	// We can't expect minSpeparation >= -b2_linearSlop because we don't
-	// push the separation above -b2_linearSlop.
-	return minSeparation >= -3.0f * b2_linearSlop;
+	return minSeparation;
 }
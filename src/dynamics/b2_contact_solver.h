@@ -42,6 +42,7 @@ struct b2VelocityConstraintPoint
 	float tangentMass;
 	float velocityBias;
 	float relativeVelocity;
+	float adjustedSeparation;
 };
 
 struct b2ContactVelocityConstraint
@@ -50,6 +51,8 @@ struct b2ContactVelocityConstraint
 	b2Vec2 normal;
 	b2Mat22 normalMass;
 	b2Mat22 K;
+	b2Vec2 centerA, centerB;
+	float angleA, angleB;
 	int32 indexA;
 	int32 indexB;
 	float invMassA, invMassB;
@@ -81,11 +84,23 @@ public:
 	void InitializeVelocityConstraints();
 
 	void WarmStart();
-	void SolveVelocityConstraints();
+
+	/// Solve the constraints in [start, end). Bodies without mass are only read, so
+	/// ranges that share no dynamic body may be solved concurrently.
+	void SolveVelocityConstraints(int32 start, int32 end);
+
+	/// Sub-stepping solver. The separation is tracked from the body movement since
+	/// InitializeVelocityConstraints, so there is no position pass. With useBias the
+	/// overlap is pushed out using soft constraints, otherwise this is a relax pass.
+	void PrepareSoftConstraints(float h);
+	void SolveSoftVelocityConstraints(bool useBias, int32 start, int32 end);
+
 	void ApplyRestitution();
 	void StoreImpulses();
 
-	bool SolvePositionConstraints();
+	/// Solve the position constraints in [start, end).
+	/// @return the smallest separation, at most zero.
+	float SolvePositionConstraints(int32 start, int32 end);
 
 	b2TimeStep m_step;
 	b2Position* m_positions;
@@ -95,6 +110,11 @@ public:
 	b2ContactVelocityConstraint* m_velocityConstraints;
 	b2Contact** m_contacts;
 	int m_count;
+
+	float m_inv_h;
+	float m_biasRate;
+	float m_massScale;
+	float m_impulseScale;
 };
 
 #endif
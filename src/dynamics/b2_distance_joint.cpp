@@ -20,6 +20,9 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include "b2_joint_solver.h"
+#include "b2_snapshot.h"
+
 #include "box2d/b2_body.h"
 #include "box2d/b2_draw.h"
 #include "box2d/b2_distance_joint.h"
@@ -313,6 +316,304 @@ bool b2DistanceJoint::SolvePositionConstraints(const b2SolverData& data)
 	return b2Abs(C) < b2_linearSlop;
 }
 
+void b2DistanceJoint::PrepareConstraint(b2DistanceConstraint* constraint, int32 jointIndex)
+{
+	m_indexA = m_bodyA->m_islandIndex;
+	m_indexB = m_bodyB->m_islandIndex;
+	m_localCenterA = m_bodyA->m_localCenter;
+	m_localCenterB = m_bodyB->m_localCenter;
+	m_invMassA = m_bodyA->m_invMass;
+	m_invMassB = m_bodyB->m_invMass;
+	m_invIA = m_bodyA->m_invI;
+	m_invIB = m_bodyB->m_invI;
+
+	b2DistanceConstraint* c = constraint;
+	c->localAnchorA = m_localAnchorA - m_localCenterA;
+	c->localAnchorB = m_localAnchorB - m_localCenterB;
+	c->length = m_length;
+	c->minLength = m_minLength;
+	c->maxLength = m_maxLength;
+	c->stiffness = m_stiffness;
+	c->damping = m_damping;
+	c->impulse = m_impulse;
+	c->lowerImpulse = m_lowerImpulse;
+	c->upperImpulse = m_upperImpulse;
+	c->invMassA = m_invMassA;
+	c->invMassB = m_invMassB;
+	c->invIA = m_invIA;
+	c->invIB = m_invIB;
+	c->indexA = m_indexA;
+	c->indexB = m_indexB;
+	c->jointIndex = jointIndex;
+}
+
+void b2DistanceJoint::StoreConstraint(const b2DistanceConstraint* constraint)
+{
+	const b2DistanceConstraint* c = constraint;
+	m_rA = c->rA;
+	m_rB = c->rB;
+	m_u = c->u;
+	m_currentLength = c->currentLength;
+	m_gamma = c->gamma;
+	m_bias = c->bias;
+	m_mass = c->mass;
+	m_softMass = c->softMass;
+	m_impulse = c->impulse;
+	m_lowerImpulse = c->lowerImpulse;
+	m_upperImpulse = c->upperImpulse;
+}
+
+// The batch kernels follow InitVelocityConstraints, SolveVelocityConstraints, and
+// SolvePositionConstraints operation for operation, so the results are the same.
+void b2DistanceJoint::InitVelocityBatch(b2DistanceConstraint* constraints, int32 count, const b2SolverData& data)
+{
+	for (int32 k = 0; k < count; ++k)
+	{
+		b2DistanceConstraint* c = constraints + k;
+
+		b2Vec2 cA = data.positions[c->indexA].c;
+		float aA = data.positions[c->indexA].a;
+		b2Vec2 vA = data.velocities[c->indexA].v;
+		float wA = data.velocities[c->indexA].w;
+
+		b2Vec2 cB = data.positions[c->indexB].c;
+		float aB = data.positions[c->indexB].a;
+		b2Vec2 vB = data.velocities[c->indexB].v;
+		float wB = data.velocities[c->indexB].w;
+
+		b2Rot qA(aA), qB(aB);
+
+		c->rA = b2Mul(qA, c->localAnchorA);
+		c->rB = b2Mul(qB, c->localAnchorB);
+		c->u = cB + c->rB - cA - c->rA;
+
+		// Handle singularity.
+		c->currentLength = c->u.Length();
+		if (c->currentLength > b2_linearSlop)
+		{
+			c->u *= 1.0f / c->currentLength;
+		}
+		else
+		{
+			c->u.Set(0.0f, 0.0f);
+			c->mass = 0.0f;
+			c->impulse = 0.0f;
+			c->lowerImpulse = 0.0f;
+			c->upperImpulse = 0.0f;
+		}
+
+		float crAu = b2Cross(c->rA, c->u);
+		float crBu = b2Cross(c->rB, c->u);
+		float invMass = c->invMassA + c->invIA * crAu * crAu + c->invMassB + c->invIB * crBu * crBu;
+		c->mass = invMass != 0.0f ? 1.0f / invMass : 0.0f;
+
+		if (c->stiffness > 0.0f && c->minLength < c->maxLength)
+		{
+			// soft
+			float C = c->currentLength - c->length;
+
+			float d = c->damping;
+			float k = c->stiffness;
+
+			float h = data.step.dt;
+			c->gamma = h * (d + h * k);
+			c->gamma = c->gamma != 0.0f ? 1.0f / c->gamma : 0.0f;
+			c->bias = C * h * k * c->gamma;
+
+			invMass += c->gamma;
+			c->softMass = invMass != 0.0f ? 1.0f / invMass : 0.0f;
+		}
+		else
+		{
+			// rigid
+			c->gamma = 0.0f;
+			c->bias = 0.0f;
+			c->softMass = c->mass;
+		}
+
+		if (data.step.warmStarting)
+		{
+			// Scale the impulse to support a variable time step.
+			c->impulse *= data.step.dtRatio;
+			c->lowerImpulse *= data.step.dtRatio;
+			c->upperImpulse *= data.step.dtRatio;
+
+			b2Vec2 P = (c->impulse + c->lowerImpulse - c->upperImpulse) * c->u;
+			vA -= c->invMassA * P;
+			wA -= c->invIA * b2Cross(c->rA, P);
+			vB += c->invMassB * P;
+			wB += c->invIB * b2Cross(c->rB, P);
+		}
+		else
+		{
+			c->impulse = 0.0f;
+		}
+
+		data.velocities[c->indexA].v = vA;
+		data.velocities[c->indexA].w = wA;
+		data.velocities[c->indexB].v = vB;
+		data.velocities[c->indexB].w = wB;
+	}
+}
+
+void b2DistanceJoint::SolveVelocityBatch(b2DistanceConstraint* constraints, int32 count, const b2SolverData& data)
+{
+	float inv_dt = data.step.inv_dt;
+
+	for (int32 k = 0; k < count; ++k)
+	{
+		b2DistanceConstraint* c = constraints + k;
+
+		b2Vec2 vA = data.velocities[c->indexA].v;
+		float wA = data.velocities[c->indexA].w;
+		b2Vec2 vB = data.velocities[c->indexB].v;
+		float wB = data.velocities[c->indexB].w;
+
+		if (c->minLength < c->maxLength)
+		{
+			if (c->stiffness > 0.0f)
+			{
+				// Cdot = dot(u, v + cross(w, r))
+				b2Vec2 vpA = vA + b2Cross(wA, c->rA);
+				b2Vec2 vpB = vB + b2Cross(wB, c->rB);
+				float Cdot = b2Dot(c->u, vpB - vpA);
+
+				float impulse = -c->softMass * (Cdot + c->bias + c->gamma * c->impulse);
+				c->impulse += impulse;
+
+				b2Vec2 P = impulse * c->u;
+				vA -= c->invMassA * P;
+				wA -= c->invIA * b2Cross(c->rA, P);
+				vB += c->invMassB * P;
+				wB += c->invIB * b2Cross(c->rB, P);
+			}
+
+			// lower
+			{
+				float C = c->currentLength - c->minLength;
+				float bias = b2Max(0.0f, C) * inv_dt;
+
+				b2Vec2 vpA = vA + b2Cross(wA, c->rA);
+				b2Vec2 vpB = vB + b2Cross(wB, c->rB);
+				float Cdot = b2Dot(c->u, vpB - vpA);
+
+				float impulse = -c->mass * (Cdot + bias);
+				float oldImpulse = c->lowerImpulse;
+				c->lowerImpulse = b2Max(0.0f, c->lowerImpulse + impulse);
+				impulse = c->lowerImpulse - oldImpulse;
+				b2Vec2 P = impulse * c->u;
+
+				vA -= c->invMassA * P;
+				wA -= c->invIA * b2Cross(c->rA, P);
+				vB += c->invMassB * P;
+				wB += c->invIB * b2Cross(c->rB, P);
+			}
+
+			// upper
+			{
+				float C = c->maxLength - c->currentLength;
+				float bias = b2Max(0.0f, C) * inv_dt;
+
+				b2Vec2 vpA = vA + b2Cross(wA, c->rA);
+				b2Vec2 vpB = vB + b2Cross(wB, c->rB);
+				float Cdot = b2Dot(c->u, vpA - vpB);
+
+				float impulse = -c->mass * (Cdot + bias);
+				float oldImpulse = c->upperImpulse;
+				c->upperImpulse = b2Max(0.0f, c->upperImpulse + impulse);
+				impulse = c->upperImpulse - oldImpulse;
+				b2Vec2 P = -impulse * c->u;
+
+				vA -= c->invMassA * P;
+				wA -= c->invIA * b2Cross(c->rA, P);
+				vB += c->invMassB * P;
+				wB += c->invIB * b2Cross(c->rB, P);
+			}
+		}
+		else
+		{
+			// Equal limits
+
+			// Cdot = dot(u, v + cross(w, r))
+			b2Vec2 vpA = vA + b2Cross(wA, c->rA);
+			b2Vec2 vpB = vB + b2Cross(wB, c->rB);
+			float Cdot = b2Dot(c->u, vpB - vpA);
+
+			float impulse = -c->mass * Cdot;
+			c->impulse += impulse;
+
+			b2Vec2 P = impulse * c->u;
+			vA -= c->invMassA * P;
+			wA -= c->invIA * b2Cross(c->rA, P);
+			vB += c->invMassB * P;
+			wB += c->invIB * b2Cross(c->rB, P);
+		}
+
+		data.velocities[c->indexA].v = vA;
+		data.velocities[c->indexA].w = wA;
+		data.velocities[c->indexB].v = vB;
+		data.velocities[c->indexB].w = wB;
+	}
+}
+
+bool b2DistanceJoint::SolvePositionBatch(const b2DistanceConstraint* constraints, int32 count, const b2SolverData& data)
+{
+	bool okay = true;
+	for (int32 k = 0; k < count; ++k)
+	{
+		const b2DistanceConstraint* c = constraints + k;
+
+		b2Vec2 cA = data.positions[c->indexA].c;
+		float aA = data.positions[c->indexA].a;
+		b2Vec2 cB = data.positions[c->indexB].c;
+		float aB = data.positions[c->indexB].a;
+
+		b2Rot qA(aA), qB(aB);
+
+		b2Vec2 rA = b2Mul(qA, c->localAnchorA);
+		b2Vec2 rB = b2Mul(qB, c->localAnchorB);
+		b2Vec2 u = cB + rB - cA - rA;
+
+		float length = u.Normalize();
+		float C;
+		if (c->minLength == c->maxLength)
+		{
+			C = length - c->minLength;
+		}
+		else if (length < c->minLength)
+		{
+			C = length - c->minLength;
+		}
+		else if (c->maxLength < length)
+		{
+			C = length - c->maxLength;
+		}
+		else
+		{
+			// Within the limits, nothing to correct.
+			continue;
+		}
+
+		float impulse = -c->mass * C;
+		b2Vec2 P = impulse * u;
+
+		cA -= c->invMassA * P;
+		aA -= c->invIA * b2Cross(rA, P);
+		cB += c->invMassB * P;
+		aB += c->invIB * b2Cross(rB, P);
+
+		data.positions[c->indexA].c = cA;
+		data.positions[c->indexA].a = aA;
+		data.positions[c->indexB].c = cB;
+		data.positions[c->indexB].a = aB;
+
+		bool jointOkay = b2Abs(C) < b2_linearSlop;
+		okay = okay && jointOkay;
+	}
+
+	return okay;
+}
+
 b2Vec2 b2DistanceJoint::GetAnchorA() const
 {
 	return m_bodyA->GetWorldPoint(m_localAnchorA);
@@ -419,3 +720,35 @@ void b2DistanceJoint::Draw(b2Draw* draw) const
 		}
 	}
 }
+
+void b2DistanceJoint::Serialize(b2SnapshotArchive& archive)
+{
+	b2Joint::Serialize(archive);
+
+	archive.Value(m_stiffness);
+	archive.Value(m_damping);
+	archive.Value(m_bias);
+	archive.Value(m_length);
+	archive.Value(m_minLength);
+	archive.Value(m_maxLength);
+	archive.Value(m_localAnchorA);
+	archive.Value(m_localAnchorB);
+	archive.Value(m_gamma);
+	archive.Value(m_impulse);
+	archive.Value(m_lowerImpulse);
+	archive.Value(m_upperImpulse);
+	archive.Value(m_indexA);
+	archive.Value(m_indexB);
+	archive.Value(m_u);
+	archive.Value(m_rA);
+	archive.Value(m_rB);
+	archive.Value(m_localCenterA);
+	archive.Value(m_localCenterB);
+	archive.Value(m_currentLength);
+	archive.Value(m_invMassA);
+	archive.Value(m_invMassB);
+	archive.Value(m_invIA);
+	archive.Value(m_invIB);
+	archive.Value(m_softMass);
+	archive.Value(m_mass);
+}
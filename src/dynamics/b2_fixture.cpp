@@ -20,6 +20,8 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include "b2_snapshot.h"
+
 #include "box2d/b2_fixture.h"
 #include "box2d/b2_block_allocator.h"
 #include "box2d/b2_broad_phase.h"
@@ -192,6 +194,19 @@ void b2Fixture::Synchronize(b2BroadPhase* broadPhase, const b2Transform& transfo
 	}
 }
 
+b2AABB b2Fixture::GetAABB(int32 childIndex) const
+{
+	if (m_body->IsStaticLayer())
+	{
+		b2AABB aabb;
+		m_shape->ComputeAABB(&aabb, m_body->GetTransform(), childIndex);
+		return aabb;
+	}
+
+	b2Assert(0 <= childIndex && childIndex < m_proxyCount);
+	return m_proxies[childIndex].aabb;
+}
+
 void b2Fixture::SetFilterData(const b2Filter& filter)
 {
 	m_filter = filter;
@@ -318,3 +333,93 @@ void b2Fixture::Dump(int32 bodyIndex)
 	b2Dump("\n");
 	b2Dump("    bodies[%d]->CreateFixture(&fd);\n", bodyIndex);
 }
+
+void b2Fixture::Serialize(b2SnapshotArchive& archive)
+{
+	archive.Value(m_density);
+	archive.Value(m_friction);
+	archive.Value(m_restitution);
+	archive.Value(m_restitutionThreshold);
+	archive.Value(m_filter.categoryBits);
+	archive.Value(m_filter.maskBits);
+	archive.Value(m_filter.groupIndex);
+	archive.Value(m_isSensor);
+	archive.Value(m_userData);
+
+	archive.Value(m_shape->m_radius);
+	switch (m_shape->m_type)
+	{
+	case b2Shape::e_circle:
+		{
+			b2CircleShape* s = (b2CircleShape*)m_shape;
+			archive.Value(s->m_p);
+		}
+		break;
+
+	case b2Shape::e_edge:
+		{
+			b2EdgeShape* s = (b2EdgeShape*)m_shape;
+			archive.Value(s->m_vertex0);
+			archive.Value(s->m_vertex1);
+			archive.Value(s->m_vertex2);
+			archive.Value(s->m_vertex3);
+			archive.Value(s->m_oneSided);
+		}
+		break;
+
+	case b2Shape::e_polygon:
+		{
+			b2PolygonShape* s = (b2PolygonShape*)m_shape;
+			archive.Value(s->m_centroid);
+			archive.Value(s->m_count);
+			if (s->m_count < 3 || s->m_count > b2_maxPolygonVertices)
+			{
+				archive.m_error = true;
+				s->m_count = 0;
+			}
+			archive.Bytes(s->m_vertices, s->m_count * sizeof(b2Vec2));
+			archive.Bytes(s->m_normals, s->m_count * sizeof(b2Vec2));
+		}
+		break;
+
+	case b2Shape::e_chain:
+		{
+			b2ChainShape* s = (b2ChainShape*)m_shape;
+			archive.Value(s->m_count);
+			if (archive.IsLoading())
+			{
+				if (s->m_count < 2 || s->m_count * int32(sizeof(b2Vec2)) > archive.m_capacity)
+				{
+					archive.m_error = true;
+					s->m_count = 0;
+				}
+				s->m_vertices = (b2Vec2*)b2Alloc(s->m_count * sizeof(b2Vec2));
+			}
+			archive.Bytes(s->m_vertices, s->m_count * sizeof(b2Vec2));
+			archive.Value(s->m_prevVertex);
+			archive.Value(s->m_nextVertex);
+		}
+		break;
+
+	default:
+		b2Assert(false);
+		break;
+	}
+
+	archive.Value(m_proxyCount);
+	int32 childCount = m_shape->GetChildCount();
+	if (m_proxyCount < 0 || m_proxyCount > childCount)
+	{
+		archive.m_error = true;
+		m_proxyCount = 0;
+	}
+
+	for (int32 i = 0; i < m_proxyCount; ++i)
+	{
+		b2FixtureProxy* proxy = m_proxies + i;
+		archive.Value(proxy->aabb);
+		archive.Value(proxy->childIndex);
+		archive.Value(proxy->proxyId);
+		proxy->fixture = this;
+	}
+}
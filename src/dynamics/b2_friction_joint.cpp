@@ -20,6 +20,8 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include "b2_snapshot.h"
+
 #include "box2d/b2_friction_joint.h"
 #include "box2d/b2_body.h"
 #include "box2d/b2_time_step.h"
@@ -253,3 +255,27 @@ void b2FrictionJoint::Dump()
 	b2Dump("  jd.maxTorque = %.9g;\n", m_maxTorque);
 	b2Dump("  joints[%d] = m_world->CreateJoint(&jd);\n", m_index);
 }
+
+void b2FrictionJoint::Serialize(b2SnapshotArchive& archive)
+{
+	b2Joint::Serialize(archive);
+
+	archive.Value(m_localAnchorA);
+	archive.Value(m_localAnchorB);
+	archive.Value(m_linearImpulse);
+	archive.Value(m_angularImpulse);
+	archive.Value(m_maxForce);
+	archive.Value(m_maxTorque);
+	archive.Value(m_indexA);
+	archive.Value(m_indexB);
+	archive.Value(m_rA);
+	archive.Value(m_rB);
+	archive.Value(m_localCenterA);
+	archive.Value(m_localCenterB);
+	archive.Value(m_invMassA);
+	archive.Value(m_invMassB);
+	archive.Value(m_invIA);
+	archive.Value(m_invIB);
+	archive.Value(m_linearMass);
+	archive.Value(m_angularMass);
+}
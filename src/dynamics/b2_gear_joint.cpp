@@ -20,6 +20,9 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include "b2_snapshot.h"
+
+#include "box2d/b2_block_allocator.h"
 #include "box2d/b2_gear_joint.h"
 #include "box2d/b2_revolute_joint.h"
 #include "box2d/b2_prismatic_joint.h"
@@ -435,3 +438,56 @@ void b2GearJoint::Dump()
 	b2Dump("  jd.ratio = %.9g;\n", m_ratio);
 	b2Dump("  joints[%d] = m_world->CreateJoint(&jd);\n", m_index);
 }
+
+void b2GearJoint::Serialize(b2SnapshotArchive& archive)
+{
+	b2Joint::Serialize(archive);
+
+	archive.Enum(m_typeA);
+	archive.Enum(m_typeB);
+	archive.Value(m_localAnchorA);
+	archive.Value(m_localAnchorB);
+	archive.Value(m_localAnchorC);
+	archive.Value(m_localAnchorD);
+	archive.Value(m_localAxisC);
+	archive.Value(m_localAxisD);
+	archive.Value(m_referenceAngleA);
+	archive.Value(m_referenceAngleB);
+	archive.Value(m_constant);
+	archive.Value(m_ratio);
+	archive.Value(m_tolerance);
+	archive.Value(m_impulse);
+	archive.Value(m_indexA);
+	archive.Value(m_indexB);
+	archive.Value(m_indexC);
+	archive.Value(m_indexD);
+	archive.Value(m_lcA);
+	archive.Value(m_lcB);
+	archive.Value(m_lcC);
+	archive.Value(m_lcD);
+	archive.Value(m_mA);
+	archive.Value(m_mB);
+	archive.Value(m_mC);
+	archive.Value(m_mD);
+	archive.Value(m_iA);
+	archive.Value(m_iB);
+	archive.Value(m_iC);
+	archive.Value(m_iD);
+	archive.Value(m_JvAC);
+	archive.Value(m_JvBD);
+	archive.Value(m_JwA);
+	archive.Value(m_JwB);
+	archive.Value(m_JwC);
+	archive.Value(m_JwD);
+	archive.Value(m_mass);
+}
+
+void b2GearJoint::Relocate(const b2BlockAllocator* allocator)
+{
+	b2Joint::Relocate(allocator);
+
+	m_joint1 = allocator->Relocate(m_joint1);
+	m_joint2 = allocator->Relocate(m_joint2);
+	m_bodyC = allocator->Relocate(m_bodyC);
+	m_bodyD = allocator->Relocate(m_bodyD);
+}
@@ -23,14 +23,21 @@
 #include "box2d/b2_body.h"
 #include "box2d/b2_contact.h"
 #include "box2d/b2_distance.h"
+#include "box2d/b2_distance_joint.h"
 #include "box2d/b2_fixture.h"
 #include "box2d/b2_joint.h"
+#include "box2d/b2_revolute_joint.h"
 #include "box2d/b2_stack_allocator.h"
+#include "box2d/b2_task.h"
 #include "box2d/b2_timer.h"
+#include "box2d/b2_weld_joint.h"
 #include "box2d/b2_world.h"
 
 #include "b2_contact_solver.h"
 #include "b2_island.h"
+#include "b2_joint_solver.h"
+
+#include <string.h>
 
 /*
 Position Correction Notes
@@ -151,41 +158,84 @@ However, we can compute sin+cos of the same angle fast.
 */
 
 b2Island::b2Island(
-	int32 bodyCapacity,
-	int32 contactCapacity,
-	int32 jointCapacity,
+	b2Body** bodies,
+	int32 bodyCount,
+	b2Contact** contacts,
+	int32 contactCount,
+	b2Joint** joints,
+	int32 jointCount,
 	b2StackAllocator* allocator,
-	b2ContactListener* listener)
+	b2ContactListener* listener,
+	b2TaskExecutor* executor,
+	bool solveChains)
 {
-	m_bodyCapacity = bodyCapacity;
-	m_contactCapacity = contactCapacity;
-	m_jointCapacity	 = jointCapacity;
-	m_bodyCount = 0;
-	m_contactCount = 0;
-	m_jointCount = 0;
+	m_bodies = bodies;
+	m_contacts = contacts;
+	m_joints = joints;
+	m_bodyCount = bodyCount;
+	m_contactCount = contactCount;
+	m_jointCount = jointCount;
 
 	m_allocator = allocator;
 	m_listener = listener;
+	m_executor = executor;
+
+	// Static bodies may belong to several islands, so the indices are assigned here.
+	for (int32 i = 0; i < m_bodyCount; ++i)
+	{
+		m_bodies[i]->m_islandIndex = i;
+	}
+
+	m_chains = nullptr;
+	m_chainCount = 0;
+	m_chainJointCount = 0;
+	if (solveChains)
+	{
+		BuildChains();
+	}
 
-	m_bodies = (b2Body**)m_allocator->Allocate(bodyCapacity * sizeof(b2Body*));
-	m_contacts = (b2Contact**)m_allocator->Allocate(contactCapacity	 * sizeof(b2Contact*));
-	m_joints = (b2Joint**)m_allocator->Allocate(jointCapacity * sizeof(b2Joint*));
+	// Only color with an executor. The coloring does not depend on the thread count,
+	// so neither do the results. Without an executor the island order is kept.
+	ColorConstraints();
+	if (m_colorCount == 0)
+	{
+		SortJoints();
+	}
 
-	m_velocities = (b2Velocity*)m_allocator->Allocate(m_bodyCapacity * sizeof(b2Velocity));
-	m_positions = (b2Position*)m_allocator->Allocate(m_bodyCapacity * sizeof(b2Position));
+	m_velocities = (b2Velocity*)m_allocator->Allocate(m_bodyCount * sizeof(b2Velocity));
+	m_positions = (b2Position*)m_allocator->Allocate(m_bodyCount * sizeof(b2Position));
+
+	PrepareJoints();
 }
 
 b2Island::~b2Island()
 {
 	// Warning: the order should reverse the constructor order.
+	if (m_distances != nullptr)
+	{
+		m_allocator->Free(m_distances);
+	}
+
+	if (m_welds != nullptr)
+	{
+		m_allocator->Free(m_welds);
+	}
+
+	if (m_revolutes != nullptr)
+	{
+		m_allocator->Free(m_revolutes);
+	}
+
 	m_allocator->Free(m_positions);
 	m_allocator->Free(m_velocities);
-	m_allocator->Free(m_joints);
-	m_allocator->Free(m_contacts);
-	m_allocator->Free(m_bodies);
+
+	if (m_chains != nullptr)
+	{
+		m_allocator->Free(m_chains);
+	}
 }
 
-void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& gravity, bool allowSleep)
+bool b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& gravity, bool allowSleep)
 {
 	b2Timer timer;
 
@@ -201,7 +251,8 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 		b2Vec2 v = b->m_linearVelocity;
 		float w = b->m_angularVelocity;
 
-		if (b->m_type == b2_dynamicBody)
+		// Sub-stepping integrates velocities in each sub-step.
+		if (b->m_type == b2_dynamicBody && step.subStepping == false)
 		{
 			// Integrate velocities.
 			v += h * b->m_invMass * (b->m_gravityScale * b->m_mass * gravity + b->m_force);
@@ -244,91 +295,19 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 	b2ContactSolver contactSolver(&contactSolverDef);
 	contactSolver.InitializeVelocityConstraints();
 
-	if (step.warmStarting)
-	{
-		contactSolver.WarmStart();
-	}
-	
-	for (int32 i = 0; i < m_jointCount; ++i)
-	{
-		m_joints[i]->InitVelocityConstraints(solverData);
-	}
-
 	profile->solveInit = timer.GetMilliseconds();
 
-	// Solve velocity constraints
-	timer.Reset();
-	for (int32 i = 0; i < step.velocityIterations; ++i)
+	bool positionSolved;
+	if (step.subStepping)
 	{
-		for (int32 j = 0; j < m_jointCount; ++j)
-		{
-			m_joints[j]->SolveVelocityConstraints(solverData);
-		}
-
-		contactSolver.SolveVelocityConstraints();
+		positionSolved = SolveSubSteps(profile, &contactSolver, solverData, gravity);
 	}
-
-	// Special handling for restitution
-	contactSolver.ApplyRestitution();
-
-	// Store impulses for warm starting
-	contactSolver.StoreImpulses();
-	profile->solveVelocity = timer.GetMilliseconds();
-
-	// Integrate positions
-	for (int32 i = 0; i < m_bodyCount; ++i)
+	else
 	{
-		b2Vec2 c = m_positions[i].c;
-		float a = m_positions[i].a;
-		b2Vec2 v = m_velocities[i].v;
-		float w = m_velocities[i].w;
-
-		// Check for large velocities
-		b2Vec2 translation = h * v;
-		if (b2Dot(translation, translation) > b2_maxTranslationSquared)
-		{
-			float ratio = b2_maxTranslation / translation.Length();
-			v *= ratio;
-		}
-
-		float rotation = h * w;
-		if (rotation * rotation > b2_maxRotationSquared)
-		{
-			float ratio = b2_maxRotation / b2Abs(rotation);
-			w *= ratio;
-		}
-
-		// Integrate
-		c += h * v;
-		a += h * w;
-
-		m_positions[i].c = c;
-		m_positions[i].a = a;
-		m_velocities[i].v = v;
-		m_velocities[i].w = w;
+		positionSolved = SolveIterations(profile, &contactSolver, solverData);
 	}
 
-	// Solve position constraints
-	timer.Reset();
-	bool positionSolved = false;
-	for (int32 i = 0; i < step.positionIterations; ++i)
-	{
-		bool contactsOkay = contactSolver.SolvePositionConstraints();
-
-		bool jointsOkay = true;
-		for (int32 j = 0; j < m_jointCount; ++j)
-		{
-			bool jointOkay = m_joints[j]->SolvePositionConstraints(solverData);
-			jointsOkay = jointsOkay && jointOkay;
-		}
-
-		if (contactsOkay && jointsOkay)
-		{
-			// Exit early if the position errors are small.
-			positionSolved = true;
-			break;
-		}
-	}
+	StoreJoints();
 
 	// Copy state buffers back to the bodies
 	for (int32 i = 0; i < m_bodyCount; ++i)
@@ -341,10 +320,9 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 		body->SynchronizeTransform();
 	}
 
-	profile->solvePosition = timer.GetMilliseconds();
-
 	Report(contactSolver.m_velocityConstraints);
 
+	bool asleep = false;
 	if (allowSleep)
 	{
 		float minSleepTime = b2_maxFloat;
@@ -381,6 +359,8 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 				b2Body* b = m_bodies[i];
 				b->SetAwake(false);
 			}
+
+			asleep = true;
 		}
 	}
 
@@ -413,6 +393,1037 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 		b->m_speculativePosition = b->m_position + step.dt * v;
 		b->m_speculativeAngle = b->m_angle + step.dt * w;
 	}
+
+	return asleep;
+}
+
+// Velocity iterations followed by position iterations (NGS).
+bool b2Island::SolveIterations(b2Profile* profile, b2ContactSolver* contactSolver, const b2SolverData& solverData)
+{
+	b2Timer timer;
+
+	const b2TimeStep& step = solverData.step;
+	float h = step.dt;
+
+	if (step.warmStarting)
+	{
+		contactSolver->WarmStart();
+	}
+	
+	InitJointVelocities(solverData);
+
+	profile->solveInit += timer.GetMilliseconds();
+
+	// Solve velocity constraints
+	timer.Reset();
+	for (int32 i = 0; i < step.velocityIterations; ++i)
+	{
+		if (m_colorCount > 0)
+		{
+			SolveColors(b2_velocityStage, contactSolver, solverData);
+			continue;
+		}
+
+		SolveJointVelocities(solverData);
+
+		contactSolver->SolveVelocityConstraints(0, m_contactCount);
+	}
+
+	// Special handling for restitution
+	contactSolver->ApplyRestitution();
+
+	// Store impulses for warm starting
+	contactSolver->StoreImpulses();
+	profile->solveVelocity = timer.GetMilliseconds();
+
+	// Integrate positions
+	IntegratePositions(h);
+
+	// Solve position constraints
+	timer.Reset();
+	bool positionSolved = false;
+	for (int32 i = 0; i < step.positionIterations; ++i)
+	{
+		bool contactsOkay;
+		bool jointsOkay;
+		if (m_colorCount > 0)
+		{
+			contactsOkay = SolveColors(b2_positionStage, contactSolver, solverData);
+			jointsOkay = true;
+		}
+		else
+		{
+			// We can't expect minSpeparation >= -b2_linearSlop because we don't
+			// push the separation above -b2_linearSlop.
+			float minSeparation = contactSolver->SolvePositionConstraints(0, m_contactCount);
+			contactsOkay = minSeparation >= -3.0f * b2_linearSlop;
+
+			jointsOkay = SolveJointPositions(solverData);
+		}
+
+		if (contactsOkay && jointsOkay)
+		{
+			// Exit early if the position errors are small.
+			positionSolved = true;
+			break;
+		}
+	}
+
+	profile->solvePosition = timer.GetMilliseconds();
+
+	return positionSolved;
+}
+
+// Soft step: each sub-step integrates velocities, solves the constraints with soft
+// contacts that push out overlap, integrates positions and then relaxes the contacts
+// without bias so the push does not add energy. Contacts are not re-collided, their
+// separation is tracked from the body motion. Joints keep their rigid velocity solver
+// and get one position pass per sub-step.
+bool b2Island::SolveSubSteps(b2Profile* profile, b2ContactSolver* contactSolver, const b2SolverData& solverData, const b2Vec2& gravity)
+{
+	b2Timer timer;
+
+	const b2TimeStep& step = solverData.step;
+	int32 subStepCount = b2Max(step.velocityIterations, 1);
+	float h = step.dt / subStepCount;
+
+	// Joints see the sub-step
+	b2SolverData subStepData = solverData;
+	subStepData.step.dt = h;
+	subStepData.step.inv_dt = subStepCount * step.inv_dt;
+
+	contactSolver->PrepareSoftConstraints(h);
+
+	profile->solveInit += timer.GetMilliseconds();
+
+	bool jointsOkay = true;
+	float solvePosition = 0.0f;
+
+	timer.Reset();
+	for (int32 i = 0; i < subStepCount; ++i)
+	{
+		// Later sub-steps warm start from the previous sub-step.
+		if (i > 0)
+		{
+			subStepData.step.dtRatio = 1.0f;
+		}
+
+		// Integrate velocities and apply damping.
+		for (int32 j = 0; j < m_bodyCount; ++j)
+		{
+			b2Body* b = m_bodies[j];
+			if (b->m_type != b2_dynamicBody)
+			{
+				continue;
+			}
+
+			b2Vec2 v = m_velocities[j].v;
+			float w = m_velocities[j].w;
+
+			v += h * b->m_invMass * (b->m_gravityScale * b->m_mass * gravity + b->m_force);
+			w += h * b->m_invI * b->m_torque;
+
+			v *= 1.0f / (1.0f + h * b->m_linearDamping);
+			w *= 1.0f / (1.0f + h * b->m_angularDamping);
+
+			m_velocities[j].v = v;
+			m_velocities[j].w = w;
+		}
+
+		if (step.warmStarting)
+		{
+			contactSolver->WarmStart();
+		}
+
+		InitJointVelocities(subStepData);
+
+		// Solve with bias
+		if (m_colorCount > 0)
+		{
+			SolveColors(b2_softVelocityStage, contactSolver, subStepData);
+		}
+		else
+		{
+			SolveJointVelocities(subStepData);
+			contactSolver->SolveSoftVelocityConstraints(true, 0, m_contactCount);
+		}
+
+		IntegratePositions(h);
+
+		b2Timer positionTimer;
+		if (m_colorCount > 0)
+		{
+			jointsOkay = SolveColors(b2_jointPositionStage, contactSolver, subStepData);
+		}
+		else
+		{
+			jointsOkay = SolveJointPositions(subStepData);
+		}
+		solvePosition += positionTimer.GetMilliseconds();
+
+		// Relax
+		if (m_colorCount > 0)
+		{
+			SolveColors(b2_relaxStage, contactSolver, subStepData);
+		}
+		else
+		{
+			SolveJointVelocities(subStepData);
+			contactSolver->SolveSoftVelocityConstraints(false, 0, m_contactCount);
+		}
+	}
+
+	// Special handling for restitution
+	contactSolver->ApplyRestitution();
+
+	// Store impulses for warm starting
+	contactSolver->StoreImpulses();
+
+	profile->solveVelocity = timer.GetMilliseconds() - solvePosition;
+	profile->solvePosition = solvePosition;
+
+	// Soft contacts have no position pass to report on.
+	return jointsOkay;
+}
+
+// Group the joints by type, keeping their order within each type. Ragdolls and chains
+// are mostly one type, so the solver runs long batches of the same code instead of
+// switching between joint types on every call.
+void b2Island::SortJoints()
+{
+	m_jointBatchCount = 0;
+	if (m_jointCount == 0)
+	{
+		return;
+	}
+
+	int32 counts[b2_jointTypeCount] = {};
+	for (int32 i = 0; i < m_jointCount; ++i)
+	{
+		b2Assert(0 <= m_joints[i]->m_type && m_joints[i]->m_type < b2_jointTypeCount);
+		counts[m_joints[i]->m_type] += 1;
+	}
+
+	int32 starts[b2_jointTypeCount];
+	int32 start = 0;
+	for (int32 type = 0; type < b2_jointTypeCount; ++type)
+	{
+		starts[type] = start;
+		if (counts[type] > 0)
+		{
+			b2JointBatch* batch = m_jointBatches + m_jointBatchCount++;
+			batch->type = b2JointType(type);
+			batch->start = start;
+			batch->count = counts[type];
+		}
+		start += counts[type];
+	}
+
+	// A single type is already in order.
+	if (m_jointBatchCount == 1)
+	{
+		return;
+	}
+
+	b2Joint** joints = (b2Joint**)m_allocator->Allocate(m_jointCount * sizeof(b2Joint*));
+	for (int32 i = 0; i < m_jointCount; ++i)
+	{
+		b2Joint* joint = m_joints[i];
+		joints[starts[joint->m_type]++] = joint;
+	}
+
+	memcpy(m_joints, joints, m_jointCount * sizeof(b2Joint*));
+	m_allocator->Free(joints);
+}
+
+// Packs the revolute, weld, and distance joints once the joint order is final.
+void b2Island::PrepareJoints()
+{
+	int32 jointCount = m_jointCount + m_chainJointCount;
+
+	m_revoluteCount = 0;
+	m_weldCount = 0;
+	m_distanceCount = 0;
+	for (int32 i = 0; i < jointCount; ++i)
+	{
+		switch (m_joints[i]->m_type)
+		{
+		case e_revoluteJoint:
+			++m_revoluteCount;
+			break;
+
+		case e_weldJoint:
+			++m_weldCount;
+			break;
+
+		case e_distanceJoint:
+			++m_distanceCount;
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	m_revolutes = nullptr;
+	if (m_revoluteCount > 0)
+	{
+		m_revolutes = (b2RevoluteConstraint*)m_allocator->Allocate(m_revoluteCount * sizeof(b2RevoluteConstraint));
+	}
+
+	m_welds = nullptr;
+	if (m_weldCount > 0)
+	{
+		m_welds = (b2WeldConstraint*)m_allocator->Allocate(m_weldCount * sizeof(b2WeldConstraint));
+	}
+
+	m_distances = nullptr;
+	if (m_distanceCount > 0)
+	{
+		m_distances = (b2DistanceConstraint*)m_allocator->Allocate(m_distanceCount * sizeof(b2DistanceConstraint));
+	}
+
+	int32 revoluteIndex = 0;
+	int32 weldIndex = 0;
+	int32 distanceIndex = 0;
+	for (int32 i = 0; i < jointCount; ++i)
+	{
+		b2Joint* joint = m_joints[i];
+		switch (joint->m_type)
+		{
+		case e_revoluteJoint:
+			static_cast<b2RevoluteJoint*>(joint)->PrepareConstraint(m_revolutes + revoluteIndex, i);
+			joint->m_constraintIndex = revoluteIndex++;
+			break;
+
+		case e_weldJoint:
+			static_cast<b2WeldJoint*>(joint)->PrepareConstraint(m_welds + weldIndex, i);
+			joint->m_constraintIndex = weldIndex++;
+			break;
+
+		case e_distanceJoint:
+			static_cast<b2DistanceJoint*>(joint)->PrepareConstraint(m_distances + distanceIndex, i);
+			joint->m_constraintIndex = distanceIndex++;
+			break;
+
+		default:
+			break;
+		}
+	}
+}
+
+// Initializes the joints in island order. Warm starting adds impulses to the shared
+// bodies, so the order matters for the result.
+void b2Island::InitJointVelocities(const b2SolverData& data)
+{
+	int32 jointCount = m_jointCount + m_chainJointCount;
+	int32 runStart = 0;
+	while (runStart < jointCount)
+	{
+		b2JointType type = m_joints[runStart]->m_type;
+		int32 runEnd = runStart + 1;
+		while (runEnd < jointCount && m_joints[runEnd]->m_type == type)
+		{
+			++runEnd;
+		}
+
+		InitJointVelocityRun(type, m_joints + runStart, runEnd - runStart, data);
+		runStart = runEnd;
+	}
+}
+
+void b2Island::InitJointVelocityRun(b2JointType type, b2Joint** joints, int32 count, const b2SolverData& data)
+{
+	int32 index = joints[0]->m_constraintIndex;
+	switch (type)
+	{
+	case e_revoluteJoint:
+		b2RevoluteJoint::InitVelocityBatch(m_revolutes + index, count, data);
+		break;
+
+	case e_weldJoint:
+		b2WeldJoint::InitVelocityBatch(m_welds + index, count, data);
+		break;
+
+	case e_distanceJoint:
+		b2DistanceJoint::InitVelocityBatch(m_distances + index, count, data);
+		break;
+
+	default:
+		for (int32 i = 0; i < count; ++i)
+		{
+			joints[i]->InitVelocityConstraints(data);
+		}
+		break;
+	}
+}
+
+// Copies the dense joint results back for warm starting and the joint getters.
+void b2Island::StoreJoints()
+{
+	for (int32 i = 0; i < m_revoluteCount; ++i)
+	{
+		const b2RevoluteConstraint* constraint = m_revolutes + i;
+		b2RevoluteJoint* joint = static_cast<b2RevoluteJoint*>(m_joints[constraint->jointIndex]);
+		joint->StoreConstraint(constraint);
+	}
+
+	for (int32 i = 0; i < m_weldCount; ++i)
+	{
+		const b2WeldConstraint* constraint = m_welds + i;
+		b2WeldJoint* joint = static_cast<b2WeldJoint*>(m_joints[constraint->jointIndex]);
+		joint->StoreConstraint(constraint);
+	}
+
+	for (int32 i = 0; i < m_distanceCount; ++i)
+	{
+		const b2DistanceConstraint* constraint = m_distances + i;
+		b2DistanceJoint* joint = static_cast<b2DistanceJoint*>(m_joints[constraint->jointIndex]);
+		joint->StoreConstraint(constraint);
+	}
+}
+
+void b2Island::SolveJointVelocityRun(b2JointType type, b2Joint** joints, int32 count, const b2SolverData& data)
+{
+	int32 index = joints[0]->m_constraintIndex;
+	switch (type)
+	{
+	case e_revoluteJoint:
+		b2RevoluteJoint::SolveVelocityBatch(m_revolutes + index, count, data);
+		break;
+
+	case e_weldJoint:
+		b2WeldJoint::SolveVelocityBatch(m_welds + index, count, data);
+		break;
+
+	case e_distanceJoint:
+		b2DistanceJoint::SolveVelocityBatch(m_distances + index, count, data);
+		break;
+
+	default:
+		b2Joint::SolveVelocityBatch(type, joints, count, data);
+		break;
+	}
+}
+
+bool b2Island::SolveJointPositionRun(b2JointType type, b2Joint** joints, int32 count, const b2SolverData& data)
+{
+	int32 index = joints[0]->m_constraintIndex;
+	switch (type)
+	{
+	case e_revoluteJoint:
+		return b2RevoluteJoint::SolvePositionBatch(m_revolutes + index, count, data);
+
+	case e_weldJoint:
+		return b2WeldJoint::SolvePositionBatch(m_welds + index, count, data);
+
+	case e_distanceJoint:
+		return b2DistanceJoint::SolvePositionBatch(m_distances + index, count, data);
+
+	default:
+		return b2Joint::SolvePositionBatch(type, joints, count, data);
+	}
+}
+
+void b2Island::SolveJointVelocities(const b2SolverData& data)
+{
+	for (int32 i = 0; i < m_jointBatchCount; ++i)
+	{
+		const b2JointBatch* batch = m_jointBatches + i;
+		SolveJointVelocityRun(batch->type, m_joints + batch->start, batch->count, data);
+	}
+
+	SolveChainVelocities(data);
+}
+
+bool b2Island::SolveJointPositions(const b2SolverData& data)
+{
+	bool okay = true;
+	for (int32 i = 0; i < m_jointBatchCount; ++i)
+	{
+		const b2JointBatch* batch = m_jointBatches + i;
+		bool batchOkay = SolveJointPositionRun(batch->type, m_joints + batch->start, batch->count, data);
+		okay = okay && batchOkay;
+	}
+
+	bool chainsOkay = SolveChainPositions(data);
+	return okay && chainsOkay;
+}
+
+// Finds chains of revolute joints without a limit or motor, where each dynamic body
+// has at most two of these joints. Static and kinematic bodies end a chain. Joints
+// at a branch, loops, and chains of one joint are left to the iterative solver. The
+// chain joints are moved behind the other joints, in order along each chain.
+void b2Island::BuildChains()
+{
+	if (m_jointCount < 2)
+	{
+		return;
+	}
+
+	// Each chain has at least two joints.
+	m_chains = (b2JointChain*)m_allocator->Allocate((m_jointCount / 2) * sizeof(b2JointChain));
+
+	// The candidate joints of each dynamic body, or -1. A count above two is a branch.
+	int32* bodyJoints = (int32*)m_allocator->Allocate(2 * m_bodyCount * sizeof(int32));
+	int32* bodyCounts = (int32*)m_allocator->Allocate(m_bodyCount * sizeof(int32));
+	memset(bodyCounts, 0, m_bodyCount * sizeof(int32));
+
+	// 0 for other joints, 1 for chain candidates, 2 once added to a chain.
+	int32* jointStates = (int32*)m_allocator->Allocate(m_jointCount * sizeof(int32));
+	for (int32 i = 0; i < m_jointCount; ++i)
+	{
+		jointStates[i] = 0;
+
+		b2Joint* joint = m_joints[i];
+		if (joint->m_type != e_revoluteJoint || joint->m_bodyA == joint->m_bodyB)
+		{
+			continue;
+		}
+
+		b2RevoluteJoint* revolute = static_cast<b2RevoluteJoint*>(joint);
+		if (revolute->m_enableLimit || revolute->m_enableMotor)
+		{
+			continue;
+		}
+
+		jointStates[i] = 1;
+
+		b2Body* bodies[2] = {joint->m_bodyA, joint->m_bodyB};
+		for (int32 j = 0; j < 2; ++j)
+		{
+			if (bodies[j]->m_type != b2_dynamicBody)
+			{
+				continue;
+			}
+
+			int32 index = bodies[j]->m_islandIndex;
+			if (bodyCounts[index] < 2)
+			{
+				bodyJoints[2 * index + bodyCounts[index]] = i;
+			}
+			bodyCounts[index] += 1;
+		}
+	}
+
+	// Joints at a branch are not part of a chain.
+	for (int32 i = 0; i < m_jointCount; ++i)
+	{
+		if (jointStates[i] == 0)
+		{
+			continue;
+		}
+
+		b2Body* bodyA = m_joints[i]->m_bodyA;
+		b2Body* bodyB = m_joints[i]->m_bodyB;
+		if ((bodyA->m_type == b2_dynamicBody && bodyCounts[bodyA->m_islandIndex] > 2) ||
+			(bodyB->m_type == b2_dynamicBody && bodyCounts[bodyB->m_islandIndex] > 2))
+		{
+			jointStates[i] = 0;
+		}
+	}
+
+	b2Joint** chainJoints = (b2Joint**)m_allocator->Allocate(m_jointCount * sizeof(b2Joint*));
+
+	// Walk each chain from an end, which is a joint with a body that has no other
+	// chain joint. Loops have no end and are skipped.
+	for (int32 i = 0; i < m_jointCount; ++i)
+	{
+		if (jointStates[i] != 1)
+		{
+			continue;
+		}
+
+		// Find the free side of this joint.
+		b2Body* end = nullptr;
+		b2Body* bodies[2] = {m_joints[i]->m_bodyA, m_joints[i]->m_bodyB};
+		for (int32 j = 0; j < 2; ++j)
+		{
+			b2Body* body = bodies[j];
+			if (body->m_type != b2_dynamicBody || bodyCounts[body->m_islandIndex] == 1)
+			{
+				end = body;
+				break;
+			}
+
+			int32 index = body->m_islandIndex;
+			int32 other = bodyJoints[2 * index] != i ? bodyJoints[2 * index] : bodyJoints[2 * index + 1];
+			if (jointStates[other] == 0)
+			{
+				end = body;
+				break;
+			}
+		}
+
+		if (end == nullptr)
+		{
+			continue;
+		}
+
+		int32 start = m_chainJointCount;
+		int32 jointIndex = i;
+		b2Body* body = end;
+		while (jointIndex != -1 && jointStates[jointIndex] == 1)
+		{
+			b2Joint* joint = m_joints[jointIndex];
+			jointStates[jointIndex] = 2;
+			chainJoints[m_chainJointCount++] = joint;
+
+			// Step over the joint to the next body and its other chain joint.
+			body = joint->m_bodyA == body ? joint->m_bodyB : joint->m_bodyA;
+			if (body->m_type != b2_dynamicBody || bodyCounts[body->m_islandIndex] != 2)
+			{
+				break;
+			}
+
+			int32 index = body->m_islandIndex;
+			int32 next = bodyJoints[2 * index];
+			jointIndex = next != jointIndex ? next : bodyJoints[2 * index + 1];
+		}
+
+		int32 count = m_chainJointCount - start;
+		if (count < 2)
+		{
+			// Not worth a direct solve.
+			jointStates[i] = 0;
+			m_chainJointCount = start;
+			continue;
+		}
+
+		b2JointChain* chain = m_chains + m_chainCount++;
+		chain->start = start;
+		chain->count = count;
+	}
+
+	if (m_chainJointCount > 0)
+	{
+		// The other joints keep their order in front of the chains.
+		int32 count = 0;
+		for (int32 i = 0; i < m_jointCount; ++i)
+		{
+			if (jointStates[i] != 2)
+			{
+				m_joints[count++] = m_joints[i];
+			}
+		}
+
+		b2Assert(count + m_chainJointCount == m_jointCount);
+		memcpy(m_joints + count, chainJoints, m_chainJointCount * sizeof(b2Joint*));
+		m_jointCount = count;
+
+		for (int32 i = 0; i < m_chainCount; ++i)
+		{
+			m_chains[i].start += count;
+		}
+	}
+
+	m_allocator->Free(chainJoints);
+	m_allocator->Free(jointStates);
+	m_allocator->Free(bodyCounts);
+	m_allocator->Free(bodyJoints);
+}
+
+void b2Island::SolveChainVelocities(const b2SolverData& data)
+{
+	for (int32 i = 0; i < m_chainCount; ++i)
+	{
+		const b2JointChain* chain = m_chains + i;
+		int32 index = m_joints[chain->start]->m_constraintIndex;
+		b2RevoluteJoint::SolveChainVelocities(m_revolutes + index, chain->count, m_allocator, data);
+	}
+}
+
+// See b2RevoluteJoint::SolveChainVelocities for why the positions are solved one joint
+// at a time.
+bool b2Island::SolveChainPositions(const b2SolverData& data)
+{
+	if (m_chainJointCount == 0)
+	{
+		return true;
+	}
+
+	return SolveJointPositionRun(e_revoluteJoint, m_joints + m_jointCount, m_chainJointCount, data);
+}
+
+// Solves ranges of one graph color. Ranges never share a dynamic body.
+class b2GraphColorTask : public b2Task
+{
+public:
+	void Execute(int32 startIndex, int32 endIndex, int32 threadIndex) override
+	{
+		m_island->SolveColorRange(this, startIndex, endIndex, threadIndex);
+	}
+
+	b2Island* m_island;
+	b2ContactSolver* m_contactSolver;
+	const b2SolverData* m_data;
+	const b2GraphColor* m_color;
+	b2SolverStage m_stage;
+
+	// Position results, one per thread
+	float* m_minSeparations;
+	bool* m_jointsOkay;
+};
+
+// The lowest color not in the mask, or b2_graphColorCount if all are taken.
+static int32 b2FindColor(uint32 mask)
+{
+	for (int32 i = 0; i < b2_graphColorCount; ++i)
+	{
+		if ((mask & (1u << i)) == 0)
+		{
+			return i;
+		}
+	}
+
+	return b2_graphColorCount;
+}
+
+// Greedy coloring in island order, joints first. Contacts only read bodies without
+// mass, so those bodies take no color. Joints write both bodies, so a joint attached
+// to a static or kinematic body goes to the overflow, as do gear and mouse joints.
+// The arrays are then sorted by color, with the overflow first and the joints of each
+// color grouped by type.
+void b2Island::ColorConstraints()
+{
+	m_colorCount = 0;
+	m_overflow.jointStart = 0;
+	m_overflow.jointCount = m_jointCount;
+	m_overflow.contactStart = 0;
+	m_overflow.contactCount = m_contactCount;
+
+	if (m_executor == nullptr || m_jointCount + m_contactCount < b2_graphColoringThreshold)
+	{
+		return;
+	}
+
+	uint32* bodyColors = (uint32*)m_allocator->Allocate(m_bodyCount * sizeof(uint32));
+	memset(bodyColors, 0, m_bodyCount * sizeof(uint32));
+
+	// Slot zero is the overflow, slot i + 1 is color i.
+	const int32 slotCount = b2_graphColorCount + 1;
+	int32* jointSlots = (int32*)m_allocator->Allocate(m_jointCount * sizeof(int32));
+	int32* contactSlots = (int32*)m_allocator->Allocate(m_contactCount * sizeof(int32));
+
+	for (int32 i = 0; i < m_jointCount; ++i)
+	{
+		b2Joint* joint = m_joints[i];
+		b2Body* bodyA = joint->m_bodyA;
+		b2Body* bodyB = joint->m_bodyB;
+
+		int32 color = b2_graphColorCount;
+		if (joint->m_type != e_gearJoint && joint->m_type != e_mouseJoint &&
+			bodyA->m_type == b2_dynamicBody && bodyB->m_type == b2_dynamicBody)
+		{
+			int32 indexA = bodyA->m_islandIndex;
+			int32 indexB = bodyB->m_islandIndex;
+			color = b2FindColor(bodyColors[indexA] | bodyColors[indexB]);
+			if (color < b2_graphColorCount)
+			{
+				bodyColors[indexA] |= 1u << color;
+				bodyColors[indexB] |= 1u << color;
+			}
+		}
+
+		jointSlots[i] = color < b2_graphColorCount ? color + 1 : 0;
+	}
+
+	for (int32 i = 0; i < m_contactCount; ++i)
+	{
+		b2Body* bodyA = m_contacts[i]->GetFixtureA()->GetBody();
+		b2Body* bodyB = m_contacts[i]->GetFixtureB()->GetBody();
+		bool dynamicA = bodyA->m_type == b2_dynamicBody;
+		bool dynamicB = bodyB->m_type == b2_dynamicBody;
+
+		uint32 mask = 0;
+		if (dynamicA)
+		{
+			mask |= bodyColors[bodyA->m_islandIndex];
+		}
+		if (dynamicB)
+		{
+			mask |= bodyColors[bodyB->m_islandIndex];
+		}
+
+		int32 color = b2FindColor(mask);
+		if (color < b2_graphColorCount)
+		{
+			if (dynamicA)
+			{
+				bodyColors[bodyA->m_islandIndex] |= 1u << color;
+			}
+			if (dynamicB)
+			{
+				bodyColors[bodyB->m_islandIndex] |= 1u << color;
+			}
+		}
+
+		contactSlots[i] = color < b2_graphColorCount ? color + 1 : 0;
+	}
+
+	// Counting sort of the joints by slot and type, which keeps the island order
+	// within each key.
+	int32 jointStarts[slotCount * b2_jointTypeCount] = {};
+	for (int32 i = 0; i < m_jointCount; ++i)
+	{
+		jointStarts[jointSlots[i] * b2_jointTypeCount + m_joints[i]->m_type] += 1;
+	}
+
+	int32 jointSlotStarts[slotCount];
+	int32 jointSlotCounts[slotCount] = {};
+	int32 start = 0;
+	for (int32 key = 0; key < slotCount * b2_jointTypeCount; ++key)
+	{
+		int32 slot = key / b2_jointTypeCount;
+		if (key % b2_jointTypeCount == 0)
+		{
+			jointSlotStarts[slot] = start;
+		}
+
+		int32 count = jointStarts[key];
+		jointStarts[key] = start;
+		jointSlotCounts[slot] += count;
+		start += count;
+	}
+
+	if (m_jointCount > 0)
+	{
+		b2Joint** joints = (b2Joint**)m_allocator->Allocate(m_jointCount * sizeof(b2Joint*));
+		for (int32 i = 0; i < m_jointCount; ++i)
+		{
+			b2Joint* joint = m_joints[i];
+			joints[jointStarts[jointSlots[i] * b2_jointTypeCount + joint->m_type]++] = joint;
+		}
+
+		memcpy(m_joints, joints, m_jointCount * sizeof(b2Joint*));
+		m_allocator->Free(joints);
+	}
+
+	// Counting sort of the contacts by slot.
+	int32 contactSlotStarts[slotCount];
+	int32 contactSlotCounts[slotCount] = {};
+	for (int32 i = 0; i < m_contactCount; ++i)
+	{
+		contactSlotCounts[contactSlots[i]] += 1;
+	}
+
+	start = 0;
+	for (int32 slot = 0; slot < slotCount; ++slot)
+	{
+		contactSlotStarts[slot] = start;
+		start += contactSlotCounts[slot];
+	}
+
+	if (m_contactCount > 0)
+	{
+		int32 offsets[slotCount];
+		memcpy(offsets, contactSlotStarts, sizeof(offsets));
+
+		b2Contact** contacts = (b2Contact**)m_allocator->Allocate(m_contactCount * sizeof(b2Contact*));
+		for (int32 i = 0; i < m_contactCount; ++i)
+		{
+			contacts[offsets[contactSlots[i]]++] = m_contacts[i];
+		}
+
+		memcpy(m_contacts, contacts, m_contactCount * sizeof(b2Contact*));
+		m_allocator->Free(contacts);
+	}
+
+	m_allocator->Free(contactSlots);
+	m_allocator->Free(jointSlots);
+	m_allocator->Free(bodyColors);
+
+	m_overflow.jointStart = jointSlotStarts[0];
+	m_overflow.jointCount = jointSlotCounts[0];
+	m_overflow.contactStart = contactSlotStarts[0];
+	m_overflow.contactCount = contactSlotCounts[0];
+
+	// Greedy coloring uses the colors from the lowest, so the used colors come first.
+	for (int32 i = 0; i < b2_graphColorCount; ++i)
+	{
+		int32 slot = i + 1;
+		if (jointSlotCounts[slot] + contactSlotCounts[slot] == 0)
+		{
+			break;
+		}
+
+		b2GraphColor* color = m_colors + i;
+		color->jointStart = jointSlotStarts[slot];
+		color->jointCount = jointSlotCounts[slot];
+		color->contactStart = contactSlotStarts[slot];
+		color->contactCount = contactSlotCounts[slot];
+		m_colorCount = i + 1;
+	}
+}
+
+// One pass over all constraints: the overflow on this thread, then each color in
+// order, spread over the executor. Every pass has the same order regardless of the
+// thread count. Returns whether the position errors are small for the position stages.
+bool b2Island::SolveColors(b2SolverStage stage, b2ContactSolver* contactSolver, const b2SolverData& data)
+{
+	int32 threadCount = m_executor != nullptr ? m_executor->GetThreadCount() : 1;
+
+	float* minSeparations = (float*)m_allocator->Allocate(threadCount * sizeof(float));
+	bool* jointsOkay = (bool*)m_allocator->Allocate(threadCount * sizeof(bool));
+	for (int32 i = 0; i < threadCount; ++i)
+	{
+		minSeparations[i] = 0.0f;
+		jointsOkay[i] = true;
+	}
+
+	b2GraphColorTask task;
+	task.m_island = this;
+	task.m_contactSolver = contactSolver;
+	task.m_data = &data;
+	task.m_stage = stage;
+	task.m_minSeparations = minSeparations;
+	task.m_jointsOkay = jointsOkay;
+
+	task.m_color = &m_overflow;
+	task.Execute(0, m_overflow.jointCount + m_overflow.contactCount, 0);
+
+	// Chains are solved serially, like the overflow.
+	if (stage == b2_positionStage || stage == b2_jointPositionStage)
+	{
+		bool chainsOkay = SolveChainPositions(data);
+		jointsOkay[0] = jointsOkay[0] && chainsOkay;
+	}
+	else
+	{
+		SolveChainVelocities(data);
+	}
+
+	for (int32 i = 0; i < m_colorCount; ++i)
+	{
+		const b2GraphColor* color = m_colors + i;
+		task.m_color = color;
+
+		int32 itemCount = color->jointCount + color->contactCount;
+		if (m_executor != nullptr)
+		{
+			m_executor->ParallelFor(&task, itemCount, 64);
+		}
+		else
+		{
+			task.Execute(0, itemCount, 0);
+		}
+	}
+
+	float minSeparation = 0.0f;
+	bool okay = true;
+	for (int32 i = 0; i < threadCount; ++i)
+	{
+		minSeparation = b2Min(minSeparation, minSeparations[i]);
+		okay = okay && jointsOkay[i];
+	}
+
+	m_allocator->Free(jointsOkay);
+	m_allocator->Free(minSeparations);
+
+	// See SolveIterations for the contact tolerance.
+	return okay && minSeparation >= -3.0f * b2_linearSlop;
+}
+
+// The joints of a color come before its contacts. Runs of one joint type go through
+// the batch kernels.
+void b2Island::SolveColorRange(const b2GraphColorTask* task, int32 startIndex, int32 endIndex, int32 threadIndex)
+{
+	const b2GraphColor* color = task->m_color;
+	const b2SolverData& data = *task->m_data;
+	b2SolverStage stage = task->m_stage;
+	b2Joint** joints = m_joints + color->jointStart;
+
+	int32 jointEnd = b2Min(endIndex, color->jointCount);
+	int32 runStart = startIndex;
+	while (runStart < jointEnd)
+	{
+		b2JointType type = joints[runStart]->m_type;
+		int32 runEnd = runStart + 1;
+		while (runEnd < jointEnd && joints[runEnd]->m_type == type)
+		{
+			++runEnd;
+		}
+
+		if (stage == b2_positionStage || stage == b2_jointPositionStage)
+		{
+			bool okay = SolveJointPositionRun(type, joints + runStart, runEnd - runStart, data);
+			task->m_jointsOkay[threadIndex] = task->m_jointsOkay[threadIndex] && okay;
+		}
+		else
+		{
+			SolveJointVelocityRun(type, joints + runStart, runEnd - runStart, data);
+		}
+
+		runStart = runEnd;
+	}
+
+	int32 contactStart = color->contactStart + b2Max(startIndex - color->jointCount, 0);
+	int32 contactEnd = color->contactStart + endIndex - color->jointCount;
+	if (contactStart >= contactEnd)
+	{
+		return;
+	}
+
+	b2ContactSolver* contactSolver = task->m_contactSolver;
+	switch (stage)
+	{
+	case b2_velocityStage:
+		contactSolver->SolveVelocityConstraints(contactStart, contactEnd);
+		break;
+
+	case b2_softVelocityStage:
+		contactSolver->SolveSoftVelocityConstraints(true, contactStart, contactEnd);
+		break;
+
+	case b2_relaxStage:
+		contactSolver->SolveSoftVelocityConstraints(false, contactStart, contactEnd);
+		break;
+
+	case b2_positionStage:
+		{
+			float minSeparation = contactSolver->SolvePositionConstraints(contactStart, contactEnd);
+			task->m_minSeparations[threadIndex] = b2Min(task->m_minSeparations[threadIndex], minSeparation);
+		}
+		break;
+
+	case b2_jointPositionStage:
+		break;
+	}
+}
+
+void b2Island::IntegratePositions(float h)
+{
+	for (int32 i = 0; i < m_bodyCount; ++i)
+	{
+		b2Vec2 c = m_positions[i].c;
+		float a = m_positions[i].a;
+		b2Vec2 v = m_velocities[i].v;
+		float w = m_velocities[i].w;
+
+		// Check for large velocities
+		b2Vec2 translation = h * v;
+		if (b2Dot(translation, translation) > b2_maxTranslationSquared)
+		{
+			float ratio = b2_maxTranslation / translation.Length();
+			v *= ratio;
+		}
+
+		float rotation = h * w;
+		if (rotation * rotation > b2_maxRotationSquared)
+		{
+			float ratio = b2_maxRotation / b2Abs(rotation);
+			w *= ratio;
+		}
+
+		// Integrate
+		c += h * v;
+		a += h * w;
+
+		m_positions[i].c = c;
+		m_positions[i].a = a;
+		m_velocities[i].v = v;
+		m_velocities[i].w = w;
+	}
 }
 
 void b2Island::Report(const b2ContactVelocityConstraint* constraints)
@@ -24,57 +24,116 @@
 #define B2_ISLAND_H
 
 #include "box2d/b2_body.h"
+#include "box2d/b2_joint.h"
 #include "box2d/b2_math.h"
 #include "box2d/b2_time_step.h"
 
 class b2Contact;
-class b2Joint;
 class b2StackAllocator;
+class b2TaskExecutor;
+class b2GraphColorTask;
 class b2ContactListener;
+class b2ContactSolver;
 struct b2ContactVelocityConstraint;
+struct b2DistanceConstraint;
+struct b2RevoluteConstraint;
+struct b2WeldConstraint;
 struct b2Profile;
 
-/// This is an internal class.
+/// Where the members of one island start in the arrays gathered by b2World::Solve.
+/// An island ends where the next one starts.
+struct b2IslandRange
+{
+	int32 bodyStart;
+	int32 contactStart;
+	int32 jointStart;
+};
+
+#define b2_jointTypeCount (e_motorJoint + 1)
+
+/// A run of island joints that share a type.
+struct b2JointBatch
+{
+	b2JointType type;
+	int32 start;
+	int32 count;
+};
+
+/// A run of island joints that form a chain, in order along the chain.
+struct b2JointChain
+{
+	int32 start;
+	int32 count;
+};
+
+/// The number of graph colors. Constraints that find no free color are solved serially.
+#define b2_graphColorCount 12
+
+/// Islands with fewer joints and contacts are solved in the order they were found.
+#define b2_graphColoringThreshold 256
+
+/// The solver passes that run over the graph colors.
+enum b2SolverStage
+{
+	b2_velocityStage,
+	b2_softVelocityStage,
+	b2_relaxStage,
+	b2_positionStage,
+	b2_jointPositionStage
+};
+
+/// The joints and contacts of one graph color, as ranges of the island arrays. The
+/// constraints of a color share no dynamic body, so they can be solved in parallel.
+struct b2GraphColor
+{
+	int32 jointStart;
+	int32 jointCount;
+	int32 contactStart;
+	int32 contactCount;
+};
+
+/// This is an internal class. The island refers to body, contact, and joint arrays
+/// owned by the caller and allocates solver storage for exactly its own bodies.
 class b2Island
 {
 public:
-	b2Island(int32 bodyCapacity, int32 contactCapacity, int32 jointCapacity,
-			b2StackAllocator* allocator, b2ContactListener* listener);
+	b2Island(b2Body** bodies, int32 bodyCount,
+			b2Contact** contacts, int32 contactCount,
+			b2Joint** joints, int32 jointCount,
+			b2StackAllocator* allocator, b2ContactListener* listener,
+			b2TaskExecutor* executor, bool solveChains);
 	~b2Island();
 
-	void Clear()
-	{
-		m_bodyCount = 0;
-		m_contactCount = 0;
-		m_jointCount = 0;
-	}
-
-	void Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& gravity, bool allowSleep);
-
-	void Add(b2Body* body)
-	{
-		b2Assert(m_bodyCount < m_bodyCapacity);
-		body->m_islandIndex = m_bodyCount;
-		m_bodies[m_bodyCount] = body;
-		++m_bodyCount;
-	}
-
-	void Add(b2Contact* contact)
-	{
-		b2Assert(m_contactCount < m_contactCapacity);
-		m_contacts[m_contactCount++] = contact;
-	}
-
-	void Add(b2Joint* joint)
-	{
-		b2Assert(m_jointCount < m_jointCapacity);
-		m_joints[m_jointCount++] = joint;
-	}
+	/// @return true if the island fell asleep.
+	bool Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& gravity, bool allowSleep);
 
 	void Report(const b2ContactVelocityConstraint* constraints);
 
+	bool SolveIterations(b2Profile* profile, b2ContactSolver* contactSolver, const b2SolverData& solverData);
+	bool SolveSubSteps(b2Profile* profile, b2ContactSolver* contactSolver, const b2SolverData& solverData, const b2Vec2& gravity);
+	void IntegratePositions(float h);
+
+	void SortJoints();
+	void PrepareJoints();
+	void InitJointVelocities(const b2SolverData& data);
+	void InitJointVelocityRun(b2JointType type, b2Joint** joints, int32 count, const b2SolverData& data);
+	void StoreJoints();
+	void SolveJointVelocities(const b2SolverData& data);
+	bool SolveJointPositions(const b2SolverData& data);
+	void SolveJointVelocityRun(b2JointType type, b2Joint** joints, int32 count, const b2SolverData& data);
+	bool SolveJointPositionRun(b2JointType type, b2Joint** joints, int32 count, const b2SolverData& data);
+
+	void BuildChains();
+	void SolveChainVelocities(const b2SolverData& data);
+	bool SolveChainPositions(const b2SolverData& data);
+
+	void ColorConstraints();
+	bool SolveColors(b2SolverStage stage, b2ContactSolver* contactSolver, const b2SolverData& data);
+	void SolveColorRange(const b2GraphColorTask* task, int32 startIndex, int32 endIndex, int32 threadIndex);
+
 	b2StackAllocator* m_allocator;
 	b2ContactListener* m_listener;
+	b2TaskExecutor* m_executor;
 
 	b2Body** m_bodies;
 	b2Contact** m_contacts;
@@ -87,9 +146,32 @@ public:
 	int32 m_jointCount;
 	int32 m_contactCount;
 
-	int32 m_bodyCapacity;
-	int32 m_contactCapacity;
-	int32 m_jointCapacity;
+	// The joints are grouped by type so each group runs one solver kernel.
+	b2JointBatch m_jointBatches[b2_jointTypeCount];
+	int32 m_jointBatchCount;
+
+	// The revolute, weld, and distance joints in island order, including the chain joints.
+	// A run of one of these types in m_joints is a run in its array, starting at the first
+	// joint's constraint index.
+	b2RevoluteConstraint* m_revolutes;
+	int32 m_revoluteCount;
+	b2WeldConstraint* m_welds;
+	int32 m_weldCount;
+	b2DistanceConstraint* m_distances;
+	int32 m_distanceCount;
+
+	// Chains of revolute joints are solved directly. Their joints follow the other
+	// joints in m_joints and are not included in m_jointCount.
+	b2JointChain* m_chains;
+	int32 m_chainCount;
+	int32 m_chainJointCount;
+
+	// Large islands are graph colored. The overflow comes first in the arrays and is
+	// solved serially, then the colors follow in order. The color count is zero if the
+	// island is not colored.
+	b2GraphColor m_overflow;
+	b2GraphColor m_colors[b2_graphColorCount];
+	int32 m_colorCount;
 };
 
 #endif
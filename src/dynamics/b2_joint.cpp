@@ -20,6 +20,8 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include "b2_snapshot.h"
+
 #include "box2d/b2_block_allocator.h"
 #include "box2d/b2_body.h"
 #include "box2d/b2_distance_joint.h"
@@ -222,6 +224,32 @@ void b2Joint::Destroy(b2Joint* joint, b2BlockAllocator* allocator)
 	}
 }
 
+void b2Joint::SolveVelocityBatch(b2JointType type, b2Joint** joints, int32 count, const b2SolverData& data)
+{
+	// Revolute, weld, and distance joints are solved by the island from dense storage.
+	b2Assert(type != e_revoluteJoint && type != e_weldJoint && type != e_distanceJoint);
+	B2_NOT_USED(type);
+
+	for (int32 i = 0; i < count; ++i)
+	{
+		joints[i]->SolveVelocityConstraints(data);
+	}
+}
+
+bool b2Joint::SolvePositionBatch(b2JointType type, b2Joint** joints, int32 count, const b2SolverData& data)
+{
+	b2Assert(type != e_revoluteJoint && type != e_weldJoint && type != e_distanceJoint);
+	B2_NOT_USED(type);
+
+	bool okay = true;
+	for (int32 i = 0; i < count; ++i)
+	{
+		bool jointOkay = joints[i]->SolvePositionConstraints(data);
+		okay = okay && jointOkay;
+	}
+	return okay;
+}
+
 b2Joint::b2Joint(const b2JointDef* def)
 {
 	b2Assert(def->bodyA != def->bodyB);
@@ -229,9 +257,13 @@ b2Joint::b2Joint(const b2JointDef* def)
 	m_type = def->type;
 	m_prev = nullptr;
 	m_next = nullptr;
+	m_sleepingIsland = nullptr;
+	m_sleepingPrev = nullptr;
+	m_sleepingNext = nullptr;
 	m_bodyA = def->bodyA;
 	m_bodyB = def->bodyB;
 	m_index = 0;
+	m_constraintIndex = 0;
 	m_collideConnected = def->collideConnected;
 	m_islandFlag = false;
 	m_userData = def->userData;
@@ -252,6 +284,35 @@ bool b2Joint::IsEnabled() const
 	return m_bodyA->IsEnabled() && m_bodyB->IsEnabled();
 }
 
+void b2Joint::Serialize(b2SnapshotArchive& archive)
+{
+	archive.Value(m_islandFlag);
+	archive.Value(m_collideConnected);
+	archive.Value(m_userData);
+}
+
+void b2Joint::Relocate(const b2BlockAllocator* allocator)
+{
+	m_prev = allocator->Relocate(m_prev);
+	m_next = allocator->Relocate(m_next);
+	m_sleepingIsland = allocator->Relocate(m_sleepingIsland);
+	m_sleepingPrev = allocator->Relocate(m_sleepingPrev);
+	m_sleepingNext = allocator->Relocate(m_sleepingNext);
+
+	m_edgeA.joint = this;
+	m_edgeA.other = allocator->Relocate(m_edgeA.other);
+	m_edgeA.prev = allocator->Relocate(m_edgeA.prev);
+	m_edgeA.next = allocator->Relocate(m_edgeA.next);
+
+	m_edgeB.joint = this;
+	m_edgeB.other = allocator->Relocate(m_edgeB.other);
+	m_edgeB.prev = allocator->Relocate(m_edgeB.prev);
+	m_edgeB.next = allocator->Relocate(m_edgeB.next);
+
+	m_bodyA = allocator->Relocate(m_bodyA);
+	m_bodyB = allocator->Relocate(m_bodyB);
+}
+
 void b2Joint::Draw(b2Draw* draw) const
 {
 	const b2Transform& xf1 = m_bodyA->GetTransform();
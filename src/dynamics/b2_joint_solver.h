@@ -0,0 +1,110 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef B2_JOINT_SOLVER_H
+#define B2_JOINT_SOLVER_H
+
+#include "box2d/b2_math.h"
+
+/// Solver state of one revolute joint. The island packs its revolute joints into a
+/// dense array of these, so the batch kernels read contiguous memory and the body
+/// state instead of the joint objects. The results are stored back after the step.
+struct b2RevoluteConstraint
+{
+	// Anchors relative to the body centers
+	b2Vec2 localAnchorA;
+	b2Vec2 localAnchorB;
+	b2Vec2 rA;
+	b2Vec2 rB;
+	b2Mat22 K;
+	b2Vec2 impulse;
+	float motorImpulse;
+	float lowerImpulse;
+	float upperImpulse;
+	float axialMass;
+	float angle;
+	float referenceAngle;
+	float lowerAngle;
+	float upperAngle;
+	float motorSpeed;
+	float maxMotorTorque;
+	float invMassA, invMassB;
+	float invIA, invIB;
+	int32 indexA;
+	int32 indexB;
+	int32 jointIndex;
+	bool enableMotor;
+	bool enableLimit;
+};
+
+/// Solver state of one weld joint, see b2RevoluteConstraint.
+struct b2WeldConstraint
+{
+	// Anchors relative to the body centers
+	b2Vec2 localAnchorA;
+	b2Vec2 localAnchorB;
+	b2Vec2 rA;
+	b2Vec2 rB;
+	b2Mat33 mass;
+	b2Vec3 impulse;
+	float referenceAngle;
+	float stiffness;
+	float damping;
+	float gamma;
+	float bias;
+	float invMassA, invMassB;
+	float invIA, invIB;
+	int32 indexA;
+	int32 indexB;
+	int32 jointIndex;
+};
+
+/// Solver state of one distance joint, see b2RevoluteConstraint.
+struct b2DistanceConstraint
+{
+	// Anchors relative to the body centers
+	b2Vec2 localAnchorA;
+	b2Vec2 localAnchorB;
+	b2Vec2 rA;
+	b2Vec2 rB;
+	b2Vec2 u;
+	float length;
+	float minLength;
+	float maxLength;
+	float currentLength;
+	float stiffness;
+	float damping;
+	float gamma;
+	float bias;
+	float impulse;
+	float lowerImpulse;
+	float upperImpulse;
+	float mass;
+	float softMass;
+	float invMassA, invMassB;
+	float invIA, invIB;
+	int32 indexA;
+	int32 indexB;
+	int32 jointIndex;
+};
+
+#endif
@@ -20,6 +20,8 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include "b2_snapshot.h"
+
 #include "box2d/b2_body.h"
 #include "box2d/b2_motor_joint.h"
 #include "box2d/b2_time_step.h"
@@ -309,3 +311,30 @@ void b2MotorJoint::Dump()
 	b2Dump("  jd.correctionFactor = %.9g;\n", m_correctionFactor);
 	b2Dump("  joints[%d] = m_world->CreateJoint(&jd);\n", m_index);
 }
+
+void b2MotorJoint::Serialize(b2SnapshotArchive& archive)
+{
+	b2Joint::Serialize(archive);
+
+	archive.Value(m_linearOffset);
+	archive.Value(m_angularOffset);
+	archive.Value(m_linearImpulse);
+	archive.Value(m_angularImpulse);
+	archive.Value(m_maxForce);
+	archive.Value(m_maxTorque);
+	archive.Value(m_correctionFactor);
+	archive.Value(m_indexA);
+	archive.Value(m_indexB);
+	archive.Value(m_rA);
+	archive.Value(m_rB);
+	archive.Value(m_localCenterA);
+	archive.Value(m_localCenterB);
+	archive.Value(m_linearError);
+	archive.Value(m_angularError);
+	archive.Value(m_invMassA);
+	archive.Value(m_invMassB);
+	archive.Value(m_invIA);
+	archive.Value(m_invIB);
+	archive.Value(m_linearMass);
+	archive.Value(m_angularMass);
+}
@@ -20,6 +20,8 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include "b2_snapshot.h"
+
 #include "box2d/b2_body.h"
 #include "box2d/b2_mouse_joint.h"
 #include "box2d/b2_time_step.h"
@@ -188,3 +190,25 @@ void b2MouseJoint::ShiftOrigin(const b2Vec2& newOrigin)
 {
 	m_targetA -= newOrigin;
 }
+
+void b2MouseJoint::Serialize(b2SnapshotArchive& archive)
+{
+	b2Joint::Serialize(archive);
+
+	archive.Value(m_localAnchorB);
+	archive.Value(m_targetA);
+	archive.Value(m_stiffness);
+	archive.Value(m_damping);
+	archive.Value(m_beta);
+	archive.Value(m_impulse);
+	archive.Value(m_maxForce);
+	archive.Value(m_gamma);
+	archive.Value(m_indexA);
+	archive.Value(m_indexB);
+	archive.Value(m_rB);
+	archive.Value(m_localCenterB);
+	archive.Value(m_invMassB);
+	archive.Value(m_invIB);
+	archive.Value(m_mass);
+	archive.Value(m_C);
+}
@@ -20,6 +20,8 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include "b2_snapshot.h"
+
 #include "box2d/b2_body.h"
 #include "box2d/b2_draw.h"
 #include "box2d/b2_prismatic_joint.h"
@@ -641,3 +643,41 @@ void b2PrismaticJoint::Draw(b2Draw* draw) const
 	draw->DrawPoint(pA, 5.0f, c1);
 	draw->DrawPoint(pB, 5.0f, c4);
 }
+
+void b2PrismaticJoint::Serialize(b2SnapshotArchive& archive)
+{
+	b2Joint::Serialize(archive);
+
+	archive.Value(m_localAnchorA);
+	archive.Value(m_localAnchorB);
+	archive.Value(m_localXAxisA);
+	archive.Value(m_localYAxisA);
+	archive.Value(m_referenceAngle);
+	archive.Value(m_impulse);
+	archive.Value(m_motorImpulse);
+	archive.Value(m_lowerImpulse);
+	archive.Value(m_upperImpulse);
+	archive.Value(m_lowerTranslation);
+	archive.Value(m_upperTranslation);
+	archive.Value(m_maxMotorForce);
+	archive.Value(m_motorSpeed);
+	archive.Value(m_enableLimit);
+	archive.Value(m_enableMotor);
+	archive.Value(m_indexA);
+	archive.Value(m_indexB);
+	archive.Value(m_localCenterA);
+	archive.Value(m_localCenterB);
+	archive.Value(m_invMassA);
+	archive.Value(m_invMassB);
+	archive.Value(m_invIA);
+	archive.Value(m_invIB);
+	archive.Value(m_axis);
+	archive.Value(m_perp);
+	archive.Value(m_s1);
+	archive.Value(m_s2);
+	archive.Value(m_a1);
+	archive.Value(m_a2);
+	archive.Value(m_K);
+	archive.Value(m_translation);
+	archive.Value(m_axialMass);
+}
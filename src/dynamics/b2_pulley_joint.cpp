@@ -20,6 +20,8 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include "b2_snapshot.h"
+
 #include "box2d/b2_body.h"
 #include "box2d/b2_pulley_joint.h"
 #include "box2d/b2_time_step.h"
@@ -350,3 +352,31 @@ void b2PulleyJoint::ShiftOrigin(const b2Vec2& newOrigin)
 	m_groundAnchorA -= newOrigin;
 	m_groundAnchorB -= newOrigin;
 }
+
+void b2PulleyJoint::Serialize(b2SnapshotArchive& archive)
+{
+	b2Joint::Serialize(archive);
+
+	archive.Value(m_groundAnchorA);
+	archive.Value(m_groundAnchorB);
+	archive.Value(m_lengthA);
+	archive.Value(m_lengthB);
+	archive.Value(m_localAnchorA);
+	archive.Value(m_localAnchorB);
+	archive.Value(m_constant);
+	archive.Value(m_ratio);
+	archive.Value(m_impulse);
+	archive.Value(m_indexA);
+	archive.Value(m_indexB);
+	archive.Value(m_uA);
+	archive.Value(m_uB);
+	archive.Value(m_rA);
+	archive.Value(m_rB);
+	archive.Value(m_localCenterA);
+	archive.Value(m_localCenterB);
+	archive.Value(m_invMassA);
+	archive.Value(m_invMassB);
+	archive.Value(m_invIA);
+	archive.Value(m_invIB);
+	archive.Value(m_mass);
+}
@@ -20,9 +20,13 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include "b2_joint_solver.h"
+#include "b2_snapshot.h"
+
 #include "box2d/b2_body.h"
 #include "box2d/b2_draw.h"
 #include "box2d/b2_revolute_joint.h"
+#include "box2d/b2_stack_allocator.h"
 #include "box2d/b2_time_step.h"
 
 // Point-to-point constraint
@@ -320,6 +324,423 @@ bool b2RevoluteJoint::SolvePositionConstraints(const b2SolverData& data)
 	return positionError <= b2_linearSlop && angularError <= b2_angularSlop;
 }
 
+void b2RevoluteJoint::PrepareConstraint(b2RevoluteConstraint* constraint, int32 jointIndex)
+{
+	m_indexA = m_bodyA->m_islandIndex;
+	m_indexB = m_bodyB->m_islandIndex;
+	m_localCenterA = m_bodyA->m_localCenter;
+	m_localCenterB = m_bodyB->m_localCenter;
+	m_invMassA = m_bodyA->m_invMass;
+	m_invMassB = m_bodyB->m_invMass;
+	m_invIA = m_bodyA->m_invI;
+	m_invIB = m_bodyB->m_invI;
+
+	b2RevoluteConstraint* c = constraint;
+	c->localAnchorA = m_localAnchorA - m_localCenterA;
+	c->localAnchorB = m_localAnchorB - m_localCenterB;
+	c->impulse = m_impulse;
+	c->motorImpulse = m_motorImpulse;
+	c->lowerImpulse = m_lowerImpulse;
+	c->upperImpulse = m_upperImpulse;
+	c->referenceAngle = m_referenceAngle;
+	c->lowerAngle = m_lowerAngle;
+	c->upperAngle = m_upperAngle;
+	c->motorSpeed = m_motorSpeed;
+	c->maxMotorTorque = m_maxMotorTorque;
+	c->invMassA = m_invMassA;
+	c->invMassB = m_invMassB;
+	c->invIA = m_invIA;
+	c->invIB = m_invIB;
+	c->indexA = m_indexA;
+	c->indexB = m_indexB;
+	c->jointIndex = jointIndex;
+	c->enableMotor = m_enableMotor;
+	c->enableLimit = m_enableLimit;
+}
+
+void b2RevoluteJoint::StoreConstraint(const b2RevoluteConstraint* constraint)
+{
+	const b2RevoluteConstraint* c = constraint;
+	m_rA = c->rA;
+	m_rB = c->rB;
+	m_K = c->K;
+	m_angle = c->angle;
+	m_axialMass = c->axialMass;
+	m_impulse = c->impulse;
+	m_motorImpulse = c->motorImpulse;
+	m_lowerImpulse = c->lowerImpulse;
+	m_upperImpulse = c->upperImpulse;
+}
+
+// The batch kernels follow InitVelocityConstraints, SolveVelocityConstraints, and
+// SolvePositionConstraints operation for operation, so the results are the same.
+void b2RevoluteJoint::InitVelocityBatch(b2RevoluteConstraint* constraints, int32 count, const b2SolverData& data)
+{
+	for (int32 k = 0; k < count; ++k)
+	{
+		b2RevoluteConstraint* c = constraints + k;
+
+		float aA = data.positions[c->indexA].a;
+		b2Vec2 vA = data.velocities[c->indexA].v;
+		float wA = data.velocities[c->indexA].w;
+
+		float aB = data.positions[c->indexB].a;
+		b2Vec2 vB = data.velocities[c->indexB].v;
+		float wB = data.velocities[c->indexB].w;
+
+		b2Rot qA(aA), qB(aB);
+
+		c->rA = b2Mul(qA, c->localAnchorA);
+		c->rB = b2Mul(qB, c->localAnchorB);
+
+		float mA = c->invMassA, mB = c->invMassB;
+		float iA = c->invIA, iB = c->invIB;
+
+		c->K.ex.x = mA + mB + c->rA.y * c->rA.y * iA + c->rB.y * c->rB.y * iB;
+		c->K.ey.x = -c->rA.y * c->rA.x * iA - c->rB.y * c->rB.x * iB;
+		c->K.ex.y = c->K.ey.x;
+		c->K.ey.y = mA + mB + c->rA.x * c->rA.x * iA + c->rB.x * c->rB.x * iB;
+
+		c->axialMass = iA + iB;
+		bool fixedRotation;
+		if (c->axialMass > 0.0f)
+		{
+			c->axialMass = 1.0f / c->axialMass;
+			fixedRotation = false;
+		}
+		else
+		{
+			fixedRotation = true;
+		}
+
+		c->angle = aB - aA - c->referenceAngle;
+		if (c->enableLimit == false || fixedRotation)
+		{
+			c->lowerImpulse = 0.0f;
+			c->upperImpulse = 0.0f;
+		}
+
+		if (c->enableMotor == false || fixedRotation)
+		{
+			c->motorImpulse = 0.0f;
+		}
+
+		if (data.step.warmStarting)
+		{
+			// Scale impulses to support a variable time step.
+			c->impulse *= data.step.dtRatio;
+			c->motorImpulse *= data.step.dtRatio;
+			c->lowerImpulse *= data.step.dtRatio;
+			c->upperImpulse *= data.step.dtRatio;
+
+			float axialImpulse = c->motorImpulse + c->lowerImpulse - c->upperImpulse;
+			b2Vec2 P(c->impulse.x, c->impulse.y);
+
+			vA -= mA * P;
+			wA -= iA * (b2Cross(c->rA, P) + axialImpulse);
+
+			vB += mB * P;
+			wB += iB * (b2Cross(c->rB, P) + axialImpulse);
+		}
+		else
+		{
+			c->impulse.SetZero();
+			c->motorImpulse = 0.0f;
+			c->lowerImpulse = 0.0f;
+			c->upperImpulse = 0.0f;
+		}
+
+		data.velocities[c->indexA].v = vA;
+		data.velocities[c->indexA].w = wA;
+		data.velocities[c->indexB].v = vB;
+		data.velocities[c->indexB].w = wB;
+	}
+}
+
+void b2RevoluteJoint::SolveVelocityBatch(b2RevoluteConstraint* constraints, int32 count, const b2SolverData& data)
+{
+	float dt = data.step.dt;
+	float inv_dt = data.step.inv_dt;
+
+	for (int32 k = 0; k < count; ++k)
+	{
+		b2RevoluteConstraint* c = constraints + k;
+
+		b2Vec2 vA = data.velocities[c->indexA].v;
+		float wA = data.velocities[c->indexA].w;
+		b2Vec2 vB = data.velocities[c->indexB].v;
+		float wB = data.velocities[c->indexB].w;
+
+		float mA = c->invMassA, mB = c->invMassB;
+		float iA = c->invIA, iB = c->invIB;
+
+		bool fixedRotation = (iA + iB == 0.0f);
+
+		// Solve motor constraint.
+		if (c->enableMotor && fixedRotation == false)
+		{
+			float Cdot = wB - wA - c->motorSpeed;
+			float impulse = -c->axialMass * Cdot;
+			float oldImpulse = c->motorImpulse;
+			float maxImpulse = dt * c->maxMotorTorque;
+			c->motorImpulse = b2Clamp(c->motorImpulse + impulse, -maxImpulse, maxImpulse);
+			impulse = c->motorImpulse - oldImpulse;
+
+			wA -= iA * impulse;
+			wB += iB * impulse;
+		}
+
+		if (c->enableLimit && fixedRotation == false)
+		{
+			// Lower limit
+			{
+				float C = c->angle - c->lowerAngle;
+				float Cdot = wB - wA;
+				float impulse = -c->axialMass * (Cdot + b2Max(C, 0.0f) * inv_dt);
+				float oldImpulse = c->lowerImpulse;
+				c->lowerImpulse = b2Max(c->lowerImpulse + impulse, 0.0f);
+				impulse = c->lowerImpulse - oldImpulse;
+
+				wA -= iA * impulse;
+				wB += iB * impulse;
+			}
+
+			// Upper limit, with the signs flipped as in SolveVelocityConstraints.
+			{
+				float C = c->upperAngle - c->angle;
+				float Cdot = wA - wB;
+				float impulse = -c->axialMass * (Cdot + b2Max(C, 0.0f) * inv_dt);
+				float oldImpulse = c->upperImpulse;
+				c->upperImpulse = b2Max(c->upperImpulse + impulse, 0.0f);
+				impulse = c->upperImpulse - oldImpulse;
+
+				wA += iA * impulse;
+				wB -= iB * impulse;
+			}
+		}
+
+		// Solve point-to-point constraint
+		{
+			b2Vec2 Cdot = vB + b2Cross(wB, c->rB) - vA - b2Cross(wA, c->rA);
+			b2Vec2 impulse = c->K.Solve(-Cdot);
+
+			c->impulse.x += impulse.x;
+			c->impulse.y += impulse.y;
+
+			vA -= mA * impulse;
+			wA -= iA * b2Cross(c->rA, impulse);
+
+			vB += mB * impulse;
+			wB += iB * b2Cross(c->rB, impulse);
+		}
+
+		data.velocities[c->indexA].v = vA;
+		data.velocities[c->indexA].w = wA;
+		data.velocities[c->indexB].v = vB;
+		data.velocities[c->indexB].w = wB;
+	}
+}
+
+bool b2RevoluteJoint::SolvePositionBatch(const b2RevoluteConstraint* constraints, int32 count, const b2SolverData& data)
+{
+	bool okay = true;
+	for (int32 k = 0; k < count; ++k)
+	{
+		const b2RevoluteConstraint* c = constraints + k;
+
+		b2Vec2 cA = data.positions[c->indexA].c;
+		float aA = data.positions[c->indexA].a;
+		b2Vec2 cB = data.positions[c->indexB].c;
+		float aB = data.positions[c->indexB].a;
+
+		b2Rot qA(aA), qB(aB);
+
+		float angularError = 0.0f;
+		float positionError = 0.0f;
+
+		float mA = c->invMassA, mB = c->invMassB;
+		float iA = c->invIA, iB = c->invIB;
+
+		bool fixedRotation = (iA + iB == 0.0f);
+
+		// Solve angular limit constraint
+		if (c->enableLimit && fixedRotation == false)
+		{
+			float angle = aB - aA - c->referenceAngle;
+			float C = 0.0f;
+
+			if (b2Abs(c->upperAngle - c->lowerAngle) < 2.0f * b2_angularSlop)
+			{
+				// Prevent large angular corrections
+				C = b2Clamp(angle - c->lowerAngle, -b2_maxAngularCorrection, b2_maxAngularCorrection);
+			}
+			else if (angle <= c->lowerAngle)
+			{
+				// Prevent large angular corrections and allow some slop.
+				C = b2Clamp(angle - c->lowerAngle + b2_angularSlop, -b2_maxAngularCorrection, 0.0f);
+			}
+			else if (angle >= c->upperAngle)
+			{
+				// Prevent large angular corrections and allow some slop.
+				C = b2Clamp(angle - c->upperAngle - b2_angularSlop, 0.0f, b2_maxAngularCorrection);
+			}
+
+			float limitImpulse = -c->axialMass * C;
+			aA -= iA * limitImpulse;
+			aB += iB * limitImpulse;
+			angularError = b2Abs(C);
+		}
+
+		// Solve point-to-point constraint.
+		{
+			qA.Set(aA);
+			qB.Set(aB);
+			b2Vec2 rA = b2Mul(qA, c->localAnchorA);
+			b2Vec2 rB = b2Mul(qB, c->localAnchorB);
+
+			b2Vec2 C = cB + rB - cA - rA;
+			positionError = C.Length();
+
+			b2Mat22 K;
+			K.ex.x = mA + mB + iA * rA.y * rA.y + iB * rB.y * rB.y;
+			K.ex.y = -iA * rA.x * rA.y - iB * rB.x * rB.y;
+			K.ey.x = K.ex.y;
+			K.ey.y = mA + mB + iA * rA.x * rA.x + iB * rB.x * rB.x;
+
+			b2Vec2 impulse = -K.Solve(C);
+
+			cA -= mA * impulse;
+			aA -= iA * b2Cross(rA, impulse);
+
+			cB += mB * impulse;
+			aB += iB * b2Cross(rB, impulse);
+		}
+
+		data.positions[c->indexA].c = cA;
+		data.positions[c->indexA].a = aA;
+		data.positions[c->indexB].c = cB;
+		data.positions[c->indexB].a = aB;
+
+		bool jointOkay = positionError <= b2_linearSlop && angularError <= b2_angularSlop;
+		okay = okay && jointOkay;
+	}
+
+	return okay;
+}
+
+// A chain of n point constraints gives the block tridiagonal system K * impulse = -Cdot
+// with 2x2 blocks. The diagonal block of a joint is its effective mass. Neighboring
+// joints are coupled through their shared body:
+// K12 = s1 * s2 * (m * I + i * perp(r1) * perp(r2)^T)
+// where s is +1 if the shared body is body B of the joint and -1 if it is body A, and
+// perp(r) = [-ry; rx]. This is solved exactly with the Thomas algorithm.
+struct b2ChainRow
+{
+	b2Mat22 invD;
+	b2Mat22 C;
+	b2Vec2 y;
+};
+
+// The rows hold the diagonal blocks in invD, the coupling to the next row in C, and
+// the right hand side in y. The solution replaces y.
+static void b2SolveChain(b2ChainRow* rows, int32 count)
+{
+	rows[0].invD = rows[0].invD.GetInverse();
+	for (int32 k = 1; k < count; ++k)
+	{
+		const b2ChainRow* prev = rows + k - 1;
+		b2ChainRow* row = rows + k;
+
+		b2Mat22 S = b2MulT(prev->C, b2Mul(prev->invD, prev->C));
+		b2Mat22 D = row->invD;
+		D.ex -= S.ex;
+		D.ey -= S.ey;
+		row->invD = D.GetInverse();
+		row->y -= b2MulT(prev->C, b2Mul(prev->invD, prev->y));
+	}
+
+	rows[count - 1].y = b2Mul(rows[count - 1].invD, rows[count - 1].y);
+	for (int32 k = count - 2; k >= 0; --k)
+	{
+		b2ChainRow* row = rows + k;
+		row->y = b2Mul(row->invD, row->y - b2Mul(row->C, rows[k + 1].y));
+	}
+}
+
+// Only the velocities are solved directly. A Newton step on the positions of a whole
+// chain spreads the correction over many light links, and the second order error of
+// their rotations adds up along a taut chain until the step diverges. The positions
+// are corrected one joint at a time instead.
+void b2RevoluteJoint::SolveChainVelocities(b2RevoluteConstraint* constraints, int32 count, b2StackAllocator* allocator, const b2SolverData& data)
+{
+	b2ChainRow* rows = (b2ChainRow*)allocator->Allocate(count * sizeof(b2ChainRow));
+
+	for (int32 k = 0; k < count; ++k)
+	{
+		const b2RevoluteConstraint* c = constraints + k;
+		b2Assert(c->enableLimit == false && c->enableMotor == false);
+
+		b2Vec2 vA = data.velocities[c->indexA].v;
+		float wA = data.velocities[c->indexA].w;
+		b2Vec2 vB = data.velocities[c->indexB].v;
+		float wB = data.velocities[c->indexB].w;
+
+		b2ChainRow* row = rows + k;
+		row->invD = c->K;
+		row->y = -(vB + b2Cross(wB, c->rB) - vA - b2Cross(wA, c->rA));
+
+		if (k == count - 1)
+		{
+			continue;
+		}
+
+		// Neighbors may share a static body as well, so look for the dynamic one. Only
+		// dynamic bodies have mass.
+		const b2RevoluteConstraint* next = c + 1;
+		int32 body = c->indexB;
+		bool sharedB = c->invMassB > 0.0f && (body == next->indexA || body == next->indexB);
+		if (sharedB == false)
+		{
+			body = c->indexA;
+		}
+
+		float s1 = sharedB ? 1.0f : -1.0f;
+		b2Vec2 r1 = sharedB ? c->rB : c->rA;
+		float m = sharedB ? c->invMassB : c->invMassA;
+		float i = sharedB ? c->invIB : c->invIA;
+
+		bool nextSharedB = body == next->indexB;
+		float s2 = nextSharedB ? 1.0f : -1.0f;
+		b2Vec2 r2 = nextSharedB ? next->rB : next->rA;
+
+		float s = s1 * s2;
+		b2Vec2 p1(-r1.y, r1.x);
+		b2Vec2 p2(-r2.y, r2.x);
+
+		row->C.ex.x = s * (m + i * p1.x * p2.x);
+		row->C.ex.y = s * i * p1.y * p2.x;
+		row->C.ey.x = s * i * p1.x * p2.y;
+		row->C.ey.y = s * (m + i * p1.y * p2.y);
+	}
+
+	b2SolveChain(rows, count);
+
+	// The impulses are solved together, so the order they are applied in does not matter.
+	for (int32 k = 0; k < count; ++k)
+	{
+		b2RevoluteConstraint* c = constraints + k;
+		b2Vec2 impulse = rows[k].y;
+		c->impulse += impulse;
+
+		data.velocities[c->indexA].v -= c->invMassA * impulse;
+		data.velocities[c->indexA].w -= c->invIA * b2Cross(c->rA, impulse);
+		data.velocities[c->indexB].v += c->invMassB * impulse;
+		data.velocities[c->indexB].w += c->invIB * b2Cross(c->rB, impulse);
+	}
+
+	allocator->Free(rows);
+}
+
 b2Vec2 b2RevoluteJoint::GetAnchorA() const
 {
 	return m_bodyA->GetWorldPoint(m_localAnchorA);
@@ -499,3 +920,35 @@ void b2RevoluteJoint::Draw(b2Draw* draw) const
 	draw->DrawSegment(pA, pB, color);
 	draw->DrawSegment(xfB.p, pB, color);
 }
+
+void b2RevoluteJoint::Serialize(b2SnapshotArchive& archive)
+{
+	b2Joint::Serialize(archive);
+
+	archive.Value(m_localAnchorA);
+	archive.Value(m_localAnchorB);
+	archive.Value(m_impulse);
+	archive.Value(m_motorImpulse);
+	archive.Value(m_lowerImpulse);
+	archive.Value(m_upperImpulse);
+	archive.Value(m_enableMotor);
+	archive.Value(m_maxMotorTorque);
+	archive.Value(m_motorSpeed);
+	archive.Value(m_enableLimit);
+	archive.Value(m_referenceAngle);
+	archive.Value(m_lowerAngle);
+	archive.Value(m_upperAngle);
+	archive.Value(m_indexA);
+	archive.Value(m_indexB);
+	archive.Value(m_rA);
+	archive.Value(m_rB);
+	archive.Value(m_localCenterA);
+	archive.Value(m_localCenterB);
+	archive.Value(m_invMassA);
+	archive.Value(m_invMassB);
+	archive.Value(m_invIA);
+	archive.Value(m_invIB);
+	archive.Value(m_K);
+	archive.Value(m_angle);
+	archive.Value(m_axialMass);
+}
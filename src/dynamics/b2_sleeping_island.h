@@ -0,0 +1,44 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef B2_SLEEPING_ISLAND_H
+#define B2_SLEEPING_ISLAND_H
+
+class b2Body;
+class b2Contact;
+class b2Joint;
+
+/// An island that fell asleep. It keeps the contacts and joints that held the island
+/// together, so waking it rebuilds the solver island without searching the graph.
+/// The bodies are linked in a ring through the bodies, the contacts and joints in
+/// lists through themselves. The record lives until the island search takes it.
+struct b2SleepingIsland
+{
+	b2Body* bodies;
+	b2Contact* contacts;
+	b2Joint* joints;
+
+	// Set once the bodies were woken, before the island search takes the record.
+	bool awake;
+};
+
+#endif
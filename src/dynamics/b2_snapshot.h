@@ -0,0 +1,110 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#ifndef B2_SNAPSHOT_H
+#define B2_SNAPSHOT_H
+
+#include "box2d/b2_math.h"
+
+#include <string.h>
+
+/// Reads or writes the flat byte stream of a world snapshot. The same Serialize
+/// functions are used in both directions, so the layout cannot drift between
+/// save and restore. Values are copied with their native size and byte order.
+/// When saving with a null buffer the archive only counts bytes.
+class b2SnapshotArchive
+{
+public:
+	b2SnapshotArchive(uint8* data, int32 capacity, bool loading)
+	{
+		m_data = data;
+		m_capacity = capacity;
+		m_offset = 0;
+		m_loading = loading;
+		m_error = false;
+	}
+
+	bool IsLoading() const
+	{
+		return m_loading;
+	}
+
+	void Bytes(void* data, int32 size)
+	{
+		bool fits = m_offset + size <= m_capacity;
+		if (m_loading)
+		{
+			if (fits && m_error == false)
+			{
+				memcpy(data, m_data + m_offset, size);
+			}
+			else
+			{
+				memset(data, 0, size);
+				m_error = true;
+			}
+		}
+		else if (m_data != nullptr)
+		{
+			if (fits && m_error == false)
+			{
+				memcpy(m_data + m_offset, data, size);
+			}
+			else
+			{
+				m_error = true;
+			}
+		}
+
+		m_offset += size;
+	}
+
+	/// Only use this for types without padding.
+	template <typename T>
+	void Value(T& value)
+	{
+		Bytes(&value, sizeof(T));
+	}
+
+	/// Enumerations are stored as int32.
+	template <typename T>
+	void Enum(T& value)
+	{
+		int32 i = m_loading ? 0 : int32(value);
+		Value(i);
+		value = T(i);
+	}
+
+	void Value(bool& value)
+	{
+		uint8 b = m_loading == false && value ? 1 : 0;
+		Value(b);
+		value = b != 0;
+	}
+
+	uint8* m_data;
+	int32 m_capacity;
+	int32 m_offset;
+	bool m_loading;
+	bool m_error;
+};
+
+#endif
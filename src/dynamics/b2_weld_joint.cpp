@@ -20,6 +20,9 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include "b2_joint_solver.h"
+#include "b2_snapshot.h"
+
 #include "box2d/b2_body.h"
 #include "box2d/b2_time_step.h"
 #include "box2d/b2_weld_joint.h"
@@ -305,6 +308,289 @@ bool b2WeldJoint::SolvePositionConstraints(const b2SolverData& data)
 	return positionError <= b2_linearSlop && angularError <= b2_angularSlop;
 }
 
+void b2WeldJoint::PrepareConstraint(b2WeldConstraint* constraint, int32 jointIndex)
+{
+	m_indexA = m_bodyA->m_islandIndex;
+	m_indexB = m_bodyB->m_islandIndex;
+	m_localCenterA = m_bodyA->m_localCenter;
+	m_localCenterB = m_bodyB->m_localCenter;
+	m_invMassA = m_bodyA->m_invMass;
+	m_invMassB = m_bodyB->m_invMass;
+	m_invIA = m_bodyA->m_invI;
+	m_invIB = m_bodyB->m_invI;
+
+	b2WeldConstraint* c = constraint;
+	c->localAnchorA = m_localAnchorA - m_localCenterA;
+	c->localAnchorB = m_localAnchorB - m_localCenterB;
+	c->impulse = m_impulse;
+	c->referenceAngle = m_referenceAngle;
+	c->stiffness = m_stiffness;
+	c->damping = m_damping;
+	c->invMassA = m_invMassA;
+	c->invMassB = m_invMassB;
+	c->invIA = m_invIA;
+	c->invIB = m_invIB;
+	c->indexA = m_indexA;
+	c->indexB = m_indexB;
+	c->jointIndex = jointIndex;
+}
+
+void b2WeldJoint::StoreConstraint(const b2WeldConstraint* constraint)
+{
+	const b2WeldConstraint* c = constraint;
+	m_rA = c->rA;
+	m_rB = c->rB;
+	m_mass = c->mass;
+	m_gamma = c->gamma;
+	m_bias = c->bias;
+	m_impulse = c->impulse;
+}
+
+// The batch kernels follow InitVelocityConstraints, SolveVelocityConstraints, and
+// SolvePositionConstraints operation for operation, so the results are the same.
+void b2WeldJoint::InitVelocityBatch(b2WeldConstraint* constraints, int32 count, const b2SolverData& data)
+{
+	for (int32 k = 0; k < count; ++k)
+	{
+		b2WeldConstraint* c = constraints + k;
+
+		float aA = data.positions[c->indexA].a;
+		b2Vec2 vA = data.velocities[c->indexA].v;
+		float wA = data.velocities[c->indexA].w;
+
+		float aB = data.positions[c->indexB].a;
+		b2Vec2 vB = data.velocities[c->indexB].v;
+		float wB = data.velocities[c->indexB].w;
+
+		b2Rot qA(aA), qB(aB);
+
+		c->rA = b2Mul(qA, c->localAnchorA);
+		c->rB = b2Mul(qB, c->localAnchorB);
+
+		float mA = c->invMassA, mB = c->invMassB;
+		float iA = c->invIA, iB = c->invIB;
+
+		b2Mat33 K;
+		K.ex.x = mA + mB + c->rA.y * c->rA.y * iA + c->rB.y * c->rB.y * iB;
+		K.ey.x = -c->rA.y * c->rA.x * iA - c->rB.y * c->rB.x * iB;
+		K.ez.x = -c->rA.y * iA - c->rB.y * iB;
+		K.ex.y = K.ey.x;
+		K.ey.y = mA + mB + c->rA.x * c->rA.x * iA + c->rB.x * c->rB.x * iB;
+		K.ez.y = c->rA.x * iA + c->rB.x * iB;
+		K.ex.z = K.ez.x;
+		K.ey.z = K.ez.y;
+		K.ez.z = iA + iB;
+
+		if (c->stiffness > 0.0f)
+		{
+			K.GetInverse22(&c->mass);
+
+			float invM = iA + iB;
+
+			float C = aB - aA - c->referenceAngle;
+
+			float d = c->damping;
+			float k = c->stiffness;
+
+			float h = data.step.dt;
+			c->gamma = h * (d + h * k);
+			c->gamma = c->gamma != 0.0f ? 1.0f / c->gamma : 0.0f;
+			c->bias = C * h * k * c->gamma;
+
+			invM += c->gamma;
+			c->mass.ez.z = invM != 0.0f ? 1.0f / invM : 0.0f;
+		}
+		else if (K.ez.z == 0.0f)
+		{
+			K.GetInverse22(&c->mass);
+			c->gamma = 0.0f;
+			c->bias = 0.0f;
+		}
+		else
+		{
+			K.GetSymInverse33(&c->mass);
+			c->gamma = 0.0f;
+			c->bias = 0.0f;
+		}
+
+		if (data.step.warmStarting)
+		{
+			// Scale impulses to support a variable time step.
+			c->impulse *= data.step.dtRatio;
+
+			b2Vec2 P(c->impulse.x, c->impulse.y);
+
+			vA -= mA * P;
+			wA -= iA * (b2Cross(c->rA, P) + c->impulse.z);
+
+			vB += mB * P;
+			wB += iB * (b2Cross(c->rB, P) + c->impulse.z);
+		}
+		else
+		{
+			c->impulse.SetZero();
+		}
+
+		data.velocities[c->indexA].v = vA;
+		data.velocities[c->indexA].w = wA;
+		data.velocities[c->indexB].v = vB;
+		data.velocities[c->indexB].w = wB;
+	}
+}
+
+void b2WeldJoint::SolveVelocityBatch(b2WeldConstraint* constraints, int32 count, const b2SolverData& data)
+{
+	for (int32 k = 0; k < count; ++k)
+	{
+		b2WeldConstraint* c = constraints + k;
+
+		b2Vec2 vA = data.velocities[c->indexA].v;
+		float wA = data.velocities[c->indexA].w;
+		b2Vec2 vB = data.velocities[c->indexB].v;
+		float wB = data.velocities[c->indexB].w;
+
+		float mA = c->invMassA, mB = c->invMassB;
+		float iA = c->invIA, iB = c->invIB;
+
+		if (c->stiffness > 0.0f)
+		{
+			float Cdot2 = wB - wA;
+
+			float impulse2 = -c->mass.ez.z * (Cdot2 + c->bias + c->gamma * c->impulse.z);
+			c->impulse.z += impulse2;
+
+			wA -= iA * impulse2;
+			wB += iB * impulse2;
+
+			b2Vec2 Cdot1 = vB + b2Cross(wB, c->rB) - vA - b2Cross(wA, c->rA);
+
+			b2Vec2 impulse1 = -b2Mul22(c->mass, Cdot1);
+			c->impulse.x += impulse1.x;
+			c->impulse.y += impulse1.y;
+
+			b2Vec2 P = impulse1;
+
+			vA -= mA * P;
+			wA -= iA * b2Cross(c->rA, P);
+
+			vB += mB * P;
+			wB += iB * b2Cross(c->rB, P);
+		}
+		else
+		{
+			b2Vec2 Cdot1 = vB + b2Cross(wB, c->rB) - vA - b2Cross(wA, c->rA);
+			float Cdot2 = wB - wA;
+			b2Vec3 Cdot(Cdot1.x, Cdot1.y, Cdot2);
+
+			b2Vec3 impulse = -b2Mul(c->mass, Cdot);
+			c->impulse += impulse;
+
+			b2Vec2 P(impulse.x, impulse.y);
+
+			vA -= mA * P;
+			wA -= iA * (b2Cross(c->rA, P) + impulse.z);
+
+			vB += mB * P;
+			wB += iB * (b2Cross(c->rB, P) + impulse.z);
+		}
+
+		data.velocities[c->indexA].v = vA;
+		data.velocities[c->indexA].w = wA;
+		data.velocities[c->indexB].v = vB;
+		data.velocities[c->indexB].w = wB;
+	}
+}
+
+bool b2WeldJoint::SolvePositionBatch(const b2WeldConstraint* constraints, int32 count, const b2SolverData& data)
+{
+	bool okay = true;
+	for (int32 k = 0; k < count; ++k)
+	{
+		const b2WeldConstraint* c = constraints + k;
+
+		b2Vec2 cA = data.positions[c->indexA].c;
+		float aA = data.positions[c->indexA].a;
+		b2Vec2 cB = data.positions[c->indexB].c;
+		float aB = data.positions[c->indexB].a;
+
+		b2Rot qA(aA), qB(aB);
+
+		float mA = c->invMassA, mB = c->invMassB;
+		float iA = c->invIA, iB = c->invIB;
+
+		b2Vec2 rA = b2Mul(qA, c->localAnchorA);
+		b2Vec2 rB = b2Mul(qB, c->localAnchorB);
+
+		float positionError, angularError;
+
+		b2Mat33 K;
+		K.ex.x = mA + mB + rA.y * rA.y * iA + rB.y * rB.y * iB;
+		K.ey.x = -rA.y * rA.x * iA - rB.y * rB.x * iB;
+		K.ez.x = -rA.y * iA - rB.y * iB;
+		K.ex.y = K.ey.x;
+		K.ey.y = mA + mB + rA.x * rA.x * iA + rB.x * rB.x * iB;
+		K.ez.y = rA.x * iA + rB.x * iB;
+		K.ex.z = K.ez.x;
+		K.ey.z = K.ez.y;
+		K.ez.z = iA + iB;
+
+		if (c->stiffness > 0.0f)
+		{
+			b2Vec2 C1 = cB + rB - cA - rA;
+
+			positionError = C1.Length();
+			angularError = 0.0f;
+
+			b2Vec2 P = -K.Solve22(C1);
+
+			cA -= mA * P;
+			aA -= iA * b2Cross(rA, P);
+
+			cB += mB * P;
+			aB += iB * b2Cross(rB, P);
+		}
+		else
+		{
+			b2Vec2 C1 = cB + rB - cA - rA;
+			float C2 = aB - aA - c->referenceAngle;
+
+			positionError = C1.Length();
+			angularError = b2Abs(C2);
+
+			b2Vec3 C(C1.x, C1.y, C2);
+
+			b2Vec3 impulse;
+			if (K.ez.z > 0.0f)
+			{
+				impulse = -K.Solve33(C);
+			}
+			else
+			{
+				b2Vec2 impulse2 = -K.Solve22(C1);
+				impulse.Set(impulse2.x, impulse2.y, 0.0f);
+			}
+
+			b2Vec2 P(impulse.x, impulse.y);
+
+			cA -= mA * P;
+			aA -= iA * (b2Cross(rA, P) + impulse.z);
+
+			cB += mB * P;
+			aB += iB * (b2Cross(rB, P) + impulse.z);
+		}
+
+		data.positions[c->indexA].c = cA;
+		data.positions[c->indexA].a = aA;
+		data.positions[c->indexB].c = cB;
+		data.positions[c->indexB].a = aB;
+
+		bool jointOkay = positionError <= b2_linearSlop && angularError <= b2_angularSlop;
+		okay = okay && jointOkay;
+	}
+
+	return okay;
+}
+
 b2Vec2 b2WeldJoint::GetAnchorA() const
 {
 	return m_bodyA->GetWorldPoint(m_localAnchorA);
@@ -342,3 +628,28 @@ void b2WeldJoint::Dump()
 	b2Dump("  jd.damping = %.9g;\n", m_damping);
 	b2Dump("  joints[%d] = m_world->CreateJoint(&jd);\n", m_index);
 }
+
+void b2WeldJoint::Serialize(b2SnapshotArchive& archive)
+{
+	b2Joint::Serialize(archive);
+
+	archive.Value(m_stiffness);
+	archive.Value(m_damping);
+	archive.Value(m_bias);
+	archive.Value(m_localAnchorA);
+	archive.Value(m_localAnchorB);
+	archive.Value(m_referenceAngle);
+	archive.Value(m_gamma);
+	archive.Value(m_impulse);
+	archive.Value(m_indexA);
+	archive.Value(m_indexB);
+	archive.Value(m_rA);
+	archive.Value(m_rB);
+	archive.Value(m_localCenterA);
+	archive.Value(m_localCenterB);
+	archive.Value(m_invMassA);
+	archive.Value(m_invMassB);
+	archive.Value(m_invIA);
+	archive.Value(m_invIB);
+	archive.Value(m_mass);
+}
@@ -20,6 +20,8 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include "b2_snapshot.h"
+
 #include "box2d/b2_body.h"
 #include "box2d/b2_draw.h"
 #include "box2d/b2_wheel_joint.h"
@@ -670,3 +672,47 @@ void b2WheelJoint::Draw(b2Draw* draw) const
 	draw->DrawPoint(pA, 5.0f, c1);
 	draw->DrawPoint(pB, 5.0f, c4);
 }
+
+void b2WheelJoint::Serialize(b2SnapshotArchive& archive)
+{
+	b2Joint::Serialize(archive);
+
+	archive.Value(m_localAnchorA);
+	archive.Value(m_localAnchorB);
+	archive.Value(m_localXAxisA);
+	archive.Value(m_localYAxisA);
+	archive.Value(m_impulse);
+	archive.Value(m_motorImpulse);
+	archive.Value(m_springImpulse);
+	archive.Value(m_lowerImpulse);
+	archive.Value(m_upperImpulse);
+	archive.Value(m_translation);
+	archive.Value(m_lowerTranslation);
+	archive.Value(m_upperTranslation);
+	archive.Value(m_maxMotorTorque);
+	archive.Value(m_motorSpeed);
+	archive.Value(m_enableLimit);
+	archive.Value(m_enableMotor);
+	archive.Value(m_stiffness);
+	archive.Value(m_damping);
+	archive.Value(m_indexA);
+	archive.Value(m_indexB);
+	archive.Value(m_localCenterA);
+	archive.Value(m_localCenterB);
+	archive.Value(m_invMassA);
+	archive.Value(m_invMassB);
+	archive.Value(m_invIA);
+	archive.Value(m_invIB);
+	archive.Value(m_ax);
+	archive.Value(m_ay);
+	archive.Value(m_sAx);
+	archive.Value(m_sBx);
+	archive.Value(m_sAy);
+	archive.Value(m_sBy);
+	archive.Value(m_mass);
+	archive.Value(m_motorMass);
+	archive.Value(m_axialMass);
+	archive.Value(m_springMass);
+	archive.Value(m_bias);
+	archive.Value(m_gamma);
+}
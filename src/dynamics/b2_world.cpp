@@ -22,6 +22,7 @@
 
 #include "b2_contact_solver.h"
 #include "b2_island.h"
+#include "b2_sleeping_island.h"
 
 #include "box2d/b2_body.h"
 #include "box2d/b2_broad_phase.h"
@@ -34,16 +35,21 @@
 #include "box2d/b2_fixture.h"
 #include "box2d/b2_polygon_shape.h"
 #include "box2d/b2_pulley_joint.h"
+#include "box2d/b2_rope_system.h"
+#include "box2d/b2_static_layer.h"
 #include "box2d/b2_time_of_impact.h"
 #include "box2d/b2_timer.h"
+#include "box2d/b2_trace.h"
 #include "box2d/b2_world.h"
 
 #include <new>
+#include <string.h>
 
 b2World::b2World(const b2Vec2& gravity)
 {
 	m_destructionListener = nullptr;
 	m_debugDraw = nullptr;
+	m_ropeSystem = nullptr;
 
 	m_bodyList = nullptr;
 	m_jointList = nullptr;
@@ -54,6 +60,7 @@ b2World::b2World(const b2Vec2& gravity)
 	m_warmStarting = true;
 	m_useContinuous = false;
 	m_subStepping = false;
+	m_chainSolving = false;
 
 	m_stepComplete = true;
 
@@ -66,6 +73,17 @@ b2World::b2World(const b2Vec2& gravity)
 
 	m_inv_dt0 = 0.0f;
 
+	m_tileList = nullptr;
+	m_tileQueueHead = nullptr;
+	m_tileQueueTail = nullptr;
+	m_tileQueueCount = 0;
+	m_tileBudget = 0.0f;
+
+	m_sleepingIslandCount = 0;
+
+	m_awakeBodyList = nullptr;
+	m_awakeBodyCount = 0;
+
 	m_contactManager.m_allocator = &m_blockAllocator;
 
 	memset(&m_profile, 0, sizeof(b2Profile));
@@ -73,12 +91,44 @@ b2World::b2World(const b2Vec2& gravity)
 
 b2World::~b2World()
 {
+	if (m_ropeSystem)
+	{
+		m_ropeSystem->RemoveWorld();
+	}
+
+	// Removed tiles are only in the queue.
+	b2StaticTile* tile = m_tileQueueHead;
+	while (tile)
+	{
+		b2StaticTile* tileNext = tile->m_queueNext;
+		if (tile->m_removed)
+		{
+			FreeStaticTile(tile);
+		}
+		tile = tileNext;
+	}
+
+	tile = m_tileList;
+	while (tile)
+	{
+		b2StaticTile* tileNext = tile->m_next;
+		FreeStaticTile(tile);
+		tile = tileNext;
+	}
+
 	// Some shapes allocate using b2Alloc.
 	b2Body* b = m_bodyList;
 	while (b)
 	{
 		b2Body* bNext = b->m_next;
 
+		// Layer fixtures refer to the blob and hold nothing from b2Alloc.
+		if (b->IsStaticLayer())
+		{
+			b = bNext;
+			continue;
+		}
+
 		b2Fixture* f = b->m_fixtureList;
 		while (f)
 		{
@@ -133,6 +183,8 @@ b2Body* b2World::CreateBody(const b2BodyDef* def)
 	m_bodyList = b;
 	++m_bodyCount;
 
+	b->UpdateAwakeList();
+
 	return b;
 }
 
@@ -145,6 +197,16 @@ void b2World::DestroyBody(b2Body* b)
 		return;
 	}
 
+	// Use DestroyStaticLayer.
+	b2Assert(b->IsStaticLayer() == false);
+	if (b->IsStaticLayer())
+	{
+		return;
+	}
+
+	// The rest of the island wakes as the joints and contacts go away.
+	RemoveSleepingBody(b);
+
 	// Delete the attached joints.
 	b2JointEdge* je = b->m_jointList;
 	while (je)
@@ -163,6 +225,12 @@ void b2World::DestroyBody(b2Body* b)
 	}
 	b->m_jointList = nullptr;
 
+	// Release rope attachments.
+	if (m_ropeSystem)
+	{
+		m_ropeSystem->RemoveBody(b);
+	}
+
 	// Delete the attached contacts.
 	b2ContactEdge* ce = b->m_contactList;
 	while (ce)
@@ -196,6 +264,11 @@ void b2World::DestroyBody(b2Body* b)
 	b->m_fixtureList = nullptr;
 	b->m_fixtureCount = 0;
 
+	if (b->m_flags & b2Body::e_awakeListFlag)
+	{
+		RemoveAwakeBody(b);
+	}
+
 	// Remove world body list.
 	if (b->m_prev)
 	{
@@ -272,7 +345,17 @@ b2Joint* b2World::CreateJoint(const b2JointDef* def)
 		}
 	}
 
-	// Note: creating a joint doesn't wake the bodies.
+	// Note: creating a joint doesn't wake the bodies. A sleeping island has to search
+	// for the new joint when it wakes.
+	if (bodyA->m_sleepingIsland)
+	{
+		bodyA->m_flags |= b2Body::e_linkFlag;
+	}
+
+	if (bodyB->m_sleepingIsland)
+	{
+		bodyB->m_flags |= b2Body::e_linkFlag;
+	}
 
 	return j;
 }
@@ -287,6 +370,11 @@ void b2World::DestroyJoint(b2Joint* j)
 
 	bool collideConnected = j->m_collideConnected;
 
+	if (j->m_sleepingIsland)
+	{
+		RemoveSleepingJoint(j);
+	}
+
 	// Remove from the doubly linked list.
 	if (j->m_prev)
 	{
@@ -372,6 +460,170 @@ void b2World::DestroyJoint(b2Joint* j)
 	}
 }
 
+// Touches the proxies of non-static bodies.
+struct b2StaticLayerTouchCallback
+{
+	bool QueryCallback(int32 proxyId)
+	{
+		b2FixtureProxy* proxy = (b2FixtureProxy*)broadPhase->GetUserData(proxyId);
+		if (proxy->fixture->GetBody()->GetType() != b2_staticBody)
+		{
+			broadPhase->TouchProxy(proxyId);
+		}
+
+		return true;
+	}
+
+	b2BroadPhase* broadPhase;
+};
+
+b2StaticLayer* b2World::CreateStaticLayer(const b2StaticLayerDef* def)
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
+	{
+		return nullptr;
+	}
+
+	void* mem = m_blockAllocator.Allocate(sizeof(b2StaticLayer));
+	b2StaticLayer* layer = new (mem) b2StaticLayer;
+	if (layer->Initialize(def->data, def->size) == false)
+	{
+		m_blockAllocator.Free(mem, sizeof(b2StaticLayer));
+		return nullptr;
+	}
+
+	b2BodyDef bd;
+	bd.position = def->position;
+	b2Body* body = CreateBody(&bd);
+	body->m_flags |= b2Body::e_staticLayerFlag;
+
+	// The chain refers to the blob vertices instead of owning a copy.
+	mem = m_blockAllocator.Allocate(sizeof(b2ChainShape));
+	b2ChainShape* chain = new (mem) b2ChainShape;
+	chain->m_vertices = const_cast<b2Vec2*>(layer->m_vertices);
+	chain->m_count = layer->m_vertexCount;
+	if (layer->m_vertexCount > 0)
+	{
+		chain->m_prevVertex = layer->m_vertices[0];
+		chain->m_nextVertex = layer->m_vertices[layer->m_vertexCount - 1];
+	}
+
+	// The fixture has no proxies. Contacts come from the layer tree.
+	mem = m_blockAllocator.Allocate(sizeof(b2Fixture));
+	b2Fixture* fixture = new (mem) b2Fixture;
+	fixture->m_userData = def->userData;
+	fixture->m_friction = def->friction;
+	fixture->m_restitution = def->restitution;
+	fixture->m_restitutionThreshold = def->restitutionThreshold;
+	fixture->m_body = body;
+	fixture->m_filter = def->filter;
+	fixture->m_isSensor = false;
+	fixture->m_shape = chain;
+
+	body->m_fixtureList = fixture;
+	body->m_fixtureCount = 1;
+
+	layer->m_body = body;
+	layer->m_fixture = fixture;
+
+	// Add to the contact manager doubly linked list.
+	layer->m_prev = nullptr;
+	layer->m_next = m_contactManager.m_layerList;
+	if (m_contactManager.m_layerList)
+	{
+		m_contactManager.m_layerList->m_prev = layer;
+	}
+	m_contactManager.m_layerList = layer;
+
+	b2AABB aabb = layer->GetAABB();
+	aabb.lowerBound += def->position;
+	aabb.upperBound += def->position;
+
+	layer->m_proxyId = b2_nullNode;
+	if (layer->m_root != b2_nullNode)
+	{
+		layer->m_proxyId = m_contactManager.m_layerTree.CreateProxy(aabb, layer);
+	}
+
+	// Layer pairs are only found for moved proxies, so touch the proxies that
+	// may already rest inside the layer.
+
+	b2StaticLayerTouchCallback callback;
+	callback.broadPhase = &m_contactManager.m_broadPhase;
+	callback.broadPhase->Query(&callback, aabb);
+
+	m_newContacts = true;
+
+	return layer;
+}
+
+void b2World::DestroyStaticLayer(b2StaticLayer* layer)
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
+	{
+		return;
+	}
+
+	b2Body* body = layer->m_body;
+
+	// Destroy the attached contacts.
+	b2ContactEdge* ce = body->m_contactList;
+	while (ce)
+	{
+		b2ContactEdge* ce0 = ce;
+		ce = ce->next;
+		m_contactManager.Destroy(ce0->contact);
+	}
+	body->m_contactList = nullptr;
+
+	b2Fixture* fixture = layer->m_fixture;
+	if (m_destructionListener)
+	{
+		m_destructionListener->SayGoodbye(fixture);
+	}
+
+	// Detach the chain from the blob before it is destroyed.
+	b2ChainShape* chain = (b2ChainShape*)fixture->m_shape;
+	chain->m_vertices = nullptr;
+	chain->m_count = 0;
+	chain->~b2ChainShape();
+	m_blockAllocator.Free(chain, sizeof(b2ChainShape));
+
+	fixture->~b2Fixture();
+	m_blockAllocator.Free(fixture, sizeof(b2Fixture));
+
+	body->m_fixtureList = nullptr;
+	body->m_fixtureCount = 0;
+	body->m_flags &= ~b2Body::e_staticLayerFlag;
+	DestroyBody(body);
+
+	if (layer->m_proxyId != b2_nullNode)
+	{
+		m_contactManager.m_layerTree.DestroyProxy(layer->m_proxyId);
+	}
+
+	// Remove from the contact manager list.
+	if (layer->m_prev)
+	{
+		layer->m_prev->m_next = layer->m_next;
+	}
+
+	if (layer->m_next)
+	{
+		layer->m_next->m_prev = layer->m_prev;
+	}
+
+	if (layer == m_contactManager.m_layerList)
+	{
+		m_contactManager.m_layerList = layer->m_next;
+	}
+
+	layer->~b2StaticLayer();
+	m_blockAllocator.Free(layer, sizeof(b2StaticLayer));
+}
+
 //
 void b2World::SetAllowSleeping(bool flag)
 {
@@ -397,61 +649,67 @@ void b2World::Solve(const b2TimeStep& step)
 	m_profile.solveVelocity = 0.0f;
 	m_profile.solvePosition = 0.0f;
 
-	// Size the island for the worst case.
-	b2Island island(m_bodyCount,
-					m_contactManager.m_contactCount,
-					m_jointCount,
-					&m_stackAllocator,
-					m_contactManager.m_contactListener);
-
-	// Clear all the island flags.
-	for (b2Body* b = m_bodyList; b; b = b->m_next)
-	{
-		b->m_flags &= ~b2Body::e_islandFlag;
-	}
-	for (b2Contact* c = m_contactManager.m_contactList; c; c = c->m_next)
-	{
-		c->m_flags &= ~b2Contact::e_islandFlag;
-	}
-	for (b2Joint* j = m_jointList; j; j = j->m_next)
-	{
-		j->m_islandFlag = false;
-	}
-
-	// Build and simulate all awake islands.
-	int32 stackSize = m_bodyCount;
-	b2Body** stack = (b2Body**)m_stackAllocator.Allocate(stackSize * sizeof(b2Body*));
-	for (b2Body* seed = m_bodyList; seed; seed = seed->m_next)
+	b2Timer islandTimer;
+	b2TraceZoneBegin("build islands");
+
+	// The island flags were cleared at the end of the previous step, so sleeping
+	// bodies, contacts, and joints are not visited here.
+
+	// Island members are gathered into contiguous arrays. Contacts and joints belong to
+	// one island. Static bodies may appear in several islands, but each appearance is
+	// reached through a contact or joint of that island.
+
+	// Bound the arrays without visiting the world, so sleeping islands cost nothing here.
+	// Every island starts from a body of the awake list. Only touching contacts are
+	// gathered, and each appearance of a static body comes with a contact or joint.
+	int32 islandCapacity = m_awakeBodyCount;
+	int32 contactCapacity = m_contactManager.m_touchingCount;
+	int32 bodyCapacity = m_bodyCount + contactCapacity + m_jointCount;
+
+	// The range after the last island marks where it ends.
+	b2IslandRange* islands = (b2IslandRange*)m_stackAllocator.Allocate((islandCapacity + 1) * sizeof(b2IslandRange));
+	b2Body** bodies = (b2Body**)m_stackAllocator.Allocate(bodyCapacity * sizeof(b2Body*));
+	b2Contact** contacts = (b2Contact**)m_stackAllocator.Allocate(contactCapacity * sizeof(b2Contact*));
+	b2Joint** joints = (b2Joint**)m_stackAllocator.Allocate(m_jointCount * sizeof(b2Joint*));
+	int32 islandCount = 0;
+	int32 bodyCount = 0;
+	int32 contactCount = 0;
+	int32 jointCount = 0;
+	int32 awakeBodyCount = 0;
+
+	// Find all awake islands. The search stack grows down from the end of the body array.
+	// Every body on the stack is added to the island once, so the stack and the gathered
+	// bodies together never exceed the capacity.
+	b2Body** stackBase = bodies + bodyCapacity;
+	for (b2Body* seed = m_awakeBodyList; seed; seed = seed->m_awakeNext)
 	{
 		if (seed->m_flags & b2Body::e_islandFlag)
 		{
 			continue;
 		}
 
-		if (seed->IsAwake() == false || seed->IsEnabled() == false)
-		{
-			continue;
-		}
-
 		// The seed can be dynamic or kinematic.
-		if (seed->GetType() == b2_staticBody)
-		{
-			continue;
-		}
-
-		// Reset island and stack.
-		island.Clear();
-		int32 stackCount = 0;
-		stack[stackCount++] = seed;
+		b2Assert(seed->IsAwake() && seed->IsEnabled() && seed->GetType() != b2_staticBody);
+
+		// Start a new island and reset the stack.
+		b2Assert(islandCount < islandCapacity);
+		b2IslandRange* island = islands + islandCount;
+		island->bodyStart = bodyCount;
+		island->contactStart = contactCount;
+		island->jointStart = jointCount;
+		b2Body** stack = stackBase;
+		b2Assert(bodies + bodyCount < stack);
+		*--stack = seed;
 		seed->m_flags |= b2Body::e_islandFlag;
 
 		// Perform a depth first search (DFS) on the constraint graph.
-		while (stackCount > 0)
+		while (stack < stackBase)
 		{
 			// Grab the next body off the stack and add it to the island.
-			b2Body* b = stack[--stackCount];
+			b2Body* b = *stack++;
 			b2Assert(b->IsEnabled() == true);
-			island.Add(b);
+			b2Assert(bodies + bodyCount < stack);
+			bodies[bodyCount++] = b;
 
 			// To keep islands as small as possible, we don't
 			// propagate islands across static bodies.
@@ -462,6 +720,129 @@ void b2World::Solve(const b2TimeStep& step)
 
 			// Make sure the body is awake (without resetting sleep timer).
 			b->m_flags |= b2Body::e_awakeFlag;
+			if ((b->m_flags & b2Body::e_awakeListFlag) == 0)
+			{
+				AddAwakeBody(b);
+			}
+			++awakeBodyCount;
+
+			// Take the rest of a sleeping island as it fell asleep instead of searching
+			// it again. Only the bodies that were linked to something new are searched.
+			b2SleepingIsland* sleepingIsland = b->m_sleepingIsland;
+			if (sleepingIsland)
+			{
+				bool wake = sleepingIsland->awake == false;
+				bool search = (b->m_flags & b2Body::e_linkFlag) != 0;
+
+				b2Body* first = sleepingIsland->bodies;
+				b2Body* ring = first;
+				do
+				{
+					b2Body* next = ring->m_sleepingNext;
+					ring->m_sleepingIsland = nullptr;
+					ring->m_sleepingPrev = nullptr;
+					ring->m_sleepingNext = nullptr;
+
+					if (wake)
+					{
+						ring->m_flags |= b2Body::e_awakeFlag;
+						ring->m_sleepTime = 0.0f;
+					}
+
+					// Bodies already on the stack are searched anyway.
+					if ((ring->m_flags & b2Body::e_islandFlag) == 0)
+					{
+						ring->m_flags |= b2Body::e_islandFlag;
+						b2Assert(bodies + bodyCount < stack);
+						if (ring->m_flags & b2Body::e_linkFlag)
+						{
+							*--stack = ring;
+						}
+						else
+						{
+							bodies[bodyCount++] = ring;
+							ring->m_flags |= b2Body::e_awakeFlag;
+							if ((ring->m_flags & b2Body::e_awakeListFlag) == 0)
+							{
+								AddAwakeBody(ring);
+							}
+							++awakeBodyCount;
+						}
+					}
+
+					ring->m_flags &= ~b2Body::e_linkFlag;
+					ring = next;
+				}
+				while (ring != first);
+
+				// The bodies on the other side are in the island now or static.
+				b2Contact* contact = sleepingIsland->contacts;
+				while (contact)
+				{
+					b2Contact* next = contact->m_sleepingNext;
+					contact->m_sleepingIsland = nullptr;
+					contact->m_sleepingPrev = nullptr;
+					contact->m_sleepingNext = nullptr;
+
+					bool solid = contact->IsEnabled() && contact->IsTouching() &&
+								 contact->m_fixtureA->m_isSensor == false && contact->m_fixtureB->m_isSensor == false;
+					if (solid && (contact->m_flags & b2Contact::e_islandFlag) == 0)
+					{
+						b2Assert(contactCount < contactCapacity);
+						contacts[contactCount++] = contact;
+						contact->m_flags |= b2Contact::e_islandFlag;
+
+						b2Body* bodyA = contact->m_fixtureA->GetBody();
+						b2Body* bodyB = contact->m_fixtureB->GetBody();
+						b2Body* other = (bodyA->m_flags & b2Body::e_islandFlag) ? bodyB : bodyA;
+						if ((other->m_flags & b2Body::e_islandFlag) == 0)
+						{
+							b2Assert(other->GetType() == b2_staticBody);
+							b2Assert(bodies + bodyCount < stack);
+							bodies[bodyCount++] = other;
+							other->m_flags |= b2Body::e_islandFlag;
+						}
+					}
+
+					contact = next;
+				}
+
+				b2Joint* joint = sleepingIsland->joints;
+				while (joint)
+				{
+					b2Joint* next = joint->m_sleepingNext;
+					joint->m_sleepingIsland = nullptr;
+					joint->m_sleepingPrev = nullptr;
+					joint->m_sleepingNext = nullptr;
+
+					b2Body* bodyA = joint->m_bodyA;
+					b2Body* bodyB = joint->m_bodyB;
+					if (joint->m_islandFlag == false && bodyA->IsEnabled() && bodyB->IsEnabled())
+					{
+						b2Assert(jointCount < m_jointCount);
+						joints[jointCount++] = joint;
+						joint->m_islandFlag = true;
+
+						b2Body* other = (bodyA->m_flags & b2Body::e_islandFlag) ? bodyB : bodyA;
+						if ((other->m_flags & b2Body::e_islandFlag) == 0)
+						{
+							b2Assert(other->GetType() == b2_staticBody);
+							b2Assert(bodies + bodyCount < stack);
+							bodies[bodyCount++] = other;
+							other->m_flags |= b2Body::e_islandFlag;
+						}
+					}
+
+					joint = next;
+				}
+
+				FreeSleepingIsland(sleepingIsland);
+
+				if (search == false)
+				{
+					continue;
+				}
+			}
 
 			// Search all contacts connected to this body.
 			for (b2ContactEdge* ce = b->m_contactList; ce; ce = ce->next)
@@ -489,7 +870,8 @@ void b2World::Solve(const b2TimeStep& step)
 					continue;
 				}
 
-				island.Add(contact);
+				b2Assert(contactCount < contactCapacity);
+				contacts[contactCount++] = contact;
 				contact->m_flags |= b2Contact::e_islandFlag;
 
 				b2Body* other = ce->other;
@@ -500,8 +882,8 @@ void b2World::Solve(const b2TimeStep& step)
 					continue;
 				}
 
-				b2Assert(stackCount < stackSize);
-				stack[stackCount++] = other;
+				b2Assert(bodies + bodyCount < stack);
+				*--stack = other;
 				other->m_flags |= b2Body::e_islandFlag;
 			}
 
@@ -521,7 +903,8 @@ void b2World::Solve(const b2TimeStep& step)
 					continue;
 				}
 
-				island.Add(je->joint);
+				b2Assert(jointCount < m_jointCount);
+				joints[jointCount++] = je->joint;
 				je->joint->m_islandFlag = true;
 
 				if (other->m_flags & b2Body::e_islandFlag)
@@ -529,23 +912,18 @@ void b2World::Solve(const b2TimeStep& step)
 					continue;
 				}
 
-				b2Assert(stackCount < stackSize);
-				stack[stackCount++] = other;
+				b2Assert(bodies + bodyCount < stack);
+				*--stack = other;
 				other->m_flags |= b2Body::e_islandFlag;
 			}
 		}
 
-		b2Profile profile;
-		island.Solve(&profile, step, m_gravity, m_allowSleep);
-		m_profile.solveInit += profile.solveInit;
-		m_profile.solveVelocity += profile.solveVelocity;
-		m_profile.solvePosition += profile.solvePosition;
+		++islandCount;
 
-		// Post solve cleanup.
-		for (int32 i = 0; i < island.m_bodyCount; ++i)
+		// Allow static bodies to participate in other islands.
+		for (int32 i = island->bodyStart; i < bodyCount; ++i)
 		{
-			// Allow static bodies to participate in other islands.
-			b2Body* b = island.m_bodies[i];
+			b2Body* b = bodies[i];
 			if (b->GetType() == b2_staticBody)
 			{
 				b->m_flags &= ~b2Body::e_islandFlag;
@@ -553,22 +931,65 @@ void b2World::Solve(const b2TimeStep& step)
 		}
 	}
 
-	m_stackAllocator.Free(stack);
+	islands[islandCount].bodyStart = bodyCount;
+	islands[islandCount].contactStart = contactCount;
+	islands[islandCount].jointStart = jointCount;
+
+	b2TraceZoneEnd("build islands");
+	m_profile.buildIslands = islandTimer.GetMilliseconds();
+	m_profile.awakeBodyCount = awakeBodyCount;
+	m_profile.islandCount = islandCount;
+	m_profile.touchingContactCount = contactCount;
+	m_profile.graphColorCount = 0;
+	m_profile.overflowConstraintCount = 0;
+	m_profile.chainJointCount = 0;
+
+	// Simulate the islands. Each island allocates solver storage for its own size.
+	for (int32 i = 0; i < islandCount; ++i)
+	{
+		b2TraceZone("solve island");
+
+		const b2IslandRange* range = islands + i;
+		const b2IslandRange* next = range + 1;
+		int32 islandBodyCount = next->bodyStart - range->bodyStart;
+		b2Island island(bodies + range->bodyStart, islandBodyCount,
+						contacts + range->contactStart, next->contactStart - range->contactStart,
+						joints + range->jointStart, next->jointStart - range->jointStart,
+						&m_stackAllocator, m_contactManager.m_contactListener,
+						m_contactManager.m_executor, m_chainSolving);
+
+		b2Profile profile;
+		bool asleep = island.Solve(&profile, step, m_gravity, m_allowSleep);
+		m_profile.solveInit += profile.solveInit;
+		m_profile.solveVelocity += profile.solveVelocity;
+		m_profile.solvePosition += profile.solvePosition;
+
+		m_profile.chainJointCount += island.m_chainJointCount;
+
+		if (island.m_colorCount > 0)
+		{
+			m_profile.graphColorCount = b2Max(m_profile.graphColorCount, island.m_colorCount);
+			m_profile.overflowConstraintCount += island.m_overflow.jointCount + island.m_overflow.contactCount;
+		}
+
+		if (asleep)
+		{
+			CreateSleepingIsland(bodies + range->bodyStart, islandBodyCount,
+								 contacts + range->contactStart, next->contactStart - range->contactStart,
+								 joints + range->jointStart, next->jointStart - range->jointStart);
+		}
+	}
 
 	{
+		b2TraceZone("broad-phase");
 		b2Timer timer;
 
 		if (m_useContinuous)
 		{
-			// Synchronize fixtures, check for out of range bodies.
-			for (b2Body* b = m_bodyList; b; b = b->GetNext())
+			// Synchronize fixtures, check for out of range bodies. Only island members moved.
+			for (int32 i = 0; i < bodyCount; ++i)
 			{
-				// If a body was not in an island then it did not move.
-				if ((b->m_flags & b2Body::e_islandFlag) == 0)
-				{
-					continue;
-				}
-
+				b2Body* b = bodies[i];
 				if (b->GetType() == b2_staticBody)
 				{
 					continue;
@@ -578,21 +999,18 @@ void b2World::Solve(const b2TimeStep& step)
 				b->SynchronizeFixturesPredicted();
 			}
 
+			m_profile.synchronizeFixtures = timer.GetMilliseconds();
+
 			// Look for new contacts.
 			m_contactManager.FindNewContacts();
 			m_profile.broadphase = timer.GetMilliseconds();
 		}
 		else
 		{
-			// Synchronize fixtures, check for out of range bodies.
-			for (b2Body* b = m_bodyList; b; b = b->GetNext())
+			// Synchronize fixtures, check for out of range bodies. Only island members moved.
+			for (int32 i = 0; i < bodyCount; ++i)
 			{
-				// If a body was not in an island then it did not move.
-				if ((b->m_flags & b2Body::e_islandFlag) == 0)
-				{
-					continue;
-				}
-
+				b2Body* b = bodies[i];
 				if (b->GetType() == b2_staticBody)
 				{
 					continue;
@@ -602,11 +1020,32 @@ void b2World::Solve(const b2TimeStep& step)
 				b->SynchronizeFixtures();
 			}
 
+			m_profile.synchronizeFixtures = timer.GetMilliseconds();
+
 			// Look for new contacts.
 			m_contactManager.FindNewContacts();
 			m_profile.broadphase = timer.GetMilliseconds();
 		}
 	}
+
+	// Clear the island flags for the next step. Only island members carry them.
+	for (int32 i = 0; i < bodyCount; ++i)
+	{
+		bodies[i]->m_flags &= ~b2Body::e_islandFlag;
+	}
+	for (int32 i = 0; i < contactCount; ++i)
+	{
+		contacts[i]->m_flags &= ~b2Contact::e_islandFlag;
+	}
+	for (int32 i = 0; i < jointCount; ++i)
+	{
+		joints[i]->m_islandFlag = false;
+	}
+
+	m_stackAllocator.Free(joints);
+	m_stackAllocator.Free(contacts);
+	m_stackAllocator.Free(bodies);
+	m_stackAllocator.Free(islands);
 }
 
 // TOI based
@@ -636,8 +1075,21 @@ void b2World::Solve(const b2TimeStep& step)
 
 void b2World::Step(float dt, int32 velocityIterations, int32 positionIterations)
 {
+	b2TraceZone("step");
 	b2Timer stepTimer;
 
+	int32 allocationCount = b2GetAllocationCount();
+	int32 stackFallbackCount = m_stackAllocator.GetFallbackCount();
+	m_stackAllocator.ResetPeakAllocation();
+
+	const b2BroadPhase& broadPhase = m_contactManager.m_broadPhase;
+	int32 movedProxyCount = broadPhase.GetMovedProxyCount();
+	int32 pairCount = broadPhase.GetFoundPairCount();
+	int32 treeRotations = broadPhase.GetTreeRotationCount();
+
+	// Load and unload streamed tiles before the step locks the world.
+	UpdateStaticTiles();
+
 	// If new fixtures were added, we need to find the new contacts.
 	if (m_newContacts)
 	{
@@ -663,9 +1115,11 @@ void b2World::Step(float dt, int32 velocityIterations, int32 positionIterations)
 	step.dtRatio = m_inv_dt0 * dt;
 
 	step.warmStarting = m_warmStarting;
+	step.subStepping = m_subStepping;
 	
 	// Update contacts. This is where some contacts are destroyed.
 	{
+		b2TraceZone("collide");
 		b2Timer timer;
 
 		// TODO movement during first time step for a body is not predicted in broadphase
@@ -674,9 +1128,21 @@ void b2World::Step(float dt, int32 velocityIterations, int32 positionIterations)
 		m_profile.collide = timer.GetMilliseconds();
 	}
 
+	// Step ropes against the body positions at the start of the step. The rope impulses
+	// are applied to the body velocities before the island solve.
+	m_profile.rope = 0.0f;
+	if (m_ropeSystem && step.dt > 0.0f)
+	{
+		b2TraceZone("rope");
+		b2Timer timer;
+		m_ropeSystem->Step(step.dt, step.velocityIterations);
+		m_profile.rope = timer.GetMilliseconds();
+	}
+
 	// Integrate velocities, solve velocity constraints, and integrate positions.
 	if (m_stepComplete && step.dt > 0.0f)
 	{
+		b2TraceZone("solve");
 		b2Timer timer;
 		Solve(step);
 		m_profile.solve = timer.GetMilliseconds();
@@ -692,6 +1158,22 @@ void b2World::Step(float dt, int32 velocityIterations, int32 positionIterations)
 		ClearForces();
 	}
 
+	// Refresh the compact query tree now that the broad-phase is settled.
+	m_contactManager.m_broadPhase.UpdateCompactTree();
+
+	m_profile.solveTOI = m_contactManager.m_toiTime;
+	m_profile.toiCalls = m_contactManager.m_toiCalls;
+	m_profile.pairCount = broadPhase.GetFoundPairCount() - pairCount;
+	m_profile.movedProxyCount = broadPhase.GetMovedProxyCount() - movedProxyCount;
+	m_profile.treeRotations = broadPhase.GetTreeRotationCount() - treeRotations;
+	m_profile.stackHighWater = m_stackAllocator.GetPeakAllocation();
+
+	// Size the stack arena so the next step does not need the heap.
+	m_profile.stackFallbacks = m_stackAllocator.GetFallbackCount() - stackFallbackCount;
+	m_stackAllocator.Grow();
+
+	m_profile.heapAllocations = b2GetAllocationCount() - allocationCount;
+
 	m_locked = false;
 
 	m_profile.step = stepTimer.GetMilliseconds();
@@ -711,11 +1193,49 @@ struct b2WorldQueryWrapper
 	bool QueryCallback(int32 proxyId)
 	{
 		b2FixtureProxy* proxy = (b2FixtureProxy*)broadPhase->GetUserData(proxyId);
-		return callback->ReportFixture(proxy->fixture);
+		proceed = callback->ReportFixture(proxy->fixture);
+		return proceed;
 	}
 
 	const b2BroadPhase* broadPhase;
 	b2QueryCallback* callback;
+	bool proceed;
+};
+
+// Reports a layer fixture once if any of its edges overlap.
+struct b2WorldLayerQueryWrapper
+{
+	bool QueryCallback(int32 childIndex)
+	{
+		B2_NOT_USED(childIndex);
+		proceed = callback->ReportFixture(fixture);
+		return false;
+	}
+
+	b2Fixture* fixture;
+	b2QueryCallback* callback;
+	bool proceed;
+};
+
+// Queries the edges of the layers whose bounds overlap.
+struct b2WorldLayerTreeQueryWrapper
+{
+	bool QueryCallback(int32 layerProxyId)
+	{
+		b2StaticLayer* layer = (b2StaticLayer*)tree->GetUserData(layerProxyId);
+		b2Vec2 offset = layer->GetBody()->GetPosition();
+		b2AABB layerAABB;
+		layerAABB.lowerBound = aabb.lowerBound - offset;
+		layerAABB.upperBound = aabb.upperBound - offset;
+
+		layerWrapper.fixture = layer->GetFixture();
+		layer->Query(&layerWrapper, layerAABB);
+		return layerWrapper.proceed;
+	}
+
+	const b2DynamicTree* tree;
+	b2WorldLayerQueryWrapper layerWrapper;
+	b2AABB aabb;
 };
 
 void b2World::QueryAABB(b2QueryCallback* callback, const b2AABB& aabb) const
@@ -723,7 +1243,20 @@ void b2World::QueryAABB(b2QueryCallback* callback, const b2AABB& aabb) const
 	b2WorldQueryWrapper wrapper;
 	wrapper.broadPhase = &m_contactManager.m_broadPhase;
 	wrapper.callback = callback;
+	wrapper.proceed = true;
 	m_contactManager.m_broadPhase.Query(&wrapper, aabb);
+
+	if (wrapper.proceed == false)
+	{
+		return;
+	}
+
+	b2WorldLayerTreeQueryWrapper treeWrapper;
+	treeWrapper.tree = &m_contactManager.m_layerTree;
+	treeWrapper.layerWrapper.callback = callback;
+	treeWrapper.layerWrapper.proceed = true;
+	treeWrapper.aabb = aabb;
+	m_contactManager.m_layerTree.Query(&treeWrapper, aabb);
 }
 
 struct b2WorldRayCastWrapper
@@ -741,7 +1274,15 @@ struct b2WorldRayCastWrapper
 		{
 			float fraction = output.fraction;
 			b2Vec2 point = (1.0f - fraction) * input.p1 + fraction * input.p2;
-			return callback->ReportFixture(fixture, point, output.normal, fraction);
+			float value = callback->ReportFixture(fixture, point, output.normal, fraction);
+
+			// Follow the clipping of the tree so the layers continue from here.
+			if (value >= 0.0f)
+			{
+				maxFraction = value;
+			}
+
+			return value;
 		}
 
 		return input.maxFraction;
@@ -749,6 +1290,65 @@ struct b2WorldRayCastWrapper
 
 	const b2BroadPhase* broadPhase;
 	b2RayCastCallback* callback;
+	float maxFraction;
+};
+
+struct b2WorldLayerRayCastWrapper
+{
+	float RayCastCallback(const b2RayCastInput& layerInput, int32 childIndex)
+	{
+		// Cast the world space ray so the reported point and normal need no fix up.
+		b2RayCastInput input;
+		input.p1 = p1;
+		input.p2 = p2;
+		input.maxFraction = layerInput.maxFraction;
+
+		b2RayCastOutput output;
+		bool hit = fixture->RayCast(&output, input, childIndex);
+
+		if (hit)
+		{
+			float fraction = output.fraction;
+			b2Vec2 point = (1.0f - fraction) * input.p1 + fraction * input.p2;
+			float value = callback->ReportFixture(fixture, point, output.normal, fraction);
+			if (value >= 0.0f)
+			{
+				maxFraction = value;
+			}
+
+			return value;
+		}
+
+		return input.maxFraction;
+	}
+
+	b2Fixture* fixture;
+	b2RayCastCallback* callback;
+	b2Vec2 p1, p2;
+	float maxFraction;
+};
+
+// Casts against the edges of the layers whose bounds the ray crosses.
+struct b2WorldLayerTreeRayCastWrapper
+{
+	float RayCastCallback(const b2RayCastInput& input, int32 layerProxyId)
+	{
+		b2StaticLayer* layer = (b2StaticLayer*)tree->GetUserData(layerProxyId);
+		b2Vec2 offset = layer->GetBody()->GetPosition();
+		b2RayCastInput layerInput;
+		layerInput.p1 = input.p1 - offset;
+		layerInput.p2 = input.p2 - offset;
+		layerInput.maxFraction = layerWrapper.maxFraction;
+
+		layerWrapper.fixture = layer->GetFixture();
+		layer->RayCast(&layerWrapper, layerInput);
+
+		// Clip the layer tree to the closest hit so far. Zero terminates the cast.
+		return layerWrapper.maxFraction;
+	}
+
+	const b2DynamicTree* tree;
+	b2WorldLayerRayCastWrapper layerWrapper;
 };
 
 void b2World::RayCast(b2RayCastCallback* callback, const b2Vec2& point1, const b2Vec2& point2) const
@@ -756,11 +1356,27 @@ void b2World::RayCast(b2RayCastCallback* callback, const b2Vec2& point1, const b
 	b2WorldRayCastWrapper wrapper;
 	wrapper.broadPhase = &m_contactManager.m_broadPhase;
 	wrapper.callback = callback;
+	wrapper.maxFraction = 1.0f;
 	b2RayCastInput input;
 	input.maxFraction = 1.0f;
 	input.p1 = point1;
 	input.p2 = point2;
 	m_contactManager.m_broadPhase.RayCast(&wrapper, input);
+
+	// A zero fraction terminates the ray cast.
+	if (wrapper.maxFraction == 0.0f)
+	{
+		return;
+	}
+
+	b2WorldLayerTreeRayCastWrapper treeWrapper;
+	treeWrapper.tree = &m_contactManager.m_layerTree;
+	treeWrapper.layerWrapper.callback = callback;
+	treeWrapper.layerWrapper.p1 = point1;
+	treeWrapper.layerWrapper.p2 = point2;
+	treeWrapper.layerWrapper.maxFraction = wrapper.maxFraction;
+	input.maxFraction = wrapper.maxFraction;
+	m_contactManager.m_layerTree.RayCast(&treeWrapper, input);
 }
 
 void b2World::DrawShape(b2Fixture* fixture, const b2Transform& xf, const b2Color& color)
@@ -844,6 +1460,12 @@ void b2World::DebugDraw()
 	{
 		for (b2Body* b = m_bodyList; b; b = b->GetNext())
 		{
+			// Layers are drawn below because the chain links all their chains.
+			if (b->IsStaticLayer())
+			{
+				continue;
+			}
+
 			const b2Transform& xf = b->GetTransform();
 			for (b2Fixture* f = b->GetFixtureList(); f; f = f->GetNext())
 			{
@@ -874,6 +1496,24 @@ void b2World::DebugDraw()
 				}
 			}
 		}
+
+		b2Color color(0.5f, 0.9f, 0.5f);
+		for (b2StaticLayer* layer = m_contactManager.m_layerList; layer; layer = layer->GetNext())
+		{
+			const b2Transform& xf = layer->GetBody()->GetTransform();
+			const b2Vec2* vertices = layer->m_vertices;
+			for (int32 i = 0; i < layer->m_vertexCount - 1; ++i)
+			{
+				// Ghost and junction edges have empty bounds.
+				const b2AABB& aabb = layer->GetEdgeAABB(i);
+				if (aabb.lowerBound.x > aabb.upperBound.x)
+				{
+					continue;
+				}
+
+				m_debugDraw->DrawSegment(b2Mul(xf, vertices[i]), b2Mul(xf, vertices[i + 1]), color);
+			}
+		}
 	}
 
 	if (flags & b2Draw::e_jointBit)
@@ -941,6 +1581,67 @@ void b2World::DebugDraw()
 	}
 }
 
+void b2World::SetTaskExecutor(b2TaskExecutor* executor)
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
+	{
+		return;
+	}
+
+	m_contactManager.SetTaskExecutor(executor);
+}
+
+void b2World::SetRopeSystem(b2RopeSystem* ropeSystem)
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
+	{
+		return;
+	}
+
+	if (m_ropeSystem)
+	{
+		m_ropeSystem->RemoveWorld();
+	}
+
+	m_ropeSystem = ropeSystem;
+
+	if (ropeSystem)
+	{
+		b2Assert(ropeSystem->m_world == nullptr);
+		ropeSystem->m_world = this;
+	}
+}
+
+void b2World::GetBlockAllocatorStats(b2BlockAllocatorStats* stats) const
+{
+	m_blockAllocator.GetStats(stats);
+}
+
+int32 b2World::TrimBlockAllocator()
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
+	{
+		return 0;
+	}
+
+	m_contactManager.FlushCaches();
+	return m_blockAllocator.Trim();
+}
+
+void b2World::SetCompactQueries(bool flag)
+{
+	m_contactManager.m_broadPhase.SetCompactQueries(flag);
+	m_contactManager.m_broadPhase.UpdateCompactTree();
+}
+
+bool b2World::GetCompactQueries() const
+{
+	return m_contactManager.m_broadPhase.GetCompactQueries();
+}
+
 int32 b2World::GetProxyCount() const
 {
 	return m_contactManager.m_broadPhase.GetProxyCount();
@@ -973,6 +1674,7 @@ void b2World::ShiftOrigin(const b2Vec2& newOrigin)
 	{
 		b->m_xf.p -= newOrigin;
 		b->m_position -= newOrigin;
+		b->m_speculativePosition -= newOrigin;
 	}
 
 	for (b2Joint* j = m_jointList; j; j = j->m_next)
@@ -981,6 +1683,18 @@ void b2World::ShiftOrigin(const b2Vec2& newOrigin)
 	}
 
 	m_contactManager.m_broadPhase.ShiftOrigin(newOrigin);
+	m_contactManager.m_broadPhase.UpdateCompactTree();
+	m_contactManager.m_layerTree.ShiftOrigin(newOrigin);
+
+	if (m_ropeSystem)
+	{
+		m_ropeSystem->ShiftOrigin(newOrigin);
+	}
+
+	for (b2StaticTile* tile = m_tileList; tile; tile = tile->m_next)
+	{
+		tile->m_layerDef.position -= newOrigin;
+	}
 }
 
 void b2World::Dump()
@@ -1046,3 +1760,143 @@ void b2World::Dump()
 
 	b2CloseDump();
 }
+
+// Hashes 32 bit words in four independent lanes. This keeps the multiplies off a
+// single dependency chain, so the loop pipelines and vectorizes well.
+struct b2StateHasher
+{
+	b2StateHasher()
+	{
+		lanes[0] = 0x9e3779b97f4a7c15ull;
+		lanes[1] = 0xbf58476d1ce4e5b9ull;
+		lanes[2] = 0x94d049bb133111ebull;
+		lanes[3] = 0x2545f4914f6cdd1dull;
+		count = 0;
+	}
+
+	void Add(float value)
+	{
+		uint32 word;
+		memcpy(&word, &value, sizeof(uint32));
+		Add(word);
+	}
+
+	void Add(uint32 word)
+	{
+		words[count++] = word;
+		if (count == b2_stateHashBatch)
+		{
+			Flush();
+		}
+	}
+
+	void Flush()
+	{
+		// Pad the last group with zeros.
+		while (count % 4 != 0)
+		{
+			words[count++] = 0;
+		}
+
+		for (int32 i = 0; i < count; i += 4)
+		{
+			for (int32 j = 0; j < 4; ++j)
+			{
+				lanes[j] = (lanes[j] ^ words[i + j]) * 0x100000001b3ull;
+			}
+		}
+
+		count = 0;
+	}
+
+	unsigned long long Finish()
+	{
+		Flush();
+
+		unsigned long long h = lanes[0];
+		for (int32 j = 1; j < 4; ++j)
+		{
+			h = (h ^ lanes[j]) * 0xff51afd7ed558ccdull;
+			h ^= h >> 33;
+		}
+
+		// Final avalanche from MurmurHash3.
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdull;
+		h ^= h >> 33;
+		h *= 0xc4ceb9fe1a85ec53ull;
+		h ^= h >> 33;
+		return h;
+	}
+
+	enum
+	{
+		b2_stateHashBatch = 64
+	};
+
+	unsigned long long lanes[4];
+	uint32 words[b2_stateHashBatch];
+	int32 count;
+};
+
+unsigned long long b2World::ComputeStateHash(uint32 flags) const
+{
+	b2StateHasher hasher;
+
+	hasher.Add(uint32(m_bodyCount));
+	for (const b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		hasher.Add(b->m_xf.p.x);
+		hasher.Add(b->m_xf.p.y);
+		hasher.Add(b->m_xf.q.s);
+		hasher.Add(b->m_xf.q.c);
+		hasher.Add(b->m_position.x);
+		hasher.Add(b->m_position.y);
+		hasher.Add(b->m_angle);
+		hasher.Add(b->m_linearVelocity.x);
+		hasher.Add(b->m_linearVelocity.y);
+		hasher.Add(b->m_angularVelocity);
+		hasher.Add(b->m_sleepTime);
+		hasher.Add(uint32(b->m_flags & (b2Body::e_awakeFlag | b2Body::e_enabledFlag)));
+	}
+
+	if (flags & e_hashContacts)
+	{
+		hasher.Add(uint32(m_contactManager.m_contactCount));
+		for (const b2Contact* c = m_contactManager.m_contactList; c; c = c->m_next)
+		{
+			const b2Manifold& manifold = c->m_manifold;
+			hasher.Add(uint32(c->m_flags & (b2Contact::e_touchingFlag | b2Contact::e_enabledFlag)));
+			hasher.Add(uint32(manifold.pointCount));
+			hasher.Add(manifold.localNormal.x);
+			hasher.Add(manifold.localNormal.y);
+			hasher.Add(manifold.localPoint.x);
+			hasher.Add(manifold.localPoint.y);
+
+			for (int32 i = 0; i < manifold.pointCount; ++i)
+			{
+				const b2ManifoldPoint& mp = manifold.points[i];
+				hasher.Add(mp.localPoint.x);
+				hasher.Add(mp.localPoint.y);
+				hasher.Add(mp.normalImpulse);
+				hasher.Add(mp.tangentImpulse);
+				hasher.Add(mp.id.key);
+			}
+		}
+	}
+
+	if (flags & e_hashJointImpulses)
+	{
+		// The reaction at a unit inverse time step is the accumulated impulse.
+		hasher.Add(uint32(m_jointCount));
+		for (const b2Joint* j = m_jointList; j; j = j->m_next)
+		{
+			b2Vec2 force = j->GetReactionForce(1.0f);
+			hasher.Add(force.x);
+			hasher.Add(force.y);
+			hasher.Add(j->GetReactionTorque(1.0f));
+		}
+	}
+
+	return hasher.Finish();
+}
@@ -0,0 +1,314 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "box2d/b2_body.h"
+#include "box2d/b2_contact.h"
+#include "box2d/b2_joint.h"
+#include "box2d/b2_world.h"
+
+#include "b2_sleeping_island.h"
+
+// Sleeping islands replace the graph search that used to wake a pile one body per
+// contact. An island that falls asleep keeps its bodies, contacts and joints, linked
+// through the objects themselves. Waking sets the awake flags on the bodies. The island
+// search then takes the members as they are and only follows the edges of the bodies
+// that were linked to something new while the island slept, see b2Body::e_linkFlag.
+// A sleeping body outside an island still wakes on its own and the island search
+// reaches its neighbors, so the records are only an acceleration.
+
+b2SleepingIsland* b2World::CreateSleepingIsland(b2Body** bodies, int32 bodyCount, b2Contact** contacts, int32 contactCount,
+												b2Joint** joints, int32 jointCount)
+{
+	// Static bodies are shared between islands and never sleep.
+	b2Body* first = nullptr;
+	b2Body* last = nullptr;
+	for (int32 i = 0; i < bodyCount; ++i)
+	{
+		b2Body* b = bodies[i];
+		if (b->m_type == b2_staticBody)
+		{
+			continue;
+		}
+
+		b2Assert(b->m_sleepingIsland == nullptr);
+		if (last)
+		{
+			last->m_sleepingNext = b;
+			b->m_sleepingPrev = last;
+		}
+		else
+		{
+			first = b;
+		}
+		last = b;
+	}
+
+	if (first == nullptr)
+	{
+		return nullptr;
+	}
+
+	// Close the ring.
+	last->m_sleepingNext = first;
+	first->m_sleepingPrev = last;
+
+	void* mem = m_blockAllocator.Allocate(sizeof(b2SleepingIsland));
+	b2SleepingIsland* island = (b2SleepingIsland*)mem;
+	island->bodies = first;
+	island->contacts = nullptr;
+	island->joints = nullptr;
+	island->awake = false;
+
+	b2Body* b = first;
+	do
+	{
+		b->m_sleepingIsland = island;
+		b = b->m_sleepingNext;
+	}
+	while (b != first);
+
+	// Push from the back to keep the solver order.
+	for (int32 i = contactCount - 1; i >= 0; --i)
+	{
+		b2Contact* c = contacts[i];
+		b2Assert(c->m_sleepingIsland == nullptr);
+		c->m_sleepingIsland = island;
+		c->m_sleepingPrev = nullptr;
+		c->m_sleepingNext = island->contacts;
+		if (island->contacts)
+		{
+			island->contacts->m_sleepingPrev = c;
+		}
+		island->contacts = c;
+	}
+
+	for (int32 i = jointCount - 1; i >= 0; --i)
+	{
+		b2Joint* j = joints[i];
+		b2Assert(j->m_sleepingIsland == nullptr);
+		j->m_sleepingIsland = island;
+		j->m_sleepingPrev = nullptr;
+		j->m_sleepingNext = island->joints;
+		if (island->joints)
+		{
+			island->joints->m_sleepingPrev = j;
+		}
+		island->joints = j;
+	}
+
+	++m_sleepingIslandCount;
+	return island;
+}
+
+// The record stays until the island search takes it, so the members need not be found again.
+void b2World::WakeSleepingIsland(b2Body* body)
+{
+	b2SleepingIsland* island = body->m_sleepingIsland;
+	b2Assert(island != nullptr);
+
+	b2Body* b = island->bodies;
+	do
+	{
+		b->m_flags |= b2Body::e_awakeFlag;
+		b->m_sleepTime = 0.0f;
+		if ((b->m_flags & b2Body::e_awakeListFlag) == 0)
+		{
+			AddAwakeBody(b);
+		}
+		b = b->m_sleepingNext;
+	}
+	while (b != island->bodies);
+
+	if (island->awake == false)
+	{
+		island->awake = true;
+		--m_sleepingIslandCount;
+	}
+}
+
+// The body leaves without waking the others. The island may now be two pieces, which
+// is fine because they still wake together. The contacts and joints of the body leave
+// as well, and any island on their other side has to search for them again.
+void b2World::RemoveSleepingBody(b2Body* body)
+{
+	for (b2ContactEdge* ce = body->m_contactList; ce; ce = ce->next)
+	{
+		if (ce->contact->m_sleepingIsland)
+		{
+			m_contactManager.RemoveSleepingContact(ce->contact);
+		}
+	}
+
+	for (b2JointEdge* je = body->m_jointList; je; je = je->next)
+	{
+		if (je->joint->m_sleepingIsland)
+		{
+			RemoveSleepingJoint(je->joint);
+
+			b2Body* other = je->other;
+			if (other->m_sleepingIsland)
+			{
+				other->m_flags |= b2Body::e_linkFlag;
+			}
+		}
+	}
+
+	b2SleepingIsland* island = body->m_sleepingIsland;
+	if (island == nullptr)
+	{
+		return;
+	}
+
+	b2Body* next = body->m_sleepingNext;
+	if (next == body)
+	{
+		// The remaining contacts and joints were all attached to this body.
+		b2Assert(island->contacts == nullptr && island->joints == nullptr);
+		FreeSleepingIsland(island);
+	}
+	else
+	{
+		b2Body* prev = body->m_sleepingPrev;
+		prev->m_sleepingNext = next;
+		next->m_sleepingPrev = prev;
+		if (island->bodies == body)
+		{
+			island->bodies = next;
+		}
+	}
+
+	body->m_sleepingIsland = nullptr;
+	body->m_sleepingPrev = nullptr;
+	body->m_sleepingNext = nullptr;
+	body->m_flags &= ~b2Body::e_linkFlag;
+}
+
+void b2World::RemoveSleepingJoint(b2Joint* joint)
+{
+	b2SleepingIsland* island = joint->m_sleepingIsland;
+	b2Assert(island != nullptr);
+
+	if (joint->m_sleepingPrev)
+	{
+		joint->m_sleepingPrev->m_sleepingNext = joint->m_sleepingNext;
+	}
+
+	if (joint->m_sleepingNext)
+	{
+		joint->m_sleepingNext->m_sleepingPrev = joint->m_sleepingPrev;
+	}
+
+	if (island->joints == joint)
+	{
+		island->joints = joint->m_sleepingNext;
+	}
+
+	joint->m_sleepingIsland = nullptr;
+	joint->m_sleepingPrev = nullptr;
+	joint->m_sleepingNext = nullptr;
+}
+
+// The members must have left the island already.
+void b2World::FreeSleepingIsland(b2SleepingIsland* island)
+{
+	if (island->awake == false)
+	{
+		--m_sleepingIslandCount;
+	}
+
+	m_blockAllocator.Free(island, sizeof(b2SleepingIsland));
+}
+
+void b2World::ClearSleepingIslands()
+{
+	for (b2Contact* c = m_contactManager.m_contactList; c; c = c->m_next)
+	{
+		c->m_sleepingIsland = nullptr;
+		c->m_sleepingPrev = nullptr;
+		c->m_sleepingNext = nullptr;
+	}
+
+	for (b2Joint* j = m_jointList; j; j = j->m_next)
+	{
+		j->m_sleepingIsland = nullptr;
+		j->m_sleepingPrev = nullptr;
+		j->m_sleepingNext = nullptr;
+	}
+
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		b2SleepingIsland* island = b->m_sleepingIsland;
+		if (island && island->bodies == b)
+		{
+			m_blockAllocator.Free(island, sizeof(b2SleepingIsland));
+		}
+	}
+
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		b->m_sleepingIsland = nullptr;
+		b->m_sleepingPrev = nullptr;
+		b->m_sleepingNext = nullptr;
+		b->m_flags &= ~b2Body::e_linkFlag;
+	}
+
+	m_sleepingIslandCount = 0;
+}
+
+// New entries go to the front, so the island search does not reach bodies that were
+// woken by the search itself.
+void b2World::AddAwakeBody(b2Body* body)
+{
+	b2Assert((body->m_flags & b2Body::e_awakeListFlag) == 0);
+	body->m_flags |= b2Body::e_awakeListFlag;
+	body->m_awakePrev = nullptr;
+	body->m_awakeNext = m_awakeBodyList;
+	if (m_awakeBodyList)
+	{
+		m_awakeBodyList->m_awakePrev = body;
+	}
+	m_awakeBodyList = body;
+	++m_awakeBodyCount;
+}
+
+void b2World::RemoveAwakeBody(b2Body* body)
+{
+	b2Assert(body->m_flags & b2Body::e_awakeListFlag);
+	if (body->m_awakePrev)
+	{
+		body->m_awakePrev->m_awakeNext = body->m_awakeNext;
+	}
+
+	if (body->m_awakeNext)
+	{
+		body->m_awakeNext->m_awakePrev = body->m_awakePrev;
+	}
+
+	if (body == m_awakeBodyList)
+	{
+		m_awakeBodyList = body->m_awakeNext;
+	}
+
+	body->m_flags &= ~b2Body::e_awakeListFlag;
+	body->m_awakePrev = nullptr;
+	body->m_awakeNext = nullptr;
+	--m_awakeBodyCount;
+}
@@ -0,0 +1,1204 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "b2_sleeping_island.h"
+#include "b2_snapshot.h"
+
+#include "box2d/b2_body.h"
+#include "box2d/b2_broad_phase.h"
+#include "box2d/b2_chain_shape.h"
+#include "box2d/b2_circle_shape.h"
+#include "box2d/b2_contact.h"
+#include "box2d/b2_distance_joint.h"
+#include "box2d/b2_edge_shape.h"
+#include "box2d/b2_fixture.h"
+#include "box2d/b2_friction_joint.h"
+#include "box2d/b2_gear_joint.h"
+#include "box2d/b2_motor_joint.h"
+#include "box2d/b2_mouse_joint.h"
+#include "box2d/b2_polygon_shape.h"
+#include "box2d/b2_prismatic_joint.h"
+#include "box2d/b2_pulley_joint.h"
+#include "box2d/b2_revolute_joint.h"
+#include "box2d/b2_rope_system.h"
+#include "box2d/b2_weld_joint.h"
+#include "box2d/b2_wheel_joint.h"
+#include "box2d/b2_world.h"
+
+#include <new>
+
+// Snapshot layout:
+// - header
+// - world settings and step state
+// - bodies in creation order, each followed by its fixtures in list order
+// - joints in creation order
+// - broad-phase tree nodes and move buffer
+// - contacts in creation order
+// - sleeping islands as body indices, contact proxy pairs and joint indices
+// Objects are restored in creation order so that every linked list, including the
+// per body joint and contact lists, comes back in the same order. The island and
+// solver order then match and the simulation continues exactly.
+
+#define b2_snapshotMagic 0x4e533262
+#define b2_snapshotVersion 6
+
+struct b2SnapshotHeader
+{
+	uint32 magic;
+	int32 version;
+	int32 byteCount;
+	int32 pointerSize;
+	int32 userDataSize;
+	int32 maxPolygonVertices;
+	int32 maxManifoldPoints;
+	int32 bodyCount;
+	int32 jointCount;
+	int32 contactCount;
+	int32 nodeCapacity;
+};
+
+static void b2SerializeHeader(b2SnapshotArchive& archive, b2SnapshotHeader& header)
+{
+	archive.Value(header.magic);
+	archive.Value(header.version);
+	archive.Value(header.byteCount);
+	archive.Value(header.pointerSize);
+	archive.Value(header.userDataSize);
+	archive.Value(header.maxPolygonVertices);
+	archive.Value(header.maxManifoldPoints);
+	archive.Value(header.bodyCount);
+	archive.Value(header.jointCount);
+	archive.Value(header.contactCount);
+	archive.Value(header.nodeCapacity);
+}
+
+template <typename T>
+static b2Joint* b2CreateSnapshotJoint(b2World* world, T* def, b2Body* bodyA, b2Body* bodyB)
+{
+	def->bodyA = bodyA;
+	def->bodyB = bodyB;
+	return world->CreateJoint(def);
+}
+
+// Create a joint of the given type with default parameters. The saved state is loaded afterwards.
+static b2Joint* b2CreateSnapshotJoint(b2World* world, b2JointType type, b2Body* bodyA, b2Body* bodyB,
+									  b2Joint* joint1, b2Joint* joint2)
+{
+	switch (type)
+	{
+	case e_distanceJoint:
+		{
+			b2DistanceJointDef def;
+			return b2CreateSnapshotJoint(world, &def, bodyA, bodyB);
+		}
+
+	case e_mouseJoint:
+		{
+			b2MouseJointDef def;
+			return b2CreateSnapshotJoint(world, &def, bodyA, bodyB);
+		}
+
+	case e_prismaticJoint:
+		{
+			b2PrismaticJointDef def;
+			return b2CreateSnapshotJoint(world, &def, bodyA, bodyB);
+		}
+
+	case e_revoluteJoint:
+		{
+			b2RevoluteJointDef def;
+			return b2CreateSnapshotJoint(world, &def, bodyA, bodyB);
+		}
+
+	case e_pulleyJoint:
+		{
+			b2PulleyJointDef def;
+			return b2CreateSnapshotJoint(world, &def, bodyA, bodyB);
+		}
+
+	case e_gearJoint:
+		{
+			b2GearJointDef def;
+			def.joint1 = joint1;
+			def.joint2 = joint2;
+			return b2CreateSnapshotJoint(world, &def, bodyA, bodyB);
+		}
+
+	case e_wheelJoint:
+		{
+			b2WheelJointDef def;
+			return b2CreateSnapshotJoint(world, &def, bodyA, bodyB);
+		}
+
+	case e_weldJoint:
+		{
+			b2WeldJointDef def;
+			return b2CreateSnapshotJoint(world, &def, bodyA, bodyB);
+		}
+
+	case e_frictionJoint:
+		{
+			b2FrictionJointDef def;
+			return b2CreateSnapshotJoint(world, &def, bodyA, bodyB);
+		}
+
+	case e_motorJoint:
+		{
+			b2MotorJointDef def;
+			return b2CreateSnapshotJoint(world, &def, bodyA, bodyB);
+		}
+
+	default:
+		return nullptr;
+	}
+}
+
+static b2Shape* b2AllocateSnapshotShape(b2Shape::Type type, b2BlockAllocator* allocator)
+{
+	switch (type)
+	{
+	case b2Shape::e_circle:
+		{
+			void* mem = allocator->Allocate(sizeof(b2CircleShape));
+			return new (mem) b2CircleShape;
+		}
+
+	case b2Shape::e_edge:
+		{
+			void* mem = allocator->Allocate(sizeof(b2EdgeShape));
+			return new (mem) b2EdgeShape;
+		}
+
+	case b2Shape::e_polygon:
+		{
+			void* mem = allocator->Allocate(sizeof(b2PolygonShape));
+			return new (mem) b2PolygonShape;
+		}
+
+	case b2Shape::e_chain:
+		{
+			void* mem = allocator->Allocate(sizeof(b2ChainShape));
+			return new (mem) b2ChainShape;
+		}
+
+	default:
+		return nullptr;
+	}
+}
+
+int32 b2World::GetSnapshotSize() const
+{
+	b2SnapshotArchive archive(nullptr, 0, false);
+
+	// Writing assigns scratch indices to bodies and joints, like Dump.
+	const_cast<b2World*>(this)->WriteSnapshot(archive);
+	return archive.m_offset;
+}
+
+int32 b2World::SaveSnapshot(void* buffer, int32 capacity) const
+{
+	b2Assert(m_locked == false);
+	if (m_locked)
+	{
+		return 0;
+	}
+
+	b2SnapshotArchive archive((uint8*)buffer, capacity, false);
+	const_cast<b2World*>(this)->WriteSnapshot(archive);
+	if (archive.m_error)
+	{
+		return 0;
+	}
+
+	return archive.m_offset;
+}
+
+bool b2World::RestoreSnapshot(const void* buffer, int32 size)
+{
+	b2Assert(m_locked == false);
+	if (m_locked)
+	{
+		return false;
+	}
+
+	b2Assert(m_contactManager.m_layerList == nullptr && m_tileQueueHead == nullptr);
+	if (m_contactManager.m_layerList != nullptr || m_tileQueueHead != nullptr)
+	{
+		return false;
+	}
+
+	b2SnapshotArchive archive((uint8*)const_cast<void*>(buffer), size, true);
+	return ReadSnapshot(archive);
+}
+
+b2World* b2World::Clone() const
+{
+	b2World* world = new b2World(m_gravity);
+	CopyTo(world);
+	return world;
+}
+
+// The copy is made in bulk. The block allocator chunks hold the bodies, fixtures, shapes,
+// contacts, joints and sleeping islands, and are copied whole. The broad-phase nodes and
+// move buffer are plain arrays. One pass over the copied objects then moves their
+// pointers over, see b2BlockAllocator::Relocate. Only chain vertices and large proxy
+// arrays live outside the chunks and are copied one by one.
+void b2World::CopyTo(b2World* world) const
+{
+	b2Assert(world != this);
+	b2Assert(m_locked == false && world->m_locked == false);
+	if (world == this || m_locked || world->m_locked)
+	{
+		return;
+	}
+
+	// Layers refer to caller owned blobs and tiles stream them, so neither can be copied.
+	b2Assert(m_contactManager.m_layerList == nullptr && m_tileQueueHead == nullptr);
+	b2Assert(world->m_contactManager.m_layerList == nullptr && world->m_tileQueueHead == nullptr);
+	if (m_contactManager.m_layerList != nullptr || m_tileQueueHead != nullptr ||
+		world->m_contactManager.m_layerList != nullptr || world->m_tileQueueHead != nullptr)
+	{
+		return;
+	}
+
+	// Release what the target holds outside of its chunks. The chunks themselves are
+	// overwritten, so nothing else is destroyed. Cached blocks would be handed out again.
+	b2BlockAllocator* allocator = &world->m_blockAllocator;
+	world->m_contactManager.FlushCaches();
+	for (b2Body* b = world->m_bodyList; b; b = b->m_next)
+	{
+		if (world->m_ropeSystem)
+		{
+			world->m_ropeSystem->RemoveBody(b);
+		}
+
+		for (b2Fixture* f = b->m_fixtureList; f; f = f->m_next)
+		{
+			int32 proxyBytes = f->m_shape->GetChildCount() * int32(sizeof(b2FixtureProxy));
+			if (proxyBytes > b2_maxBlockSize)
+			{
+				allocator->Free(f->m_proxies, proxyBytes);
+			}
+
+			if (f->m_shape->m_type == b2Shape::e_chain)
+			{
+				((b2ChainShape*)f->m_shape)->Clear();
+			}
+		}
+	}
+
+	allocator->Copy(&m_blockAllocator);
+
+	const b2BroadPhase* broadPhase = &m_contactManager.m_broadPhase;
+	const b2DynamicTree* tree = &broadPhase->m_tree;
+	b2BroadPhase* targetBroadPhase = &world->m_contactManager.m_broadPhase;
+	b2DynamicTree* targetTree = &targetBroadPhase->m_tree;
+
+	// The capacity decides when the tree grows, so it must match. The leaves are
+	// pointed at the copied proxies below.
+	if (targetTree->m_nodeCapacity != tree->m_nodeCapacity)
+	{
+		b2Free(targetTree->m_nodes);
+		targetTree->m_nodeCapacity = tree->m_nodeCapacity;
+		targetTree->m_nodes = (b2TreeNode*)b2Alloc(targetTree->m_nodeCapacity * sizeof(b2TreeNode));
+	}
+
+	memcpy(targetTree->m_nodes, tree->m_nodes, tree->m_nodeCapacity * sizeof(b2TreeNode));
+	targetTree->m_root = tree->m_root;
+	targetTree->m_nodeCount = tree->m_nodeCount;
+	targetTree->m_freeList = tree->m_freeList;
+	targetTree->m_insertionCount = tree->m_insertionCount;
+	targetTree->m_rotationCount = tree->m_rotationCount;
+
+	if (broadPhase->m_moveCount > targetBroadPhase->m_moveCapacity)
+	{
+		b2Free(targetBroadPhase->m_moveBuffer);
+		targetBroadPhase->m_moveCapacity = broadPhase->m_moveCapacity;
+		targetBroadPhase->m_moveBuffer = (int32*)b2Alloc(targetBroadPhase->m_moveCapacity * sizeof(int32));
+	}
+
+	memcpy(targetBroadPhase->m_moveBuffer, broadPhase->m_moveBuffer, broadPhase->m_moveCount * sizeof(int32));
+	targetBroadPhase->m_moveCount = broadPhase->m_moveCount;
+	targetBroadPhase->m_proxyCount = broadPhase->m_proxyCount;
+	targetBroadPhase->m_compactValid = false;
+	targetBroadPhase->m_compactRebuild = true;
+	targetBroadPhase->m_compactMoveCount = 0;
+
+	// Bodies, walked along with the source to find the first body of each island.
+	world->m_bodyList = allocator->Relocate(m_bodyList);
+	const b2Body* source = m_bodyList;
+	for (b2Body* b = world->m_bodyList; b; b = b->m_next, source = source->m_next)
+	{
+		b->m_world = world;
+		b->m_prev = allocator->Relocate(b->m_prev);
+		b->m_next = allocator->Relocate(b->m_next);
+		b->m_fixtureList = allocator->Relocate(b->m_fixtureList);
+		b->m_jointList = allocator->Relocate(b->m_jointList);
+		b->m_contactList = allocator->Relocate(b->m_contactList);
+		b->m_sleepingIsland = allocator->Relocate(b->m_sleepingIsland);
+		b->m_sleepingPrev = allocator->Relocate(b->m_sleepingPrev);
+		b->m_sleepingNext = allocator->Relocate(b->m_sleepingNext);
+		b->m_awakePrev = allocator->Relocate(b->m_awakePrev);
+		b->m_awakeNext = allocator->Relocate(b->m_awakeNext);
+
+		b2SleepingIsland* island = b->m_sleepingIsland;
+		if (island && source->m_sleepingIsland->bodies == source)
+		{
+			island->bodies = b;
+			island->contacts = allocator->Relocate(island->contacts);
+			island->joints = allocator->Relocate(island->joints);
+		}
+
+		for (b2Fixture* f = b->m_fixtureList; f; f = f->m_next)
+		{
+			f->m_next = allocator->Relocate(f->m_next);
+			f->m_body = b;
+			f->m_shape = allocator->Relocate(f->m_shape);
+
+			if (f->m_shape->m_type == b2Shape::e_chain)
+			{
+				b2ChainShape* chain = (b2ChainShape*)f->m_shape;
+				const b2Vec2* vertices = chain->m_vertices;
+				chain->m_vertices = (b2Vec2*)b2Alloc(chain->m_count * sizeof(b2Vec2));
+				memcpy(chain->m_vertices, vertices, chain->m_count * sizeof(b2Vec2));
+			}
+
+			int32 childCount = f->m_shape->GetChildCount();
+			int32 proxyBytes = childCount * int32(sizeof(b2FixtureProxy));
+			if (proxyBytes > b2_maxBlockSize)
+			{
+				const b2FixtureProxy* proxies = f->m_proxies;
+				f->m_proxies = (b2FixtureProxy*)allocator->Allocate(proxyBytes);
+				memcpy(f->m_proxies, proxies, proxyBytes);
+			}
+			else
+			{
+				f->m_proxies = allocator->Relocate(f->m_proxies);
+			}
+
+			for (int32 i = 0; i < childCount; ++i)
+			{
+				f->m_proxies[i].fixture = f;
+			}
+
+			for (int32 i = 0; i < f->m_proxyCount; ++i)
+			{
+				targetTree->m_nodes[f->m_proxies[i].proxyId].userData = f->m_proxies + i;
+			}
+		}
+	}
+
+	world->m_jointList = allocator->Relocate(m_jointList);
+	for (b2Joint* j = world->m_jointList; j; j = j->m_next)
+	{
+		j->Relocate(allocator);
+	}
+
+	b2ContactManager* contactManager = &world->m_contactManager;
+	contactManager->m_contactList = allocator->Relocate(m_contactManager.m_contactList);
+	for (b2Contact* c = contactManager->m_contactList; c; c = c->m_next)
+	{
+		c->m_prev = allocator->Relocate(c->m_prev);
+		c->m_next = allocator->Relocate(c->m_next);
+		c->m_sleepingIsland = allocator->Relocate(c->m_sleepingIsland);
+		c->m_sleepingPrev = allocator->Relocate(c->m_sleepingPrev);
+		c->m_sleepingNext = allocator->Relocate(c->m_sleepingNext);
+		c->m_fixtureA = allocator->Relocate(c->m_fixtureA);
+		c->m_fixtureB = allocator->Relocate(c->m_fixtureB);
+
+		c->m_nodeA.contact = c;
+		c->m_nodeA.other = allocator->Relocate(c->m_nodeA.other);
+		c->m_nodeA.prev = allocator->Relocate(c->m_nodeA.prev);
+		c->m_nodeA.next = allocator->Relocate(c->m_nodeA.next);
+
+		c->m_nodeB.contact = c;
+		c->m_nodeB.other = allocator->Relocate(c->m_nodeB.other);
+		c->m_nodeB.prev = allocator->Relocate(c->m_nodeB.prev);
+		c->m_nodeB.next = allocator->Relocate(c->m_nodeB.next);
+	}
+
+	contactManager->m_contactCount = m_contactManager.m_contactCount;
+	contactManager->m_touchingCount = m_contactManager.m_touchingCount;
+
+	world->m_bodyCount = m_bodyCount;
+	world->m_jointCount = m_jointCount;
+	world->m_awakeBodyList = allocator->Relocate(m_awakeBodyList);
+	world->m_awakeBodyCount = m_awakeBodyCount;
+	world->m_sleepingIslandCount = m_sleepingIslandCount;
+
+	world->m_gravity = m_gravity;
+	world->m_allowSleep = m_allowSleep;
+	world->m_warmStarting = m_warmStarting;
+	world->m_useContinuous = m_useContinuous;
+	world->m_subStepping = m_subStepping;
+	world->m_chainSolving = m_chainSolving;
+	world->m_clearForces = m_clearForces;
+	world->m_stepComplete = m_stepComplete;
+	world->m_newContacts = m_newContacts;
+	world->m_inv_dt0 = m_inv_dt0;
+
+	world->SetCompactQueries(broadPhase->GetCompactQueries());
+}
+
+void b2World::WriteSnapshot(b2SnapshotArchive& archive)
+{
+	// Layers refer to caller owned blobs that cannot be captured.
+	b2Assert(m_contactManager.m_layerList == nullptr && m_tileQueueHead == nullptr);
+	if (m_contactManager.m_layerList != nullptr || m_tileQueueHead != nullptr)
+	{
+		archive.m_error = true;
+		return;
+	}
+
+	b2SnapshotHeader header;
+	header.magic = b2_snapshotMagic;
+	header.version = b2_snapshotVersion;
+	header.byteCount = 0;
+	header.pointerSize = int32(sizeof(void*));
+	header.userDataSize = int32(sizeof(b2BodyUserData) + sizeof(b2FixtureUserData) + sizeof(b2JointUserData));
+	header.maxPolygonVertices = b2_maxPolygonVertices;
+	header.maxManifoldPoints = b2_maxManifoldPoints;
+	header.bodyCount = m_bodyCount;
+	header.jointCount = m_jointCount;
+	header.contactCount = m_contactManager.m_contactCount;
+	header.nodeCapacity = m_contactManager.m_broadPhase.m_tree.m_nodeCapacity;
+
+	// The byte count is patched at the end.
+	int32 byteCountOffset = archive.m_offset + 2 * int32(sizeof(int32));
+	b2SerializeHeader(archive, header);
+
+	archive.Value(m_gravity);
+	archive.Value(m_allowSleep);
+	archive.Value(m_warmStarting);
+	archive.Value(m_useContinuous);
+	archive.Value(m_subStepping);
+	archive.Value(m_chainSolving);
+	archive.Value(m_clearForces);
+	archive.Value(m_stepComplete);
+	archive.Value(m_newContacts);
+	archive.Value(m_inv_dt0);
+
+	// Bodies, oldest first. New bodies are pushed on the front of the list.
+	b2Body* bodyTail = m_bodyList;
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		bodyTail = b;
+	}
+
+	int32 bodyIndex = 0;
+	for (b2Body* b = bodyTail; b; b = b->m_prev)
+	{
+		b->m_islandIndex = bodyIndex++;
+		b->Serialize(archive);
+
+		archive.Value(b->m_fixtureCount);
+		for (b2Fixture* f = b->m_fixtureList; f; f = f->m_next)
+		{
+			int32 type = f->m_shape->m_type;
+			int32 childCount = f->m_shape->GetChildCount();
+			archive.Value(type);
+			archive.Value(childCount);
+			f->Serialize(archive);
+		}
+	}
+
+	// Joints, oldest first. Gear joints always come after the joints they couple.
+	b2Joint* jointTail = m_jointList;
+	for (b2Joint* j = m_jointList; j; j = j->m_next)
+	{
+		jointTail = j;
+	}
+
+	int32 jointIndex = 0;
+	for (b2Joint* j = jointTail; j; j = j->m_prev)
+	{
+		j->m_index = jointIndex++;
+
+		int32 type = j->m_type;
+		int32 indexA = j->m_bodyA->m_islandIndex;
+		int32 indexB = j->m_bodyB->m_islandIndex;
+		archive.Value(type);
+		archive.Value(indexA);
+		archive.Value(indexB);
+
+		if (j->m_type == e_gearJoint)
+		{
+			b2GearJoint* gear = (b2GearJoint*)j;
+			int32 index1 = gear->GetJoint1()->m_index;
+			int32 index2 = gear->GetJoint2()->m_index;
+			archive.Value(index1);
+			archive.Value(index2);
+		}
+
+		j->Serialize(archive);
+	}
+
+	// Broad-phase. Leaf user data is rebuilt from the fixture proxies.
+	b2BroadPhase* broadPhase = &m_contactManager.m_broadPhase;
+	b2DynamicTree* tree = &broadPhase->m_tree;
+	archive.Value(tree->m_root);
+	archive.Value(tree->m_nodeCount);
+	archive.Value(tree->m_freeList);
+	for (int32 i = 0; i < tree->m_nodeCapacity; ++i)
+	{
+		b2TreeNode* node = tree->m_nodes + i;
+		archive.Value(node->aabb);
+		archive.Value(node->parent);
+		archive.Value(node->child1);
+		archive.Value(node->child2);
+		archive.Value(node->height);
+		archive.Value(node->moved);
+	}
+
+	archive.Value(broadPhase->m_proxyCount);
+	archive.Value(broadPhase->m_moveCount);
+	archive.Bytes(broadPhase->m_moveBuffer, broadPhase->m_moveCount * int32(sizeof(int32)));
+
+	// Contacts, oldest first. The fixtures are found through their broad-phase proxies.
+	b2Contact* contactTail = m_contactManager.m_contactList;
+	for (b2Contact* c = m_contactManager.m_contactList; c; c = c->m_next)
+	{
+		contactTail = c;
+	}
+
+	for (b2Contact* c = contactTail; c; c = c->m_prev)
+	{
+		int32 proxyIdA = c->m_fixtureA->m_proxies[c->m_indexA].proxyId;
+		int32 proxyIdB = c->m_fixtureB->m_proxies[c->m_indexB].proxyId;
+		archive.Value(proxyIdA);
+		archive.Value(proxyIdB);
+		c->Serialize(archive);
+	}
+
+	// Sleeping islands, so that they wake as the same units after a restore. Each island
+	// is written from its first body, with its contacts and joints in solver order.
+	int32 sleepingIslandCount = 0;
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		if (b->m_sleepingIsland && b->m_sleepingIsland->bodies == b)
+		{
+			++sleepingIslandCount;
+		}
+	}
+
+	archive.Value(sleepingIslandCount);
+	for (b2Body* b = bodyTail; b; b = b->m_prev)
+	{
+		b2SleepingIsland* island = b->m_sleepingIsland;
+		if (island == nullptr || island->bodies != b)
+		{
+			continue;
+		}
+
+		archive.Value(island->awake);
+
+		int32 islandBodyCount = 0;
+		b2Body* ring = b;
+		do
+		{
+			++islandBodyCount;
+			ring = ring->m_sleepingNext;
+		}
+		while (ring != b);
+
+		archive.Value(islandBodyCount);
+		do
+		{
+			archive.Value(ring->m_islandIndex);
+			ring = ring->m_sleepingNext;
+		}
+		while (ring != b);
+
+		int32 islandContactCount = 0;
+		for (b2Contact* c = island->contacts; c; c = c->m_sleepingNext)
+		{
+			++islandContactCount;
+		}
+
+		archive.Value(islandContactCount);
+		for (b2Contact* c = island->contacts; c; c = c->m_sleepingNext)
+		{
+			int32 proxyIdA = c->m_fixtureA->m_proxies[c->m_indexA].proxyId;
+			int32 proxyIdB = c->m_fixtureB->m_proxies[c->m_indexB].proxyId;
+			archive.Value(proxyIdA);
+			archive.Value(proxyIdB);
+		}
+
+		int32 islandJointCount = 0;
+		for (b2Joint* j = island->joints; j; j = j->m_sleepingNext)
+		{
+			++islandJointCount;
+		}
+
+		archive.Value(islandJointCount);
+		for (b2Joint* j = island->joints; j; j = j->m_sleepingNext)
+		{
+			archive.Value(j->m_index);
+		}
+	}
+
+	// The awake list, because it decides which body starts each island.
+	archive.Value(m_awakeBodyCount);
+	for (b2Body* b = m_awakeBodyList; b; b = b->m_awakeNext)
+	{
+		archive.Value(b->m_islandIndex);
+	}
+
+	if (archive.m_error == false && archive.m_data != nullptr)
+	{
+		memcpy(archive.m_data + byteCountOffset, &archive.m_offset, sizeof(int32));
+	}
+}
+
+bool b2World::ReadSnapshot(b2SnapshotArchive& archive)
+{
+	b2SnapshotHeader header;
+	b2SerializeHeader(archive, header);
+
+	if (archive.m_error ||
+		header.magic != b2_snapshotMagic ||
+		header.version != b2_snapshotVersion ||
+		header.byteCount != archive.m_capacity ||
+		header.pointerSize != int32(sizeof(void*)) ||
+		header.userDataSize != int32(sizeof(b2BodyUserData) + sizeof(b2FixtureUserData) + sizeof(b2JointUserData)) ||
+		header.maxPolygonVertices != b2_maxPolygonVertices ||
+		header.maxManifoldPoints != b2_maxManifoldPoints ||
+		header.bodyCount < 0 || header.jointCount < 0 || header.contactCount < 0 ||
+		header.nodeCapacity <= 0)
+	{
+		return false;
+	}
+
+	DestroyAll();
+
+	archive.Value(m_gravity);
+	archive.Value(m_allowSleep);
+	archive.Value(m_warmStarting);
+	archive.Value(m_useContinuous);
+	archive.Value(m_subStepping);
+	archive.Value(m_chainSolving);
+	archive.Value(m_clearForces);
+	archive.Value(m_stepComplete);
+	archive.Value(m_newContacts);
+	archive.Value(m_inv_dt0);
+
+	int32 bodyCount = header.bodyCount;
+	int32 jointCount = header.jointCount;
+
+	// Scratch tables come from the stack allocator, so restoring into a warm world
+	// does not touch the heap.
+	b2Body** bodies = (b2Body**)m_stackAllocator.Allocate((bodyCount + 1) * sizeof(b2Body*));
+	b2Joint** joints = (b2Joint**)m_stackAllocator.Allocate((jointCount + 1) * sizeof(b2Joint*));
+
+	b2BodyDef bodyDef;
+	for (int32 i = 0; i < bodyCount && archive.m_error == false; ++i)
+	{
+		b2Body* b = CreateBody(&bodyDef);
+		b->Serialize(archive);
+		b->m_flags &= ~b2Body::e_awakeListFlag;
+		bodies[i] = b;
+
+		int32 fixtureCount = 0;
+		archive.Value(fixtureCount);
+
+		b2Fixture* tail = nullptr;
+		for (int32 k = 0; k < fixtureCount && archive.m_error == false; ++k)
+		{
+			int32 type = 0;
+			int32 childCount = 0;
+			archive.Value(type);
+			archive.Value(childCount);
+
+			b2Shape* shape = nullptr;
+			if (0 <= type && type < b2Shape::e_typeCount && childCount > 0)
+			{
+				shape = b2AllocateSnapshotShape(b2Shape::Type(type), &m_blockAllocator);
+			}
+
+			if (shape == nullptr)
+			{
+				archive.m_error = true;
+				break;
+			}
+
+			void* mem = m_blockAllocator.Allocate(sizeof(b2Fixture));
+			b2Fixture* f = new (mem) b2Fixture;
+			f->m_body = b;
+			f->m_shape = shape;
+			f->m_proxies = (b2FixtureProxy*)m_blockAllocator.Allocate(childCount * sizeof(b2FixtureProxy));
+			f->Serialize(archive);
+
+			if (shape->GetChildCount() != childCount)
+			{
+				archive.m_error = true;
+			}
+
+			// Keep the list order.
+			if (tail)
+			{
+				tail->m_next = f;
+			}
+			else
+			{
+				b->m_fixtureList = f;
+			}
+			tail = f;
+			b->m_fixtureCount += 1;
+		}
+	}
+
+	for (int32 i = 0; i < jointCount && archive.m_error == false; ++i)
+	{
+		int32 type = 0;
+		int32 indexA = 0;
+		int32 indexB = 0;
+		archive.Value(type);
+		archive.Value(indexA);
+		archive.Value(indexB);
+
+		int32 index1 = 0;
+		int32 index2 = 0;
+		if (type == e_gearJoint)
+		{
+			archive.Value(index1);
+			archive.Value(index2);
+			if (index1 < 0 || index1 >= i || index2 < 0 || index2 >= i)
+			{
+				archive.m_error = true;
+				break;
+			}
+		}
+
+		if (indexA < 0 || indexA >= bodyCount || indexB < 0 || indexB >= bodyCount || indexA == indexB)
+		{
+			archive.m_error = true;
+			break;
+		}
+
+		b2Joint* j = b2CreateSnapshotJoint(this, b2JointType(type), bodies[indexA], bodies[indexB],
+										   joints[index1], joints[index2]);
+		if (j == nullptr)
+		{
+			archive.m_error = true;
+			break;
+		}
+
+		j->Serialize(archive);
+		joints[i] = j;
+	}
+
+	b2BroadPhase* broadPhase = &m_contactManager.m_broadPhase;
+	b2DynamicTree* tree = &broadPhase->m_tree;
+
+	// The capacity decides when the tree grows, so it must match.
+	if (archive.m_error == false && tree->m_nodeCapacity != header.nodeCapacity)
+	{
+		b2Free(tree->m_nodes);
+		tree->m_nodeCapacity = header.nodeCapacity;
+		tree->m_nodes = (b2TreeNode*)b2Alloc(tree->m_nodeCapacity * sizeof(b2TreeNode));
+	}
+
+	if (archive.m_error == false)
+	{
+		archive.Value(tree->m_root);
+		archive.Value(tree->m_nodeCount);
+		archive.Value(tree->m_freeList);
+		for (int32 i = 0; i < tree->m_nodeCapacity; ++i)
+		{
+			b2TreeNode* node = tree->m_nodes + i;
+			archive.Value(node->aabb);
+			node->userData = nullptr;
+			archive.Value(node->parent);
+			archive.Value(node->child1);
+			archive.Value(node->child2);
+			archive.Value(node->height);
+			archive.Value(node->moved);
+		}
+
+		int32 moveCount = 0;
+		archive.Value(broadPhase->m_proxyCount);
+		archive.Value(moveCount);
+		if (moveCount < 0 || moveCount > tree->m_nodeCapacity)
+		{
+			archive.m_error = true;
+			moveCount = 0;
+		}
+
+		if (moveCount > broadPhase->m_moveCapacity)
+		{
+			b2Free(broadPhase->m_moveBuffer);
+			broadPhase->m_moveCapacity = moveCount;
+			broadPhase->m_moveBuffer = (int32*)b2Alloc(moveCount * sizeof(int32));
+		}
+
+		archive.Bytes(broadPhase->m_moveBuffer, moveCount * int32(sizeof(int32)));
+		broadPhase->m_moveCount = moveCount;
+
+		broadPhase->m_compactValid = false;
+		broadPhase->m_compactRebuild = true;
+		broadPhase->m_compactMoveCount = 0;
+
+		// Point the leaves back at the fixture proxies.
+		for (b2Body* b = m_bodyList; b; b = b->m_next)
+		{
+			for (b2Fixture* f = b->m_fixtureList; f; f = f->m_next)
+			{
+				for (int32 i = 0; i < f->m_proxyCount; ++i)
+				{
+					int32 proxyId = f->m_proxies[i].proxyId;
+					if (proxyId < 0 || proxyId >= tree->m_nodeCapacity || tree->m_nodes[proxyId].IsLeaf() == false)
+					{
+						archive.m_error = true;
+						continue;
+					}
+
+					tree->m_nodes[proxyId].userData = f->m_proxies + i;
+				}
+			}
+		}
+	}
+
+	for (int32 i = 0; i < header.contactCount && archive.m_error == false; ++i)
+	{
+		int32 proxyIdA = 0;
+		int32 proxyIdB = 0;
+		archive.Value(proxyIdA);
+		archive.Value(proxyIdB);
+
+		if (proxyIdA < 0 || proxyIdA >= tree->m_nodeCapacity || proxyIdB < 0 || proxyIdB >= tree->m_nodeCapacity)
+		{
+			archive.m_error = true;
+			break;
+		}
+
+		b2FixtureProxy* proxyA = (b2FixtureProxy*)tree->m_nodes[proxyIdA].userData;
+		b2FixtureProxy* proxyB = (b2FixtureProxy*)tree->m_nodes[proxyIdB].userData;
+		if (proxyA == nullptr || proxyB == nullptr)
+		{
+			archive.m_error = true;
+			break;
+		}
+
+		// The saved order is the primary order, so creation does not swap the fixtures.
+		b2Contact* c = b2Contact::Create(proxyA->fixture, proxyA->childIndex, proxyB->fixture, proxyB->childIndex, &m_blockAllocator);
+		if (c == nullptr)
+		{
+			archive.m_error = true;
+			break;
+		}
+
+		c->Serialize(archive);
+		m_contactManager.LinkContact(c);
+	}
+
+	int32 sleepingIslandCount = 0;
+	archive.Value(sleepingIslandCount);
+	if (sleepingIslandCount < 0 || sleepingIslandCount > bodyCount)
+	{
+		archive.m_error = true;
+	}
+
+	// The island flags catch a member listed twice.
+	b2Body** islandBodies = (b2Body**)m_stackAllocator.Allocate((bodyCount + 1) * sizeof(b2Body*));
+	b2Contact** islandContacts = (b2Contact**)m_stackAllocator.Allocate((header.contactCount + 1) * sizeof(b2Contact*));
+	b2Joint** islandJoints = (b2Joint**)m_stackAllocator.Allocate((jointCount + 1) * sizeof(b2Joint*));
+	for (int32 i = 0; i < sleepingIslandCount && archive.m_error == false; ++i)
+	{
+		bool awake = false;
+		archive.Value(awake);
+
+		int32 islandBodyCount = 0;
+		archive.Value(islandBodyCount);
+		if (islandBodyCount <= 0 || islandBodyCount > bodyCount)
+		{
+			archive.m_error = true;
+			break;
+		}
+
+		for (int32 k = 0; k < islandBodyCount; ++k)
+		{
+			int32 index = -1;
+			archive.Value(index);
+			if (index < 0 || index >= bodyCount)
+			{
+				archive.m_error = true;
+				islandBodyCount = k;
+				break;
+			}
+
+			b2Body* b = bodies[index];
+			if (b->m_type == b2_staticBody || (b->IsAwake() && awake == false) || b->m_sleepingIsland != nullptr ||
+				(b->m_flags & b2Body::e_islandFlag))
+			{
+				archive.m_error = true;
+				islandBodyCount = k;
+				break;
+			}
+
+			b->m_flags |= b2Body::e_islandFlag;
+			islandBodies[k] = b;
+		}
+
+		int32 islandContactCount = 0;
+		archive.Value(islandContactCount);
+		if (islandContactCount < 0 || islandContactCount > header.contactCount)
+		{
+			archive.m_error = true;
+			islandContactCount = 0;
+		}
+
+		for (int32 k = 0; k < islandContactCount && archive.m_error == false; ++k)
+		{
+			int32 proxyIdA = 0;
+			int32 proxyIdB = 0;
+			archive.Value(proxyIdA);
+			archive.Value(proxyIdB);
+
+			b2Contact* c = nullptr;
+			if (0 <= proxyIdA && proxyIdA < tree->m_nodeCapacity && 0 <= proxyIdB && proxyIdB < tree->m_nodeCapacity)
+			{
+				b2FixtureProxy* proxyA = (b2FixtureProxy*)tree->m_nodes[proxyIdA].userData;
+				b2FixtureProxy* proxyB = (b2FixtureProxy*)tree->m_nodes[proxyIdB].userData;
+				if (proxyA != nullptr && proxyB != nullptr)
+				{
+					for (b2ContactEdge* ce = proxyA->fixture->GetBody()->m_contactList; ce; ce = ce->next)
+					{
+						b2Contact* candidate = ce->contact;
+						if (candidate->m_fixtureA == proxyA->fixture && candidate->m_indexA == proxyA->childIndex &&
+							candidate->m_fixtureB == proxyB->fixture && candidate->m_indexB == proxyB->childIndex)
+						{
+							c = candidate;
+							break;
+						}
+					}
+				}
+			}
+
+			if (c == nullptr || c->m_sleepingIsland != nullptr || (c->m_flags & b2Contact::e_islandFlag))
+			{
+				archive.m_error = true;
+				islandContactCount = k;
+				break;
+			}
+
+			c->m_flags |= b2Contact::e_islandFlag;
+			islandContacts[k] = c;
+		}
+
+		int32 islandJointCount = 0;
+		archive.Value(islandJointCount);
+		if (islandJointCount < 0 || islandJointCount > jointCount)
+		{
+			archive.m_error = true;
+			islandJointCount = 0;
+		}
+
+		for (int32 k = 0; k < islandJointCount && archive.m_error == false; ++k)
+		{
+			int32 index = -1;
+			archive.Value(index);
+			if (index < 0 || index >= jointCount || joints[index]->m_sleepingIsland != nullptr ||
+				joints[index]->m_islandFlag)
+			{
+				archive.m_error = true;
+				islandJointCount = k;
+				break;
+			}
+
+			joints[index]->m_islandFlag = true;
+			islandJoints[k] = joints[index];
+		}
+
+		for (int32 k = 0; k < islandBodyCount; ++k)
+		{
+			islandBodies[k]->m_flags &= ~b2Body::e_islandFlag;
+		}
+
+		for (int32 k = 0; k < islandContactCount; ++k)
+		{
+			islandContacts[k]->m_flags &= ~b2Contact::e_islandFlag;
+		}
+
+		for (int32 k = 0; k < islandJointCount; ++k)
+		{
+			islandJoints[k]->m_islandFlag = false;
+		}
+
+		if (archive.m_error)
+		{
+			break;
+		}
+
+		b2SleepingIsland* island = CreateSleepingIsland(islandBodies, islandBodyCount, islandContacts, islandContactCount,
+														islandJoints, islandJointCount);
+		if (awake)
+		{
+			island->awake = true;
+			--m_sleepingIslandCount;
+		}
+	}
+
+	// Every awake body must be listed once. The list is rebuilt from the back because
+	// bodies are added at the front.
+	int32 awakeBodyCount = 0;
+	archive.Value(awakeBodyCount);
+	if (awakeBodyCount < 0 || awakeBodyCount > bodyCount)
+	{
+		archive.m_error = true;
+		awakeBodyCount = 0;
+	}
+
+	for (int32 k = 0; k < awakeBodyCount; ++k)
+	{
+		int32 index = -1;
+		archive.Value(index);
+		if (archive.m_error || index < 0 || index >= bodyCount)
+		{
+			archive.m_error = true;
+			awakeBodyCount = k;
+			break;
+		}
+
+		b2Body* b = bodies[index];
+		if (b->m_type == b2_staticBody || b->IsAwake() == false || b->IsEnabled() == false ||
+			(b->m_flags & b2Body::e_islandFlag))
+		{
+			archive.m_error = true;
+			awakeBodyCount = k;
+			break;
+		}
+
+		b->m_flags |= b2Body::e_islandFlag;
+		islandBodies[k] = b;
+	}
+
+	for (int32 k = awakeBodyCount - 1; k >= 0; --k)
+	{
+		islandBodies[k]->m_flags &= ~b2Body::e_islandFlag;
+		AddAwakeBody(islandBodies[k]);
+	}
+
+	for (int32 i = 0; i < bodyCount && archive.m_error == false; ++i)
+	{
+		b2Body* b = bodies[i];
+		if (b->m_type != b2_staticBody && b->IsAwake() && b->IsEnabled() &&
+			(b->m_flags & b2Body::e_awakeListFlag) == 0)
+		{
+			archive.m_error = true;
+		}
+	}
+
+	m_stackAllocator.Free(islandJoints);
+	m_stackAllocator.Free(islandContacts);
+	m_stackAllocator.Free(islandBodies);
+
+	m_stackAllocator.Free(joints);
+	m_stackAllocator.Free(bodies);
+
+	b2Assert(archive.m_error == false && archive.m_offset == archive.m_capacity);
+	if (archive.m_error || archive.m_offset != archive.m_capacity)
+	{
+		// Do not leave a partially restored world behind.
+		DestroyAll();
+		return false;
+	}
+
+	return true;
+}
+
+void b2World::DestroyAll()
+{
+	ClearSleepingIslands();
+
+	b2Contact* c = m_contactManager.m_contactList;
+	while (c)
+	{
+		b2Contact* cNext = c->m_next;
+		b2Contact::Destroy(c, &m_blockAllocator);
+		c = cNext;
+	}
+	m_contactManager.m_contactList = nullptr;
+	m_contactManager.m_contactCount = 0;
+	m_contactManager.m_touchingCount = 0;
+
+	b2Joint* j = m_jointList;
+	while (j)
+	{
+		b2Joint* jNext = j->m_next;
+		b2Joint::Destroy(j, &m_blockAllocator);
+		j = jNext;
+	}
+	m_jointList = nullptr;
+	m_jointCount = 0;
+
+	b2Body* b = m_bodyList;
+	while (b)
+	{
+		b2Body* bNext = b->m_next;
+
+		if (m_ropeSystem)
+		{
+			m_ropeSystem->RemoveBody(b);
+		}
+
+		b2Fixture* f = b->m_fixtureList;
+		while (f)
+		{
+			b2Fixture* fNext = f->m_next;
+			f->m_proxyCount = 0;
+			f->Destroy(&m_blockAllocator);
+			f->~b2Fixture();
+			m_blockAllocator.Free(f, sizeof(b2Fixture));
+			f = fNext;
+		}
+
+		b->~b2Body();
+		m_blockAllocator.Free(b, sizeof(b2Body));
+		b = bNext;
+	}
+	m_bodyList = nullptr;
+	m_bodyCount = 0;
+	m_awakeBodyList = nullptr;
+	m_awakeBodyCount = 0;
+
+	// Reset the broad-phase in one shot instead of removing the proxies one by one.
+	// The node array is kept because a restore usually needs the same capacity.
+	b2BroadPhase* broadPhase = &m_contactManager.m_broadPhase;
+	b2DynamicTree* tree = &broadPhase->m_tree;
+	memset(tree->m_nodes, 0, tree->m_nodeCapacity * sizeof(b2TreeNode));
+	for (int32 i = 0; i < tree->m_nodeCapacity; ++i)
+	{
+		tree->m_nodes[i].next = i + 1;
+		tree->m_nodes[i].height = -1;
+	}
+	tree->m_nodes[tree->m_nodeCapacity - 1].next = b2_nullNode;
+	tree->m_root = b2_nullNode;
+	tree->m_nodeCount = 0;
+	tree->m_freeList = 0;
+	tree->m_insertionCount = 0;
+	tree->m_rotationCount = 0;
+
+	broadPhase->m_proxyCount = 0;
+	broadPhase->m_moveCount = 0;
+	broadPhase->m_compactValid = false;
+	broadPhase->m_compactRebuild = true;
+	broadPhase->m_compactMoveCount = 0;
+}
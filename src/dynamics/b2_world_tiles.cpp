@@ -0,0 +1,210 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "box2d/b2_static_layer.h"
+#include "box2d/b2_timer.h"
+#include "box2d/b2_trace.h"
+#include "box2d/b2_world.h"
+
+#include <new>
+#include <string.h>
+
+b2StaticTile* b2World::AddStaticTile(const b2StaticTileDef* def)
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
+	{
+		return nullptr;
+	}
+
+	b2Assert(def->chainCount >= 0);
+
+	// Copy the chains and their vertices into one block.
+	int32 vertexCount = 0;
+	for (int32 i = 0; i < def->chainCount; ++i)
+	{
+		vertexCount += def->chains[i].count;
+	}
+
+	int32 chainSize = def->chainCount * int32(sizeof(b2StaticChainDef));
+	void* geometry = b2Alloc(chainSize + vertexCount * int32(sizeof(b2Vec2)));
+	b2StaticChainDef* chains = (b2StaticChainDef*)geometry;
+	b2Vec2* vertices = (b2Vec2*)((uint8*)geometry + chainSize);
+	for (int32 i = 0; i < def->chainCount; ++i)
+	{
+		chains[i] = def->chains[i];
+		memcpy(vertices, def->chains[i].vertices, def->chains[i].count * sizeof(b2Vec2));
+		chains[i].vertices = vertices;
+		vertices += def->chains[i].count;
+	}
+
+	void* mem = m_blockAllocator.Allocate(sizeof(b2StaticTile));
+	b2StaticTile* tile = new (mem) b2StaticTile;
+	tile->m_chains = chains;
+	tile->m_chainCount = def->chainCount;
+	tile->m_data = nullptr;
+	tile->m_layerDef.position = def->position;
+	tile->m_layerDef.userData = def->userData;
+	tile->m_layerDef.friction = def->friction;
+	tile->m_layerDef.restitution = def->restitution;
+	tile->m_layerDef.restitutionThreshold = def->restitutionThreshold;
+	tile->m_layerDef.filter = def->filter;
+	tile->m_layer = nullptr;
+	tile->m_removed = false;
+
+	// Add to the world doubly linked list.
+	tile->m_prev = nullptr;
+	tile->m_next = m_tileList;
+	if (m_tileList)
+	{
+		m_tileList->m_prev = tile;
+	}
+	m_tileList = tile;
+
+	// Append to the queue, so requests are served in order.
+	tile->m_queueNext = nullptr;
+	if (m_tileQueueTail)
+	{
+		m_tileQueueTail->m_queueNext = tile;
+	}
+	else
+	{
+		m_tileQueueHead = tile;
+	}
+	m_tileQueueTail = tile;
+	++m_tileQueueCount;
+
+	return tile;
+}
+
+void b2World::RemoveStaticTile(b2StaticTile* tile)
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
+	{
+		return;
+	}
+
+	b2Assert(tile->m_removed == false);
+	if (tile->m_removed)
+	{
+		return;
+	}
+
+	tile->m_removed = true;
+
+	// Remove from the world list.
+	if (tile->m_prev)
+	{
+		tile->m_prev->m_next = tile->m_next;
+	}
+
+	if (tile->m_next)
+	{
+		tile->m_next->m_prev = tile->m_prev;
+	}
+
+	if (tile == m_tileList)
+	{
+		m_tileList = tile->m_next;
+	}
+
+	// A tile that is still waiting to load is dropped when the queue reaches it.
+	if (tile->m_layer == nullptr)
+	{
+		return;
+	}
+
+	tile->m_queueNext = nullptr;
+	if (m_tileQueueTail)
+	{
+		m_tileQueueTail->m_queueNext = tile;
+	}
+	else
+	{
+		m_tileQueueHead = tile;
+	}
+	m_tileQueueTail = tile;
+	++m_tileQueueCount;
+}
+
+void b2World::FreeStaticTile(b2StaticTile* tile)
+{
+	b2Free(tile->m_chains);
+	b2Free(tile->m_data);
+	tile->~b2StaticTile();
+	m_blockAllocator.Free(tile, sizeof(b2StaticTile));
+}
+
+void b2World::UpdateStaticTiles()
+{
+	m_profile.tiles = 0.0f;
+
+	if (m_tileQueueHead == nullptr)
+	{
+		return;
+	}
+
+	b2TraceZone("tiles");
+	b2Timer timer;
+
+	// Serve at least one request, so the queue drains under any budget.
+	do
+	{
+		b2StaticTile* tile = m_tileQueueHead;
+		m_tileQueueHead = tile->m_queueNext;
+		if (m_tileQueueHead == nullptr)
+		{
+			m_tileQueueTail = nullptr;
+		}
+		tile->m_queueNext = nullptr;
+		--m_tileQueueCount;
+
+		if (tile->m_removed)
+		{
+			if (tile->m_layer)
+			{
+				DestroyStaticLayer(tile->m_layer);
+				tile->m_layer = nullptr;
+			}
+
+			FreeStaticTile(tile);
+			continue;
+		}
+
+		// Build the tile tree in one pass, then attach it as a layer.
+		int32 capacity = b2BuildStaticLayer(tile->m_chains, tile->m_chainCount, nullptr, 0);
+		tile->m_data = b2Alloc(capacity);
+		int32 size = b2BuildStaticLayer(tile->m_chains, tile->m_chainCount, tile->m_data, capacity);
+
+		b2Free(tile->m_chains);
+		tile->m_chains = nullptr;
+		tile->m_chainCount = 0;
+
+		tile->m_layerDef.data = tile->m_data;
+		tile->m_layerDef.size = size;
+		tile->m_layer = CreateStaticLayer(&tile->m_layerDef);
+		b2Assert(tile->m_layer != nullptr);
+	}
+	while (m_tileQueueHead != nullptr && (m_tileBudget <= 0.0f || timer.GetMilliseconds() < m_tileBudget));
+
+	m_profile.tiles = timer.GetMilliseconds();
+}
@@ -20,126 +20,72 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include "box2d/b2_distance.h"
 #include "box2d/b2_draw.h"
 #include "box2d/b2_rope.h"
+#include "box2d/b2_shape.h"
 
-#include <stdio.h>
-
-struct b2RopeStretch
-{
-	int32 i1, i2;
-	float invMass1, invMass2;
-	float L;
-	float lambda;
-	float spring;
-	float damper;
-};
-
-struct b2RopeBend
-{
-	int32 i1, i2, i3;
-	float invMass1, invMass2, invMass3;
-	float invEffectiveMass;
-	float lambda;
-	float L1, L2;
-	float alpha1, alpha2;
-	float spring;
-	float damper;
-};
-
-b2Rope::b2Rope()
-{
-	m_position.SetZero();
-	m_count = 0;
-	m_stretchCount = 0;
-	m_bendCount = 0;
-	m_stretchConstraints = nullptr;
-	m_bendConstraints = nullptr;
-	m_bindPositions = nullptr;
-	m_ps = nullptr;
-	m_p0s = nullptr;
-	m_vs = nullptr;
-	m_invMasses = nullptr;
-	m_gravity.SetZero();
-}
+#include "b2_rope_solver.h"
 
-b2Rope::~b2Rope()
-{
-	b2Free(m_stretchConstraints);
-	b2Free(m_bendConstraints);
-	b2Free(m_bindPositions);
-	b2Free(m_ps);
-	b2Free(m_p0s);
-	b2Free(m_vs);
-	b2Free(m_invMasses);
-}
+#include <stdio.h>
 
-void b2Rope::Create(const b2RopeDef& def)
+void b2InitializeRope(b2RopeData* data, const b2RopeDef& def)
 {
 	b2Assert(def.count >= 3);
-	m_position = def.position;
-	m_count = def.count;
-	m_bindPositions = (b2Vec2*)b2Alloc(m_count * sizeof(b2Vec2));
-	m_ps = (b2Vec2*)b2Alloc(m_count * sizeof(b2Vec2));
-	m_p0s = (b2Vec2*)b2Alloc(m_count * sizeof(b2Vec2));
-	m_vs = (b2Vec2*)b2Alloc(m_count * sizeof(b2Vec2));
-	m_invMasses = (float*)b2Alloc(m_count * sizeof(float));
+	b2Assert(data->count == def.count);
 
-	for (int32 i = 0; i < m_count; ++i)
+	for (int32 i = 0; i < data->count; ++i)
 	{
-		m_bindPositions[i] = def.vertices[i];
-		m_ps[i] = def.vertices[i] + m_position;
-		m_p0s[i] = def.vertices[i] + m_position;
-		m_vs[i].SetZero();
+		data->bindPositions[i] = def.vertices[i];
+		data->ps[i] = def.vertices[i] + def.position;
+		data->p0s[i] = def.vertices[i] + def.position;
+		data->vs[i].SetZero();
 
 		float m = def.masses[i];
 		if (m > 0.0f)
 		{
-			m_invMasses[i] = 1.0f / m;
+			data->invMasses[i] = 1.0f / m;
 		}
 		else
 		{
-			m_invMasses[i] = 0.0f;
+			data->invMasses[i] = 0.0f;
 		}
 	}
 
-	m_stretchCount = m_count - 1;
-	m_bendCount = m_count - 2;
-
-	m_stretchConstraints = (b2RopeStretch*)b2Alloc(m_stretchCount * sizeof(b2RopeStretch));
-	m_bendConstraints = (b2RopeBend*)b2Alloc(m_bendCount * sizeof(b2RopeBend));
+	b2Assert(data->stretchCount == data->count - 1);
+	b2Assert(data->bendCount == data->count - 2);
 
-	for (int32 i = 0; i < m_stretchCount; ++i)
+	for (int32 i = 0; i < data->stretchCount; ++i)
 	{
-		b2RopeStretch& c = m_stretchConstraints[i];
+		b2RopeStretch& c = data->stretchConstraints[i];
 
-		b2Vec2 p1 = m_ps[i];
-		b2Vec2 p2 = m_ps[i+1];
+		b2Vec2 p1 = data->ps[i];
+		b2Vec2 p2 = data->ps[i+1];
 
 		c.i1 = i;
 		c.i2 = i + 1;
 		c.L = b2Distance(p1, p2);
-		c.invMass1 = m_invMasses[i];
-		c.invMass2 = m_invMasses[i + 1];
+		c.invMass1 = data->invMasses[i];
+		c.invMass2 = data->invMasses[i + 1];
 		c.lambda = 0.0f;
 		c.damper = 0.0f;
 		c.spring = 0.0f;
 	}
 
-	for (int32 i = 0; i < m_bendCount; ++i)
+	for (int32 i = 0; i < data->bendCount; ++i)
 	{
-		b2RopeBend& c = m_bendConstraints[i];
+		b2RopeBend& c = data->bendConstraints[i];
 
-		b2Vec2 p1 = m_ps[i];
-		b2Vec2 p2 = m_ps[i + 1];
-		b2Vec2 p3 = m_ps[i + 2];
+		b2Vec2 p1 = data->ps[i];
+		b2Vec2 p2 = data->ps[i + 1];
+		b2Vec2 p3 = data->ps[i + 2];
 
 		c.i1 = i;
 		c.i2 = i + 1;
 		c.i3 = i + 2;
-		c.invMass1 = m_invMasses[i];
-		c.invMass2 = m_invMasses[i + 1];
-		c.invMass3 = m_invMasses[i + 2];
+		c.invMass1 = data->invMasses[i];
+		c.invMass2 = data->invMasses[i + 1];
+		c.invMass3 = data->invMasses[i + 2];
 		c.invEffectiveMass = 0.0f;
 		c.L1 = b2Distance(p1, p2);
 		c.L2 = b2Distance(p2, p3);
@@ -179,22 +125,20 @@ void b2Rope::Create(const b2RopeDef& def)
 		c.alpha2 = b2Dot(e1, r) / rr;
 	}
 
-	m_gravity = def.gravity;
-
-	SetTuning(def.tuning);
+	data->gravity = def.gravity;
 }
 
-void b2Rope::SetTuning(const b2RopeTuning& tuning)
+void b2TuneRope(b2RopeData* data)
 {
-	m_tuning = tuning;
+	const b2RopeTuning& tuning = *data->tuning;
 
 	// Pre-compute spring and damper values based on tuning
 
-	const float bendOmega = 2.0f * b2_pi * m_tuning.bendHertz;
+	const float bendOmega = 2.0f * b2_pi * tuning.bendHertz;
 
-	for (int32 i = 0; i < m_bendCount; ++i)
+	for (int32 i = 0; i < data->bendCount; ++i)
 	{
-		b2RopeBend& c = m_bendConstraints[i];
+		b2RopeBend& c = data->bendConstraints[i];
 
 		float L1sqr = c.L1 * c.L1;
 		float L2sqr = c.L2 * c.L2;
@@ -219,14 +163,14 @@ void b2Rope::SetTuning(const b2RopeTuning& tuning)
 		float mass = 1.0f / sum;
 
 		c.spring = mass * bendOmega * bendOmega;
-		c.damper = 2.0f * mass * m_tuning.bendDamping * bendOmega;
+		c.damper = 2.0f * mass * tuning.bendDamping * bendOmega;
 	}
 	
-	const float stretchOmega = 2.0f * b2_pi * m_tuning.stretchHertz;
+	const float stretchOmega = 2.0f * b2_pi * tuning.stretchHertz;
 
-	for (int32 i = 0; i < m_stretchCount; ++i)
+	for (int32 i = 0; i < data->stretchCount; ++i)
 	{
-		b2RopeStretch& c = m_stretchConstraints[i];
+		b2RopeStretch& c = data->stretchConstraints[i];
 
 		float sum = c.invMass1 + c.invMass2;
 		if (sum == 0.0f)
@@ -237,130 +181,20 @@ void b2Rope::SetTuning(const b2RopeTuning& tuning)
 		float mass = 1.0f / sum;
 
 		c.spring = mass * stretchOmega * stretchOmega;
-		c.damper = 2.0f * mass * m_tuning.stretchDamping * stretchOmega;
+		c.damper = 2.0f * mass * tuning.stretchDamping * stretchOmega;
 	}
 }
 
-void b2Rope::Step(float dt, int32 iterations, const b2Vec2& position)
+static void b2SolveStretch_PBD(b2RopeData* data, int32 start, int32 stride)
 {
-	if (dt == 0.0f)
-	{
-		return;
-	}
+	const float stiffness = data->tuning->stretchStiffness;
 
-	const float inv_dt = 1.0f / dt;
-	float d = expf(- dt * m_tuning.damping);
-
-	// Apply gravity and damping
-	for (int32 i = 0; i < m_count; ++i)
+	for (int32 i = start; i < data->stretchCount; i += stride)
 	{
-		if (m_invMasses[i] > 0.0f)
-		{
-			m_vs[i] *= d;
-			m_vs[i] += dt * m_gravity;
-		}
-		else
-		{
-			m_vs[i] = inv_dt * (m_bindPositions[i] + position - m_p0s[i]);
-		}
-	}
+		const b2RopeStretch& c = data->stretchConstraints[i];
 
-	// Apply bending spring
-	if (m_tuning.bendingModel == b2_springAngleBendingModel)
-	{
-		ApplyBendForces(dt);
-	}
-
-	for (int32 i = 0; i < m_bendCount; ++i)
-	{
-		m_bendConstraints[i].lambda = 0.0f;
-	}
-
-	for (int32 i = 0; i < m_stretchCount; ++i)
-	{
-		m_stretchConstraints[i].lambda = 0.0f;
-	}
-
-	// Update position
-	for (int32 i = 0; i < m_count; ++i)
-	{
-		m_ps[i] += dt * m_vs[i];
-	}
-
-	// Solve constraints
-	for (int32 i = 0; i < iterations; ++i)
-	{
-		if (m_tuning.bendingModel == b2_pbdAngleBendingModel)
-		{
-			SolveBend_PBD_Angle();
-		}
-		else if (m_tuning.bendingModel == b2_xpbdAngleBendingModel)
-		{
-			SolveBend_XPBD_Angle(dt);
-		}
-		else if (m_tuning.bendingModel == b2_pbdDistanceBendingModel)
-		{
-			SolveBend_PBD_Distance();
-		}
-		else if (m_tuning.bendingModel == b2_pbdHeightBendingModel)
-		{
-			SolveBend_PBD_Height();
-		}
-		else if (m_tuning.bendingModel == b2_pbdTriangleBendingModel)
-		{
-			SolveBend_PBD_Triangle();
-		}
-
-		if (m_tuning.stretchingModel == b2_pbdStretchingModel)
-		{
-			SolveStretch_PBD();
-		}
-		else if (m_tuning.stretchingModel == b2_xpbdStretchingModel)
-		{
-			SolveStretch_XPBD(dt);
-		}
-	}
-
-	// Constrain velocity
-	for (int32 i = 0; i < m_count; ++i)
-	{
-		m_vs[i] = inv_dt * (m_ps[i] - m_p0s[i]);
-		m_p0s[i] = m_ps[i];
-	}
-}
-
-void b2Rope::Reset(const b2Vec2& position)
-{
-	m_position = position;
-
-	for (int32 i = 0; i < m_count; ++i)
-	{
-		m_ps[i] = m_bindPositions[i] + m_position;
-		m_p0s[i] = m_bindPositions[i] + m_position;
-		m_vs[i].SetZero();
-	}
-
-	for (int32 i = 0; i < m_bendCount; ++i)
-	{
-		m_bendConstraints[i].lambda = 0.0f;
-	}
-
-	for (int32 i = 0; i < m_stretchCount; ++i)
-	{
-		m_stretchConstraints[i].lambda = 0.0f;
-	}
-}
-
-void b2Rope::SolveStretch_PBD()
-{
-	const float stiffness = m_tuning.stretchStiffness;
-
-	for (int32 i = 0; i < m_stretchCount; ++i)
-	{
-		const b2RopeStretch& c = m_stretchConstraints[i];
-
-		b2Vec2 p1 = m_ps[c.i1];
-		b2Vec2 p2 = m_ps[c.i2];
+		b2Vec2 p1 = data->ps[c.i1];
+		b2Vec2 p2 = data->ps[c.i2];
 
 		b2Vec2 d = p2 - p1;
 		float L = d.Normalize();
@@ -377,24 +211,24 @@ void b2Rope::SolveStretch_PBD()
 		p1 -= stiffness * s1 * (c.L - L) * d;
 		p2 += stiffness * s2 * (c.L - L) * d;
 
-		m_ps[c.i1] = p1;
-		m_ps[c.i2] = p2;
+		data->ps[c.i1] = p1;
+		data->ps[c.i2] = p2;
 	}
 }
 
-void b2Rope::SolveStretch_XPBD(float dt)
+static void b2SolveStretch_XPBD(b2RopeData* data, float dt, int32 start, int32 stride)
 {
 	b2Assert(dt > 0.0f);
 
-	for (int32 i = 0; i < m_stretchCount; ++i)
+	for (int32 i = start; i < data->stretchCount; i += stride)
 	{
-		b2RopeStretch& c = m_stretchConstraints[i];
+		b2RopeStretch& c = data->stretchConstraints[i];
 
-		b2Vec2 p1 = m_ps[c.i1];
-		b2Vec2 p2 = m_ps[c.i2];
+		b2Vec2 p1 = data->ps[c.i1];
+		b2Vec2 p2 = data->ps[c.i2];
 
-		b2Vec2 dp1 = p1 - m_p0s[c.i1];
-		b2Vec2 dp2 = p2 - m_p0s[c.i2];
+		b2Vec2 dp1 = p1 - data->p0s[c.i1];
+		b2Vec2 dp2 = p2 - data->p0s[c.i2];
 
 		b2Vec2 u = p2 - p1;
 		float L = u.Normalize();
@@ -424,23 +258,23 @@ void b2Rope::SolveStretch_XPBD(float dt)
 		p1 += (c.invMass1 * impulse) * J1;
 		p2 += (c.invMass2 * impulse) * J2;
 
-		m_ps[c.i1] = p1;
-		m_ps[c.i2] = p2;
+		data->ps[c.i1] = p1;
+		data->ps[c.i2] = p2;
 		c.lambda += impulse;
 	}
 }
 
-void b2Rope::SolveBend_PBD_Angle()
+static void b2SolveBend_PBD_Angle(b2RopeData* data, int32 start, int32 stride)
 {
-	const float stiffness = m_tuning.bendStiffness;
+	const float stiffness = data->tuning->bendStiffness;
 
-	for (int32 i = 0; i < m_bendCount; ++i)
+	for (int32 i = start; i < data->bendCount; i += stride)
 	{
-		const b2RopeBend& c = m_bendConstraints[i];
+		const b2RopeBend& c = data->bendConstraints[i];
 
-		b2Vec2 p1 = m_ps[c.i1];
-		b2Vec2 p2 = m_ps[c.i2];
-		b2Vec2 p3 = m_ps[c.i3];
+		b2Vec2 p1 = data->ps[c.i1];
+		b2Vec2 p2 = data->ps[c.i2];
+		b2Vec2 p3 = data->ps[c.i3];
 
 		b2Vec2 d1 = p2 - p1;
 		b2Vec2 d2 = p3 - p2;
@@ -451,7 +285,7 @@ void b2Rope::SolveBend_PBD_Angle()
 
 		float L1sqr, L2sqr;
 		
-		if (m_tuning.isometric)
+		if (data->tuning->isometric)
 		{
 			L1sqr = c.L1 * c.L1;
 			L2sqr = c.L2 * c.L2;
@@ -475,7 +309,7 @@ void b2Rope::SolveBend_PBD_Angle()
 		b2Vec2 J3 = Jd2;
 
 		float sum;
-		if (m_tuning.fixedEffectiveMass)
+		if (data->tuning->fixedEffectiveMass)
 		{
 			sum = c.invEffectiveMass;
 		}
@@ -495,34 +329,34 @@ void b2Rope::SolveBend_PBD_Angle()
 		p2 += (c.invMass2 * impulse) * J2;
 		p3 += (c.invMass3 * impulse) * J3;
 
-		m_ps[c.i1] = p1;
-		m_ps[c.i2] = p2;
-		m_ps[c.i3] = p3;
+		data->ps[c.i1] = p1;
+		data->ps[c.i2] = p2;
+		data->ps[c.i3] = p3;
 	}
 }
 
-void b2Rope::SolveBend_XPBD_Angle(float dt)
+static void b2SolveBend_XPBD_Angle(b2RopeData* data, float dt, int32 start, int32 stride)
 {
 	b2Assert(dt > 0.0f);
 
-	for (int32 i = 0; i < m_bendCount; ++i)
+	for (int32 i = start; i < data->bendCount; i += stride)
 	{
-		b2RopeBend& c = m_bendConstraints[i];
+		b2RopeBend& c = data->bendConstraints[i];
 
-		b2Vec2 p1 = m_ps[c.i1];
-		b2Vec2 p2 = m_ps[c.i2];
-		b2Vec2 p3 = m_ps[c.i3];
+		b2Vec2 p1 = data->ps[c.i1];
+		b2Vec2 p2 = data->ps[c.i2];
+		b2Vec2 p3 = data->ps[c.i3];
 
-		b2Vec2 dp1 = p1 - m_p0s[c.i1];
-		b2Vec2 dp2 = p2 - m_p0s[c.i2];
-		b2Vec2 dp3 = p3 - m_p0s[c.i3];
+		b2Vec2 dp1 = p1 - data->p0s[c.i1];
+		b2Vec2 dp2 = p2 - data->p0s[c.i2];
+		b2Vec2 dp3 = p3 - data->p0s[c.i3];
 
 		b2Vec2 d1 = p2 - p1;
 		b2Vec2 d2 = p3 - p2;
 
 		float L1sqr, L2sqr;
 
-		if (m_tuning.isometric)
+		if (data->tuning->isometric)
 		{
 			L1sqr = c.L1 * c.L1;
 			L2sqr = c.L2 * c.L2;
@@ -551,7 +385,7 @@ void b2Rope::SolveBend_XPBD_Angle(float dt)
 		b2Vec2 J3 = Jd2;
 
 		float sum;
-		if (m_tuning.fixedEffectiveMass)
+		if (data->tuning->fixedEffectiveMass)
 		{
 			sum = c.invEffectiveMass;
 		}
@@ -582,36 +416,36 @@ void b2Rope::SolveBend_XPBD_Angle(float dt)
 		p2 += (c.invMass2 * impulse) * J2;
 		p3 += (c.invMass3 * impulse) * J3;
 
-		m_ps[c.i1] = p1;
-		m_ps[c.i2] = p2;
-		m_ps[c.i3] = p3;
+		data->ps[c.i1] = p1;
+		data->ps[c.i2] = p2;
+		data->ps[c.i3] = p3;
 		c.lambda += impulse;
 	}
 }
 
-void b2Rope::ApplyBendForces(float dt)
+static void b2ApplyBendForces(b2RopeData* data, float dt, int32 start, int32 stride)
 {
 	// omega = 2 * pi * hz
-	const float omega = 2.0f * b2_pi * m_tuning.bendHertz;
+	const float omega = 2.0f * b2_pi * data->tuning->bendHertz;
 
-	for (int32 i = 0; i < m_bendCount; ++i)
+	for (int32 i = start; i < data->bendCount; i += stride)
 	{
-		const b2RopeBend& c = m_bendConstraints[i];
+		const b2RopeBend& c = data->bendConstraints[i];
 
-		b2Vec2 p1 = m_ps[c.i1];
-		b2Vec2 p2 = m_ps[c.i2];
-		b2Vec2 p3 = m_ps[c.i3];
+		b2Vec2 p1 = data->ps[c.i1];
+		b2Vec2 p2 = data->ps[c.i2];
+		b2Vec2 p3 = data->ps[c.i3];
 
-		b2Vec2 v1 = m_vs[c.i1];
-		b2Vec2 v2 = m_vs[c.i2];
-		b2Vec2 v3 = m_vs[c.i3];
+		b2Vec2 v1 = data->vs[c.i1];
+		b2Vec2 v2 = data->vs[c.i2];
+		b2Vec2 v3 = data->vs[c.i3];
 
 		b2Vec2 d1 = p2 - p1;
 		b2Vec2 d2 = p3 - p2;
 
 		float L1sqr, L2sqr;
 
-		if (m_tuning.isometric)
+		if (data->tuning->isometric)
 		{
 			L1sqr = c.L1 * c.L1;
 			L2sqr = c.L2 * c.L2;
@@ -640,7 +474,7 @@ void b2Rope::ApplyBendForces(float dt)
 		b2Vec2 J3 = Jd2;
 
 		float sum;
-		if (m_tuning.fixedEffectiveMass)
+		if (data->tuning->fixedEffectiveMass)
 		{
 			sum = c.invEffectiveMass;
 		}
@@ -657,32 +491,32 @@ void b2Rope::ApplyBendForces(float dt)
 		float mass = 1.0f / sum;
 
 		const float spring = mass * omega * omega;
-		const float damper = 2.0f * mass * m_tuning.bendDamping * omega;
+		const float damper = 2.0f * mass * data->tuning->bendDamping * omega;
 
 		float C = angle;
 		float Cdot = b2Dot(J1, v1) + b2Dot(J2, v2) + b2Dot(J3, v3);
 
 		float impulse = -dt * (spring * C + damper * Cdot);
 
-		m_vs[c.i1] += (c.invMass1 * impulse) * J1;
-		m_vs[c.i2] += (c.invMass2 * impulse) * J2;
-		m_vs[c.i3] += (c.invMass3 * impulse) * J3;
+		data->vs[c.i1] += (c.invMass1 * impulse) * J1;
+		data->vs[c.i2] += (c.invMass2 * impulse) * J2;
+		data->vs[c.i3] += (c.invMass3 * impulse) * J3;
 	}
 }
 
-void b2Rope::SolveBend_PBD_Distance()
+static void b2SolveBend_PBD_Distance(b2RopeData* data, int32 start, int32 stride)
 {
-	const float stiffness = m_tuning.bendStiffness;
+	const float stiffness = data->tuning->bendStiffness;
 
-	for (int32 i = 0; i < m_bendCount; ++i)
+	for (int32 i = start; i < data->bendCount; i += stride)
 	{
-		const b2RopeBend& c = m_bendConstraints[i];
+		const b2RopeBend& c = data->bendConstraints[i];
 
 		int32 i1 = c.i1;
 		int32 i2 = c.i3;
 
-		b2Vec2 p1 = m_ps[i1];
-		b2Vec2 p2 = m_ps[i2];
+		b2Vec2 p1 = data->ps[i1];
+		b2Vec2 p2 = data->ps[i2];
 
 		b2Vec2 d = p2 - p1;
 		float L = d.Normalize();
@@ -699,24 +533,24 @@ void b2Rope::SolveBend_PBD_Distance()
 		p1 -= stiffness * s1 * (c.L1 + c.L2 - L) * d;
 		p2 += stiffness * s2 * (c.L1 + c.L2 - L) * d;
 
-		m_ps[i1] = p1;
-		m_ps[i2] = p2;
+		data->ps[i1] = p1;
+		data->ps[i2] = p2;
 	}
 }
 
 // Constraint based implementation of:
 // P. Volino: Simple Linear Bending Stiffness in Particle Systems
-void b2Rope::SolveBend_PBD_Height()
+static void b2SolveBend_PBD_Height(b2RopeData* data, int32 start, int32 stride)
 {
-	const float stiffness = m_tuning.bendStiffness;
+	const float stiffness = data->tuning->bendStiffness;
 
-	for (int32 i = 0; i < m_bendCount; ++i)
+	for (int32 i = start; i < data->bendCount; i += stride)
 	{
-		const b2RopeBend& c = m_bendConstraints[i];
+		const b2RopeBend& c = data->bendConstraints[i];
 
-		b2Vec2 p1 = m_ps[c.i1];
-		b2Vec2 p2 = m_ps[c.i2];
-		b2Vec2 p3 = m_ps[c.i3];
+		b2Vec2 p1 = data->ps[c.i1];
+		b2Vec2 p2 = data->ps[c.i2];
+		b2Vec2 p3 = data->ps[c.i3];
 
 		// Barycentric coordinates are held constant
 		b2Vec2 d = c.alpha1 * p1 + c.alpha2 * p3 - p2;
@@ -748,24 +582,24 @@ void b2Rope::SolveBend_PBD_Height()
 		p2 += (c.invMass2 * impulse) * J2;
 		p3 += (c.invMass3 * impulse) * J3;
 
-		m_ps[c.i1] = p1;
-		m_ps[c.i2] = p2;
-		m_ps[c.i3] = p3;
+		data->ps[c.i1] = p1;
+		data->ps[c.i2] = p2;
+		data->ps[c.i3] = p3;
 	}
 }
 
 // M. Kelager: A Triangle Bending Constraint Model for PBD
-void b2Rope::SolveBend_PBD_Triangle()
+static void b2SolveBend_PBD_Triangle(b2RopeData* data, int32 start, int32 stride)
 {
-	const float stiffness = m_tuning.bendStiffness;
+	const float stiffness = data->tuning->bendStiffness;
 
-	for (int32 i = 0; i < m_bendCount; ++i)
+	for (int32 i = start; i < data->bendCount; i += stride)
 	{
-		const b2RopeBend& c = m_bendConstraints[i];
+		const b2RopeBend& c = data->bendConstraints[i];
 
-		b2Vec2 b0 = m_ps[c.i1];
-		b2Vec2 v = m_ps[c.i2];
-		b2Vec2 b1 = m_ps[c.i3];
+		b2Vec2 b0 = data->ps[c.i1];
+		b2Vec2 v = data->ps[c.i2];
+		b2Vec2 b1 = data->ps[c.i3];
 
 		float wb0 = c.invMass1;
 		float wv = c.invMass2;
@@ -784,26 +618,516 @@ void b2Rope::SolveBend_PBD_Triangle()
 		v += dv;
 		b1 += db1;
 
-		m_ps[c.i1] = b0;
-		m_ps[c.i2] = v;
-		m_ps[c.i3] = b1;
+		data->ps[c.i1] = b0;
+		data->ps[c.i2] = v;
+		data->ps[c.i3] = b1;
 	}
 }
 
-void b2Rope::Draw(b2Draw* draw) const
+// Pull attached particles and body anchors together. The anchor is moved by its share
+// of the correction so later iterations see the body response.
+static void b2SolveAttachments(b2RopeData* data, float inv_dt)
+{
+	for (int32 i = 0; i < data->attachmentCount; ++i)
+	{
+		b2RopeAttachment& a = data->attachments[i];
+
+		b2Vec2 p = data->ps[a.index];
+		float w = data->invMasses[a.index];
+
+		if (w == 0.0f)
+		{
+			data->ps[a.index] = a.target;
+			continue;
+		}
+
+		b2Vec2 d = p - a.target;
+		float L = d.Normalize();
+		if (L < b2_epsilon)
+		{
+			continue;
+		}
+
+		float rn = b2Cross(a.target - a.center, d);
+		float wb = a.invMass + a.invI * rn * rn;
+		float lambda = -L / (w + wb);
+
+		data->ps[a.index] = p + (w * lambda) * d;
+		a.target -= (wb * lambda) * d;
+
+		b2Vec2 P = (-lambda * inv_dt) * d;
+		a.linearImpulse += P;
+		a.angularImpulse += b2Cross(a.target - a.center, P);
+	}
+}
+
+// Find a push out plane for a particle inside the core of a collider. The particle
+// position at the start of the step was usually outside, so the normal found there is
+// used. Otherwise the particle is pushed out perpendicular to the rope, away from the
+// collider, onto the supporting plane of the shape in that direction. The start position
+// is moved out as well so the push does not become velocity.
+static void b2FindDeepRopeContact(b2RopeData* data, int32 index, const b2RopeCollider& collider,
+	b2Vec2* normal, b2Vec2* point)
+{
+	b2Vec2 p0 = data->p0s[index];
+
+	b2DistanceInput input;
+	input.proxyA.Set(collider.shape, collider.childIndex);
+	input.proxyB.Set(&p0, 1, 0.0f);
+	input.transformA = collider.xf;
+	input.transformB.SetIdentity();
+	input.useRadii = false;
+
+	const b2DistanceProxy& proxy = input.proxyA;
+	float shapeRadius = proxy.m_radius;
+
+	b2SimplexCache cache;
+	cache.count = 0;
+	b2DistanceOutput output;
+	b2Distance(&output, &cache, &input);
+
+	if (output.distance >= b2_epsilon)
+	{
+		*normal = (1.0f / output.distance) * (output.pointB - output.pointA);
+		*point = output.pointA + shapeRadius * (*normal);
+		return;
+	}
+
+	int32 i1 = b2Max(index - 1, 0);
+	int32 i2 = b2Min(index + 1, data->count - 1);
+	b2Vec2 n = b2Cross(1.0f, data->ps[i2] - data->ps[i1]);
+	if (n.Normalize() < b2_epsilon)
+	{
+		n.Set(0.0f, 1.0f);
+	}
+
+	if (b2Dot(n, data->ps[index] - collider.aabb.GetCenter()) < 0.0f)
+	{
+		n = -n;
+	}
+
+	b2Vec2 v = proxy.GetSupportVertex(b2MulT(collider.xf.q, n));
+	*normal = n;
+	*point = b2Mul(collider.xf, v) + shapeRadius * n;
+
+	float C0 = b2Dot(n, p0 - *point) - data->radius;
+	if (C0 < 0.0f)
+	{
+		data->p0s[index] = p0 - C0 * n;
+	}
+}
+
+// Particles do not collide with the bodies they are attached to.
+static bool b2IsRopeAttached(const b2RopeData* data, int32 index, const b2Body* body)
+{
+	for (int32 i = 0; i < data->attachmentCount; ++i)
+	{
+		if (data->attachments[i].index == index && data->attachments[i].body == body)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// Find the particles near colliders. This runs once per step on the predicted positions.
+static int32 b2FindRopeContacts(b2RopeData* data, float wakeSpeed)
+{
+	int32 contactCount = 0;
+	const float radius = data->radius;
+
+	for (int32 i = 0; i < data->count; ++i)
+	{
+		if (data->invMasses[i] == 0.0f)
+		{
+			continue;
+		}
+
+		b2Vec2 p = data->ps[i];
+		b2AABB aabb;
+		aabb.lowerBound.Set(p.x - radius, p.y - radius);
+		aabb.upperBound.Set(p.x + radius, p.y + radius);
+
+		for (int32 j = 0; j < data->colliderCount && contactCount < data->contactCapacity; ++j)
+		{
+			const b2RopeCollider& collider = data->colliders[j];
+			if (b2TestOverlap(aabb, collider.aabb) == false || b2IsRopeAttached(data, i, collider.body))
+			{
+				continue;
+			}
+
+			b2DistanceInput input;
+			input.proxyA.Set(collider.shape, collider.childIndex);
+			input.proxyB.Set(&p, 1, 0.0f);
+			input.transformA = collider.xf;
+			input.transformB.SetIdentity();
+			input.useRadii = false;
+
+			b2SimplexCache cache;
+			cache.count = 0;
+			b2DistanceOutput output;
+			b2Distance(&output, &cache, &input);
+
+			float shapeRadius = input.proxyA.m_radius;
+			if (output.distance > shapeRadius + radius + b2_linearSlop)
+			{
+				continue;
+			}
+
+			b2Vec2 normal, point;
+			if (output.distance >= b2_epsilon)
+			{
+				normal = (1.0f / output.distance) * (output.pointB - output.pointA);
+				point = output.pointA + shapeRadius * normal;
+			}
+			else
+			{
+				// The particle is inside the core shape, so the closest point gives no normal.
+				b2FindDeepRopeContact(data, i, collider, &normal, &point);
+			}
+
+			if (-b2Dot(data->vs[i], normal) > wakeSpeed)
+			{
+				data->colliders[j].wake = true;
+			}
+
+			b2RopeContact& c = data->contacts[contactCount];
+			c.index = i;
+			c.collider = j;
+			c.normal = normal;
+			c.point = point;
+
+			float rn = b2Cross(c.point - collider.center, normal);
+			c.invMass = collider.invMass + collider.invI * rn * rn;
+
+			++contactCount;
+		}
+	}
+
+	return contactCount;
+}
+
+// Push particles out of colliders with position based friction.
+static void b2SolveContacts(b2RopeData* data, int32 contactCount, float inv_dt)
+{
+	const float radius = data->radius;
+
+	for (int32 i = 0; i < contactCount; ++i)
+	{
+		b2RopeContact& c = data->contacts[i];
+		b2RopeCollider& collider = data->colliders[c.collider];
+
+		b2Vec2 p = data->ps[c.index];
+		float w = data->invMasses[c.index];
+
+		float C = b2Dot(c.normal, p - c.point) - radius;
+		if (C >= 0.0f)
+		{
+			continue;
+		}
+
+		float sum = w + c.invMass;
+		float lambda = -C / sum;
+
+		b2Vec2 P = lambda * c.normal;
+		p += w * P;
+		c.point -= c.invMass * P;
+
+		// Remove tangential motion up to the friction cone
+		b2Vec2 dp = p - data->p0s[c.index];
+		b2Vec2 tangent = dp - b2Dot(dp, c.normal) * c.normal;
+		float slip = tangent.Length();
+		float maxSlip = collider.friction * lambda * sum;
+		if (slip > maxSlip && slip > 0.0f)
+		{
+			tangent *= maxSlip / slip;
+		}
+
+		b2Vec2 Pt = (-1.0f / sum) * tangent;
+		p += w * Pt;
+		P += Pt;
+
+		data->ps[c.index] = p;
+
+		P = -inv_dt * P;
+		collider.linearImpulse += P;
+		collider.angularImpulse += b2Cross(c.point - collider.center, P);
+	}
+}
+
+// Stretch constraints i and i + 2 share no particles. Bend constraints i and i + 3 share no particles.
+static const int32 b2_ropeStretchColors = 2;
+static const int32 b2_ropeBendColors = 3;
+
+void b2StepRope(b2RopeData* data, float dt, int32 iterations, const b2Vec2& position, bool colored)
+{
+	if (dt == 0.0f)
+	{
+		return;
+	}
+
+	const b2RopeTuning& tuning = *data->tuning;
+	const int32 count = data->count;
+	b2Vec2* ps = data->ps;
+	b2Vec2* p0s = data->p0s;
+	b2Vec2* vs = data->vs;
+
+	const int32 stretchColors = colored ? b2_ropeStretchColors : 1;
+	const int32 bendColors = colored ? b2_ropeBendColors : 1;
+
+	const float inv_dt = 1.0f / dt;
+	float d = b2Exp(- dt * tuning.damping);
+
+	// Apply gravity and damping
+	for (int32 i = 0; i < count; ++i)
+	{
+		if (data->invMasses[i] > 0.0f)
+		{
+			vs[i] *= d;
+			vs[i] += dt * data->gravity;
+		}
+		else
+		{
+			vs[i] = inv_dt * (data->bindPositions[i] + position - p0s[i]);
+		}
+	}
+
+	// A resting particle gains gravity each step, which must not wake the bodies it
+	// touches or hangs from.
+	float wakeSpeed = b2_linearSleepTolerance + dt * data->gravity.Length();
+	for (int32 i = 0; i < data->attachmentCount; ++i)
+	{
+		b2RopeAttachment& a = data->attachments[i];
+		a.wake = vs[a.index].Length() > wakeSpeed;
+	}
+
+	// Apply bending spring
+	if (tuning.bendingModel == b2_springAngleBendingModel)
+	{
+		for (int32 color = 0; color < bendColors; ++color)
+		{
+			b2ApplyBendForces(data, dt, color, bendColors);
+		}
+	}
+
+	for (int32 i = 0; i < data->bendCount; ++i)
+	{
+		data->bendConstraints[i].lambda = 0.0f;
+	}
+
+	for (int32 i = 0; i < data->stretchCount; ++i)
+	{
+		data->stretchConstraints[i].lambda = 0.0f;
+	}
+
+	// Update position
+	for (int32 i = 0; i < count; ++i)
+	{
+		ps[i] += dt * vs[i];
+	}
+
+	int32 contactCount = 0;
+	if (data->colliderCount > 0)
+	{
+		contactCount = b2FindRopeContacts(data, wakeSpeed);
+	}
+
+	// Solve constraints
+	for (int32 i = 0; i < iterations; ++i)
+	{
+		for (int32 color = 0; color < bendColors; ++color)
+		{
+			if (tuning.bendingModel == b2_pbdAngleBendingModel)
+			{
+				b2SolveBend_PBD_Angle(data, color, bendColors);
+			}
+			else if (tuning.bendingModel == b2_xpbdAngleBendingModel)
+			{
+				b2SolveBend_XPBD_Angle(data, dt, color, bendColors);
+			}
+			else if (tuning.bendingModel == b2_pbdDistanceBendingModel)
+			{
+				b2SolveBend_PBD_Distance(data, color, bendColors);
+			}
+			else if (tuning.bendingModel == b2_pbdHeightBendingModel)
+			{
+				b2SolveBend_PBD_Height(data, color, bendColors);
+			}
+			else if (tuning.bendingModel == b2_pbdTriangleBendingModel)
+			{
+				b2SolveBend_PBD_Triangle(data, color, bendColors);
+			}
+		}
+
+		for (int32 color = 0; color < stretchColors; ++color)
+		{
+			if (tuning.stretchingModel == b2_pbdStretchingModel)
+			{
+				b2SolveStretch_PBD(data, color, stretchColors);
+			}
+			else if (tuning.stretchingModel == b2_xpbdStretchingModel)
+			{
+				b2SolveStretch_XPBD(data, dt, color, stretchColors);
+			}
+		}
+
+		b2SolveAttachments(data, inv_dt);
+		b2SolveContacts(data, contactCount, inv_dt);
+	}
+
+	// Constrain velocity
+	for (int32 i = 0; i < count; ++i)
+	{
+		vs[i] = inv_dt * (ps[i] - p0s[i]);
+		p0s[i] = ps[i];
+	}
+}
+
+void b2ResetRope(b2RopeData* data, const b2Vec2& position)
+{
+	for (int32 i = 0; i < data->count; ++i)
+	{
+		data->ps[i] = data->bindPositions[i] + position;
+		data->p0s[i] = data->bindPositions[i] + position;
+		data->vs[i].SetZero();
+	}
+
+	for (int32 i = 0; i < data->bendCount; ++i)
+	{
+		data->bendConstraints[i].lambda = 0.0f;
+	}
+
+	for (int32 i = 0; i < data->stretchCount; ++i)
+	{
+		data->stretchConstraints[i].lambda = 0.0f;
+	}
+}
+
+void b2DrawRope(const b2RopeData* data, b2Draw* draw)
 {
 	b2Color c(0.4f, 0.5f, 0.7f);
 	b2Color pg(0.1f, 0.8f, 0.1f);
 	b2Color pd(0.7f, 0.2f, 0.4f);
 
-	for (int32 i = 0; i < m_count - 1; ++i)
+	const int32 count = data->count;
+	const b2Vec2* ps = data->ps;
+
+	for (int32 i = 0; i < count - 1; ++i)
 	{
-		draw->DrawSegment(m_ps[i], m_ps[i+1], c);
+		draw->DrawSegment(ps[i], ps[i+1], c);
 
-		const b2Color& pc = m_invMasses[i] > 0.0f ? pd : pg;
-		draw->DrawPoint(m_ps[i], 5.0f, pc);
+		const b2Color& pc = data->invMasses[i] > 0.0f ? pd : pg;
+		draw->DrawPoint(ps[i], 5.0f, pc);
 	}
 
-	const b2Color& pc = m_invMasses[m_count - 1] > 0.0f ? pd : pg;
-	draw->DrawPoint(m_ps[m_count - 1], 5.0f, pc);
+	const b2Color& pc = data->invMasses[count - 1] > 0.0f ? pd : pg;
+	draw->DrawPoint(ps[count - 1], 5.0f, pc);
+}
+
+b2Rope::b2Rope()
+{
+	m_position.SetZero();
+	m_count = 0;
+	m_stretchCount = 0;
+	m_bendCount = 0;
+	m_stretchConstraints = nullptr;
+	m_bendConstraints = nullptr;
+	m_bindPositions = nullptr;
+	m_ps = nullptr;
+	m_p0s = nullptr;
+	m_vs = nullptr;
+	m_invMasses = nullptr;
+	m_gravity.SetZero();
+}
+
+b2Rope::~b2Rope()
+{
+	b2Free(m_stretchConstraints);
+	b2Free(m_bendConstraints);
+	b2Free(m_bindPositions);
+	b2Free(m_ps);
+	b2Free(m_p0s);
+	b2Free(m_vs);
+	b2Free(m_invMasses);
+}
+
+void b2Rope::GetData(b2RopeData* data) const
+{
+	data->bindPositions = m_bindPositions;
+	data->ps = m_ps;
+	data->p0s = m_p0s;
+	data->vs = m_vs;
+	data->invMasses = m_invMasses;
+	data->stretchConstraints = m_stretchConstraints;
+	data->bendConstraints = m_bendConstraints;
+	data->count = m_count;
+	data->stretchCount = m_stretchCount;
+	data->bendCount = m_bendCount;
+	data->gravity = m_gravity;
+	data->tuning = &m_tuning;
+	data->attachments = nullptr;
+	data->colliders = nullptr;
+	data->contacts = nullptr;
+	data->attachmentCount = 0;
+	data->colliderCount = 0;
+	data->contactCapacity = 0;
+	data->radius = 0.0f;
+}
+
+void b2Rope::Create(const b2RopeDef& def)
+{
+	b2Assert(def.count >= 3);
+	m_position = def.position;
+	m_count = def.count;
+	m_bindPositions = (b2Vec2*)b2Alloc(m_count * sizeof(b2Vec2));
+	m_ps = (b2Vec2*)b2Alloc(m_count * sizeof(b2Vec2));
+	m_p0s = (b2Vec2*)b2Alloc(m_count * sizeof(b2Vec2));
+	m_vs = (b2Vec2*)b2Alloc(m_count * sizeof(b2Vec2));
+	m_invMasses = (float*)b2Alloc(m_count * sizeof(float));
+
+	m_stretchCount = m_count - 1;
+	m_bendCount = m_count - 2;
+
+	m_stretchConstraints = (b2RopeStretch*)b2Alloc(m_stretchCount * sizeof(b2RopeStretch));
+	m_bendConstraints = (b2RopeBend*)b2Alloc(m_bendCount * sizeof(b2RopeBend));
+
+	b2RopeData data;
+	GetData(&data);
+	b2InitializeRope(&data, def);
+
+	m_gravity = def.gravity;
+
+	SetTuning(def.tuning);
+}
+
+void b2Rope::SetTuning(const b2RopeTuning& tuning)
+{
+	m_tuning = tuning;
+
+	b2RopeData data;
+	GetData(&data);
+	b2TuneRope(&data);
+}
+
+void b2Rope::Step(float dt, int32 iterations, const b2Vec2& position)
+{
+	b2RopeData data;
+	GetData(&data);
+	b2StepRope(&data, dt, iterations, position, false);
+}
+
+void b2Rope::Reset(const b2Vec2& position)
+{
+	m_position = position;
+
+	b2RopeData data;
+	GetData(&data);
+	b2ResetRope(&data, position);
+}
+
+void b2Rope::Draw(b2Draw* draw) const
+{
+	b2RopeData data;
+	GetData(&data);
+	b2DrawRope(&data, draw);
 }
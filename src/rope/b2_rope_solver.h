@@ -0,0 +1,147 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef B2_ROPE_SOLVER_H
+#define B2_ROPE_SOLVER_H
+
+#include "box2d/b2_collision.h"
+#include "box2d/b2_math.h"
+#include "box2d/b2_rope.h"
+
+class b2Body;
+class b2Shape;
+
+struct b2RopeStretch
+{
+	int32 i1, i2;
+	float invMass1, invMass2;
+	float L;
+	float lambda;
+	float spring;
+	float damper;
+};
+
+struct b2RopeBend
+{
+	int32 i1, i2, i3;
+	float invMass1, invMass2, invMass3;
+	float invEffectiveMass;
+	float lambda;
+	float L1, L2;
+	float alpha1, alpha2;
+	float spring;
+	float damper;
+};
+
+/// A particle pinned to a body anchor. The anchor moves with the body and
+/// the reaction impulse is accumulated for the body.
+struct b2RopeAttachment
+{
+	int32 index;
+	b2Body* body;
+	b2Vec2 target;
+	b2Vec2 center;
+	float invMass, invI;
+	b2Vec2 linearImpulse;
+	float angularImpulse;
+
+	/// Set when the particle moves fast enough to wake a sleeping body.
+	bool wake;
+};
+
+/// A fixture child near a rope, gathered from the broad-phase before the rope is solved.
+struct b2RopeCollider
+{
+	const b2Shape* shape;
+	int32 childIndex;
+	b2Transform xf;
+	b2AABB aabb;
+	b2Body* body;
+	b2Vec2 center;
+	float invMass, invI;
+	float friction;
+	b2Vec2 linearImpulse;
+	float angularImpulse;
+
+	/// Set when a particle hits the collider fast enough to wake a sleeping body.
+	bool wake;
+};
+
+/// A particle touching a collider. The normal points from the collider to the particle.
+struct b2RopeContact
+{
+	int32 index;
+	int32 collider;
+	b2Vec2 normal;
+	b2Vec2 point;
+	float invMass;
+};
+
+/// A view of the state of a single rope. This is shared by b2Rope and b2RopeSystem.
+/// Particle indices in the constraints are relative to the rope.
+struct b2RopeData
+{
+	b2Vec2* bindPositions;
+	b2Vec2* ps;
+	b2Vec2* p0s;
+	b2Vec2* vs;
+	float* invMasses;
+
+	b2RopeStretch* stretchConstraints;
+	b2RopeBend* bendConstraints;
+
+	int32 count;
+	int32 stretchCount;
+	int32 bendCount;
+
+	b2Vec2 gravity;
+	const b2RopeTuning* tuning;
+
+	// Coupling with rigid bodies, only used by ropes in a world.
+	b2RopeAttachment* attachments;
+	b2RopeCollider* colliders;
+	b2RopeContact* contacts;
+	int32 attachmentCount;
+	int32 colliderCount;
+	int32 contactCapacity;
+	float radius;
+};
+
+/// Initialize the particles and constraints from a definition. The arrays must be allocated.
+void b2InitializeRope(b2RopeData* data, const b2RopeDef& def);
+
+/// Pre-compute spring and damper values based on the tuning.
+void b2TuneRope(b2RopeData* data);
+
+/// Advance a rope. With colored ordering, constraints that share no particles are
+/// solved in separate sweeps (even/odd for stretch, three colors for bend), so each
+/// sweep has no dependencies between iterations. Attachment and collider impulses
+/// are accumulated but not applied to the bodies.
+void b2StepRope(b2RopeData* data, float dt, int32 iterations, const b2Vec2& position, bool colored);
+
+/// Move the rope back to the bind pose at a new position.
+void b2ResetRope(b2RopeData* data, const b2Vec2& position);
+
+/// Debug draw a rope.
+void b2DrawRope(const b2RopeData* data, b2Draw* draw);
+
+#endif
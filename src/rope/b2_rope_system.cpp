@@ -0,0 +1,532 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "box2d/b2_body.h"
+#include "box2d/b2_fixture.h"
+#include "box2d/b2_rope_system.h"
+#include "box2d/b2_task.h"
+#include "box2d/b2_timer.h"
+#include "box2d/b2_world.h"
+
+#include "b2_rope_solver.h"
+
+#include <string.h>
+
+// Contact storage is reserved per particle so ropes can be solved concurrently.
+static const int32 b2_ropeContactsPerParticle = 2;
+
+// Steps a range of ropes. Ropes share no particles or constraints.
+class b2RopeSystemTask : public b2Task
+{
+public:
+	void Execute(int32 startIndex, int32 endIndex, int32 threadIndex) override
+	{
+		B2_NOT_USED(threadIndex);
+
+		for (int32 i = startIndex; i < endIndex; ++i)
+		{
+			b2RopeData data;
+			m_system->GetData(i, &data);
+			b2StepRope(&data, m_dt, m_iterations, m_system->m_ropes[i].position, true);
+		}
+	}
+
+	const b2RopeSystem* m_system;
+	float m_dt;
+	int32 m_iterations;
+};
+
+b2RopeSystem::b2RopeSystem()
+{
+	m_ropes = nullptr;
+	m_ropeCount = 0;
+	m_ropeCapacity = 0;
+
+	m_bindPositions = nullptr;
+	m_ps = nullptr;
+	m_p0s = nullptr;
+	m_vs = nullptr;
+	m_invMasses = nullptr;
+	m_particleCount = 0;
+	m_particleCapacity = 0;
+
+	m_stretchConstraints = nullptr;
+	m_bendConstraints = nullptr;
+	m_stretchCount = 0;
+	m_bendCount = 0;
+
+	m_anchors = nullptr;
+	m_anchorCount = 0;
+	m_anchorCapacity = 0;
+
+	m_attachments = nullptr;
+	m_colliders = nullptr;
+	m_colliderCount = 0;
+	m_colliderCapacity = 0;
+
+	m_contacts = nullptr;
+
+	m_world = nullptr;
+	m_executor = nullptr;
+	memset(&m_profile, 0, sizeof(b2RopeProfile));
+}
+
+b2RopeSystem::~b2RopeSystem()
+{
+	if (m_world)
+	{
+		m_world->m_ropeSystem = nullptr;
+	}
+
+	b2Free(m_ropes);
+	b2Free(m_bindPositions);
+	b2Free(m_ps);
+	b2Free(m_p0s);
+	b2Free(m_vs);
+	b2Free(m_invMasses);
+	b2Free(m_stretchConstraints);
+	b2Free(m_bendConstraints);
+	b2Free(m_anchors);
+	b2Free(m_attachments);
+	b2Free(m_colliders);
+	b2Free(m_contacts);
+}
+
+template <typename T>
+static T* b2GrowArray(T* oldArray, int32 count, int32 capacity)
+{
+	T* newArray = (T*)b2Alloc(capacity * sizeof(T));
+	if (oldArray)
+	{
+		memcpy(newArray, oldArray, count * sizeof(T));
+		b2Free(oldArray);
+	}
+	return newArray;
+}
+
+void b2RopeSystem::Reserve(int32 particleCapacity, int32 ropeCapacity)
+{
+	if (ropeCapacity > m_ropeCapacity)
+	{
+		m_ropeCapacity = b2Max(ropeCapacity, 2 * m_ropeCapacity);
+		m_ropes = b2GrowArray(m_ropes, m_ropeCount, m_ropeCapacity);
+	}
+
+	if (particleCapacity > m_particleCapacity)
+	{
+		// Constraint counts are bounded by the particle count.
+		m_particleCapacity = b2Max(particleCapacity, 2 * m_particleCapacity);
+		m_bindPositions = b2GrowArray(m_bindPositions, m_particleCount, m_particleCapacity);
+		m_ps = b2GrowArray(m_ps, m_particleCount, m_particleCapacity);
+		m_p0s = b2GrowArray(m_p0s, m_particleCount, m_particleCapacity);
+		m_vs = b2GrowArray(m_vs, m_particleCount, m_particleCapacity);
+		m_invMasses = b2GrowArray(m_invMasses, m_particleCount, m_particleCapacity);
+		m_stretchConstraints = b2GrowArray(m_stretchConstraints, m_stretchCount, m_particleCapacity);
+		m_bendConstraints = b2GrowArray(m_bendConstraints, m_bendCount, m_particleCapacity);
+		m_contacts = b2GrowArray(m_contacts, 0, b2_ropeContactsPerParticle * m_particleCapacity);
+	}
+}
+
+int32 b2RopeSystem::CreateRope(const b2RopeDef& def)
+{
+	b2Assert(def.count >= 3);
+
+	Reserve(m_particleCount + def.count, m_ropeCount + 1);
+
+	int32 index = m_ropeCount;
+	Rope* rope = m_ropes + index;
+	rope->particleOffset = m_particleCount;
+	rope->stretchOffset = m_stretchCount;
+	rope->bendOffset = m_bendCount;
+	rope->count = def.count;
+	rope->position = def.position;
+	rope->gravity = def.gravity;
+	rope->radius = def.radius;
+	rope->tuning = def.tuning;
+	rope->attachmentStart = 0;
+	rope->attachmentCount = 0;
+	rope->colliderStart = 0;
+	rope->colliderCount = 0;
+
+	m_ropeCount += 1;
+	m_particleCount += def.count;
+	m_stretchCount += def.count - 1;
+	m_bendCount += def.count - 2;
+
+	b2RopeData data;
+	GetData(index, &data);
+	b2InitializeRope(&data, def);
+	b2TuneRope(&data);
+
+	return index;
+}
+
+void b2RopeSystem::Clear()
+{
+	m_ropeCount = 0;
+	m_particleCount = 0;
+	m_stretchCount = 0;
+	m_bendCount = 0;
+	m_anchorCount = 0;
+	m_colliderCount = 0;
+}
+
+void b2RopeSystem::GetData(int32 index, b2RopeData* data) const
+{
+	b2Assert(0 <= index && index < m_ropeCount);
+	const Rope* rope = m_ropes + index;
+
+	data->bindPositions = m_bindPositions + rope->particleOffset;
+	data->ps = m_ps + rope->particleOffset;
+	data->p0s = m_p0s + rope->particleOffset;
+	data->vs = m_vs + rope->particleOffset;
+	data->invMasses = m_invMasses + rope->particleOffset;
+	data->stretchConstraints = m_stretchConstraints + rope->stretchOffset;
+	data->bendConstraints = m_bendConstraints + rope->bendOffset;
+	data->count = rope->count;
+	data->stretchCount = rope->count - 1;
+	data->bendCount = rope->count - 2;
+	data->gravity = rope->gravity;
+	data->tuning = &rope->tuning;
+
+	data->attachments = m_attachments + rope->attachmentStart;
+	data->colliders = m_colliders + rope->colliderStart;
+	data->contacts = m_contacts + b2_ropeContactsPerParticle * rope->particleOffset;
+	data->attachmentCount = rope->attachmentCount;
+	data->colliderCount = rope->colliderCount;
+	data->contactCapacity = b2_ropeContactsPerParticle * rope->count;
+	data->radius = rope->radius;
+}
+
+void b2RopeSystem::SetTuning(int32 index, const b2RopeTuning& tuning)
+{
+	b2Assert(0 <= index && index < m_ropeCount);
+	m_ropes[index].tuning = tuning;
+
+	b2RopeData data;
+	GetData(index, &data);
+	b2TuneRope(&data);
+}
+
+void b2RopeSystem::SetPosition(int32 index, const b2Vec2& position)
+{
+	b2Assert(0 <= index && index < m_ropeCount);
+	m_ropes[index].position = position;
+}
+
+void b2RopeSystem::Reset(int32 index, const b2Vec2& position)
+{
+	b2Assert(0 <= index && index < m_ropeCount);
+	m_ropes[index].position = position;
+
+	b2RopeData data;
+	GetData(index, &data);
+	b2ResetRope(&data, position);
+}
+
+void b2RopeSystem::Attach(int32 index, int32 particleIndex, b2Body* body, const b2Vec2& localAnchor)
+{
+	b2Assert(0 <= index && index < m_ropeCount);
+	b2Assert(0 <= particleIndex && particleIndex < m_ropes[index].count);
+	b2Assert(body != nullptr);
+
+	if (m_anchorCount == m_anchorCapacity)
+	{
+		m_anchorCapacity = b2Max(16, 2 * m_anchorCapacity);
+		m_anchors = b2GrowArray(m_anchors, m_anchorCount, m_anchorCapacity);
+		m_attachments = b2GrowArray(m_attachments, 0, m_anchorCapacity);
+	}
+
+	// Keep the anchors sorted by rope so each rope owns a contiguous range
+	int32 i = m_anchorCount;
+	while (i > 0 && m_anchors[i - 1].rope > index)
+	{
+		m_anchors[i] = m_anchors[i - 1];
+		--i;
+	}
+
+	Anchor* anchor = m_anchors + i;
+	anchor->rope = index;
+	anchor->particle = particleIndex;
+	anchor->body = body;
+	anchor->localAnchor = localAnchor;
+	++m_anchorCount;
+}
+
+void b2RopeSystem::Detach(int32 index, int32 particleIndex)
+{
+	int32 count = 0;
+	for (int32 i = 0; i < m_anchorCount; ++i)
+	{
+		const Anchor& anchor = m_anchors[i];
+		if (anchor.rope != index || anchor.particle != particleIndex)
+		{
+			m_anchors[count++] = anchor;
+		}
+	}
+	m_anchorCount = count;
+}
+
+void b2RopeSystem::RemoveBody(b2Body* body)
+{
+	int32 count = 0;
+	for (int32 i = 0; i < m_anchorCount; ++i)
+	{
+		if (m_anchors[i].body != body)
+		{
+			m_anchors[count++] = m_anchors[i];
+		}
+	}
+	m_anchorCount = count;
+}
+
+void b2RopeSystem::RemoveWorld()
+{
+	// The anchors and colliders point at bodies of the world.
+	for (int32 i = 0; i < m_ropeCount; ++i)
+	{
+		m_ropes[i].attachmentCount = 0;
+		m_ropes[i].colliderCount = 0;
+	}
+	m_anchorCount = 0;
+	m_colliderCount = 0;
+	m_world = nullptr;
+}
+
+void b2RopeSystem::ShiftOrigin(const b2Vec2& newOrigin)
+{
+	for (int32 i = 0; i < m_particleCount; ++i)
+	{
+		m_ps[i] -= newOrigin;
+		m_p0s[i] -= newOrigin;
+	}
+
+	for (int32 i = 0; i < m_ropeCount; ++i)
+	{
+		m_ropes[i].position -= newOrigin;
+	}
+}
+
+void b2RopeSystem::SetTaskExecutor(b2TaskExecutor* executor)
+{
+	m_executor = executor;
+}
+
+// Gathers the fixture children that overlap a rope.
+struct b2RopeColliderCallback
+{
+	bool QueryCallback(int32 proxyId)
+	{
+		b2FixtureProxy* proxy = (b2FixtureProxy*)broadPhase->GetUserData(proxyId);
+		b2Fixture* fixture = proxy->fixture;
+		if (fixture->IsSensor())
+		{
+			return true;
+		}
+
+		b2Body* body = fixture->GetBody();
+		system->AddCollider(fixture, proxy->childIndex, proxy->aabb, body);
+		return true;
+	}
+
+	const b2BroadPhase* broadPhase;
+	b2RopeSystem* system;
+};
+
+void b2RopeSystem::AddCollider(b2Fixture* fixture, int32 childIndex, const b2AABB& aabb, b2Body* body)
+{
+	if (m_colliderCount == m_colliderCapacity)
+	{
+		m_colliderCapacity = b2Max(16, 2 * m_colliderCapacity);
+		m_colliders = b2GrowArray(m_colliders, m_colliderCount, m_colliderCapacity);
+	}
+
+	b2RopeCollider* collider = m_colliders + m_colliderCount;
+	collider->shape = fixture->GetShape();
+	collider->childIndex = childIndex;
+	collider->xf = body->m_xf;
+	collider->aabb = aabb;
+	collider->body = body;
+	collider->center = body->m_position;
+
+	// A sleeping body holds still unless the rope wakes it, see ApplyImpulses.
+	collider->invMass = body->IsAwake() ? body->m_invMass : 0.0f;
+	collider->invI = body->IsAwake() ? body->m_invI : 0.0f;
+	collider->friction = fixture->GetFriction();
+	collider->linearImpulse.SetZero();
+	collider->angularImpulse = 0.0f;
+	collider->wake = false;
+	++m_colliderCount;
+}
+
+void b2RopeSystem::PrepareCoupling(float dt)
+{
+	m_colliderCount = 0;
+
+	b2RopeColliderCallback callback;
+	callback.broadPhase = &m_world->m_contactManager.m_broadPhase;
+	callback.system = this;
+
+	int32 anchorIndex = 0;
+	for (int32 i = 0; i < m_ropeCount; ++i)
+	{
+		Rope* rope = m_ropes + i;
+
+		rope->attachmentStart = anchorIndex;
+		while (anchorIndex < m_anchorCount && m_anchors[anchorIndex].rope == i)
+		{
+			const Anchor& anchor = m_anchors[anchorIndex];
+			b2Body* body = anchor.body;
+
+			b2RopeAttachment* a = m_attachments + anchorIndex;
+			a->index = anchor.particle;
+			a->body = body;
+			a->target = b2Mul(body->m_xf, anchor.localAnchor);
+			a->center = body->m_position;
+			a->invMass = body->IsAwake() ? body->m_invMass : 0.0f;
+			a->invI = body->IsAwake() ? body->m_invI : 0.0f;
+			a->linearImpulse.SetZero();
+			a->angularImpulse = 0.0f;
+			a->wake = false;
+			++anchorIndex;
+		}
+		rope->attachmentCount = anchorIndex - rope->attachmentStart;
+
+		// Bound the predicted particle motion
+		const b2Vec2* ps = m_ps + rope->particleOffset;
+		const b2Vec2* vs = m_vs + rope->particleOffset;
+		b2Vec2 gravityStep = dt * dt * rope->gravity;
+
+		b2AABB aabb;
+		aabb.lowerBound = ps[0];
+		aabb.upperBound = ps[0];
+		for (int32 j = 0; j < rope->count; ++j)
+		{
+			b2Vec2 p2 = ps[j] + dt * vs[j] + gravityStep;
+			aabb.lowerBound = b2Min(aabb.lowerBound, b2Min(ps[j], p2));
+			aabb.upperBound = b2Max(aabb.upperBound, b2Max(ps[j], p2));
+		}
+
+		b2Vec2 r(rope->radius + b2_linearSlop, rope->radius + b2_linearSlop);
+		aabb.lowerBound -= r;
+		aabb.upperBound += r;
+
+		rope->colliderStart = m_colliderCount;
+		m_world->m_contactManager.m_broadPhase.Query(&callback, aabb);
+		rope->colliderCount = m_colliderCount - rope->colliderStart;
+	}
+}
+
+// A sleeping body is only woken when a particle moves into it faster than the sleep
+// tolerance, so a rope resting on it or hanging from it does not keep it awake.
+void b2RopeSystem::ApplyImpulse(b2Body* body, const b2Vec2& linearImpulse, float angularImpulse, bool wake)
+{
+	if (body->GetType() != b2_dynamicBody)
+	{
+		return;
+	}
+
+	body->ApplyLinearImpulseToCenter(linearImpulse, wake);
+	body->ApplyAngularImpulse(angularImpulse, wake);
+}
+
+void b2RopeSystem::ApplyImpulses()
+{
+	for (int32 i = 0; i < m_anchorCount; ++i)
+	{
+		const b2RopeAttachment& a = m_attachments[i];
+		ApplyImpulse(a.body, a.linearImpulse, a.angularImpulse, a.wake);
+	}
+
+	for (int32 i = 0; i < m_colliderCount; ++i)
+	{
+		const b2RopeCollider& c = m_colliders[i];
+		ApplyImpulse(c.body, c.linearImpulse, c.angularImpulse, c.wake);
+	}
+}
+
+void b2RopeSystem::Step(float dt, int32 iterations)
+{
+	b2Timer timer;
+
+	if (m_world && dt > 0.0f)
+	{
+		PrepareCoupling(dt);
+	}
+	else
+	{
+		for (int32 i = 0; i < m_ropeCount; ++i)
+		{
+			m_ropes[i].attachmentCount = 0;
+			m_ropes[i].colliderCount = 0;
+		}
+		m_colliderCount = 0;
+	}
+
+	b2RopeSystemTask task;
+	task.m_system = this;
+	task.m_dt = dt;
+	task.m_iterations = iterations;
+
+	if (m_executor)
+	{
+		// Small ropes are cheap, so keep a few per range to amortize dispatch
+		m_executor->ParallelFor(&task, m_ropeCount, 4);
+	}
+	else
+	{
+		task.Execute(0, m_ropeCount, 0);
+	}
+
+	if (m_world && dt > 0.0f)
+	{
+		ApplyImpulses();
+	}
+
+	m_profile.step = timer.GetMilliseconds();
+	m_profile.ropeCount = m_ropeCount;
+	m_profile.particleCount = m_particleCount;
+	m_profile.constraintCount = m_stretchCount + m_bendCount + m_anchorCount;
+	m_profile.colliderCount = m_colliderCount;
+}
+
+int32 b2RopeSystem::GetParticleCount(int32 index) const
+{
+	b2Assert(0 <= index && index < m_ropeCount);
+	return m_ropes[index].count;
+}
+
+const b2Vec2* b2RopeSystem::GetPositions(int32 index) const
+{
+	b2Assert(0 <= index && index < m_ropeCount);
+	return m_ps + m_ropes[index].particleOffset;
+}
+
+void b2RopeSystem::Draw(b2Draw* draw) const
+{
+	for (int32 i = 0; i < m_ropeCount; ++i)
+	{
+		b2RopeData data;
+		GetData(i, &data);
+		b2DrawRope(&data, draw);
+	}
+}
@@ -373,6 +373,7 @@ static void UpdateUI()
 				ImGui::Checkbox("Warm Starting", &s_settings.m_enableWarmStarting);
 				ImGui::Checkbox("Continuous", &s_settings.m_enableContinuous);
 				ImGui::Checkbox("Sub-Stepping", &s_settings.m_enableSubStepping);
+				ImGui::Checkbox("Chain Solving", &s_settings.m_enableChainSolving);
 
 				ImGui::Separator();
 
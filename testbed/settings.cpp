@@ -71,6 +71,7 @@ void Settings::Save()
 	fprintf(file, "  \"enableWarmStarting\": %s,\n", m_enableWarmStarting ? "true" : "false");
 	fprintf(file, "  \"enableContinuous\": %s,\n", m_enableContinuous ? "true" : "false");
 	fprintf(file, "  \"enableSubStepping\": %s,\n", m_enableSubStepping ? "true" : "false");
+	fprintf(file, "  \"enableChainSolving\": %s,\n", m_enableChainSolving ? "true" : "false");
 	fprintf(file, "  \"enableSleep\": %s\n", m_enableSleep ? "true" : "false");
 	fprintf(file, "}\n");
 	fclose(file);
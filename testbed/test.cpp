@@ -304,6 +304,7 @@ void Test::Step(Settings& settings)
 	m_world->SetWarmStarting(settings.m_enableWarmStarting);
 	m_world->SetContinuousPhysics(settings.m_enableContinuous);
 	m_world->SetSubStepping(settings.m_enableSubStepping);
+	m_world->SetChainSolving(settings.m_enableChainSolving);
 
 	m_pointCount = 0;
 
@@ -339,20 +340,28 @@ void Test::Step(Settings& settings)
 		m_maxProfile.step = b2Max(m_maxProfile.step, p.step);
 		m_maxProfile.collide = b2Max(m_maxProfile.collide, p.collide);
 		m_maxProfile.solve = b2Max(m_maxProfile.solve, p.solve);
+		m_maxProfile.buildIslands = b2Max(m_maxProfile.buildIslands, p.buildIslands);
 		m_maxProfile.solveInit = b2Max(m_maxProfile.solveInit, p.solveInit);
 		m_maxProfile.solveVelocity = b2Max(m_maxProfile.solveVelocity, p.solveVelocity);
 		m_maxProfile.solvePosition = b2Max(m_maxProfile.solvePosition, p.solvePosition);
 		m_maxProfile.solveTOI = b2Max(m_maxProfile.solveTOI, p.solveTOI);
+		m_maxProfile.synchronizeFixtures = b2Max(m_maxProfile.synchronizeFixtures, p.synchronizeFixtures);
 		m_maxProfile.broadphase = b2Max(m_maxProfile.broadphase, p.broadphase);
+		m_maxProfile.rope = b2Max(m_maxProfile.rope, p.rope);
+		m_maxProfile.tiles = b2Max(m_maxProfile.tiles, p.tiles);
 
 		m_totalProfile.step += p.step;
 		m_totalProfile.collide += p.collide;
 		m_totalProfile.solve += p.solve;
+		m_totalProfile.buildIslands += p.buildIslands;
 		m_totalProfile.solveInit += p.solveInit;
 		m_totalProfile.solveVelocity += p.solveVelocity;
 		m_totalProfile.solvePosition += p.solvePosition;
 		m_totalProfile.solveTOI += p.solveTOI;
+		m_totalProfile.synchronizeFixtures += p.synchronizeFixtures;
 		m_totalProfile.broadphase += p.broadphase;
+		m_totalProfile.rope += p.rope;
+		m_totalProfile.tiles += p.tiles;
 	}
 
 	if (settings.m_drawProfile)
@@ -367,11 +376,15 @@ void Test::Step(Settings& settings)
 			aveProfile.step = scale * m_totalProfile.step;
 			aveProfile.collide = scale * m_totalProfile.collide;
 			aveProfile.solve = scale * m_totalProfile.solve;
+			aveProfile.buildIslands = scale * m_totalProfile.buildIslands;
 			aveProfile.solveInit = scale * m_totalProfile.solveInit;
 			aveProfile.solveVelocity = scale * m_totalProfile.solveVelocity;
 			aveProfile.solvePosition = scale * m_totalProfile.solvePosition;
 			aveProfile.solveTOI = scale * m_totalProfile.solveTOI;
+			aveProfile.synchronizeFixtures = scale * m_totalProfile.synchronizeFixtures;
 			aveProfile.broadphase = scale * m_totalProfile.broadphase;
+			aveProfile.rope = scale * m_totalProfile.rope;
+			aveProfile.tiles = scale * m_totalProfile.tiles;
 		}
 
 		g_debugDraw.DrawString(5, m_textLine, "step [ave] (max) = %5.2f [%6.2f] (%6.2f)", p.step, aveProfile.step, m_maxProfile.step);
@@ -380,6 +393,8 @@ void Test::Step(Settings& settings)
 		m_textLine += m_textIncrement;
 		g_debugDraw.DrawString(5, m_textLine, "solve [ave] (max) = %5.2f [%6.2f] (%6.2f)", p.solve, aveProfile.solve, m_maxProfile.solve);
 		m_textLine += m_textIncrement;
+		g_debugDraw.DrawString(5, m_textLine, "build islands [ave] (max) = %5.2f [%6.2f] (%6.2f)", p.buildIslands, aveProfile.buildIslands, m_maxProfile.buildIslands);
+		m_textLine += m_textIncrement;
 		g_debugDraw.DrawString(5, m_textLine, "solve init [ave] (max) = %5.2f [%6.2f] (%6.2f)", p.solveInit, aveProfile.solveInit, m_maxProfile.solveInit);
 		m_textLine += m_textIncrement;
 		g_debugDraw.DrawString(5, m_textLine, "solve velocity [ave] (max) = %5.2f [%6.2f] (%6.2f)", p.solveVelocity, aveProfile.solveVelocity, m_maxProfile.solveVelocity);
@@ -388,8 +403,22 @@ void Test::Step(Settings& settings)
 		m_textLine += m_textIncrement;
 		g_debugDraw.DrawString(5, m_textLine, "solveTOI [ave] (max) = %5.2f [%6.2f] (%6.2f)", p.solveTOI, aveProfile.solveTOI, m_maxProfile.solveTOI);
 		m_textLine += m_textIncrement;
+		g_debugDraw.DrawString(5, m_textLine, "sync fixtures [ave] (max) = %5.2f [%6.2f] (%6.2f)", p.synchronizeFixtures, aveProfile.synchronizeFixtures, m_maxProfile.synchronizeFixtures);
+		m_textLine += m_textIncrement;
 		g_debugDraw.DrawString(5, m_textLine, "broad-phase [ave] (max) = %5.2f [%6.2f] (%6.2f)", p.broadphase, aveProfile.broadphase, m_maxProfile.broadphase);
 		m_textLine += m_textIncrement;
+		g_debugDraw.DrawString(5, m_textLine, "rope [ave] (max) = %5.2f [%6.2f] (%6.2f)", p.rope, aveProfile.rope, m_maxProfile.rope);
+		m_textLine += m_textIncrement;
+		g_debugDraw.DrawString(5, m_textLine, "tiles [ave] (max) = %5.2f [%6.2f] (%6.2f)", p.tiles, aveProfile.tiles, m_maxProfile.tiles);
+		m_textLine += m_textIncrement;
+		g_debugDraw.DrawString(5, m_textLine, "awake bodies/islands/touching contacts = %d/%d/%d", p.awakeBodyCount, p.islandCount, p.touchingContactCount);
+		m_textLine += m_textIncrement;
+		g_debugDraw.DrawString(5, m_textLine, "graph colors/overflow constraints/chain joints = %d/%d/%d", p.graphColorCount, p.overflowConstraintCount, p.chainJointCount);
+		m_textLine += m_textIncrement;
+		g_debugDraw.DrawString(5, m_textLine, "toi calls/pairs/moved proxies/tree rotations = %d/%d/%d/%d", p.toiCalls, p.pairCount, p.movedProxyCount, p.treeRotations);
+		m_textLine += m_textIncrement;
+		g_debugDraw.DrawString(5, m_textLine, "stack high water/fallbacks/heap allocations = %d/%d/%d", p.stackHighWater, p.stackFallbacks, p.heapAllocations);
+		m_textLine += m_textIncrement;
 	}
 
 	if (m_bombSpawning)
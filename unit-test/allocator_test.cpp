@@ -0,0 +1,316 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "box2d/box2d.h"
+#include "box2d/b2_block_allocator.h"
+#include "box2d/b2_task.h"
+#include "doctest.h"
+#include "thread_executor.h"
+#include <string.h>
+
+DOCTEST_TEST_CASE("block allocator trim")
+{
+	b2BlockAllocator allocator;
+
+	const int32 count = 1000;
+	void* blocks[count];
+	for (int32 i = 0; i < count; ++i)
+	{
+		blocks[i] = allocator.Allocate(100);
+	}
+
+	void* large = allocator.Allocate(1000);
+
+	b2BlockAllocatorStats stats;
+	allocator.GetStats(&stats);
+	CHECK(stats.sizes[4].blockSize == 128);
+	CHECK(stats.sizes[4].liveBlocks == count);
+	CHECK(stats.sizes[4].chunkCount == 8);
+	CHECK(stats.sizes[4].freeBlocks == 8 * 128 - count);
+	CHECK(stats.chunkCount == 8);
+	CHECK(stats.largeCount == 1);
+	CHECK(stats.largeBytes == 1000);
+
+	// Nothing to release while every chunk is in use
+	CHECK(allocator.Trim() == 0);
+
+	// Free all but the last block, in an interleaved order
+	for (int32 i = 0; i < count - 1; i += 2)
+	{
+		allocator.Free(blocks[i], 100);
+	}
+	for (int32 i = 1; i < count - 1; i += 2)
+	{
+		allocator.Free(blocks[i], 100);
+	}
+	allocator.Free(large, 1000);
+
+	int32 released = allocator.Trim();
+	CHECK(released == 7 * 16 * 1024);
+
+	allocator.GetStats(&stats);
+	CHECK(stats.sizes[4].liveBlocks == 1);
+	CHECK(stats.sizes[4].chunkCount == 1);
+	CHECK(stats.sizes[4].freeBlocks == 127);
+	CHECK(stats.chunkCount == 1);
+	CHECK(stats.largeCount == 0);
+
+	// The remaining free list is still usable
+	for (int32 i = 0; i < 127; ++i)
+	{
+		blocks[i] = allocator.Allocate(128);
+	}
+
+	allocator.GetStats(&stats);
+	CHECK(stats.chunkCount == 1);
+	CHECK(stats.sizes[4].freeBlocks == 0);
+
+	for (int32 i = 0; i < 127; ++i)
+	{
+		allocator.Free(blocks[i], 128);
+	}
+	allocator.Free(blocks[count - 1], 100);
+
+	CHECK(allocator.Trim() == 16 * 1024);
+	allocator.GetStats(&stats);
+	CHECK(stats.chunkCount == 0);
+}
+
+DOCTEST_TEST_CASE("world memory trim")
+{
+	b2World world(b2Vec2(0.0f, -10.0f));
+
+	b2CircleShape circle;
+	circle.m_radius = 0.5f;
+
+	b2BodyDef bodyDef;
+	bodyDef.type = b2_dynamicBody;
+
+	b2Body* bodies[500];
+	for (int32 i = 0; i < 500; ++i)
+	{
+		bodyDef.position.Set(2.0f * i, 0.0f);
+		bodies[i] = world.CreateBody(&bodyDef);
+		bodies[i]->CreateFixture(&circle, 1.0f);
+	}
+
+	b2BlockAllocatorStats peak;
+	world.GetBlockAllocatorStats(&peak);
+
+	for (int32 i = 0; i < 500; ++i)
+	{
+		world.DestroyBody(bodies[i]);
+	}
+
+	CHECK(world.TrimBlockAllocator() > 0);
+
+	b2BlockAllocatorStats stats;
+	world.GetBlockAllocatorStats(&stats);
+	CHECK(stats.chunkCount < peak.chunkCount);
+
+	for (int32 i = 0; i < b2_blockSizeCount; ++i)
+	{
+		CHECK(stats.sizes[i].liveBlocks == 0);
+	}
+}
+
+class AllocatorTask : public b2Task
+{
+public:
+	void Execute(int32 startIndex, int32 endIndex, int32 threadIndex) override
+	{
+		b2BlockAllocatorCache* cache = caches + threadIndex;
+		cache->Bind(allocator);
+
+		for (int32 i = startIndex; i < endIndex; ++i)
+		{
+			blocks[i] = allocator->Allocate(16 + i % 600);
+			memset(blocks[i], i & 0xFF, 16);
+		}
+
+		// Free every other block to exercise the magazine flush
+		for (int32 i = startIndex; i < endIndex; i += 2)
+		{
+			allocator->Free(blocks[i], 16 + i % 600);
+			blocks[i] = nullptr;
+		}
+
+		cache->Unbind();
+	}
+
+	b2BlockAllocator* allocator;
+	b2BlockAllocatorCache* caches;
+	void** blocks;
+};
+
+DOCTEST_TEST_CASE("block allocator cache")
+{
+	b2BlockAllocator allocator;
+	b2BlockAllocatorCache caches[4];
+
+	const int32 count = 4000;
+	void* blocks[count];
+
+	AllocatorTask task;
+	task.allocator = &allocator;
+	task.caches = caches;
+	task.blocks = blocks;
+
+	ThreadExecutor executor;
+	executor.ParallelFor(&task, count, 1);
+
+	for (int32 i = 0; i < 4; ++i)
+	{
+		caches[i].Flush();
+	}
+
+	b2BlockAllocatorStats stats;
+	allocator.GetStats(&stats);
+
+	int32 liveCount = 0;
+	for (int32 i = 0; i < b2_blockSizeCount; ++i)
+	{
+		liveCount += stats.sizes[i].liveBlocks;
+	}
+	CHECK(liveCount == count / 2);
+
+	for (int32 i = 1; i < count; i += 2)
+	{
+		CHECK(*(uint8*)blocks[i] == (i & 0xFF));
+		allocator.Free(blocks[i], 16 + i % 600);
+	}
+
+	allocator.GetStats(&stats);
+	for (int32 i = 0; i < b2_blockSizeCount; ++i)
+	{
+		CHECK(stats.sizes[i].liveBlocks == 0);
+	}
+}
+
+static void CreatePile(b2World* world)
+{
+	b2BodyDef bodyDef;
+	b2Body* ground = world->CreateBody(&bodyDef);
+
+	b2EdgeShape edge;
+	edge.SetTwoSided(b2Vec2(-40.0f, 0.0f), b2Vec2(40.0f, 0.0f));
+	ground->CreateFixture(&edge, 0.0f);
+
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.5f);
+
+	b2CircleShape circle;
+	circle.m_radius = 0.5f;
+
+	bodyDef.type = b2_dynamicBody;
+	for (int32 i = 0; i < 20; ++i)
+	{
+		for (int32 j = 0; j < 20; ++j)
+		{
+			bodyDef.position.Set(1.1f * i - 11.0f + 0.05f * j, 0.5f + 1.05f * j);
+			b2Body* body = world->CreateBody(&bodyDef);
+			if ((i + j) & 1)
+			{
+				body->CreateFixture(&box, 1.0f);
+			}
+			else
+			{
+				body->CreateFixture(&circle, 1.0f);
+			}
+		}
+	}
+}
+
+DOCTEST_TEST_CASE("parallel contact creation")
+{
+	// Both worlds have an executor, so both color their islands and only the contact
+	// creation differs.
+	b2TaskExecutor serialExecutor;
+	b2World serial(b2Vec2(0.0f, -10.0f));
+	serial.SetTaskExecutor(&serialExecutor);
+	CreatePile(&serial);
+
+	ThreadExecutor executor;
+	b2World parallel(b2Vec2(0.0f, -10.0f));
+	parallel.SetTaskExecutor(&executor);
+	CHECK(parallel.GetTaskExecutor() == &executor);
+	CreatePile(&parallel);
+
+	for (int32 i = 0; i < 60; ++i)
+	{
+		serial.Step(1.0f / 60.0f, 8, 3);
+		parallel.Step(1.0f / 60.0f, 8, 3);
+	}
+
+	CHECK(serial.GetContactCount() == parallel.GetContactCount());
+
+	// Same contact order gives bitwise identical results
+	const b2Body* b1 = serial.GetBodyList();
+	const b2Body* b2 = parallel.GetBodyList();
+	while (b1 && b2)
+	{
+		CHECK(b1->GetPosition().x == b2->GetPosition().x);
+		CHECK(b1->GetPosition().y == b2->GetPosition().y);
+		b1 = b1->GetNext();
+		b2 = b2->GetNext();
+	}
+
+	// Return the blocks kept by the thread caches before comparing.
+	parallel.TrimBlockAllocator();
+
+	b2BlockAllocatorStats stats1, stats2;
+	serial.GetBlockAllocatorStats(&stats1);
+	parallel.GetBlockAllocatorStats(&stats2);
+	for (int32 i = 0; i < b2_blockSizeCount; ++i)
+	{
+		CHECK(stats1.sizes[i].liveBlocks == stats2.sizes[i].liveBlocks);
+	}
+
+	// The thread caches keep their blocks from step to step until trimmed.
+	{
+		b2World world(b2Vec2(0.0f, -10.0f));
+		world.SetTaskExecutor(&executor);
+		CreatePile(&world);
+		world.Step(1.0f / 60.0f, 8, 3);
+
+		while (world.GetBodyList())
+		{
+			world.DestroyBody(world.GetBodyList());
+		}
+
+		b2BlockAllocatorStats stats;
+		world.GetBlockAllocatorStats(&stats);
+		int32 liveCount = 0;
+		for (int32 i = 0; i < b2_blockSizeCount; ++i)
+		{
+			liveCount += stats.sizes[i].liveBlocks;
+		}
+		CHECK(liveCount > 0);
+
+		world.TrimBlockAllocator();
+		world.GetBlockAllocatorStats(&stats);
+		for (int32 i = 0; i < b2_blockSizeCount; ++i)
+		{
+			CHECK(stats.sizes[i].liveBlocks == 0);
+		}
+	}
+}
@@ -0,0 +1,283 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "box2d/box2d.h"
+#include "box2d/b2_task.h"
+#include "doctest.h"
+#include "thread_executor.h"
+
+// FNV-1a over the raw bytes, so any bit difference changes the hash.
+static unsigned long long HashBytes(unsigned long long hash, const void* data, int32 size)
+{
+	const uint8* bytes = (const uint8*)data;
+	for (int32 i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+static unsigned long long HashWorld(const b2World* world)
+{
+	unsigned long long hash = 14695981039346656037ull;
+	for (const b2Body* b = world->GetBodyList(); b; b = b->GetNext())
+	{
+		b2Transform xf = b->GetTransform();
+		b2Vec2 v = b->GetLinearVelocity();
+		float w = b->GetAngularVelocity();
+		hash = HashBytes(hash, &xf, sizeof(xf));
+		hash = HashBytes(hash, &v, sizeof(v));
+		hash = HashBytes(hash, &w, sizeof(w));
+	}
+	return hash;
+}
+
+// A pyramid, a spinning pendulum chain and a car, which covers the trig in the solver.
+static unsigned long long RunScene(int32 stepCount, b2TaskExecutor* executor)
+{
+	b2World world(b2Vec2(0.0f, -10.0f));
+	world.SetTaskExecutor(executor);
+
+	b2BodyDef bodyDef;
+	b2Body* ground = world.CreateBody(&bodyDef);
+
+	b2EdgeShape edge;
+	edge.SetTwoSided(b2Vec2(-40.0f, 0.0f), b2Vec2(40.0f, 0.0f));
+	ground->CreateFixture(&edge, 0.0f);
+
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.5f);
+
+	bodyDef.type = b2_dynamicBody;
+	for (int32 i = 0; i < 10; ++i)
+	{
+		for (int32 j = i; j < 10; ++j)
+		{
+			bodyDef.position.Set(-10.0f + 0.5625f * i + 1.125f * (j - i), 0.5f + 1.0f * i);
+			bodyDef.angle = 0.01f * (i - j);
+			b2Body* body = world.CreateBody(&bodyDef);
+			body->CreateFixture(&box, 5.0f);
+		}
+	}
+
+	bodyDef.angle = 0.0f;
+	b2PolygonShape link;
+	link.SetAsBox(0.6f, 0.125f);
+
+	b2Body* prev = ground;
+	for (int32 i = 0; i < 8; ++i)
+	{
+		bodyDef.position.Set(10.5f + i, 15.0f);
+		b2Body* body = world.CreateBody(&bodyDef);
+		body->CreateFixture(&link, 20.0f);
+
+		b2RevoluteJointDef jd;
+		jd.Initialize(prev, body, b2Vec2(10.0f + i, 15.0f));
+		world.CreateJoint(&jd);
+		prev = body;
+	}
+
+	bodyDef.position.Set(20.0f, 1.0f);
+	b2Body* chassis = world.CreateBody(&bodyDef);
+	b2PolygonShape chassisShape;
+	chassisShape.SetAsBox(1.5f, 0.25f);
+	chassis->CreateFixture(&chassisShape, 1.0f);
+
+	b2CircleShape wheelShape;
+	wheelShape.m_radius = 0.4f;
+	for (int32 i = 0; i < 2; ++i)
+	{
+		bodyDef.position.Set(19.0f + 2.0f * i, 0.4f);
+		b2Body* wheel = world.CreateBody(&bodyDef);
+		wheel->CreateFixture(&wheelShape, 1.0f);
+
+		b2WheelJointDef jd;
+		jd.Initialize(chassis, wheel, wheel->GetPosition(), b2Vec2(0.0f, 1.0f));
+		jd.enableMotor = true;
+		jd.motorSpeed = -10.0f;
+		jd.maxMotorTorque = 20.0f;
+		world.CreateJoint(&jd);
+	}
+
+	for (int32 i = 0; i < stepCount; ++i)
+	{
+		world.Step(1.0f / 60.0f, 8, 3);
+	}
+
+	return HashWorld(&world);
+}
+
+DOCTEST_TEST_CASE("determinism")
+{
+	unsigned long long hash = RunScene(300, nullptr);
+
+	// The same inputs give the same bits, regardless of allocation addresses.
+	CHECK(RunScene(300, nullptr) == hash);
+
+	ThreadExecutor executor;
+	CHECK(RunScene(300, &executor) == hash);
+
+#if defined(B2_DETERMINISTIC)
+	// This must match on every platform. Update it when the solver changes on purpose.
+	CHECK(hash == 0xd6384a98972a375dull);
+#endif
+}
+
+DOCTEST_TEST_CASE("state hash")
+{
+	b2World world(b2Vec2(0.0f, -10.0f));
+
+	b2BodyDef bodyDef;
+	b2Body* ground = world.CreateBody(&bodyDef);
+
+	b2EdgeShape edge;
+	edge.SetTwoSided(b2Vec2(-10.0f, 0.0f), b2Vec2(10.0f, 0.0f));
+	ground->CreateFixture(&edge, 0.0f);
+
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.5f);
+
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.position.Set(0.0f, 0.5f);
+	b2Body* body = world.CreateBody(&bodyDef);
+	body->CreateFixture(&box, 1.0f);
+
+	bodyDef.position.Set(3.0f, 4.0f);
+	b2Body* bob = world.CreateBody(&bodyDef);
+	bob->CreateFixture(&box, 1.0f);
+
+	b2RevoluteJointDef jd;
+	jd.Initialize(ground, bob, b2Vec2(3.0f, 6.0f));
+	world.CreateJoint(&jd);
+
+	for (int32 i = 0; i < 30; ++i)
+	{
+		world.Step(1.0f / 60.0f, 8, 3);
+	}
+
+	const uint32 allFlags = b2World::e_hashContacts | b2World::e_hashJointImpulses;
+	unsigned long long hash = world.ComputeStateHash();
+	unsigned long long fullHash = world.ComputeStateHash(allFlags);
+	CHECK(world.ComputeStateHash() == hash);
+	CHECK(world.ComputeStateHash(allFlags) == fullHash);
+
+	// Contacts and joint impulses are only hashed on request.
+	CHECK(world.ComputeStateHash(b2World::e_hashContacts) != hash);
+	CHECK(world.ComputeStateHash(b2World::e_hashJointImpulses) != hash);
+
+	b2World* clone = world.Clone();
+	CHECK(clone->ComputeStateHash(allFlags) == fullHash);
+
+	b2Body* cloneBody = clone->GetBodyList();
+	cloneBody->SetLinearVelocity(cloneBody->GetLinearVelocity() + b2Vec2(1.0e-6f, 0.0f));
+	CHECK(clone->ComputeStateHash() != hash);
+	delete clone;
+
+	// Stepping both the same way keeps them in sync.
+	clone = world.Clone();
+	world.Step(1.0f / 60.0f, 8, 3);
+	clone->Step(1.0f / 60.0f, 8, 3);
+	CHECK(clone->ComputeStateHash(allFlags) == world.ComputeStateHash(allFlags));
+	delete clone;
+}
+
+// Islands this large are solved by graph color, so they take the colored path with or
+// without an executor.
+static unsigned long long RunLargeScene(b2TaskExecutor* executor, b2Profile* profile, float* topHeight)
+{
+	b2World world(b2Vec2(0.0f, -10.0f));
+	world.SetTaskExecutor(executor);
+
+	b2BodyDef bodyDef;
+	b2Body* ground = world.CreateBody(&bodyDef);
+
+	b2EdgeShape edge;
+	edge.SetTwoSided(b2Vec2(-200.0f, 0.0f), b2Vec2(200.0f, 0.0f));
+	ground->CreateFixture(&edge, 0.0f);
+
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.5f);
+
+	const int32 rowCount = 20;
+	bodyDef.type = b2_dynamicBody;
+	b2Body* top = nullptr;
+	for (int32 i = 0; i < rowCount; ++i)
+	{
+		for (int32 j = i; j < rowCount; ++j)
+		{
+			bodyDef.position.Set(-30.0f + 0.5625f * i + 1.125f * (j - i), 0.5f + 1.0f * i);
+			top = world.CreateBody(&bodyDef);
+			top->CreateFixture(&box, 5.0f);
+		}
+	}
+
+	// A free chain lying on the ground, one island of joints.
+	b2PolygonShape link;
+	link.SetAsBox(0.5f, 0.125f);
+
+	b2Body* prev = nullptr;
+	for (int32 i = 0; i < 300; ++i)
+	{
+		bodyDef.position.Set(-150.0f + i, 0.125f);
+		b2Body* body = world.CreateBody(&bodyDef);
+		body->CreateFixture(&link, 20.0f);
+
+		if (prev != nullptr)
+		{
+			b2RevoluteJointDef jd;
+			jd.Initialize(prev, body, b2Vec2(-150.5f + i, 0.125f));
+			world.CreateJoint(&jd);
+		}
+		prev = body;
+	}
+
+	for (int32 i = 0; i < 120; ++i)
+	{
+		world.Step(1.0f / 60.0f, 8, 3);
+	}
+
+	*profile = world.GetProfile();
+	*topHeight = top->GetPosition().y;
+	return HashWorld(&world);
+}
+
+DOCTEST_TEST_CASE("graph coloring")
+{
+	// Without an executor the island is solved in its own order.
+	b2Profile profile;
+	float topHeight;
+	RunLargeScene(nullptr, &profile, &topHeight);
+	CHECK(profile.graphColorCount == 0);
+	CHECK(b2Abs(topHeight - 19.5f) < 0.5f);
+
+	// Any executor colors the island, so one thread and four give the same bits.
+	b2TaskExecutor serialExecutor;
+	unsigned long long hash = RunLargeScene(&serialExecutor, &profile, &topHeight);
+	CHECK(profile.graphColorCount > 0);
+	CHECK(b2Abs(topHeight - 19.5f) < 0.5f);
+
+	ThreadExecutor executor;
+	b2Profile threadedProfile;
+	float threadedHeight;
+	CHECK(RunLargeScene(&executor, &threadedProfile, &threadedHeight) == hash);
+	CHECK(threadedProfile.graphColorCount == profile.graphColorCount);
+}
@@ -104,3 +104,259 @@ DOCTEST_TEST_CASE("joint reactions")
 		CHECK(T == 0.0f);
 	}
 }
+
+// A hanging chain that cycles through joint types, so one island holds several batches.
+DOCTEST_TEST_CASE("mixed joint island")
+{
+	b2World world(b2Vec2(0.0f, -10.0f));
+
+	b2BodyDef bodyDef;
+	b2Body* ground = world.CreateBody(&bodyDef);
+
+	b2PolygonShape link;
+	link.SetAsBox(0.5f, 0.125f);
+
+	const int32 count = 12;
+	b2Body* bodies[count];
+	b2Joint* joints[count];
+	bodyDef.type = b2_dynamicBody;
+	b2Body* prev = ground;
+	for (int32 i = 0; i < count; ++i)
+	{
+		bodyDef.position.Set(0.5f + i, 20.0f);
+		b2Body* body = world.CreateBody(&bodyDef);
+		body->CreateFixture(&link, 1.0f);
+		bodies[i] = body;
+
+		b2Vec2 anchor(float(i), 20.0f);
+		switch (i % 3)
+		{
+		case 0:
+			{
+				b2RevoluteJointDef jd;
+				jd.Initialize(prev, body, anchor);
+				joints[i] = world.CreateJoint(&jd);
+			}
+			break;
+
+		case 1:
+			{
+				b2WeldJointDef jd;
+				jd.Initialize(prev, body, anchor);
+				joints[i] = world.CreateJoint(&jd);
+			}
+			break;
+
+		default:
+			{
+				b2DistanceJointDef jd;
+				jd.Initialize(prev, body, prev->GetPosition(), body->GetPosition());
+				joints[i] = world.CreateJoint(&jd);
+			}
+			break;
+		}
+
+		prev = body;
+	}
+
+	for (int32 i = 0; i < 180; ++i)
+	{
+		world.Step(1.0f / 60.0f, 8, 3);
+	}
+
+	CHECK(world.GetProfile().islandCount == 1);
+
+	// The chain swung down and every joint held
+	CHECK(bodies[count - 1]->GetPosition().y < 19.0f);
+	for (int32 i = 0; i < count; ++i)
+	{
+		float length = b2Distance(joints[i]->GetAnchorA(), joints[i]->GetAnchorB());
+		if (joints[i]->GetType() == e_distanceJoint)
+		{
+			CHECK(length == doctest::Approx(1.0f).epsilon(0.05f));
+		}
+		else
+		{
+			CHECK(length < 0.05f);
+		}
+	}
+}
+
+// Boxes hanging from a soft weld joint and a distance spring. The reaction forces come
+// from the impulses the island stores back into the joints.
+DOCTEST_TEST_CASE("soft joint island")
+{
+	b2World world(b2Vec2(0.0f, -10.0f));
+
+	b2BodyDef bodyDef;
+	b2Body* ground = world.CreateBody(&bodyDef);
+
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.5f);
+
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.position.Set(1.0f, 10.0f);
+	b2Body* weldBody = world.CreateBody(&bodyDef);
+	weldBody->CreateFixture(&box, 1.0f);
+
+	bodyDef.position.Set(5.0f, 8.0f);
+	bodyDef.fixedRotation = true;
+	b2Body* springBody = world.CreateBody(&bodyDef);
+	springBody->CreateFixture(&box, 1.0f);
+
+	b2WeldJointDef weldDef;
+	weldDef.Initialize(ground, weldBody, b2Vec2(0.5f, 10.0f));
+	weldDef.stiffness = 1000.0f;
+	weldDef.damping = 100.0f;
+	b2WeldJoint* weldJoint = (b2WeldJoint*)world.CreateJoint(&weldDef);
+
+	b2DistanceJointDef distanceDef;
+	distanceDef.Initialize(ground, springBody, b2Vec2(5.0f, 10.0f), b2Vec2(5.0f, 8.0f));
+	distanceDef.minLength = 1.0f;
+	distanceDef.maxLength = 4.0f;
+	b2LinearStiffness(distanceDef.stiffness, distanceDef.damping, 2.0f, 1.0f, ground, springBody);
+	b2DistanceJoint* distanceJoint = (b2DistanceJoint*)world.CreateJoint(&distanceDef);
+
+	const float timeStep = 1.0f / 60.0f;
+	for (int32 i = 0; i < 600; ++i)
+	{
+		world.Step(timeStep, 8, 3);
+	}
+
+	// The weld joint sags under the torque of the offset box but holds the anchor
+	CHECK(b2Distance(weldJoint->GetAnchorA(), weldJoint->GetAnchorB()) < 0.01f);
+	CHECK(weldBody->GetAngle() < -0.001f);
+
+	// The spring stretched past its rest length and carries the weight
+	float length = b2Distance(distanceJoint->GetAnchorA(), distanceJoint->GetAnchorB());
+	CHECK(length > 2.0f);
+	CHECK(length < 4.0f);
+
+	float invTimeStep = 60.0f;
+	float weldWeight = weldBody->GetMass() * 10.0f;
+	float springWeight = springBody->GetMass() * 10.0f;
+	CHECK(weldJoint->GetReactionForce(invTimeStep).y == doctest::Approx(weldWeight).epsilon(0.01f));
+	CHECK(distanceJoint->GetReactionForce(invTimeStep).y == doctest::Approx(springWeight).epsilon(0.01f));
+}
+
+// A chain hanging from the ground with a heavy weight at the end, stepped with few
+// iterations. Returns the largest gap between joint anchors.
+static float RunHangingChain(bool chainSolving, bool subStepping, int32* chainJointCount)
+{
+	b2World world(b2Vec2(0.0f, -10.0f));
+	world.SetChainSolving(chainSolving);
+	world.SetSubStepping(subStepping);
+
+	b2BodyDef bodyDef;
+	b2Body* ground = world.CreateBody(&bodyDef);
+
+	b2PolygonShape link;
+	link.SetAsBox(0.5f, 0.125f);
+
+	b2FixtureDef fd;
+	fd.shape = &link;
+	fd.density = 20.0f;
+	fd.filter.groupIndex = -1;
+
+	const int32 linkCount = 30;
+	bodyDef.type = b2_dynamicBody;
+	b2Body* prev = ground;
+	for (int32 i = 0; i < linkCount; ++i)
+	{
+		bodyDef.position.Set(0.5f + i, 20.0f);
+		b2Body* body = world.CreateBody(&bodyDef);
+		body->CreateFixture(&fd);
+
+		b2RevoluteJointDef jd;
+		jd.Initialize(prev, body, b2Vec2(float(i), 20.0f));
+		world.CreateJoint(&jd);
+		prev = body;
+	}
+
+	b2CircleShape circle;
+	circle.m_radius = 1.0f;
+	fd.shape = &circle;
+	fd.density = 200.0f;
+
+	bodyDef.position.Set(linkCount + 1.0f, 20.0f);
+	b2Body* weight = world.CreateBody(&bodyDef);
+	weight->CreateFixture(&fd);
+
+	b2RevoluteJointDef jd;
+	jd.Initialize(prev, weight, b2Vec2(float(linkCount), 20.0f));
+	world.CreateJoint(&jd);
+
+	float maxGap = 0.0f;
+	for (int32 i = 0; i < 120; ++i)
+	{
+		world.Step(1.0f / 60.0f, 4, 2);
+
+		for (b2Joint* joint = world.GetJointList(); joint; joint = joint->GetNext())
+		{
+			maxGap = b2Max(maxGap, b2Distance(joint->GetAnchorA(), joint->GetAnchorB()));
+		}
+	}
+
+	*chainJointCount = world.GetProfile().chainJointCount;
+	return maxGap;
+}
+
+DOCTEST_TEST_CASE("chain solving")
+{
+	int32 chainJointCount;
+	float iterativeGap = RunHangingChain(false, false, &chainJointCount);
+	CHECK(chainJointCount == 0);
+
+	float chainGap = RunHangingChain(true, false, &chainJointCount);
+	CHECK(chainJointCount == 31);
+	CHECK(chainGap < 0.5f * iterativeGap);
+
+	// Sub-steps correct the positions more often, so the exact velocities matter more.
+	float iterativeSubStepGap = RunHangingChain(false, true, &chainJointCount);
+	float chainSubStepGap = RunHangingChain(true, true, &chainJointCount);
+	CHECK(chainJointCount == 31);
+	CHECK(chainSubStepGap < 0.25f * iterativeSubStepGap);
+
+	// A bridge is one chain from ground to ground. A body with three joints splits it.
+	b2World world(b2Vec2(0.0f, -10.0f));
+	world.SetChainSolving(true);
+
+	b2BodyDef bodyDef;
+	b2Body* ground = world.CreateBody(&bodyDef);
+
+	b2PolygonShape plank;
+	plank.SetAsBox(0.5f, 0.125f);
+
+	bodyDef.type = b2_dynamicBody;
+	b2Body* planks[20];
+	b2Body* prev = ground;
+	for (int32 i = 0; i < 20; ++i)
+	{
+		bodyDef.position.Set(0.5f + i, 5.0f);
+		planks[i] = world.CreateBody(&bodyDef);
+		planks[i]->CreateFixture(&plank, 20.0f);
+
+		b2RevoluteJointDef jd;
+		jd.Initialize(prev, planks[i], b2Vec2(float(i), 5.0f));
+		world.CreateJoint(&jd);
+		prev = planks[i];
+	}
+
+	b2RevoluteJointDef jd;
+	jd.Initialize(prev, ground, b2Vec2(20.0f, 5.0f));
+	b2Joint* last = world.CreateJoint(&jd);
+
+	world.Step(1.0f / 60.0f, 8, 3);
+	CHECK(world.GetProfile().chainJointCount == 21);
+
+	// The planks on both sides of plank 10 still form chains.
+	jd.Initialize(planks[10], ground, planks[10]->GetPosition());
+	world.CreateJoint(&jd);
+	world.Step(1.0f / 60.0f, 8, 3);
+	CHECK(world.GetProfile().chainJointCount == 19);
+
+	// A limit takes the joint out of its chain.
+	static_cast<b2RevoluteJoint*>(last)->EnableLimit(true);
+	world.Step(1.0f / 60.0f, 8, 3);
+	CHECK(world.GetProfile().chainJointCount == 18);
+}
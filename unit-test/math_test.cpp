@@ -39,16 +39,59 @@ DOCTEST_TEST_CASE("math test")
 
 		b2Transform transform;
 
+#if defined(B2_DETERMINISTIC)
+		// The deterministic build does not use the standard library.
+		b2Rot q1(sweep.a1);
+		b2Rot q2(sweep.a2);
+#else
+		b2Rot q1, q2;
+		q1.c = cosf(sweep.a1);
+		q1.s = sinf(sweep.a1);
+		q2.c = cosf(sweep.a2);
+		q2.s = sinf(sweep.a2);
+#endif
+
 		sweep.GetTransform(&transform, 0.0f);
 		DOCTEST_REQUIRE_EQ(transform.p.x, sweep.c1.x);
 		DOCTEST_REQUIRE_EQ(transform.p.y, sweep.c1.y);
-		DOCTEST_REQUIRE_EQ(transform.q.c, cosf(sweep.a1));
-		DOCTEST_REQUIRE_EQ(transform.q.s, sinf(sweep.a1));
+		DOCTEST_REQUIRE_EQ(transform.q.c, q1.c);
+		DOCTEST_REQUIRE_EQ(transform.q.s, q1.s);
 
 		sweep.GetTransform(&transform, 1.0f);
 		DOCTEST_REQUIRE_EQ(transform.p.x, sweep.c2.x);
 		DOCTEST_REQUIRE_EQ(transform.p.y, sweep.c2.y);
-		DOCTEST_REQUIRE_EQ(transform.q.c, cosf(sweep.a2));
-		DOCTEST_REQUIRE_EQ(transform.q.s, sinf(sweep.a2));
+		DOCTEST_REQUIRE_EQ(transform.q.c, q2.c);
+		DOCTEST_REQUIRE_EQ(transform.q.s, q2.s);
+	}
+
+	SUBCASE("deterministic functions")
+	{
+		float maxTrigError = 0.0f;
+		float maxExpError = 0.0f;
+		for (int32 i = -2000; i <= 2000; ++i)
+		{
+			float angle = 0.01f * i;
+			float c, s;
+			b2ComputeCosSin(angle, &c, &s);
+			maxTrigError = b2Max(maxTrigError, b2Abs(c - cosf(angle)));
+			maxTrigError = b2Max(maxTrigError, b2Abs(s - sinf(angle)));
+
+			float x = cosf(0.37f * i);
+			float y = sinf(0.37f * i) * (1.0f + 0.001f * i);
+			maxTrigError = b2Max(maxTrigError, b2Abs(b2ComputeAtan2(y, x) - atan2f(y, x)));
+
+			float e = 0.02f * i;
+			maxExpError = b2Max(maxExpError, b2Abs(b2ComputeExp(e) - expf(e)) / expf(e));
+		}
+
+		DOCTEST_CHECK(maxTrigError < 1.0e-6f);
+		DOCTEST_CHECK(maxExpError < 1.0e-6f);
+
+		DOCTEST_CHECK(b2ComputeAtan2(0.0f, 0.0f) == 0.0f);
+		DOCTEST_CHECK(b2ComputeAtan2(1.0f, 0.0f) == doctest::Approx(0.5f * b2_pi));
+		DOCTEST_CHECK(b2ComputeAtan2(0.0f, -1.0f) == doctest::Approx(b2_pi));
+		DOCTEST_CHECK(b2ComputeAtan2(-1.0f, -1.0f) == doctest::Approx(-0.75f * b2_pi));
+		DOCTEST_CHECK(b2ComputeExp(0.0f) == 1.0f);
+		DOCTEST_CHECK(b2ComputeExp(-100.0f) == 0.0f);
 	}
 }
@@ -0,0 +1,371 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "box2d/box2d.h"
+#include "box2d/b2_rope_system.h"
+#include "box2d/b2_task.h"
+#include "doctest.h"
+
+// Splits the work into single item ranges and runs them in reverse to mimic
+// out of order execution on worker threads.
+class ReverseExecutor : public b2TaskExecutor
+{
+public:
+	int32 GetThreadCount() const override
+	{
+		return 4;
+	}
+
+	void ParallelFor(b2Task* task, int32 itemCount, int32 minRange) override
+	{
+		B2_NOT_USED(minRange);
+		for (int32 i = itemCount - 1; i >= 0; --i)
+		{
+			task->Execute(i, i + 1, i % 4);
+		}
+	}
+};
+
+static void CreateRopes(b2RopeSystem* system, int32 ropeCount)
+{
+	const int32 count = 20;
+	b2Vec2 vertices[count];
+	float masses[count];
+
+	for (int32 i = 0; i < count; ++i)
+	{
+		vertices[i].Set(0.0f, -0.25f * i);
+		masses[i] = 1.0f;
+	}
+	masses[0] = 0.0f;
+
+	b2RopeDef def;
+	def.vertices = vertices;
+	def.count = count;
+	def.masses = masses;
+	def.gravity.Set(0.0f, -10.0f);
+
+	for (int32 i = 0; i < ropeCount; ++i)
+	{
+		def.position.Set(2.0f * i, 10.0f);
+		def.tuning.bendingModel = (i & 1) ? b2_pbdAngleBendingModel : b2_pbdTriangleBendingModel;
+		int32 index = system->CreateRope(def);
+		CHECK(index == i);
+	}
+}
+
+DOCTEST_TEST_CASE("rope system")
+{
+	const int32 ropeCount = 9;
+
+	b2RopeSystem serial;
+	CreateRopes(&serial, ropeCount);
+
+	ReverseExecutor executor;
+	b2RopeSystem parallel;
+	parallel.SetTaskExecutor(&executor);
+	CreateRopes(&parallel, ropeCount);
+
+	for (int32 i = 0; i < 60; ++i)
+	{
+		// Swing the anchors sideways
+		for (int32 j = 0; j < ropeCount; ++j)
+		{
+			b2Vec2 position(2.0f * j + 0.05f * i, 10.0f);
+			serial.SetPosition(j, position);
+			parallel.SetPosition(j, position);
+		}
+
+		serial.Step(1.0f / 60.0f, 8);
+		parallel.Step(1.0f / 60.0f, 8);
+	}
+
+	const b2RopeProfile& profile = parallel.GetProfile();
+	CHECK(profile.ropeCount == ropeCount);
+	CHECK(profile.particleCount == 20 * ropeCount);
+	CHECK(profile.constraintCount == (19 + 18) * ropeCount);
+	CHECK(profile.step >= 0.0f);
+
+	for (int32 i = 0; i < ropeCount; ++i)
+	{
+		REQUIRE(serial.GetParticleCount(i) == 20);
+		const b2Vec2* ps1 = serial.GetPositions(i);
+		const b2Vec2* ps2 = parallel.GetPositions(i);
+
+		// Ropes are independent, so the execution order cannot change the result
+		for (int32 j = 0; j < 20; ++j)
+		{
+			CHECK(ps1[j].x == ps2[j].x);
+			CHECK(ps1[j].y == ps2[j].y);
+		}
+
+		// The anchor follows the target and the segments stay near rest length
+		CHECK(ps1[0].x == doctest::Approx(2.0f * i + 0.05f * 59.0f));
+		CHECK(ps1[0].y == doctest::Approx(10.0f));
+
+		for (int32 j = 0; j < 19; ++j)
+		{
+			float L = b2Distance(ps1[j], ps1[j + 1]);
+			CHECK(L < 0.3f);
+			CHECK(L > 0.2f);
+		}
+	}
+
+	parallel.Reset(0, b2Vec2(-5.0f, 0.0f));
+	const b2Vec2* ps = parallel.GetPositions(0);
+	CHECK(ps[19].x == -5.0f);
+	CHECK(ps[19].y == -0.25f * 19.0f);
+
+	parallel.Clear();
+	CHECK(parallel.GetRopeCount() == 0);
+}
+
+DOCTEST_TEST_CASE("rope world coupling")
+{
+	b2Vec2 gravity(0.0f, -10.0f);
+	b2World world(gravity);
+
+	b2RopeSystem ropes;
+	world.SetRopeSystem(&ropes);
+	CHECK(world.GetRopeSystem() == &ropes);
+
+	b2BodyDef bodyDef;
+	b2Body* ground = world.CreateBody(&bodyDef);
+
+	b2PolygonShape box;
+	box.SetAsBox(20.0f, 1.0f, b2Vec2(0.0f, -1.0f), 0.0f);
+	ground->CreateFixture(&box, 0.0f);
+
+	const int32 count = 10;
+	b2Vec2 vertices[count];
+	float masses[count];
+
+	b2RopeDef def;
+	def.vertices = vertices;
+	def.count = count;
+	def.masses = masses;
+	def.gravity = gravity;
+
+	// A rope dropped on the ground
+	for (int32 i = 0; i < count; ++i)
+	{
+		vertices[i].Set(0.25f * i, 1.0f);
+		masses[i] = 1.0f;
+	}
+	int32 lying = ropes.CreateRope(def);
+
+	// A weight hanging from a static anchor
+	for (int32 i = 0; i < count; ++i)
+	{
+		vertices[i].Set(10.0f, 10.0f - 0.25f * i);
+	}
+	int32 hanging = ropes.CreateRope(def);
+	ropes.Attach(hanging, 0, ground, b2Vec2(10.0f, 10.0f));
+
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.position = vertices[count - 1];
+	b2Body* weight = world.CreateBody(&bodyDef);
+
+	box.SetAsBox(0.1f, 0.1f);
+	weight->CreateFixture(&box, 25.0f);
+	ropes.Attach(hanging, count - 1, weight, b2Vec2_zero);
+	CHECK(ropes.GetAttachmentCount() == 2);
+
+	for (int32 i = 0; i < 120; ++i)
+	{
+		world.Step(1.0f / 60.0f, 8, 3);
+	}
+
+	const b2Vec2* ps = ropes.GetPositions(lying);
+	for (int32 i = 0; i < count; ++i)
+	{
+		CHECK(ps[i].y > 0.0f);
+		CHECK(ps[i].y < 0.1f);
+	}
+
+	// The rope holds the weight and the weight stretches the rope
+	ps = ropes.GetPositions(hanging);
+	CHECK(b2Distance(ps[0], b2Vec2(10.0f, 10.0f)) < 0.01f);
+	CHECK(b2Distance(ps[count - 1], weight->GetPosition()) < 0.05f);
+	CHECK(weight->GetPosition().y > 7.0f);
+	CHECK(weight->GetPosition().y < 7.75f);
+	CHECK(b2Abs(weight->GetLinearVelocity().y) < 0.5f);
+
+	// Destroying the body removes the attachment
+	world.DestroyBody(weight);
+	CHECK(ropes.GetAttachmentCount() == 1);
+
+	// Shifting the origin moves the ropes
+	world.ShiftOrigin(b2Vec2(10.0f, 0.0f));
+	ps = ropes.GetPositions(hanging);
+	CHECK(b2Distance(ps[0], b2Vec2(0.0f, 10.0f)) < 0.01f);
+
+	world.SetRopeSystem(nullptr);
+}
+
+DOCTEST_TEST_CASE("rope deep penetration")
+{
+	b2Vec2 gravity(0.0f, -10.0f);
+	b2World* world = new b2World(gravity);
+
+	b2RopeSystem ropes;
+	world->SetRopeSystem(&ropes);
+
+	b2BodyDef bodyDef;
+	b2Body* ground = world->CreateBody(&bodyDef);
+
+	b2PolygonShape box;
+	box.SetAsBox(20.0f, 5.0f, b2Vec2(0.0f, -5.0f), 0.0f);
+	ground->CreateFixture(&box, 0.0f);
+
+	const int32 count = 10;
+	b2Vec2 vertices[count];
+	float masses[count];
+
+	b2RopeDef def;
+	def.vertices = vertices;
+	def.count = count;
+	def.masses = masses;
+	def.gravity = gravity;
+
+	// A rope that starts inside the ground
+	for (int32 i = 0; i < count; ++i)
+	{
+		vertices[i].Set(-10.0f + 0.25f * i, -1.0f);
+		masses[i] = 1.0f;
+	}
+	int32 buried = ropes.CreateRope(def);
+
+	// A rope falling fast enough to reach the core of the ground in one step
+	for (int32 i = 0; i < count; ++i)
+	{
+		vertices[i].Set(5.0f + 0.25f * i, 30.0f);
+	}
+	int32 falling = ropes.CreateRope(def);
+
+	for (int32 i = 0; i < 180; ++i)
+	{
+		world->Step(1.0f / 60.0f, 8, 3);
+	}
+
+	const b2Vec2* ps = ropes.GetPositions(buried);
+	for (int32 i = 0; i < count; ++i)
+	{
+		CHECK(ps[i].y > 0.0f);
+		CHECK(ps[i].y < 0.1f);
+	}
+
+	ps = ropes.GetPositions(falling);
+	for (int32 i = 0; i < count; ++i)
+	{
+		CHECK(ps[i].y > 0.0f);
+		CHECK(ps[i].y < 0.1f);
+	}
+
+	// Destroying the world releases the attachments
+	ropes.Attach(falling, 0, ground, b2Vec2(5.0f, 0.0f));
+	CHECK(ropes.GetAttachmentCount() == 1);
+
+	delete world;
+	CHECK(ropes.GetAttachmentCount() == 0);
+
+	// The rope now falls freely
+	float y0 = ropes.GetPositions(falling)[0].y;
+	ropes.Step(1.0f / 60.0f, 8);
+	CHECK(ropes.GetPositions(falling)[0].y < y0);
+}
+
+DOCTEST_TEST_CASE("rope wakes bodies")
+{
+	b2Vec2 gravity(0.0f, -10.0f);
+	b2World world(gravity);
+
+	b2RopeSystem ropes;
+	world.SetRopeSystem(&ropes);
+
+	b2BodyDef bodyDef;
+	b2Body* ground = world.CreateBody(&bodyDef);
+
+	b2PolygonShape box;
+	box.SetAsBox(20.0f, 1.0f, b2Vec2(0.0f, -1.0f), 0.0f);
+	ground->CreateFixture(&box, 0.0f);
+
+	// A plank that falls asleep before the rope arrives
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.position.Set(0.0f, 0.5f);
+	b2Body* plank = world.CreateBody(&bodyDef);
+	box.SetAsBox(2.0f, 0.25f);
+	plank->CreateFixture(&box, 1.0f);
+
+	for (int32 i = 0; i < 120; ++i)
+	{
+		world.Step(1.0f / 60.0f, 8, 3);
+	}
+
+	REQUIRE(plank->IsAwake() == false);
+	float plankY = plank->GetPosition().y;
+
+	// A rope heavier than the plank
+	const int32 count = 10;
+	b2Vec2 vertices[count];
+	float masses[count];
+	for (int32 i = 0; i < count; ++i)
+	{
+		vertices[i].Set(-1.125f + 0.25f * i, 3.0f);
+		masses[i] = 1.0f;
+	}
+
+	b2RopeDef def;
+	def.vertices = vertices;
+	def.count = count;
+	def.masses = masses;
+	def.gravity = gravity;
+	int32 rope = ropes.CreateRope(def);
+
+	// The impact wakes the plank, which pushes back on the rope in the same step
+	bool woken = false;
+	for (int32 i = 0; i < 60 && woken == false; ++i)
+	{
+		world.Step(1.0f / 60.0f, 8, 3);
+		woken = plank->IsAwake();
+	}
+
+	CHECK(woken);
+	CHECK(plank->GetPosition().y == doctest::Approx(plankY).epsilon(0.01f));
+
+	// The rope comes to rest on the plank and lets it sleep again
+	for (int32 i = 0; i < 120; ++i)
+	{
+		world.Step(1.0f / 60.0f, 8, 3);
+	}
+
+	CHECK(plank->IsAwake() == false);
+	CHECK(plank->GetPosition().y == doctest::Approx(plankY).epsilon(0.01f));
+
+	float topY = plankY + 0.25f;
+	const b2Vec2* ps = ropes.GetPositions(rope);
+	for (int32 i = 0; i < count; ++i)
+	{
+		CHECK(ps[i].y > topY);
+		CHECK(ps[i].y < topY + 0.1f);
+	}
+}
@@ -0,0 +1,424 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "box2d/box2d.h"
+#include "doctest.h"
+
+#include <string.h>
+#include <vector>
+
+// A scene that touches every shape type and most joint types.
+static void CreateScene(b2World* world)
+{
+	b2BodyDef bodyDef;
+	b2Body* ground = world->CreateBody(&bodyDef);
+
+	b2Vec2 points[4] = { b2Vec2(-30.0f, 10.0f), b2Vec2(-20.0f, 0.0f), b2Vec2(20.0f, 0.0f), b2Vec2(30.0f, 10.0f) };
+	b2ChainShape chain;
+	chain.CreateChain(points, 4, b2Vec2(-40.0f, 10.0f), b2Vec2(40.0f, 10.0f));
+	ground->CreateFixture(&chain, 0.0f);
+
+	b2EdgeShape edge;
+	edge.SetTwoSided(b2Vec2(-5.0f, 4.0f), b2Vec2(5.0f, 3.0f));
+	ground->CreateFixture(&edge, 0.0f);
+
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.5f);
+
+	b2CircleShape circle;
+	circle.m_radius = 0.4f;
+
+	bodyDef.type = b2_dynamicBody;
+	for (int32 i = 0; i < 6; ++i)
+	{
+		for (int32 j = 0; j < 4; ++j)
+		{
+			bodyDef.position.Set(-3.0f + 1.1f * j + 0.1f * i, 6.0f + 1.05f * i);
+			b2Body* body = world->CreateBody(&bodyDef);
+			if ((i + j) % 3 == 0)
+			{
+				body->CreateFixture(&circle, 1.0f);
+			}
+			else
+			{
+				body->CreateFixture(&box, 1.0f);
+			}
+		}
+	}
+
+	// Pendulum chain
+	b2Body* prev = ground;
+	for (int32 i = 0; i < 5; ++i)
+	{
+		bodyDef.position.Set(10.0f + 1.0f * i, 15.0f);
+		b2Body* body = world->CreateBody(&bodyDef);
+		body->CreateFixture(&box, 1.0f);
+
+		b2RevoluteJointDef jd;
+		jd.Initialize(prev, body, b2Vec2(9.5f + 1.0f * i, 15.0f));
+		world->CreateJoint(&jd);
+		prev = body;
+	}
+
+	// Gear coupling a wheel and a slider
+	bodyDef.position.Set(-10.0f, 12.0f);
+	b2Body* wheel = world->CreateBody(&bodyDef);
+	wheel->CreateFixture(&circle, 1.0f);
+
+	b2RevoluteJointDef rjd;
+	rjd.Initialize(ground, wheel, bodyDef.position);
+	b2Joint* revolute = world->CreateJoint(&rjd);
+
+	bodyDef.position.Set(-12.0f, 12.0f);
+	b2Body* slider = world->CreateBody(&bodyDef);
+	slider->CreateFixture(&box, 1.0f);
+
+	b2PrismaticJointDef pjd;
+	pjd.Initialize(ground, slider, bodyDef.position, b2Vec2(0.0f, 1.0f));
+	pjd.enableLimit = true;
+	pjd.lowerTranslation = -5.0f;
+	pjd.upperTranslation = 5.0f;
+	b2Joint* prismatic = world->CreateJoint(&pjd);
+
+	b2GearJointDef gjd;
+	gjd.bodyA = wheel;
+	gjd.bodyB = slider;
+	gjd.joint1 = revolute;
+	gjd.joint2 = prismatic;
+	gjd.ratio = 2.0f;
+	world->CreateJoint(&gjd);
+
+	// Soft joints with warm started impulses
+	bodyDef.position.Set(15.0f, 8.0f);
+	b2Body* a = world->CreateBody(&bodyDef);
+	a->CreateFixture(&box, 1.0f);
+
+	bodyDef.position.Set(17.0f, 8.0f);
+	b2Body* b = world->CreateBody(&bodyDef);
+	b->CreateFixture(&circle, 1.0f);
+
+	b2DistanceJointDef djd;
+	djd.Initialize(ground, a, b2Vec2(15.0f, 12.0f), a->GetPosition());
+	b2LinearStiffness(djd.stiffness, djd.damping, 2.0f, 0.3f, ground, a);
+	world->CreateJoint(&djd);
+
+	b2WeldJointDef wjd;
+	wjd.Initialize(a, b, b2Vec2(16.0f, 8.0f));
+	b2AngularStiffness(wjd.stiffness, wjd.damping, 3.0f, 0.5f, a, b);
+	world->CreateJoint(&wjd);
+
+	b2WheelJointDef whjd;
+	bodyDef.position.Set(-16.0f, 10.0f);
+	b2Body* car = world->CreateBody(&bodyDef);
+	car->CreateFixture(&circle, 1.0f);
+	whjd.Initialize(a, car, car->GetPosition(), b2Vec2(0.0f, 1.0f));
+	whjd.enableMotor = true;
+	whjd.motorSpeed = 3.0f;
+	whjd.maxMotorTorque = 10.0f;
+	world->CreateJoint(&whjd);
+
+	b2MotorJointDef mjd;
+	mjd.Initialize(ground, b);
+	mjd.maxForce = 5.0f;
+	world->CreateJoint(&mjd);
+}
+
+static void CheckSameState(b2World* a, b2World* b)
+{
+	REQUIRE(a->GetBodyCount() == b->GetBodyCount());
+	REQUIRE(a->GetJointCount() == b->GetJointCount());
+	REQUIRE(a->GetContactCount() == b->GetContactCount());
+
+	const b2Body* ba = a->GetBodyList();
+	const b2Body* bb = b->GetBodyList();
+	while (ba && bb)
+	{
+		b2Transform xa = ba->GetTransform();
+		b2Transform xb = bb->GetTransform();
+		b2Vec2 va = ba->GetLinearVelocity();
+		b2Vec2 vb = bb->GetLinearVelocity();
+		float wa = ba->GetAngularVelocity();
+		float wb = bb->GetAngularVelocity();
+
+		// Bit exact
+		CHECK(memcmp(&xa, &xb, sizeof(b2Transform)) == 0);
+		CHECK(memcmp(&va, &vb, sizeof(b2Vec2)) == 0);
+		CHECK(memcmp(&wa, &wb, sizeof(float)) == 0);
+		CHECK(ba->IsAwake() == bb->IsAwake());
+
+		ba = ba->GetNext();
+		bb = bb->GetNext();
+	}
+}
+
+DOCTEST_TEST_CASE("snapshot continuation")
+{
+	const float timeStep = 1.0f / 60.0f;
+
+	b2World world(b2Vec2(0.0f, -10.0f));
+	CreateScene(&world);
+
+	for (int32 i = 0; i < 60; ++i)
+	{
+		world.Step(timeStep, 8, 3);
+	}
+
+	int32 size = world.GetSnapshotSize();
+	REQUIRE(size > 0);
+
+	std::vector<char> buffer(size);
+	CHECK(world.SaveSnapshot(buffer.data(), size - 1) == 0);
+	REQUIRE(world.SaveSnapshot(buffer.data(), size) == size);
+
+	// Restore into a world with different contents.
+	b2World copy(b2Vec2(0.0f, 0.0f));
+	CreateScene(&copy);
+	REQUIRE(copy.RestoreSnapshot(buffer.data(), size));
+	CHECK(copy.GetGravity().y == -10.0f);
+	CheckSameState(&world, &copy);
+
+	for (int32 i = 0; i < 120; ++i)
+	{
+		world.Step(timeStep, 8, 3);
+		copy.Step(timeStep, 8, 3);
+	}
+
+	CHECK(world.GetContactCount() > 0);
+	CheckSameState(&world, &copy);
+
+	// Rewind the copy and replay with sub-stepping, which uses the warm starting
+	// impulses differently.
+	std::vector<char> buffer2(world.GetSnapshotSize());
+	REQUIRE(world.SaveSnapshot(buffer2.data(), int32(buffer2.size())) == int32(buffer2.size()));
+
+	world.SetSubStepping(true);
+	copy.SetSubStepping(true);
+	for (int32 i = 0; i < 60; ++i)
+	{
+		world.Step(timeStep, 4, 0);
+		copy.Step(timeStep, 4, 0);
+	}
+
+	REQUIRE(copy.RestoreSnapshot(buffer2.data(), int32(buffer2.size())));
+	CHECK(copy.GetSubStepping() == false);
+	REQUIRE(world.RestoreSnapshot(buffer2.data(), int32(buffer2.size())));
+	for (int32 i = 0; i < 60; ++i)
+	{
+		world.Step(timeStep, 8, 3);
+		copy.Step(timeStep, 8, 3);
+	}
+
+	CheckSameState(&world, &copy);
+}
+
+DOCTEST_TEST_CASE("snapshot validation")
+{
+	b2World world(b2Vec2(0.0f, -10.0f));
+	CreateScene(&world);
+	world.Step(1.0f / 60.0f, 8, 3);
+
+	int32 size = world.GetSnapshotSize();
+	std::vector<char> buffer(size);
+	REQUIRE(world.SaveSnapshot(buffer.data(), size) == size);
+
+	b2World other(b2Vec2(0.0f, -10.0f));
+	CreateScene(&other);
+	int32 bodyCount = other.GetBodyCount();
+
+	// Truncated
+	CHECK(other.RestoreSnapshot(buffer.data(), size - 4) == false);
+
+	// Wrong version
+	buffer[4] ^= 0x7f;
+	CHECK(other.RestoreSnapshot(buffer.data(), size) == false);
+	buffer[4] ^= 0x7f;
+
+	// Rejected snapshots leave the world alone.
+	CHECK(other.GetBodyCount() == bodyCount);
+
+	CHECK(other.RestoreSnapshot(buffer.data(), size));
+	CHECK(other.GetBodyCount() == world.GetBodyCount());
+}
+
+DOCTEST_TEST_CASE("world clone")
+{
+	const float timeStep = 1.0f / 60.0f;
+
+	b2World world(b2Vec2(0.0f, -10.0f));
+	CreateScene(&world);
+
+	for (int32 i = 0; i < 30; ++i)
+	{
+		world.Step(timeStep, 8, 3);
+	}
+
+	b2World* fork = world.Clone();
+	CheckSameState(&world, fork);
+
+	// Lookahead on the fork does not disturb the original.
+	b2Vec2 p = world.GetBodyList()->GetPosition();
+	fork->GetBodyList()->ApplyLinearImpulseToCenter(b2Vec2(100.0f, 0.0f), true);
+	for (int32 i = 0; i < 10; ++i)
+	{
+		fork->Step(timeStep, 8, 3);
+	}
+	CHECK(world.GetBodyList()->GetPosition() == p);
+
+	// Rollback: reset the fork from the original and keep both in lockstep.
+	world.CopyTo(fork);
+	for (int32 i = 0; i < 90; ++i)
+	{
+		world.Step(timeStep, 8, 3);
+		fork->Step(timeStep, 8, 3);
+	}
+
+	CheckSameState(&world, fork);
+	delete fork;
+}
+
+DOCTEST_TEST_CASE("world copy reuses memory")
+{
+	b2World world(b2Vec2(0.0f, -10.0f));
+
+	b2BodyDef bodyDef;
+	b2Body* ground = world.CreateBody(&bodyDef);
+
+	b2EdgeShape edge;
+	edge.SetTwoSided(b2Vec2(-40.0f, 0.0f), b2Vec2(40.0f, 0.0f));
+	ground->CreateFixture(&edge, 0.0f);
+
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.5f);
+
+	bodyDef.type = b2_dynamicBody;
+	for (int32 i = 0; i < 10; ++i)
+	{
+		bodyDef.position.Set(0.0f, 0.5f + 1.0f * i);
+		world.CreateBody(&bodyDef)->CreateFixture(&box, 1.0f);
+	}
+
+	for (int32 i = 0; i < 30; ++i)
+	{
+		world.Step(1.0f / 60.0f, 8, 3);
+	}
+
+	// The first copy sizes the chunks and the tree of the target. Without chain
+	// shapes the next copies stay off the heap.
+	b2World fork(b2Vec2(0.0f, -10.0f));
+	world.CopyTo(&fork);
+
+	int32 allocationCount = b2GetAllocationCount();
+	world.CopyTo(&fork);
+	CHECK(b2GetAllocationCount() == allocationCount);
+	CHECK(fork.ComputeStateHash(b2World::e_hashContacts) == world.ComputeStateHash(b2World::e_hashContacts));
+}
+
+DOCTEST_TEST_CASE("world copy outlives the original")
+{
+	const float timeStep = 1.0f / 60.0f;
+
+	b2World* world = new b2World(b2Vec2(0.0f, -10.0f));
+	CreateScene(world);
+
+	// A long chain keeps its proxies out of the small block pools.
+	b2BodyDef bodyDef;
+	b2Body* ground = world->CreateBody(&bodyDef);
+	b2Vec2 points[40];
+	for (int32 i = 0; i < 40; ++i)
+	{
+		points[i].Set(-60.0f + 3.0f * i, -5.0f + 0.5f * sinf(0.7f * i));
+	}
+	b2ChainShape chain;
+	chain.CreateLoop(points, 40);
+	ground->CreateFixture(&chain, 0.0f);
+
+	// A pile far away that falls asleep.
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.5f);
+	bodyDef.type = b2_dynamicBody;
+	for (int32 i = 0; i < 5; ++i)
+	{
+		bodyDef.position.Set(100.0f, 0.5f + 1.0f * i);
+		world->CreateBody(&bodyDef)->CreateFixture(&box, 1.0f);
+	}
+	b2EdgeShape edge;
+	edge.SetTwoSided(b2Vec2(90.0f, 0.0f), b2Vec2(110.0f, 0.0f));
+	ground->CreateFixture(&edge, 0.0f);
+
+	for (int32 i = 0; i < 240; ++i)
+	{
+		world->Step(timeStep, 8, 3);
+	}
+
+	// The target holds a different and larger scene that the copy replaces.
+	b2World* fork = new b2World(b2Vec2(0.0f, -10.0f));
+	CreateScene(fork);
+	for (int32 i = 0; i < 3; ++i)
+	{
+		CreateScene(fork);
+		fork->Step(timeStep, 8, 3);
+	}
+
+	world->CopyTo(fork);
+	CheckSameState(world, fork);
+
+	bool sleeping = false;
+	for (b2Body* b = fork->GetBodyList(); b; b = b->GetNext())
+	{
+		sleeping = sleeping || (b->GetType() == b2_dynamicBody && b->IsAwake() == false);
+	}
+	CHECK(sleeping);
+
+	for (int32 i = 0; i < 60; ++i)
+	{
+		world->Step(timeStep, 8, 3);
+		fork->Step(timeStep, 8, 3);
+	}
+	CheckSameState(world, fork);
+
+	// Wake the pile in both worlds, then drop the original.
+	for (b2Body* a = world->GetBodyList(), *b = fork->GetBodyList(); a; a = a->GetNext(), b = b->GetNext())
+	{
+		a->SetAwake(true);
+		b->SetAwake(true);
+	}
+	world->Step(timeStep, 8, 3);
+	fork->Step(timeStep, 8, 3);
+	CheckSameState(world, fork);
+	unsigned long long hash = world->ComputeStateHash(b2World::e_hashContacts);
+	delete world;
+
+	CHECK(fork->ComputeStateHash(b2World::e_hashContacts) == hash);
+	for (int32 i = 0; i < 60; ++i)
+	{
+		fork->Step(timeStep, 8, 3);
+	}
+	while (fork->GetJointList())
+	{
+		fork->DestroyJoint(fork->GetJointList());
+	}
+	while (fork->GetBodyList())
+	{
+		fork->DestroyBody(fork->GetBodyList());
+	}
+	CHECK(fork->GetContactCount() == 0);
+	delete fork;
+}
@@ -0,0 +1,540 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+#include "box2d/box2d.h"
+#include "doctest.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <vector>
+
+// A ground line and a box loop standing on it.
+static std::vector<uint32> BuildGround()
+{
+	// One-sided edges collide on the right side, so the line runs from right to left.
+	b2Vec2 line[3] = { b2Vec2(40.0f, 0.0f), b2Vec2(0.0f, 0.0f), b2Vec2(-40.0f, 0.0f) };
+	b2Vec2 box[4] = { b2Vec2(10.0f, 0.0f), b2Vec2(14.0f, 0.0f), b2Vec2(14.0f, 2.0f), b2Vec2(10.0f, 2.0f) };
+
+	b2StaticChainDef chains[2];
+	chains[0].vertices = line;
+	chains[0].count = 3;
+	chains[0].prevVertex.Set(41.0f, 0.0f);
+	chains[0].nextVertex.Set(-41.0f, 0.0f);
+	chains[1].vertices = box;
+	chains[1].count = 4;
+	chains[1].loop = true;
+
+	int32 size = b2BuildStaticLayer(chains, 2, nullptr, 0);
+	CHECK(size > 0);
+
+	std::vector<uint32> blob((size + 3) / 4);
+	int32 written = b2BuildStaticLayer(chains, 2, blob.data(), int32(blob.size() * 4));
+	CHECK(0 < written);
+	CHECK(written <= size);
+	blob.resize((written + 3) / 4);
+	return blob;
+}
+
+struct LayerQueryCallback : public b2QueryCallback
+{
+	bool ReportFixture(b2Fixture* fixture) override
+	{
+		fixtures.push_back(fixture);
+		return true;
+	}
+
+	std::vector<b2Fixture*> fixtures;
+};
+
+struct LayerRayCastCallback : public b2RayCastCallback
+{
+	float ReportFixture(b2Fixture* fixture, const b2Vec2& point, const b2Vec2& normal, float fraction) override
+	{
+		this->fixture = fixture;
+		this->point = point;
+		this->normal = normal;
+		return fraction;
+	}
+
+	b2Fixture* fixture = nullptr;
+	b2Vec2 point = b2Vec2_zero;
+	b2Vec2 normal = b2Vec2_zero;
+};
+
+DOCTEST_TEST_CASE("static layer build")
+{
+	std::vector<uint32> blob = BuildGround();
+
+	// The build does not depend on the buffer contents.
+	std::vector<uint32> other = BuildGround();
+	REQUIRE(other.size() == blob.size());
+	CHECK(memcmp(other.data(), blob.data(), blob.size() * 4) == 0);
+
+	b2World world(b2Vec2(0.0f, -10.0f));
+
+	b2StaticLayerDef def;
+	def.data = blob.data();
+	def.size = int32(blob.size() * 4);
+	b2StaticLayer* layer = world.CreateStaticLayer(&def);
+	REQUIRE(layer != nullptr);
+	CHECK(layer->GetEdgeCount() == 6);
+	CHECK(layer->GetBody()->IsStaticLayer());
+	CHECK(layer->GetBody()->GetType() == b2_staticBody);
+	CHECK(layer->GetFixture()->GetType() == b2Shape::e_chain);
+	CHECK(world.GetStaticLayerList() == layer);
+	CHECK(world.GetBodyCount() == 1);
+	CHECK(world.GetProxyCount() == 0);
+
+	// Reject damaged blobs.
+	std::vector<uint32> damaged = blob;
+	damaged[0] ^= 1;
+	def.data = damaged.data();
+	CHECK(world.CreateStaticLayer(&def) == nullptr);
+
+	// The header is ten words: magic, version, byte count, vertex count, edge count,
+	// node count, root, then the vertex, AABB and node offsets.
+	int32 nodeCount = int32(blob[5]);
+	REQUIRE(nodeCount > 1);
+
+	damaged = blob;
+	damaged[6] = uint32(-2);
+	def.data = damaged.data();
+	CHECK(world.CreateStaticLayer(&def) == nullptr);
+
+	damaged[6] = uint32(nodeCount);
+	CHECK(world.CreateStaticLayer(&def) == nullptr);
+
+	// Children must point forward into the node array or name an edge.
+	int32 childWord = int32((blob[9] + offsetof(b2CompactNode, children)) / 4);
+	int32 root = int32(blob[6]);
+	REQUIRE(root == 0);
+
+	damaged = blob;
+	damaged[childWord] = uint32(root);
+	def.data = damaged.data();
+	CHECK(world.CreateStaticLayer(&def) == nullptr);
+
+	damaged[childWord] = uint32(nodeCount);
+	CHECK(world.CreateStaticLayer(&def) == nullptr);
+
+	int32 vertexCount = int32(blob[3]);
+	damaged[childWord] = uint32(b2CompactNode::EncodeLeaf(vertexCount - 1));
+	CHECK(world.CreateStaticLayer(&def) == nullptr);
+
+	damaged[childWord] = 0x80000000u;
+	CHECK(world.CreateStaticLayer(&def) == nullptr);
+
+	def.data = blob.data();
+	def.size = 8;
+	CHECK(world.CreateStaticLayer(&def) == nullptr);
+	CHECK(world.GetBodyCount() == 1);
+
+	world.DestroyStaticLayer(layer);
+	CHECK(world.GetStaticLayerList() == nullptr);
+	CHECK(world.GetBodyCount() == 0);
+}
+
+DOCTEST_TEST_CASE("static layer collision")
+{
+	std::vector<uint32> blob = BuildGround();
+
+	b2World world(b2Vec2(0.0f, -10.0f));
+
+	// Bodies that exist before the layer must find it too.
+	b2BodyDef bodyDef;
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.position.Set(-30.0f, 1.0f);
+	b2Body* early = world.CreateBody(&bodyDef);
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.5f);
+	early->CreateFixture(&box, 1.0f);
+
+	b2StaticLayerDef def;
+	def.data = blob.data();
+	def.size = int32(blob.size() * 4);
+	def.friction = 0.6f;
+	b2StaticLayer* layer = world.CreateStaticLayer(&def);
+	REQUIRE(layer != nullptr);
+
+	b2CircleShape circle;
+	circle.m_radius = 0.5f;
+
+	std::vector<b2Body*> bodies;
+	bodies.push_back(early);
+	for (int32 i = 0; i < 8; ++i)
+	{
+		bodyDef.position.Set(-15.0f + 2.0f * i, 3.0f + 0.5f * i);
+		b2Body* body = world.CreateBody(&bodyDef);
+		if (i % 2 == 0)
+		{
+			body->CreateFixture(&box, 1.0f);
+		}
+		else
+		{
+			body->CreateFixture(&circle, 1.0f);
+		}
+		bodies.push_back(body);
+	}
+
+	// One on top of the loop.
+	bodyDef.position.Set(12.0f, 4.0f);
+	b2Body* top = world.CreateBody(&bodyDef);
+	top->CreateFixture(&box, 1.0f);
+
+	for (int32 i = 0; i < 300; ++i)
+	{
+		world.Step(1.0f / 60.0f, 8, 3);
+	}
+
+	for (size_t i = 0; i < bodies.size(); ++i)
+	{
+		CHECK(bodies[i]->GetPosition().y == doctest::Approx(0.5f).epsilon(0.02f));
+		CHECK(bodies[i]->IsAwake() == false);
+	}
+
+	CHECK(top->GetPosition().y == doctest::Approx(2.5f).epsilon(0.02f));
+
+	// Contacts report the layer fixture and the edge as the child index.
+	int32 layerContactCount = 0;
+	for (b2Contact* c = world.GetContactList(); c; c = c->GetNext())
+	{
+		b2Fixture* fixture = c->GetFixtureA() == layer->GetFixture() ? c->GetFixtureA() : c->GetFixtureB();
+		if (fixture != layer->GetFixture())
+		{
+			continue;
+		}
+
+		int32 childIndex = fixture == c->GetFixtureA() ? c->GetChildIndexA() : c->GetChildIndexB();
+		const b2AABB& aabb = layer->GetEdgeAABB(childIndex);
+		CHECK(aabb.lowerBound.x <= aabb.upperBound.x);
+
+		// Layer fixtures have no proxies but still report the edge bounds.
+		b2AABB fixtureAABB = fixture->GetAABB(childIndex);
+		CHECK(fixtureAABB.lowerBound.x == doctest::Approx(aabb.lowerBound.x));
+		CHECK(fixtureAABB.lowerBound.y == doctest::Approx(aabb.lowerBound.y));
+		CHECK(fixtureAABB.upperBound.x == doctest::Approx(aabb.upperBound.x));
+		CHECK(fixtureAABB.upperBound.y == doctest::Approx(aabb.upperBound.y));
+		CHECK(c->GetFriction() == doctest::Approx(b2MixFriction(0.6f, 0.2f)));
+		++layerContactCount;
+	}
+	CHECK(layerContactCount >= int32(bodies.size()) + 1);
+
+	// Without the layer everything falls.
+	world.DestroyStaticLayer(layer);
+	CHECK(world.GetContactCount() == 0);
+
+	for (size_t i = 0; i < bodies.size(); ++i)
+	{
+		bodies[i]->SetAwake(true);
+	}
+	top->SetAwake(true);
+
+	for (int32 i = 0; i < 60; ++i)
+	{
+		world.Step(1.0f / 60.0f, 8, 3);
+	}
+
+	for (size_t i = 0; i < bodies.size(); ++i)
+	{
+		CHECK(bodies[i]->GetPosition().y < -1.0f);
+	}
+}
+
+DOCTEST_TEST_CASE("static layer queries")
+{
+	std::vector<uint32> blob = BuildGround();
+
+	b2World world(b2Vec2(0.0f, -10.0f));
+
+	b2StaticLayerDef def;
+	def.data = blob.data();
+	def.size = int32(blob.size() * 4);
+	b2StaticLayer* layer = world.CreateStaticLayer(&def);
+	REQUIRE(layer != nullptr);
+
+	b2BodyDef bodyDef;
+	bodyDef.position.Set(-20.0f, 3.0f);
+	b2Body* body = world.CreateBody(&bodyDef);
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.5f);
+	b2Fixture* boxFixture = body->CreateFixture(&box, 0.0f);
+
+	{
+		LayerRayCastCallback callback;
+		world.RayCast(&callback, b2Vec2(-5.0f, 10.0f), b2Vec2(-5.0f, -10.0f));
+		CHECK(callback.fixture == layer->GetFixture());
+		CHECK(callback.point.y == doctest::Approx(0.0f));
+		CHECK(callback.normal.y == doctest::Approx(1.0f));
+	}
+
+	{
+		// The box is closer than the layer.
+		LayerRayCastCallback callback;
+		world.RayCast(&callback, b2Vec2(-20.0f, 10.0f), b2Vec2(-20.0f, -10.0f));
+		CHECK(callback.fixture == boxFixture);
+		CHECK(callback.point.y == doctest::Approx(3.5f));
+	}
+
+	{
+		// Top of the loop.
+		LayerRayCastCallback callback;
+		world.RayCast(&callback, b2Vec2(12.0f, 10.0f), b2Vec2(12.0f, -10.0f));
+		CHECK(callback.fixture == layer->GetFixture());
+		CHECK(callback.point.y == doctest::Approx(2.0f));
+	}
+
+	{
+		LayerRayCastCallback callback;
+		world.RayCast(&callback, b2Vec2(-5.0f, 10.0f), b2Vec2(-5.0f, 5.0f));
+		CHECK(callback.fixture == nullptr);
+	}
+
+	{
+		LayerQueryCallback callback;
+		b2AABB aabb;
+		aabb.lowerBound.Set(-30.0f, -1.0f);
+		aabb.upperBound.Set(30.0f, 5.0f);
+		world.QueryAABB(&callback, aabb);
+		REQUIRE(callback.fixtures.size() == 2);
+		CHECK(callback.fixtures[0] == boxFixture);
+		CHECK(callback.fixtures[1] == layer->GetFixture());
+	}
+
+	{
+		LayerQueryCallback callback;
+		b2AABB aabb;
+		aabb.lowerBound.Set(-5.0f, 1.0f);
+		aabb.upperBound.Set(5.0f, 5.0f);
+		world.QueryAABB(&callback, aabb);
+		CHECK(callback.fixtures.empty());
+	}
+
+	// The layer follows an origin shift.
+	world.ShiftOrigin(b2Vec2(0.0f, 10.0f));
+
+	{
+		LayerRayCastCallback callback;
+		world.RayCast(&callback, b2Vec2(-5.0f, 0.0f), b2Vec2(-5.0f, -20.0f));
+		CHECK(callback.fixture == layer->GetFixture());
+		CHECK(callback.point.y == doctest::Approx(-10.0f));
+	}
+}
+
+DOCTEST_TEST_CASE("static layer tree")
+{
+	std::vector<uint32> blob = BuildGround();
+
+	b2World world(b2Vec2(0.0f, -10.0f));
+
+	// A row of layers, the ground lines overlap where the layers meet.
+	b2StaticLayer* layers[4];
+	for (int32 i = 0; i < 4; ++i)
+	{
+		b2StaticLayerDef def;
+		def.data = blob.data();
+		def.size = int32(blob.size() * 4);
+		def.position.Set(60.0f * i, 10.0f * i);
+		layers[i] = world.CreateStaticLayer(&def);
+		REQUIRE(layers[i] != nullptr);
+	}
+
+	{
+		// Only the layer under the box is reported.
+		LayerQueryCallback callback;
+		b2AABB aabb;
+		aabb.lowerBound.Set(155.0f, 19.0f);
+		aabb.upperBound.Set(165.0f, 21.0f);
+		world.QueryAABB(&callback, aabb);
+		REQUIRE(callback.fixtures.size() == 1);
+		CHECK(callback.fixtures[0] == layers[2]->GetFixture());
+	}
+
+	{
+		// The ray crosses the ground of two layers and stops at the closer one.
+		LayerRayCastCallback callback;
+		world.RayCast(&callback, b2Vec2(90.0f, 40.0f), b2Vec2(90.0f, -10.0f));
+		CHECK(callback.fixture == layers[2]->GetFixture());
+		CHECK(callback.point.y == doctest::Approx(20.0f));
+	}
+
+	// A box dropped on the last layer only pairs with that layer.
+	b2BodyDef bodyDef;
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.position.Set(190.0f, 31.0f);
+	b2Body* body = world.CreateBody(&bodyDef);
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.5f);
+	body->CreateFixture(&box, 1.0f);
+
+	for (int32 i = 0; i < 60; ++i)
+	{
+		world.Step(1.0f / 60.0f, 8, 3);
+	}
+
+	REQUIRE(body->GetContactList() != nullptr);
+	CHECK(body->GetContactList()->contact->GetFixtureA() == layers[3]->GetFixture());
+	CHECK(body->GetPosition().y == doctest::Approx(30.5f).epsilon(0.01f));
+
+	// The tree follows removal and origin shifts.
+	b2Fixture* fixture1 = layers[1]->GetFixture();
+	b2Fixture* fixture3 = layers[3]->GetFixture();
+	world.DestroyStaticLayer(layers[2]);
+	world.ShiftOrigin(b2Vec2(100.0f, 0.0f));
+
+	{
+		LayerQueryCallback callback;
+		b2AABB aabb;
+		aabb.lowerBound.Set(0.0f, 0.0f);
+		aabb.upperBound.Set(60.0f, 40.0f);
+		world.QueryAABB(&callback, aabb);
+		REQUIRE(callback.fixtures.size() == 2);
+		bool found1 = callback.fixtures[0] == fixture1 || callback.fixtures[1] == fixture1;
+		bool found3 = callback.fixtures[0] == fixture3 || callback.fixtures[1] == fixture3;
+		CHECK(found1);
+		CHECK(found3);
+	}
+}
+
+static int32 CountLayers(b2World* world)
+{
+	int32 count = 0;
+	for (b2StaticLayer* layer = world->GetStaticLayerList(); layer; layer = layer->GetNext())
+	{
+		++count;
+	}
+	return count;
+}
+
+DOCTEST_TEST_CASE("static tile streaming")
+{
+	b2World world(b2Vec2(0.0f, -10.0f));
+
+	// Tiles share local geometry and differ by position.
+	b2Vec2 line[2] = { b2Vec2(5.0f, 0.0f), b2Vec2(-5.0f, 0.0f) };
+	b2StaticChainDef chain;
+	chain.vertices = line;
+	chain.count = 2;
+	chain.prevVertex.Set(6.0f, 0.0f);
+	chain.nextVertex.Set(-6.0f, 0.0f);
+
+	b2StaticTileDef def;
+	def.chains = &chain;
+	def.chainCount = 1;
+
+	b2StaticTile* tiles[3];
+	for (int32 i = 0; i < 3; ++i)
+	{
+		def.position.Set(10.0f * i, 0.0f);
+		tiles[i] = world.AddStaticTile(&def);
+		CHECK(tiles[i]->IsLoaded() == false);
+	}
+
+	// The geometry was copied.
+	line[0].SetZero();
+	line[1].SetZero();
+
+	CHECK(world.GetStaticTileQueueCount() == 3);
+	CHECK(world.GetStaticTileList() == tiles[2]);
+	CHECK(CountLayers(&world) == 0);
+
+	// A tile removed before loading is never built.
+	world.RemoveStaticTile(tiles[1]);
+	CHECK(world.GetStaticTileQueueCount() == 3);
+	CHECK(world.GetStaticTileList() == tiles[2]);
+	CHECK(tiles[2]->GetNext() == tiles[0]);
+
+	// Serve one request per step.
+	world.SetStaticTileBudget(1.0e-6f);
+	world.Step(1.0f / 60.0f, 8, 3);
+	CHECK(world.GetStaticTileQueueCount() == 2);
+	CHECK(tiles[0]->IsLoaded());
+	CHECK(tiles[2]->IsLoaded() == false);
+
+	world.Step(1.0f / 60.0f, 8, 3);
+	CHECK(world.GetStaticTileQueueCount() == 1);
+	CHECK(CountLayers(&world) == 1);
+
+	world.Step(1.0f / 60.0f, 8, 3);
+	CHECK(world.GetStaticTileQueueCount() == 0);
+	CHECK(tiles[2]->IsLoaded());
+	CHECK(CountLayers(&world) == 2);
+	CHECK(world.GetProfile().tiles >= 0.0f);
+
+	b2StaticLayer* layer = tiles[2]->GetLayer();
+	CHECK(layer->GetBody()->GetPosition() == b2Vec2(20.0f, 0.0f));
+	CHECK(layer->GetEdgeCount() == 1);
+
+	// Bodies rest on the loaded tiles and fall through the gap.
+	b2BodyDef bodyDef;
+	bodyDef.type = b2_dynamicBody;
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.5f);
+
+	b2Body* bodies[3];
+	for (int32 i = 0; i < 3; ++i)
+	{
+		bodyDef.position.Set(10.0f * i, 2.0f);
+		bodies[i] = world.CreateBody(&bodyDef);
+		bodies[i]->CreateFixture(&box, 1.0f);
+	}
+
+	world.SetStaticTileBudget(0.0f);
+	for (int32 i = 0; i < 120; ++i)
+	{
+		world.Step(1.0f / 60.0f, 8, 3);
+	}
+
+	CHECK(bodies[0]->GetPosition().y == doctest::Approx(0.5f).epsilon(0.02f));
+	CHECK(bodies[1]->GetPosition().y < -5.0f);
+	CHECK(bodies[2]->GetPosition().y == doctest::Approx(0.5f).epsilon(0.02f));
+
+	// A loaded tile keeps colliding until the next step.
+	world.RemoveStaticTile(tiles[2]);
+	CHECK(world.GetStaticTileList() == tiles[0]);
+	CHECK(world.GetStaticTileQueueCount() == 1);
+	CHECK(CountLayers(&world) == 2);
+
+	bodies[2]->SetAwake(true);
+	for (int32 i = 0; i < 60; ++i)
+	{
+		world.Step(1.0f / 60.0f, 8, 3);
+	}
+
+	CHECK(world.GetStaticTileQueueCount() == 0);
+	CHECK(CountLayers(&world) == 1);
+	CHECK(bodies[0]->GetPosition().y == doctest::Approx(0.5f).epsilon(0.02f));
+	CHECK(bodies[2]->GetPosition().y < -2.0f);
+
+	// Queued tiles follow an origin shift.
+	line[0].Set(5.0f, 0.0f);
+	line[1].Set(-5.0f, 0.0f);
+	def.position.Set(100.0f, 0.0f);
+	b2StaticTile* tile = world.AddStaticTile(&def);
+	world.ShiftOrigin(b2Vec2(50.0f, 0.0f));
+	CHECK(tile->GetPosition() == b2Vec2(50.0f, 0.0f));
+	world.Step(1.0f / 60.0f, 8, 3);
+	CHECK(tile->GetLayer()->GetBody()->GetPosition() == b2Vec2(50.0f, 0.0f));
+
+	// The world frees tiles in any state.
+	world.RemoveStaticTile(tiles[0]);
+	def.position.SetZero();
+	world.AddStaticTile(&def);
+}
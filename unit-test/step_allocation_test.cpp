@@ -0,0 +1,221 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "box2d/box2d.h"
+#include "doctest.h"
+
+// Testbed style scenes. Once warmed up, stepping them must not touch the heap.
+
+static void CreatePyramid(b2World* world)
+{
+	b2BodyDef bd;
+	b2Body* ground = world->CreateBody(&bd);
+
+	b2EdgeShape edge;
+	edge.SetTwoSided(b2Vec2(-40.0f, 0.0f), b2Vec2(40.0f, 0.0f));
+	ground->CreateFixture(&edge, 0.0f);
+
+	b2PolygonShape shape;
+	shape.SetAsBox(0.5f, 0.5f);
+
+	const int32 count = 20;
+	b2Vec2 x(-7.0f, 0.75f);
+	b2Vec2 deltaX(0.5625f, 1.25f);
+	b2Vec2 deltaY(1.125f, 0.0f);
+
+	bd.type = b2_dynamicBody;
+	for (int32 i = 0; i < count; ++i)
+	{
+		b2Vec2 y = x;
+
+		for (int32 j = i; j < count; ++j)
+		{
+			bd.position = y;
+			b2Body* body = world->CreateBody(&bd);
+			body->CreateFixture(&shape, 5.0f);
+			y += deltaY;
+		}
+
+		x += deltaX;
+	}
+}
+
+static void CreateTumbler(b2World* world)
+{
+	b2BodyDef bd;
+	b2Body* ground = world->CreateBody(&bd);
+
+	bd.type = b2_dynamicBody;
+	bd.allowSleep = false;
+	bd.position.Set(0.0f, 10.0f);
+	b2Body* body = world->CreateBody(&bd);
+
+	b2PolygonShape shape;
+	shape.SetAsBox(0.5f, 10.0f, b2Vec2( 10.0f, 0.0f), 0.0);
+	body->CreateFixture(&shape, 5.0f);
+	shape.SetAsBox(0.5f, 10.0f, b2Vec2(-10.0f, 0.0f), 0.0);
+	body->CreateFixture(&shape, 5.0f);
+	shape.SetAsBox(10.0f, 0.5f, b2Vec2(0.0f, 10.0f), 0.0);
+	body->CreateFixture(&shape, 5.0f);
+	shape.SetAsBox(10.0f, 0.5f, b2Vec2(0.0f, -10.0f), 0.0);
+	body->CreateFixture(&shape, 5.0f);
+
+	b2RevoluteJointDef jd;
+	jd.bodyA = ground;
+	jd.bodyB = body;
+	jd.localAnchorA.Set(0.0f, 10.0f);
+	jd.localAnchorB.Set(0.0f, 0.0f);
+	jd.referenceAngle = 0.0f;
+	jd.motorSpeed = 0.05f * b2_pi;
+	jd.maxMotorTorque = 1e8f;
+	jd.enableMotor = true;
+	world->CreateJoint(&jd);
+
+	shape.SetAsBox(0.125f, 0.125f);
+	bd.allowSleep = true;
+	for (int32 i = 0; i < 10; ++i)
+	{
+		for (int32 j = 0; j < 10; ++j)
+		{
+			bd.position.Set(-2.25f + 0.5f * i, 5.25f + 0.5f * j);
+			b2Body* box = world->CreateBody(&bd);
+			box->CreateFixture(&shape, 1.0f);
+		}
+	}
+}
+
+static void CreateBoxes(b2World* world)
+{
+	float groundSize = 25.0f;
+
+	b2BodyDef bd;
+	b2Body* ground = world->CreateBody(&bd);
+
+	b2PolygonShape box;
+	box.SetAsBox(groundSize, 1.2f);
+	ground->CreateFixture(&box, 0.0f);
+
+	bd.angle = 0.5f * b2_pi;
+	bd.position.Set(groundSize, 2.0f * groundSize);
+	ground = world->CreateBody(&bd);
+
+	box.SetAsBox(2.0f * groundSize, 1.2f);
+	ground->CreateFixture(&box, 0.0f);
+
+	bd.position.Set(-groundSize, 2.0f * groundSize);
+	ground = world->CreateBody(&bd);
+	ground->CreateFixture(&box, 0.0f);
+
+	b2FixtureDef sd;
+	sd.density = 1.0f;
+	sd.friction = 0.5f;
+
+	b2PolygonShape cuboid;
+	cuboid.SetAsBox(0.5f, 0.5f);
+	sd.shape = &cuboid;
+
+	const int32 num = 26;
+	float shift = 1.0f;
+	float centerx = shift * num / 2.0f;
+	float centery = shift / 2.0f;
+
+	bd = b2BodyDef();
+	bd.type = b2_dynamicBody;
+	for (int32 i = 0; i < num; ++i)
+	{
+		float x = i * shift - centerx;
+
+		for (int32 j = 0; j < 20; ++j)
+		{
+			bd.position.Set(x, j * shift + centery + 2.0f);
+			b2Body* body = world->CreateBody(&bd);
+			body->CreateFixture(&sd);
+		}
+	}
+}
+
+// Step a scene past warm-up and report the steps that allocated. The warm-up must
+// be long enough for the contact count to reach its peak.
+static void CheckSteadyState(void (*createScene)(b2World*), int32 warmUpCount)
+{
+	b2World world(b2Vec2(0.0f, -10.0f));
+	createScene(&world);
+
+	for (int32 i = 0; i < warmUpCount; ++i)
+	{
+		world.Step(1.0f / 60.0f, 8, 3);
+	}
+
+	for (int32 i = 0; i < 240; ++i)
+	{
+		int32 allocationCount = b2GetAllocationCount();
+		world.Step(1.0f / 60.0f, 8, 3);
+
+		INFO("step ", warmUpCount + i);
+		CHECK(b2GetAllocationCount() == allocationCount);
+		CHECK(world.GetProfile().heapAllocations == 0);
+		CHECK(world.GetProfile().stackFallbacks == 0);
+	}
+}
+
+DOCTEST_TEST_CASE("zero allocation step")
+{
+	SUBCASE("pyramid")
+	{
+		CheckSteadyState(CreatePyramid, 120);
+	}
+
+	SUBCASE("tumbler")
+	{
+		// The pile keeps finding new contacts until the container has turned a while
+		CheckSteadyState(CreateTumbler, 1000);
+	}
+
+	SUBCASE("boxes")
+	{
+		CheckSteadyState(CreateBoxes, 120);
+	}
+}
+
+DOCTEST_TEST_CASE("allocation counter")
+{
+	int32 allocationCount = b2GetAllocationCount();
+	int32 liveCount = b2GetLiveAllocationCount();
+
+	void* p = b2Alloc(100);
+	CHECK(b2GetAllocationCount() == allocationCount + 1);
+	CHECK(b2GetLiveAllocationCount() == liveCount + 1);
+
+	b2Free(p);
+	CHECK(b2GetAllocationCount() == allocationCount + 1);
+	CHECK(b2GetLiveAllocationCount() == liveCount);
+
+	{
+		b2World world(b2Vec2(0.0f, -10.0f));
+		CreatePyramid(&world);
+		world.Step(1.0f / 60.0f, 8, 3);
+		CHECK(world.GetProfile().heapAllocations > 0);
+	}
+
+	// The world releases everything it allocated
+	CHECK(b2GetLiveAllocationCount() == liveCount);
+}
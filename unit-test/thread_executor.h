@@ -0,0 +1,59 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef THREAD_EXECUTOR_H
+#define THREAD_EXECUTOR_H
+
+#include "box2d/b2_math.h"
+#include "box2d/b2_task.h"
+
+#include <thread>
+
+// Runs each range on its own thread, so tasks see several thread indices and allocator caches.
+class ThreadExecutor : public b2TaskExecutor
+{
+public:
+	int32 GetThreadCount() const override
+	{
+		return 4;
+	}
+
+	void ParallelFor(b2Task* task, int32 itemCount, int32 minRange) override
+	{
+		int32 rangeSize = b2Max(minRange, (itemCount + 3) / 4);
+		std::thread threads[4];
+		int32 threadCount = 0;
+		for (int32 start = 0; start < itemCount; start += rangeSize)
+		{
+			int32 end = b2Min(start + rangeSize, itemCount);
+			int32 threadIndex = threadCount;
+			threads[threadCount++] = std::thread([=]() { task->Execute(start, end, threadIndex); });
+		}
+
+		for (int32 i = 0; i < threadCount; ++i)
+		{
+			threads[i].join();
+		}
+	}
+};
+
+#endif
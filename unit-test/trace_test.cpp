@@ -0,0 +1,104 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "box2d/box2d.h"
+#include "box2d/b2_trace.h"
+#include "doctest.h"
+
+#include <stdio.h>
+#include <string.h>
+
+DOCTEST_TEST_CASE("trace ring buffer")
+{
+	b2TraceClear();
+	CHECK(b2TraceGetEventCount() == 0);
+
+	{
+		b2TraceScope outer("outer");
+		b2TraceBegin("inner");
+		b2TraceEnd("inner");
+	}
+
+	CHECK(b2TraceGetEventCount() == 4);
+
+	const char* fileName = "trace_test.json";
+	CHECK(b2TraceWrite(fileName));
+
+	FILE* file = fopen(fileName, "r");
+	REQUIRE(file != nullptr);
+
+	char buffer[1024];
+	size_t length = fread(buffer, 1, sizeof(buffer) - 1, file);
+	buffer[length] = 0;
+	fclose(file);
+	remove(fileName);
+
+	CHECK(strstr(buffer, "\"traceEvents\"") != nullptr);
+	CHECK(strstr(buffer, "{\"name\": \"outer\", \"ph\": \"B\", \"ts\": 0.000") != nullptr);
+	CHECK(strstr(buffer, "{\"name\": \"inner\", \"ph\": \"E\"") != nullptr);
+
+	// Old events are overwritten once the buffer is full
+	for (int32 i = 0; i < b2_traceCapacity; ++i)
+	{
+		b2TraceBegin("fill");
+	}
+
+	CHECK(b2TraceGetEventCount() == b2_traceCapacity);
+
+	b2TraceClear();
+	CHECK(b2TraceGetEventCount() == 0);
+}
+
+DOCTEST_TEST_CASE("timer")
+{
+	b2Timer timer;
+
+	// The clock is monotonic and advances in less than a millisecond
+	unsigned long long previous = timer.GetNanoseconds();
+	unsigned long long advance = 0;
+	for (int32 i = 0; i < 1000000 && advance == 0; ++i)
+	{
+		unsigned long long nanoseconds = timer.GetNanoseconds();
+		CHECK(nanoseconds >= previous);
+		advance = nanoseconds - previous;
+		previous = nanoseconds;
+	}
+
+	CHECK(advance > 0);
+	CHECK(advance < 1000000);
+
+	// The later reading is larger up to float rounding
+	float ms = timer.GetMilliseconds();
+	float us = timer.GetMicroseconds();
+	CHECK(us >= 0.999f * 1000.0f * ms);
+
+	b2CycleTimer cycleTimer;
+	unsigned long long cycles = cycleTimer.GetCycles();
+	b2Timer wait;
+	while (wait.GetMicroseconds() < 10.0f)
+	{
+	}
+	CHECK(cycleTimer.GetCycles() > cycles);
+
+	timer.Reset();
+	CHECK(timer.GetMilliseconds() < ms + 1.0f);
+}
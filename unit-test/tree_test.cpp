@@ -0,0 +1,167 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "box2d/box2d.h"
+#include "box2d/b2_compact_tree.h"
+#include "doctest.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Collects every proxy reported by a query or ray-cast without clipping.
+struct TreeCallback
+{
+	TreeCallback()
+	{
+		memset(hits, 0, sizeof(hits));
+		count = 0;
+	}
+
+	bool QueryCallback(int32 proxyId)
+	{
+		REQUIRE(proxyId < 4096);
+		hits[proxyId] += 1;
+		count += 1;
+		return true;
+	}
+
+	float RayCastCallback(const b2RayCastInput& input, int32 proxyId)
+	{
+		REQUIRE(proxyId < 4096);
+		hits[proxyId] += 1;
+		count += 1;
+		return input.maxFraction;
+	}
+
+	int32 hits[4096];
+	int32 count;
+};
+
+static float RandomFloat(float lo, float hi)
+{
+	float r = (float)(rand() & (RAND_MAX));
+	r /= RAND_MAX;
+	r = (hi - lo) * r + lo;
+	return r;
+}
+
+static b2AABB RandomAABB(float extent, float size)
+{
+	b2AABB aabb;
+	aabb.lowerBound.Set(RandomFloat(-extent, extent), RandomFloat(-extent, extent));
+	aabb.upperBound = aabb.lowerBound + b2Vec2(RandomFloat(0.0f, size), RandomFloat(0.0f, size));
+	return aabb;
+}
+
+DOCTEST_TEST_CASE("compact tree")
+{
+	srand(888);
+
+	b2DynamicTree tree;
+	b2CompactTree compact;
+
+	SUBCASE("empty and single proxy")
+	{
+		compact.Build(&tree);
+		CHECK(compact.GetNodeCount() == 0);
+
+		b2AABB aabb;
+		aabb.lowerBound.Set(-1.0f, -1.0f);
+		aabb.upperBound.Set(1.0f, 1.0f);
+		int32 proxyId = tree.CreateProxy(aabb, nullptr);
+		compact.Build(&tree);
+		CHECK(compact.GetNodeCount() == 1);
+
+		TreeCallback callback;
+		compact.Query(&callback, aabb);
+		CHECK(callback.count == 1);
+		CHECK(callback.hits[proxyId] == 1);
+	}
+
+	SUBCASE("matches dynamic tree")
+	{
+		const int32 proxyCount = 1000;
+		int32 proxies[proxyCount];
+		for (int32 i = 0; i < proxyCount; ++i)
+		{
+			proxies[i] = tree.CreateProxy(RandomAABB(1000.0f, 5.0f), nullptr);
+		}
+
+		// Remove some proxies so the id space has holes.
+		for (int32 i = 0; i < proxyCount; i += 7)
+		{
+			tree.DestroyProxy(proxies[i]);
+		}
+
+		compact.Build(&tree);
+		CHECK(compact.GetNodeCount() > 0);
+		CHECK(compact.GetNodeCount() < proxyCount / 2);
+
+		for (int32 i = 0; i < 100; ++i)
+		{
+			b2AABB aabb = RandomAABB(1000.0f, 100.0f);
+
+			TreeCallback expected, actual;
+			tree.Query(&expected, aabb);
+			compact.Query(&actual, aabb);
+
+			CHECK(expected.count == actual.count);
+			CHECK(memcmp(expected.hits, actual.hits, sizeof(expected.hits)) == 0);
+		}
+
+		for (int32 i = 0; i < 100; ++i)
+		{
+			b2RayCastInput input;
+			input.p1.Set(RandomFloat(-1000.0f, 1000.0f), RandomFloat(-1000.0f, 1000.0f));
+			input.p2.Set(RandomFloat(-1000.0f, 1000.0f), RandomFloat(-1000.0f, 1000.0f));
+			input.maxFraction = 1.0f;
+
+			TreeCallback expected, actual;
+			tree.RayCast(&expected, input);
+			compact.RayCast(&actual, input);
+
+			CHECK(expected.count == actual.count);
+			CHECK(memcmp(expected.hits, actual.hits, sizeof(expected.hits)) == 0);
+		}
+
+		// Move proxies and refit instead of rebuilding.
+		for (int32 i = 1; i < proxyCount; i += 7)
+		{
+			b2AABB aabb = RandomAABB(1000.0f, 5.0f);
+			tree.MoveProxy(proxies[i], aabb);
+		}
+
+		compact.Refit();
+
+		for (int32 i = 0; i < 100; ++i)
+		{
+			b2AABB aabb = RandomAABB(1000.0f, 100.0f);
+
+			TreeCallback expected, actual;
+			tree.Query(&expected, aabb);
+			compact.Query(&actual, aabb);
+
+			CHECK(expected.count == actual.count);
+			CHECK(memcmp(expected.hits, actual.hits, sizeof(expected.hits)) == 0);
+		}
+	}
+}
@@ -24,6 +24,8 @@
 #include "doctest.h"
 #include <stdio.h>
 
+extern B2_API int32 b2_toiCalls;
+
 static bool begin_contact = false;
 
 class MyContactListener : public b2ContactListener
@@ -71,3 +73,412 @@ DOCTEST_TEST_CASE("begin contact")
 	CHECK(world.GetContactList() != nullptr);
 	CHECK(begin_contact == true);
 }
+
+DOCTEST_TEST_CASE("shift origin")
+{
+	b2World world({ 0.0f, 0.0f });
+
+	b2BodyDef bodyDef;
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.position.Set(5000.25f, -3000.5f);
+	b2Body* body = world.CreateBody(&bodyDef);
+
+	b2CircleShape circle;
+	circle.m_radius = 0.5f;
+	body->CreateFixture(&circle, 1.0f);
+
+	world.Step(1.0f / 60.0f, 8, 3);
+	world.ShiftOrigin(b2Vec2(5000.0f, -3000.0f));
+
+	CHECK(body->GetPosition().x == 0.25f);
+	CHECK(body->GetPosition().y == -0.5f);
+
+	// The broad-phase proxy moved with the body.
+	world.Step(1.0f / 60.0f, 8, 3);
+	b2AABB aabb = body->GetFixtureList()->GetAABB(0);
+	CHECK(aabb.lowerBound.x < 0.25f);
+	CHECK(aabb.upperBound.x > 0.25f);
+	CHECK(aabb.lowerBound.y < -0.5f);
+	CHECK(aabb.upperBound.y > -0.5f);
+}
+
+DOCTEST_TEST_CASE("stack allocator growth")
+{
+	b2StackAllocator allocator;
+	CHECK(allocator.GetCapacity() == b2_stackSize);
+
+	void* a = allocator.Allocate(b2_stackSize / 2);
+	void* b = allocator.Allocate(b2_stackSize);
+	CHECK(allocator.GetFallbackCount() == 1);
+	allocator.Free(b);
+	allocator.Free(a);
+
+	allocator.Grow();
+	CHECK(allocator.GetCapacity() >= allocator.GetMaxAllocation());
+
+	a = allocator.Allocate(b2_stackSize / 2);
+	b = allocator.Allocate(b2_stackSize);
+	CHECK(allocator.GetFallbackCount() == 1);
+	allocator.Free(b);
+	allocator.Free(a);
+
+	// A large pile overflows the initial arena on the first steps only
+	b2World world({ 0.0f, -10.0f });
+
+	b2BodyDef bodyDef;
+	b2Body* ground = world.CreateBody(&bodyDef);
+
+	b2EdgeShape edge;
+	edge.SetTwoSided(b2Vec2(-40.0f, 0.0f), b2Vec2(40.0f, 0.0f));
+	ground->CreateFixture(&edge, 0.0f);
+
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.5f);
+
+	bodyDef.type = b2_dynamicBody;
+	for (int32 i = 0; i < 30; ++i)
+	{
+		for (int32 j = 0; j < 20; ++j)
+		{
+			bodyDef.position.Set(1.0f * i - 15.0f, 0.5f + 1.0f * j);
+			b2Body* body = world.CreateBody(&bodyDef);
+			body->CreateFixture(&box, 1.0f);
+		}
+	}
+
+	int32 fallbacks = 0;
+	for (int32 i = 0; i < 10; ++i)
+	{
+		world.Step(1.0f / 60.0f, 8, 3);
+		fallbacks += world.GetProfile().stackFallbacks;
+	}
+
+	CHECK(fallbacks > 0);
+
+	for (int32 i = 0; i < 10; ++i)
+	{
+		world.Step(1.0f / 60.0f, 8, 3);
+		CHECK(world.GetProfile().stackFallbacks == 0);
+	}
+}
+
+DOCTEST_TEST_CASE("islands sharing ground")
+{
+	b2World world({ 0.0f, -10.0f });
+
+	b2BodyDef bodyDef;
+	b2Body* ground = world.CreateBody(&bodyDef);
+
+	b2EdgeShape edge;
+	edge.SetTwoSided(b2Vec2(-40.0f, 0.0f), b2Vec2(40.0f, 0.0f));
+	ground->CreateFixture(&edge, 0.0f);
+
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.5f);
+
+	// Separate boxes and a jointed pair, each its own island touching the same ground
+	const int32 count = 8;
+	b2Body* bodies[count];
+	bodyDef.type = b2_dynamicBody;
+	for (int32 i = 0; i < count; ++i)
+	{
+		bodyDef.position.Set(3.0f * i - 12.0f, 0.75f);
+		bodies[i] = world.CreateBody(&bodyDef);
+		bodies[i]->CreateFixture(&box, 1.0f);
+	}
+
+	bodyDef.position.Set(20.0f, 2.0f);
+	b2Body* top = world.CreateBody(&bodyDef);
+	top->CreateFixture(&box, 1.0f);
+
+	b2DistanceJointDef jointDef;
+	jointDef.Initialize(bodies[count - 1], top, bodies[count - 1]->GetPosition(), top->GetPosition());
+	world.CreateJoint(&jointDef);
+
+	for (int32 i = 0; i < 120; ++i)
+	{
+		world.Step(1.0f / 60.0f, 8, 3);
+	}
+
+	for (int32 i = 0; i < count; ++i)
+	{
+		CHECK(bodies[i]->GetPosition().y == doctest::Approx(0.5f).epsilon(0.02f));
+	}
+
+	CHECK(b2Distance(top->GetPosition(), bodies[count - 1]->GetPosition()) == doctest::Approx(jointDef.length).epsilon(0.02f));
+}
+
+DOCTEST_TEST_CASE("profile counters")
+{
+	b2World world(b2Vec2(0.0f, -10.0f));
+
+	b2BodyDef bodyDef;
+	b2Body* ground = world.CreateBody(&bodyDef);
+
+	b2EdgeShape edge;
+	edge.SetTwoSided(b2Vec2(-40.0f, 0.0f), b2Vec2(40.0f, 0.0f));
+	ground->CreateFixture(&edge, 0.0f);
+
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.5f);
+
+	// Resting boxes, each its own island
+	const int32 count = 8;
+	bodyDef.type = b2_dynamicBody;
+	for (int32 i = 0; i < count; ++i)
+	{
+		bodyDef.position.Set(3.0f * i - 12.0f, 0.5f);
+		b2Body* body = world.CreateBody(&bodyDef);
+		body->CreateFixture(&box, 1.0f);
+	}
+
+	// The count is kept per world, the global counts all worlds
+	int32 toiCalls = b2_toiCalls;
+	world.Step(1.0f / 60.0f, 8, 3);
+
+	const b2Profile& profile = world.GetProfile();
+	CHECK(profile.toiCalls == b2_toiCalls - toiCalls);
+	CHECK(profile.awakeBodyCount == count);
+	CHECK(profile.islandCount == count);
+	CHECK(profile.touchingContactCount == count);
+	CHECK(profile.pairCount == count);
+	CHECK(profile.movedProxyCount >= count);
+	CHECK(profile.toiCalls >= count);
+	CHECK(profile.stackHighWater > 0);
+	CHECK(profile.buildIslands >= 0.0f);
+	CHECK(profile.synchronizeFixtures <= profile.broadphase);
+
+	world.Step(1.0f / 60.0f, 8, 3);
+
+	// Nothing left its fat AABB
+	CHECK(profile.movedProxyCount == 0);
+	CHECK(profile.pairCount == 0);
+
+	for (int32 i = 0; i < 60; ++i)
+	{
+		world.Step(1.0f / 60.0f, 8, 3);
+	}
+
+	// Everything is asleep
+	CHECK(profile.awakeBodyCount == 0);
+	CHECK(profile.islandCount == 0);
+	CHECK(profile.touchingContactCount == 0);
+	CHECK(profile.toiCalls == 0);
+}
+
+DOCTEST_TEST_CASE("sub-stepping stack")
+{
+	b2World world(b2Vec2(0.0f, -10.0f));
+	world.SetSubStepping(true);
+
+	b2BodyDef bodyDef;
+	b2Body* ground = world.CreateBody(&bodyDef);
+
+	b2EdgeShape edge;
+	edge.SetTwoSided(b2Vec2(-40.0f, 0.0f), b2Vec2(40.0f, 0.0f));
+	ground->CreateFixture(&edge, 0.0f);
+
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.5f);
+
+	b2FixtureDef fixtureDef;
+	fixtureDef.shape = &box;
+	fixtureDef.density = 1.0f;
+	fixtureDef.friction = 0.6f;
+
+	const int32 count = 20;
+	b2Body* top = nullptr;
+	bodyDef.type = b2_dynamicBody;
+	for (int32 i = 0; i < count; ++i)
+	{
+		bodyDef.position.Set(0.0f, 0.5f + 1.0f * i);
+		top = world.CreateBody(&bodyDef);
+		top->CreateFixture(&fixtureDef);
+	}
+
+	// Four sub-steps keep a tall stack standing without sagging
+	for (int32 i = 0; i < 300; ++i)
+	{
+		world.Step(1.0f / 60.0f, 4, 0);
+	}
+
+	b2Vec2 p = top->GetPosition();
+	CHECK(p.y > 0.5f + 1.0f * (count - 1) - 0.1f);
+	CHECK(p.y < 0.5f + 1.0f * count);
+	CHECK(b2Abs(p.x) < 1.0f);
+}
+
+DOCTEST_TEST_CASE("sleeping islands")
+{
+	b2World world(b2Vec2(0.0f, -10.0f));
+
+	b2BodyDef bodyDef;
+	b2Body* ground = world.CreateBody(&bodyDef);
+
+	b2EdgeShape edge;
+	edge.SetTwoSided(b2Vec2(-40.0f, 0.0f), b2Vec2(40.0f, 0.0f));
+	ground->CreateFixture(&edge, 0.0f);
+
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.5f);
+
+	// Two stacks, each its own island
+	const int32 count = 5;
+	b2Body* stacks[2][count];
+	bodyDef.type = b2_dynamicBody;
+	for (int32 i = 0; i < 2; ++i)
+	{
+		for (int32 j = 0; j < count; ++j)
+		{
+			bodyDef.position.Set(10.0f * i - 5.0f, 0.5f + 1.0f * j);
+			stacks[i][j] = world.CreateBody(&bodyDef);
+			stacks[i][j]->CreateFixture(&box, 1.0f);
+		}
+	}
+
+	for (int32 i = 0; i < 240; ++i)
+	{
+		world.Step(1.0f / 60.0f, 8, 3);
+	}
+
+	CHECK(world.GetSleepingIslandCount() == 2);
+	for (int32 j = 0; j < count; ++j)
+	{
+		CHECK(stacks[0][j]->IsAwake() == false);
+		CHECK(stacks[1][j]->IsAwake() == false);
+	}
+
+	// A restored world keeps the islands
+	b2World* clone = world.Clone();
+	CHECK(clone->GetSleepingIslandCount() == 2);
+	delete clone;
+
+	// Waking one body wakes its whole island at once
+	stacks[0][0]->SetAwake(true);
+	CHECK(world.GetSleepingIslandCount() == 1);
+	for (int32 j = 0; j < count; ++j)
+	{
+		CHECK(stacks[0][j]->IsAwake() == true);
+		CHECK(stacks[1][j]->IsAwake() == false);
+	}
+
+	// Destroying a sleeping body wakes the rest of its island
+	world.DestroyBody(stacks[1][2]);
+	CHECK(world.GetSleepingIslandCount() == 0);
+	CHECK(stacks[1][0]->IsAwake() == true);
+	CHECK(stacks[1][4]->IsAwake() == true);
+
+	for (int32 i = 0; i < 240; ++i)
+	{
+		world.Step(1.0f / 60.0f, 8, 3);
+	}
+
+	// The top of the second stack landed on its bottom
+	CHECK(world.GetSleepingIslandCount() == 2);
+
+	// A falling box wakes the stack it lands on, all the way to the ground
+	bodyDef.position.Set(-5.0f, 8.0f);
+	b2Body* crate = world.CreateBody(&bodyDef);
+	crate->CreateFixture(&box, 1.0f);
+
+	int32 stepCount = 0;
+	while (stacks[0][count - 1]->IsAwake() == false && stepCount < 120)
+	{
+		world.Step(1.0f / 60.0f, 8, 3);
+		++stepCount;
+	}
+
+	CHECK(stepCount < 120);
+	CHECK(stacks[0][0]->IsAwake() == true);
+	CHECK(world.GetSleepingIslandCount() == 1);
+
+	// A joint made while the island sleeps is found when the island wakes, even
+	// though the island is entered from another body
+	bodyDef.position.Set(7.0f, 0.5f);
+	bodyDef.awake = false;
+	b2Body* anchor = world.CreateBody(&bodyDef);
+	anchor->CreateFixture(&box, 1.0f);
+
+	b2DistanceJointDef jointDef;
+	jointDef.Initialize(stacks[1][0], anchor, stacks[1][0]->GetPosition(), anchor->GetPosition());
+	world.CreateJoint(&jointDef);
+
+	stacks[1][4]->SetAwake(true);
+	CHECK(world.GetSleepingIslandCount() == 0);
+	CHECK(anchor->IsAwake() == false);
+
+	// A restored world continues the same way
+	clone = world.Clone();
+	world.Step(1.0f / 60.0f, 8, 3);
+	clone->Step(1.0f / 60.0f, 8, 3);
+	CHECK(anchor->IsAwake() == true);
+	CHECK(clone->GetBodyList()->IsAwake() == true);
+	CHECK(clone->GetBodyList()->GetPosition() == anchor->GetPosition());
+	delete clone;
+}
+
+DOCTEST_TEST_CASE("awake bodies")
+{
+	b2World world(b2Vec2(0.0f, -10.0f));
+
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.5f);
+
+	// Only awake bodies start islands, so every way of waking a body must keep it simulated
+	b2BodyDef bodyDef;
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.awake = false;
+	bodyDef.position.Set(0.0f, 10.0f);
+	b2Body* body = world.CreateBody(&bodyDef);
+	body->CreateFixture(&box, 1.0f);
+
+	world.Step(1.0f / 60.0f, 8, 3);
+	CHECK(world.GetProfile().awakeBodyCount == 0);
+	CHECK(body->GetPosition().y == 10.0f);
+
+	body->SetAwake(true);
+	world.Step(1.0f / 60.0f, 8, 3);
+	CHECK(world.GetProfile().awakeBodyCount == 1);
+	CHECK(body->GetPosition().y < 10.0f);
+
+	// A disabled body keeps its awake flag but is not simulated
+	body->SetEnabled(false);
+	float y = body->GetPosition().y;
+	world.Step(1.0f / 60.0f, 8, 3);
+	CHECK(world.GetProfile().awakeBodyCount == 0);
+	CHECK(body->GetPosition().y == y);
+
+	body->SetEnabled(true);
+	world.Step(1.0f / 60.0f, 8, 3);
+	CHECK(world.GetProfile().awakeBodyCount == 1);
+	CHECK(body->GetPosition().y < y);
+
+	body->SetType(b2_staticBody);
+	y = body->GetPosition().y;
+	world.Step(1.0f / 60.0f, 8, 3);
+	CHECK(world.GetProfile().awakeBodyCount == 0);
+	CHECK(body->GetPosition().y == y);
+
+	body->SetType(b2_dynamicBody);
+	world.Step(1.0f / 60.0f, 8, 3);
+	CHECK(world.GetProfile().awakeBodyCount == 1);
+	CHECK(body->GetPosition().y < y);
+
+	// A restored world starts its islands from the same bodies
+	bodyDef.awake = true;
+	bodyDef.position.Set(2.0f, 10.0f);
+	b2Body* other = world.CreateBody(&bodyDef);
+	other->CreateFixture(&box, 1.0f);
+
+	b2World* clone = world.Clone();
+	world.Step(1.0f / 60.0f, 8, 3);
+	clone->Step(1.0f / 60.0f, 8, 3);
+	CHECK(clone->GetProfile().awakeBodyCount == 2);
+	CHECK(clone->ComputeStateHash() == world.ComputeStateHash());
+	delete clone;
+
+	world.DestroyBody(body);
+	world.Step(1.0f / 60.0f, 8, 3);
+	CHECK(world.GetProfile().awakeBodyCount == 1);
+	CHECK(other->GetPosition().y < 10.0f);
+}